@@ -0,0 +1,442 @@
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <brooks/brooks_doc.h>
+#include <brooks/brooks_misc.h>
+#include <brooks/brooks_pool.h>
+#include <brooks/query/brooks_cursor.h>
+#include <brooks/query/brooks_operator.h>
+#include <brooks/query/operators/scans/brooks_scan_arrays.h>
+#include <brooks/query/operators/scans/brooks_scan_objects.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC 1
+#else
+#define BENCH_HAS_TSC 0
+#endif
+
+#define BENCH_DEFAULT_MAX_SIZE          10000000
+#define BENCH_DEFAULT_REPETITIONS       10
+#define BENCH_DEFAULT_WARMUP            2
+#define BENCH_DEFAULT_MIN_TIME_NS       2000000     // per repetition; small sizes are batched up to this
+#define BENCH_MAX_REPETITIONS           64
+#define BENCH_NUM_KEYS                  1024
+
+/**
+ * Micro benchmarks for the hot internal primitives. Every benchmark processes 'n' elements per run (e.g., 'n' calls
+ * to brooks_pool_malloc, or one scan over 'n' values). A repetition sets up a fresh context, runs the benchmark as
+ * often as needed to last BENCH_DEFAULT_MIN_TIME_NS, and tears the context down; only the runs are timed. After
+ * warmup repetitions, the reported figures are mean, median and 95% confidence interval of the time per element, and
+ * the time stamp counter ticks per element where available.
+ */
+typedef struct bench_ctx_t
+{
+    brooks_pool_t *pool;
+    brooks_object_t *object;
+    brooks_array_t *array;
+    brooks_cursor_t *cursor;
+    const brooks_value_t **values;
+    brooks_operator_t opp;
+    FILE *sink;
+    uint64_t digest;
+} bench_ctx_t;
+
+typedef struct bench_t
+{
+    const char *name;
+    void (*setup)(bench_ctx_t *ctx, size_t n);
+    void (*run)(bench_ctx_t *ctx, size_t n);
+    void (*teardown)(bench_ctx_t *ctx);
+} bench_t;
+
+typedef struct bench_config_t
+{
+    const char *filter;
+    size_t min_size;
+    size_t max_size;
+    unsigned repetitions;
+    unsigned warmup;
+    uint64_t min_time_ns;
+    bool json;
+} bench_config_t;
+
+typedef struct bench_result_t
+{
+    const char *name;
+    size_t n;
+    size_t batch;
+    unsigned repetitions;
+    double mean_ns;
+    double median_ns;
+    double ci95_ns;
+    double ticks;
+    uint64_t digest;
+} bench_result_t;
+
+static char bench_keys[BENCH_NUM_KEYS][16];
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T I M I N G
+// ---------------------------------------------------------------------------------------------------------------------
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+static uint64_t bench_ticks(void)
+{
+#if BENCH_HAS_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Two-sided 95% quantile of Student's t distribution for 'df' degrees of freedom
+static double bench_student_t95(unsigned df)
+{
+    static const double table[] = {
+        0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228, 2.201, 2.179, 2.160, 2.145,
+        2.131, 2.120, 2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    return (df < sizeof(table) / sizeof(table[0]) ? table[df] : (df < 60 ? 2.000 : 1.960));
+}
+
+static int bench_compare_double(const void *lhs, const void *rhs)
+{
+    double a = *(const double *) lhs, b = *(const double *) rhs;
+    return (a > b) - (a < b);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// B E N C H M A R K S
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void setup_pool(bench_ctx_t *ctx, size_t n)
+{
+    brooks_pool_create(&ctx->pool);
+}
+
+static void teardown_pool(bench_ctx_t *ctx)
+{
+    brooks_pool_dispose(ctx->pool);
+}
+
+static void run_pool_malloc(bench_ctx_t *ctx, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint64_t *block = brooks_pool_malloc(ctx->pool, sizeof(uint64_t));
+        *block = i;
+        ctx->digest += (uintptr_t) block & 0xff;
+    }
+}
+
+static void run_pooled_autoresize(bench_ctx_t *ctx, size_t n)
+{
+    size_t capacity = 1;
+    uint64_t *base = brooks_pool_malloc(ctx->pool, capacity * sizeof(uint64_t));
+    for (size_t i = 0; i < n; i++) {
+        base = brooks_misc_pooled_autoresize(ctx->pool, base, sizeof(uint64_t), i, &capacity, 1,
+                                             brooks_pool_category_other);
+        base[i] = i;
+    }
+    ctx->digest += base[n - 1];
+}
+
+static void run_strdup(bench_ctx_t *ctx, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        ctx->digest += (uint64_t) *brooks_misc_strdup(ctx->pool, bench_keys[i % BENCH_NUM_KEYS]);
+    }
+}
+
+// brooks_doc_add_integer is the public entry to property_add
+static void run_property_add(bench_ctx_t *ctx, size_t n)
+{
+    brooks_object_t *object;
+    brooks_doc_create(&object, ctx->pool);
+    for (uint64_t i = 0; i < n; i++) {
+        brooks_doc_add_integer(object, bench_keys[i % BENCH_NUM_KEYS], &i);
+    }
+    ctx->digest += brooks_doc_object_num_elements(object);
+}
+
+static void run_add_value(bench_ctx_t *ctx, size_t n)
+{
+    brooks_object_t *object;
+    brooks_array_t *array;
+    brooks_doc_create(&object, ctx->pool);
+    brooks_doc_add_array(&array, object, brooks_type_number_integer, "values");
+    for (uint64_t i = 0; i < n; i++) {
+        brooks_doc_add_value(array, &i);
+    }
+    ctx->digest += brooks_doc_array_get_length(array);
+}
+
+static void setup_cursor_append(bench_ctx_t *ctx, size_t n)
+{
+    uint64_t one = 1;
+    brooks_pool_create(&ctx->pool);
+    brooks_doc_create(&ctx->object, ctx->pool);
+    brooks_doc_add_integer(ctx->object, "one", &one);
+    brooks_cursor_create(&ctx->cursor, 16, ctx->pool);
+    const brooks_value_t *value = brooks_doc_object_get_value(ctx->object, 0);
+    ctx->values = malloc(n * sizeof(brooks_value_t *));
+    for (size_t i = 0; i < n; i++) {
+        ctx->values[i] = value;
+    }
+}
+
+static void teardown_cursor_append(bench_ctx_t *ctx)
+{
+    free(ctx->values);
+    brooks_cursor_dispose(ctx->cursor);
+    brooks_pool_dispose(ctx->pool);
+}
+
+// One value per call, as appended by the operators and index lookups
+static void run_cursor_append(bench_ctx_t *ctx, size_t n)
+{
+    size_t num_values;
+    brooks_cursor_clear(ctx->cursor);
+    for (size_t i = 0; i < n; i++) {
+        brooks_cursor_append(ctx->cursor, ctx->values + i, 1);
+    }
+    brooks_cursor_read(&num_values, ctx->cursor);
+    ctx->digest += num_values;
+}
+
+static void setup_integers(bench_ctx_t *ctx, size_t n)
+{
+    brooks_pool_create(&ctx->pool);
+    brooks_doc_create(&ctx->object, ctx->pool);
+    brooks_doc_add_array(&ctx->array, ctx->object, brooks_type_number_integer, "values");
+    for (uint64_t i = 0; i < n; i++) {
+        brooks_doc_add_value(ctx->array, &i);
+    }
+}
+
+static void setup_scan_arrays(bench_ctx_t *ctx, size_t n)
+{
+    setup_integers(ctx, n);
+    brooks_operators_scan_arrays_create(&ctx->opp, &ctx->array, 1, ctx->pool);
+}
+
+static void setup_scan_objects(bench_ctx_t *ctx, size_t n)
+{
+    brooks_pool_create(&ctx->pool);
+    brooks_doc_create(&ctx->object, ctx->pool);
+    for (uint64_t i = 0; i < n; i++) {
+        brooks_doc_add_integer(ctx->object, bench_keys[i % BENCH_NUM_KEYS], &i);
+    }
+    brooks_operators_scan_objects_create(&ctx->opp, &ctx->object, 1, ctx->pool);
+}
+
+static void teardown_scan(bench_ctx_t *ctx)
+{
+    brooks_operator_close(&ctx->opp);
+    brooks_pool_dispose(ctx->pool);
+}
+
+static void run_scan(bench_ctx_t *ctx, size_t n)
+{
+    const brooks_cursor_t *cursor;
+    size_t num_values;
+    brooks_operator_open(&ctx->opp);
+    while ((cursor = brooks_operator_next(&ctx->opp)) != NULL) {
+        brooks_cursor_read(&num_values, cursor);
+        ctx->digest += num_values;
+    }
+}
+
+static void setup_print(bench_ctx_t *ctx, size_t n)
+{
+    setup_integers(ctx, n);
+    ctx->sink = tmpfile();
+}
+
+static void teardown_print(bench_ctx_t *ctx)
+{
+    fclose(ctx->sink);
+    brooks_pool_dispose(ctx->pool);
+}
+
+static void run_print(bench_ctx_t *ctx, size_t n)
+{
+    rewind(ctx->sink);
+    brooks_doc_print(ctx->sink, ctx->object);
+    ctx->digest += (uint64_t) ftell(ctx->sink);
+}
+
+static const bench_t benchmarks[] = {
+    { "pool_malloc",        setup_pool,           run_pool_malloc,       teardown_pool },
+    { "pooled_autoresize",  setup_pool,           run_pooled_autoresize, teardown_pool },
+    { "strdup",             setup_pool,           run_strdup,            teardown_pool },
+    { "property_add",       setup_pool,           run_property_add,      teardown_pool },
+    { "add_value",          setup_pool,           run_add_value,         teardown_pool },
+    { "cursor_append",      setup_cursor_append,  run_cursor_append,     teardown_cursor_append },
+    { "scan_arrays_next",   setup_scan_arrays,    run_scan,              teardown_scan },
+    { "scan_objects_next",  setup_scan_objects,   run_scan,              teardown_scan },
+    { "print",              setup_print,          run_print,             teardown_print }
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+// D R I V E R
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void bench_measure(bench_result_t *result, const bench_t *bench, size_t n, const bench_config_t *config)
+{
+    bench_ctx_t ctx = { .digest = 0 };
+    double per_element[BENCH_MAX_REPETITIONS];
+    double ticks_sum = 0;
+
+    // calibrate the number of runs per repetition on a single run
+    bench->setup(&ctx, n);
+    uint64_t begin = bench_now_ns();
+    bench->run(&ctx, n);
+    uint64_t elapsed = bench_now_ns() - begin;
+    bench->teardown(&ctx);
+    size_t batch = (elapsed >= config->min_time_ns ? 1 : (size_t) (config->min_time_ns / (elapsed + 1)) + 1);
+
+    for (unsigned rep = 0; rep < config->warmup + config->repetitions; rep++) {
+        ctx = (bench_ctx_t) { .digest = ctx.digest };
+        bench->setup(&ctx, n);
+        uint64_t ticks = bench_ticks();
+        begin = bench_now_ns();
+        for (size_t i = 0; i < batch; i++) {
+            bench->run(&ctx, n);
+        }
+        elapsed = bench_now_ns() - begin;
+        ticks = bench_ticks() - ticks;
+        bench->teardown(&ctx);
+
+        if (rep >= config->warmup) {
+            per_element[rep - config->warmup] = (double) elapsed / ((double) batch * n);
+            ticks_sum += (double) ticks / ((double) batch * n);
+        }
+    }
+
+    unsigned num = config->repetitions;
+    double sum = 0, squares = 0;
+    for (unsigned i = 0; i < num; i++) {
+        sum += per_element[i];
+    }
+    double mean = sum / num;
+    for (unsigned i = 0; i < num; i++) {
+        squares += (per_element[i] - mean) * (per_element[i] - mean);
+    }
+    double stddev = (num > 1 ? sqrt(squares / (num - 1)) : 0);
+    qsort(per_element, num, sizeof(double), bench_compare_double);
+
+    *result = (bench_result_t) {
+        .name = bench->name, .n = n, .batch = batch, .repetitions = num, .mean_ns = mean,
+        .median_ns = (num % 2 ? per_element[num / 2] : (per_element[num / 2 - 1] + per_element[num / 2]) / 2),
+        .ci95_ns = (num > 1 ? bench_student_t95(num - 1) * stddev / sqrt(num) : 0),
+        .ticks = (BENCH_HAS_TSC ? ticks_sum / num : -1), .digest = ctx.digest
+    };
+}
+
+static void bench_print(FILE *file, const bench_result_t *result)
+{
+    fprintf(file, "%-18s %10zu %8zu %13.3f %10.3f %13.3f %10.2f %14.0f\n", result->name, result->n, result->batch,
+            result->mean_ns, result->ci95_ns, result->median_ns, result->ticks,
+            (result->mean_ns > 0 ? 1e9 / result->mean_ns : 0));
+}
+
+static void bench_print_json(FILE *file, const bench_result_t *result)
+{
+    fprintf(file, "{ \"name\": \"%s\", \"n\": %zu, \"batch\": %zu, \"repetitions\": %u, \"mean_ns\": %.4f, "
+                  "\"ci95_ns\": %.4f, \"median_ns\": %.4f, \"ticks_per_element\": %.3f, \"digest\": %llu }",
+            result->name, result->n, result->batch, result->repetitions, result->mean_ns, result->ci95_ns,
+            result->median_ns, result->ticks, (unsigned long long) result->digest);
+}
+
+static size_t parse_size(const char *text, size_t fallback)
+{
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    return (*end == '\0' && value > 0 ? (size_t) value : fallback);
+}
+
+int main(int argc, char *argv[])
+{
+    bench_config_t config = {
+        .filter = NULL, .min_size = 1, .max_size = BENCH_DEFAULT_MAX_SIZE, .repetitions = BENCH_DEFAULT_REPETITIONS,
+        .warmup = BENCH_DEFAULT_WARMUP, .min_time_ns = BENCH_DEFAULT_MIN_TIME_NS, .json = false
+    };
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--json") == 0) {
+            config.json = true;
+        } else if (strcmp(argv[i], "--bench") == 0 && has_value) {
+            config.filter = argv[++i];
+        } else if (strcmp(argv[i], "--min-size") == 0 && has_value) {
+            config.min_size = parse_size(argv[++i], config.min_size);
+        } else if (strcmp(argv[i], "--max-size") == 0 && has_value) {
+            config.max_size = parse_size(argv[++i], config.max_size);
+        } else if (strcmp(argv[i], "--repetitions") == 0 && has_value) {
+            config.repetitions = (unsigned) parse_size(argv[++i], config.repetitions);
+        } else if (strcmp(argv[i], "--warmup") == 0 && has_value) {
+            config.warmup = (unsigned) strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--min-time-ms") == 0 && has_value) {
+            config.min_time_ns = parse_size(argv[++i], config.min_time_ns / 1000000) * 1000000;
+        } else {
+            fprintf(stderr, "usage: %s [--bench NAME] [--min-size N] [--max-size N] [--repetitions N] [--warmup N] "
+                            "[--min-time-ms N] [--json]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    config.repetitions = (config.repetitions < BENCH_MAX_REPETITIONS ? config.repetitions : BENCH_MAX_REPETITIONS);
+
+    for (size_t i = 0; i < BENCH_NUM_KEYS; i++) {
+        snprintf(bench_keys[i], sizeof(bench_keys[i]), "key_%zu", i);
+    }
+
+    bool first = true;
+    if (config.json) {
+        printf("{ \"suite\": \"brooks-bench\", \"repetitions\": %u, \"warmup\": %u, \"results\": [",
+               config.repetitions, config.warmup);
+    } else {
+        printf("%-18s %10s %8s %13s %10s %13s %10s %14s\n", "benchmark", "n", "batch", "ns/elem", "+-95%",
+               "median", "ticks/elem", "elem/s");
+    }
+
+    for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+        if (config.filter != NULL && strcmp(config.filter, benchmarks[b].name) != 0) {
+            continue;
+        }
+        for (size_t n = 1; n <= config.max_size; n *= 10) {
+            if (n < config.min_size) {
+                continue;
+            }
+            bench_result_t result;
+            bench_measure(&result, benchmarks + b, n, &config);
+            if (config.json) {
+                printf("%s\n  ", first ? "" : ",");
+                bench_print_json(stdout, &result);
+            } else {
+                bench_print(stdout, &result);
+            }
+            fflush(stdout);
+            first = false;
+        }
+    }
+
+    if (config.json) {
+        printf("\n] }\n");
+    }
+    return EXIT_SUCCESS;
+}
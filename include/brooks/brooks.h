@@ -60,15 +60,15 @@ typedef enum
     brooks_status_true           = 1,
     brooks_status_false          = 0,
     brooks_status_failed         = 0,
+    brooks_status_eof            = 0,
+    brooks_status_nullptr        = 2,
     brooks_status_malloc_err,
     brooks_status_pmalloc_err,
     brooks_status_realloc_err,
-    brooks_status_nullptr        = 2,
     brooks_status_notype,
     brooks_status_interalerr,
     brooks_status_wrongusage,
     brooks_status_nopool,
-    brooks_status_eof            = 0,
     brooks_status_illegalarg,
     brooks_status_badcall,
     brooks_status_full
@@ -27,6 +27,7 @@
 
 #include <brooks/brooks.h>
 #include <brooks/brooks_pool.h>
+#include <brooks/brooks_shape.h>
 
 
 #ifdef __cplusplus
@@ -41,12 +42,15 @@ extern "C" {
     #define BOOKS_DEFAULT_CAPACITY_VALUE                    300
 #endif
 
-#ifndef BROOKS_OBJECT_CAPACITY
-    #define BROOKS_OBJECT_CAPACITY                          BOOKS_DEFAULT_CAPACITY_VALUE
-#endif
 #ifndef BROOKS_ARRAY_CAPACITY
     #define BROOKS_ARRAY_CAPACITY                           BOOKS_DEFAULT_CAPACITY_VALUE
 #endif
+#ifndef BROOKS_ZONE_MAP_BLOCK_SIZE
+    #define BROOKS_ZONE_MAP_BLOCK_SIZE                      256
+#endif
+#ifndef BROOKS_DOC_HISTORY_CAPACITY
+    #define BROOKS_DOC_HISTORY_CAPACITY                     16
+#endif
 
 // ---------------------------------------------------------------------------------------------------------------------
 // F O R W A R D   D E C L A R A T I O N S
@@ -58,12 +62,96 @@ typedef struct brooks_array_t          brooks_array_t;
 
 typedef struct brooks_unnamed_entry_t  brooks_unnamed_entry_t;
 
-typedef struct brooks_named_entry_t    brooks_named_entry_t;
-
 typedef struct brooks_element_t        brooks_element_t;
 
 typedef struct brooks_value_t          brooks_value_t;
 
+typedef struct brooks_doc_history_t    brooks_doc_history_t;
+
+typedef struct brooks_path_t           brooks_path_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Synopsis of a block of BROOKS_ZONE_MAP_BLOCK_SIZE consecutive elements of a number array. Elements without an order
+ * (NaN) are counted as nulls and do not contribute to 'min' and 'max', which are undefined if all elements are nulls.
+ */
+typedef struct brooks_zone_t
+{
+    union {
+        uint64_t                    integer;
+        double                      decimal;
+    } min, max;
+    size_t                          num_nulls;
+    size_t                          num_elements;
+} brooks_zone_t;
+
+/**
+ * Memory held by documents, broken down by the structures that represent them. Sizes are those of the structures as
+ * requested from the pool, i.e., without allocator overhead, without blocks a resize left behind and without the
+ * shapes, which are shared by all documents of a pool (see brooks_pool_stats_t). Properties are stored as values in
+ * their object, in the order of the object's shape (see brooks_shape_t). 'bytes_slack' are the unused slots of value
+ * arrays and entries arrays that are allocated ahead of time, 'bytes_lazy' the text copies and structural indexes of
+ * lazily parsed documents (see brooks_doc_parse_lazy), which hold the strings decoded so far and the containers not
+ * built yet, and 'bytes_pointers' the share of all bytes that are pointers (parent links, shapes, entries arrays,
+ * strings and children). Each value is attributed its own bytes, the bytes of its entry and slot if it is an array
+ * element, and its content (the string unless it is in a text copy, or the container structure with its unused slots,
+ * entries array and zone map). Roots are no values, but count as objects in 'type_values' and 'type_bytes'.
+ */
+typedef struct brooks_doc_footprint_t
+{
+    size_t                          num_documents;
+    size_t                          num_objects;
+    size_t                          num_arrays;
+    size_t                          num_properties;
+    size_t                          num_unnamed_entries;
+    size_t                          num_values;
+    size_t                          bytes_objects;
+    size_t                          bytes_arrays;
+    size_t                          bytes_unnamed_entries;
+    size_t                          bytes_values;
+    size_t                          bytes_slots;
+    size_t                          bytes_slack;
+    size_t                          bytes_zones;
+    size_t                          bytes_strings;
+    size_t                          bytes_lazy;
+    size_t                          bytes_pointers;
+    size_t                          type_values[brooks_type_null + 1];
+    size_t                          type_bytes[brooks_type_null + 1];
+} brooks_doc_footprint_t;
+
+typedef enum brooks_doc_token_e
+{
+    brooks_doc_token_object_begin, brooks_doc_token_object_end, brooks_doc_token_array_begin,
+    brooks_doc_token_array_end, brooks_doc_token_key, brooks_doc_token_scalar
+} brooks_doc_token_e;
+
+/**
+ * What brooks_doc_scan does after a token: after a key, 'skip' passes over the property's value; after the begin of an
+ * object or array, it passes over its content up to its end token.
+ */
+typedef enum brooks_doc_scan_e
+{
+    brooks_doc_scan_continue, brooks_doc_scan_skip, brooks_doc_scan_stop
+} brooks_doc_scan_e;
+
+/**
+ * A token of brooks_doc_scan. 'key' and a string 'value' are valid during the call of the handler only.
+ */
+typedef struct brooks_doc_token_t
+{
+    brooks_doc_token_e              kind;
+    const char                     *key;                // of a property's key, scalar and begin, NULL otherwise
+    const brooks_value_t           *value;              // a scalar, or an object or array without content
+    size_t                          begin;              // offset of the value in the text, for keys as well
+    size_t                          end;                // offset past the value, for scalars and ends
+    size_t                          num_elements;       // properties or elements, for ends
+} brooks_doc_token_t;
+
+typedef brooks_doc_scan_e (*brooks_doc_token_handler_t)(void *capture, const brooks_doc_token_t *token);
+
 // ---------------------------------------------------------------------------------------------------------------------
 // I N T E R F A C E   D E C L A R A T I O N
 // ---------------------------------------------------------------------------------------------------------------------
@@ -72,6 +160,57 @@ brooks_status_e brooks_doc_create(brooks_object_t **doc, brooks_pool_t *pool);
 
 brooks_status_e brooks_doc_parse(brooks_object_t **doc, brooks_pool_t *pool, const char *text);
 
+/**
+ * Parses 'text' like brooks_doc_parse, but only into a structural index of its objects and arrays at first; each is
+ * built the first time it is accessed, e.g., when its properties are counted or looked up, or its elements iterated.
+ * A subtree that is never accessed costs its index entries and its part of a copy of 'text' in 'pool'. The whole text
+ * is validated upfront, and arrays that mix types are rejected with brooks_status_notype as brooks_doc_parse does.
+ * Since reading a lazily parsed document may change it, it must not be read by several threads at once.
+ */
+brooks_status_e brooks_doc_parse_lazy(brooks_object_t **doc, brooks_pool_t *pool, const char *text);
+
+/**
+ * Parses only the parts of 'text' that one of 'paths' addresses. A property whose keys from the root match a path in
+ * the sense of brooks_path_matches is parsed with everything in it. Objects and arrays on the way to such a property
+ * are kept, possibly empty, with just the properties and elements that lead there; arrays are traversed implicitly
+ * as by brooks_path_visit, such that only their objects and arrays are kept. Everything else is skipped by matching
+ * brackets and quotes, and is neither built nor validated beyond that. An empty path addresses the whole text, which
+ * is then parsed by brooks_doc_parse.
+ */
+brooks_status_e brooks_doc_parse_projected(brooks_object_t **doc, brooks_pool_t *pool, const char *text,
+                                           const brooks_path_t * const *paths, size_t num_paths);
+
+/**
+ * Reads the objects in 'text', one or more separated by whitespace as in NDJSON, as a stream of tokens without
+ * building them, and passes each token to 'handler'. Strings are decoded into buffers that are reused, such that
+ * memory depends on the nesting depth and the longest string only. What the handler skips is passed over by matching
+ * brackets and quotes, and neither decoded nor validated beyond that; arrays may mix types. Returns brooks_status_ok
+ * as well if the handler stops the scan.
+ */
+brooks_status_e brooks_doc_scan(const char *text, void *capture, brooks_doc_token_handler_t handler);
+
+/**
+ * Copies 'doc' into 'pool' as a new document that shares nothing with 'doc', such that the pool of 'doc' may be
+ * disposed afterwards. The clone is sized exactly in a first pass and placed in one block of the pool in a second
+ * one: each object is followed by its values, each array by its entries, and each container by the content of its
+ * values, i.e., the clone is laid out in the order of a depth-first traversal and its containers have no unused
+ * slots. Adding to the clone later moves the affected containers out of the block.
+ */
+brooks_status_e brooks_doc_clone(brooks_object_t **clone, brooks_pool_t *pool, const brooks_object_t *doc);
+
+/**
+ * Copies 'doc' into 'pool' like brooks_doc_clone does, but as a read-only document for long-lived readers. Arrays of
+ * scalars are packed, i.e., their entries, values and strings follow each other in three runs rather than interleaved.
+ * Every function that changes the frozen document or one of its containers fails with brooks_status_badcall. Reading
+ * it writes to neither the document nor its pool, such that it may be shared across threads as long as nothing else
+ * uses 'pool' concurrently; brooks_doc_fullscan is an exception, as it allocates its result in the pool.
+ */
+brooks_status_e brooks_doc_freeze(brooks_object_t **frozen, brooks_pool_t *pool, const brooks_object_t *doc);
+
+/**
+ * Writes 'json' as JSON text that parses back to the same values: keys and strings are escaped, integers are signed as
+ * the parser reads them, and decimals keep a fraction or an exponent. Decimals that are not finite print as null.
+ */
 brooks_status_e brooks_doc_print(FILE *file, const brooks_object_t *json);
 
 brooks_status_e brooks_doc_add_boolean(brooks_object_t *parent, const char *key, const bool *data);
@@ -91,11 +230,40 @@ brooks_status_e brooks_doc_add_array(brooks_array_t **array, brooks_object_t *pa
 
 brooks_status_e brooks_doc_add_value(brooks_array_t *parent, const void *data);
 
-brooks_named_entry_t **brooks_doc_object_begin(const brooks_object_t *object);
+size_t brooks_doc_object_num_elements(const brooks_object_t *object);
 
-brooks_named_entry_t **brooks_doc_object_end(const brooks_object_t *object);
+const char *brooks_doc_object_get_key(const brooks_object_t *object, size_t idx);
 
-size_t brooks_doc_object_num_elements(const brooks_object_t *object);
+/**
+ * The value of the property at 'idx'. Properties are stored in their object, such that the address of a value is
+ * stable only once no more properties are added to its object.
+ */
+const brooks_value_t *brooks_doc_object_get_value(const brooks_object_t *object, size_t idx);
+
+const brooks_shape_t *brooks_doc_object_get_shape(const brooks_object_t *object);
+
+bool brooks_doc_object_is_frozen(const brooks_object_t *object);
+
+/**
+ * Sets the first property named 'key' to a value of 'type', or adds the property if there is none. 'data' is read as
+ * by brooks_doc_history_set. Whatever the property held before is recycled in the object's pool (see
+ * brooks_pool_recycle). A lookup is O(1) in objects whose shape is indexed (see BROOKS_SHAPE_INDEX_THRESHOLD) and
+ * linear in the number of keys otherwise; adding a property is amortized O(1).
+ */
+brooks_status_e brooks_doc_object_set(brooks_object_t *object, const char *key, brooks_type_e type, const void *data);
+
+/**
+ * As brooks_doc_object_set, but sets the property to a deep copy of 'value', which may be from any document,
+ * including this one.
+ */
+brooks_status_e brooks_doc_object_set_value(brooks_object_t *object, const char *key, const brooks_value_t *value);
+
+/**
+ * Removes the first property named 'key' and recycles what it held, returns brooks_status_false if there is none. The
+ * following properties move up, which is linear in the number of keys of this object only; the slots that become
+ * unused are released once less than a quarter of them is in use.
+ */
+brooks_status_e brooks_doc_object_remove(brooks_object_t *object, const char *key);
 
 brooks_status_e brooks_doc_array_add_object(brooks_object_t **object, brooks_array_t *parent);
 
@@ -103,6 +271,36 @@ brooks_status_e brooks_doc_array_add_array(brooks_array_t **array, brooks_type_e
 
 size_t brooks_doc_array_get_length(const brooks_array_t *array);
 
+brooks_type_e brooks_doc_array_get_type(const brooks_array_t *array);
+
+brooks_status_e brooks_doc_array_enable_zone_map(brooks_array_t *array);
+
+const brooks_zone_t *brooks_doc_array_get_zones(size_t *num_zones, const brooks_array_t *array);
+
+/**
+ * Replaces the element at 'idx' of an array of scalars by 'data', read as by brooks_doc_add_value, in O(1).
+ */
+brooks_status_e brooks_doc_array_set(brooks_array_t *array, size_t idx, const void *data);
+
+/**
+ * Inserts a scalar at 'idx' of an array of scalars, where 'idx' may be the array's length. The following elements
+ * move, which is linear in their number, and so is the update of the zone map, if any.
+ */
+brooks_status_e brooks_doc_array_insert(brooks_array_t *array, size_t idx, const void *data);
+
+/**
+ * As brooks_doc_array_insert, but inserts a deep copy of 'value', which may be from any document, including this one.
+ * 'value' must be of the array's type, an integer for an array of decimals, or of any type for an empty array,
+ * which then takes that type.
+ */
+brooks_status_e brooks_doc_array_insert_value(brooks_array_t *array, size_t idx, const brooks_value_t *value);
+
+/**
+ * Removes the element at 'idx' and recycles it, returns brooks_status_false if there is none. The following
+ * elements move; entries arrays larger than BROOKS_ARRAY_CAPACITY are released once less than a quarter is in use.
+ */
+brooks_status_e brooks_doc_array_remove(brooks_array_t *array, size_t idx);
+
 brooks_unnamed_entry_t **brooks_doc_array_begin(const brooks_array_t *array);
 
 brooks_unnamed_entry_t **brooks_doc_array_end(const brooks_array_t *array);
@@ -131,9 +329,27 @@ bool brooks_doc_value_as_boolean(const brooks_value_t *value);
 
 const brooks_object_t *brooks_doc_value_as_object(const brooks_value_t *value);
 
+/**
+ * Writes 'value' as JSON text, see brooks_doc_print.
+ */
 brooks_status_e brooks_doc_value_print(FILE *file, const brooks_value_t *value);
 
-const brooks_value_t *brooks_doc_named_entry_get_value(const brooks_named_entry_t *entry);
+/**
+ * Writes 'string' as a JSON string, escaped as brooks_doc_print escapes keys and strings.
+ */
+brooks_status_e brooks_doc_string_print(FILE *file, const char *string);
+
+const char *brooks_doc_value_get_key(const brooks_value_t *value);
+
+size_t brooks_doc_value_get_index(const brooks_value_t *value);
+
+size_t brooks_doc_value_get_depth(const brooks_value_t *value);
+
+const brooks_object_t *brooks_doc_value_get_owner(const brooks_value_t *value);
+
+const brooks_object_t *brooks_doc_value_get_root(const brooks_value_t *value);
+
+brooks_element_t *brooks_doc_element_from_value(brooks_pool_t *pool, const brooks_value_t *value);
 
 const brooks_value_t *brooks_doc_unnamed_entry_get_value(const brooks_unnamed_entry_t *entry);
 
@@ -141,6 +357,57 @@ const char *brooks_doc_type_str(const brooks_type_e type);
 
 brooks_pool_t *brooks_doc_get_pool(const brooks_object_t *object);
 
+/**
+ * Adds the memory held by 'doc' to 'footprint', which the caller zeroes, such that a collection can be summed up.
+ */
+brooks_status_e brooks_doc_footprint(brooks_doc_footprint_t *footprint, const brooks_object_t *doc);
+
+/**
+ * Resolves 'location' in 'doc'. A location is a sequence of keys and array positions separated by
+ * BROOKS_PATH_SEPARATOR, e.g., "servers.0.port"; a key addresses the first property of that name. Returns
+ * brooks_status_false if there is no such value.
+ */
+brooks_status_e brooks_doc_locate(const brooks_value_t **value, const brooks_object_t *doc, const char *location);
+
+/**
+ * Starts the version history of 'doc', which becomes its first version and must not be changed afterwards. Versions
+ * are immutable documents that are read with the functions above. An update copies the containers on the path from
+ * the root to the changed location and shares all others with the previous version, such that memory grows with the
+ * changed paths only. Versions are allocated in the pool of 'doc' and live as long as that pool.
+ *
+ * Updates must be made by one thread at a time, while any number of threads read versions without locks: readers
+ * never block the writer and are never blocked by it. This holds for the shapes that versions share with the writer
+ * as well, whose key arrays and indexes an update only extends or replaces once they are complete. Readers must not
+ * change the pool of 'doc' (e.g., by cloning into it), and 'doc' must not be lazily parsed unless it was built in
+ * full. Navigating upwards from a value in a shared container (e.g., brooks_doc_value_get_root) leads to the
+ * ancestors of the version that created the container.
+ */
+brooks_status_e brooks_doc_history_create(brooks_doc_history_t **history, brooks_object_t *doc);
+
+/**
+ * The latest version, in O(1).
+ */
+const brooks_object_t *brooks_doc_history_snapshot(const brooks_doc_history_t *history);
+
+const brooks_object_t *brooks_doc_history_get(const brooks_doc_history_t *history, size_t version);
+
+size_t brooks_doc_history_num_versions(const brooks_doc_history_t *history);
+
+/**
+ * Creates a version in which 'location' holds a value of 'type'. The last component of 'location' names a property,
+ * which is replaced or added, an array position, which is replaced, or "-", which appends to an array. 'data' is
+ * read as by brooks_doc_add_value for scalars; it is the element type (or NULL for an untyped empty array) for
+ * arrays, and ignored for objects, which are created empty. An array element must be of the array's type unless
+ * the array is empty.
+ */
+brooks_status_e brooks_doc_history_set(brooks_doc_history_t *history, const char *location, brooks_type_e type,
+                                       const void *data);
+
+/**
+ * Creates a version without the property or array element at 'location'.
+ */
+brooks_status_e brooks_doc_history_remove(brooks_doc_history_t *history, const char *location);
+
 
 #ifdef __cplusplus
 }
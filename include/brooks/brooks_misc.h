@@ -22,6 +22,9 @@
 // I N C L U D E S
 // ---------------------------------------------------------------------------------------------------------------------
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include <brooks/brooks.h>
 #include <brooks/brooks_pool.h>
 
@@ -29,17 +32,53 @@
 extern "C" {
 #endif
 
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+/**
+ * A hash set of addresses, e.g., of the documents added to an index.
+ */
+typedef struct brooks_misc_set_t
+{
+    const void                  **slots;
+    size_t                        num_entries;
+    size_t                        capacity;
+} brooks_misc_set_t;
+
 // ---------------------------------------------------------------------------------------------------------------------
 // I N T E R F A C E   D E C L A R A T I O N
 // ---------------------------------------------------------------------------------------------------------------------
 
+/**
+ * Moves 'base' to a larger pool block if 'num_add' entries do not fit. The new block is attributed to 'category', the
+ * old one becomes garbage in the pool's statistics.
+ */
 void *brooks_misc_pooled_autoresize(brooks_pool_t *pool, void *base, size_t elem_size, size_t num_entries,
-                                    size_t *capacity, size_t num_add);
+                                    size_t *capacity, size_t num_add, brooks_pool_category_e category);
 
 void *brooks_misc_autoresize(void *base, size_t elem_size, size_t num_entries, size_t *capacity, size_t num_add);
 
 char *brooks_misc_strdup(brooks_pool_t *pool, const char *str);
 
+uint64_t brooks_misc_hash_str(const char *str);
+
+/**
+ * Nanoseconds on a monotonic clock, for measuring intervals that the wall clock being set does not disturb.
+ */
+uint64_t brooks_misc_clock_ns(void);
+
+brooks_status_e brooks_misc_set_create(brooks_misc_set_t *set);
+
+/**
+ * Adds 'entry', which must not be NULL, if it is not in 'set' yet.
+ */
+brooks_status_e brooks_misc_set_insert(brooks_misc_set_t *set, const void *entry);
+
+bool brooks_misc_set_contains(const brooks_misc_set_t *set, const void *entry);
+
+void brooks_misc_set_dispose(brooks_misc_set_t *set);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,88 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef BROOKS_PATCH_H
+#define BROOKS_PATCH_H
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+
+#include <brooks/brooks.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// C O N F I G
+// ---------------------------------------------------------------------------------------------------------------------
+
+#ifndef BROOKS_PATCH_DIFF_MAX_CELLS
+    #define BROOKS_PATCH_DIFF_MAX_CELLS                 (1 << 20)  // of the edit matrix of two arrays
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// F O R W A R D   D E C L A R A T I O N S
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef struct brooks_object_t   brooks_object_t;
+typedef struct brooks_array_t    brooks_array_t;
+typedef struct brooks_pool_t     brooks_pool_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Parses the text of a JSON Patch (RFC 6902), i.e., an array of operations, into 'pool'. The values of operations
+ * follow the rules of brooks_doc_parse, e.g., arrays are homogeneous.
+ */
+brooks_status_e brooks_patch_parse(brooks_array_t **patch, brooks_pool_t *pool, const char *text);
+
+/**
+ * Applies the operations of a JSON Patch (RFC 6902) to 'doc' in place and in order. Paths are JSON Pointers
+ * (RFC 6901), where a key addresses the first property of that name; the path "" replaces the whole document and
+ * hence takes an object. Returns brooks_status_false if a path does not exist or a "test" fails,
+ * brooks_status_illegalarg for a malformed operation, and brooks_status_wrongusage for a value that does not fit the
+ * type of its array. The operations before a failing one remain applied.
+ */
+brooks_status_e brooks_patch_apply(brooks_object_t *doc, const brooks_array_t *patch);
+
+/**
+ * Applies a JSON Merge Patch (RFC 7386) to 'doc' in place.
+ */
+brooks_status_e brooks_patch_merge(brooks_object_t *doc, const brooks_object_t *patch);
+
+/**
+ * Writes a JSON Patch to 'file' that turns 'from' into 'to', and sets 'num_operations' to its number of operations.
+ * Containers are compared by a hash of their content, computed once per container, such that equal branches are
+ * skipped in O(1) after one pass; containers that both documents share, such as the versions of a
+ * brooks_doc_history_t do, are equal by address. Properties are matched by key, regardless of their order and
+ * considering the first of duplicate keys only. Arrays are aligned by a shortest edit script of removals, additions
+ * and replacements, or by position if that exceeds BROOKS_PATCH_DIFF_MAX_CELLS.
+ */
+brooks_status_e brooks_patch_diff(size_t *num_operations, FILE *file, const brooks_object_t *from,
+                                  const brooks_object_t *to);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BROOKS_PATCH_H
@@ -0,0 +1,95 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef BROOKS_PATH_H
+#define BROOKS_PATH_H
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <stdbool.h>
+
+#include <brooks/brooks.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// C O N S T A N T S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#define BROOKS_PATH_SEPARATOR                '.'
+#define BROOKS_PATH_WILDCARD                 "*"
+
+// ---------------------------------------------------------------------------------------------------------------------
+// F O R W A R D   D E C L A R A T I O N S
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef struct brooks_object_t   brooks_object_t;
+typedef struct brooks_value_t    brooks_value_t;
+typedef struct brooks_pool_t     brooks_pool_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+/**
+ * A compiled key path such as "movies.actors.name". Arrays on the way are traversed implicitly, i.e., the path
+ * addresses every element of an array that is reached by a key. The component "*" matches any key. An empty path
+ * addresses every value in the document at any depth. Each component carries an inline cache of the key's position
+ * per object shape (see brooks_shape_cache_t), which visiting updates; a path must hence not be visited by several
+ * threads at once.
+ */
+typedef struct brooks_path_t brooks_path_t;
+
+typedef void (*brooks_path_visitor_t)(void *capture, const brooks_value_t *value);
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e brooks_path_create(brooks_path_t **path, brooks_pool_t *pool, const char *text);
+
+brooks_status_e brooks_path_visit(const brooks_path_t *path, const brooks_object_t *root, void *capture,
+                                  brooks_path_visitor_t visitor);
+
+/**
+ * Like brooks_path_visit, but visits exactly the values whose keys from the root match the path in the sense of
+ * brooks_path_matches, i.e., an array reached by the last component is visited before its elements. Visits nothing
+ * for an empty path.
+ */
+brooks_status_e brooks_path_visit_matching(const brooks_path_t *path, const brooks_object_t *root, void *capture,
+                                           brooks_path_visitor_t visitor);
+
+bool brooks_path_matches(const brooks_path_t *path, const char * const *keys, size_t num_keys);
+
+/**
+ * Whether the component 'idx' of 'path' matches 'key', i.e., equals it or is the wildcard.
+ */
+bool brooks_path_matches_component(const brooks_path_t *path, size_t idx, const char *key);
+
+size_t brooks_path_length(const brooks_path_t *path);
+
+const char *brooks_path_str(const brooks_path_t *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BROOKS_PATH_H
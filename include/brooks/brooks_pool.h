@@ -36,6 +36,17 @@ extern "C" {
     #define BROOKS_POOL_CAPACITY                        1500
 #endif
 
+#ifndef BROOKS_POOL_CHUNK_OVERHEAD
+    #define BROOKS_POOL_CHUNK_OVERHEAD                  8          // allocator header per block, estimated
+#endif
+
+#ifndef BROOKS_POOL_CHUNK_ALIGNMENT
+    #define BROOKS_POOL_CHUNK_ALIGNMENT                 16
+#endif
+#ifndef BROOKS_POOL_FREE_LISTS
+    #define BROOKS_POOL_FREE_LISTS                      16         // distinct block sizes that are recycled
+#endif
+
 // ---------------------------------------------------------------------------------------------------------------------
 // F O R W A R D   D E C L A R A T I O N S
 // ---------------------------------------------------------------------------------------------------------------------
@@ -46,18 +57,56 @@ typedef struct brooks_array_t          brooks_array_t;
 
 typedef struct brooks_unnamed_entry_t  brooks_unnamed_entry_t;
 
-typedef struct brooks_named_entry_t    brooks_named_entry_t;
-
 typedef struct brooks_element_t        brooks_element_t;
 
 typedef struct brooks_value_t          brooks_value_t;
 
+typedef struct brooks_shape_registry_t brooks_shape_registry_t;
+
 // ---------------------------------------------------------------------------------------------------------------------
 // T Y P E   D E C L A R A T I O N S
 // ---------------------------------------------------------------------------------------------------------------------
 
 typedef struct brooks_pool_t           brooks_pool_t;
 
+typedef enum brooks_pool_category_e
+{
+    brooks_pool_category_other,
+    brooks_pool_category_object,
+    brooks_pool_category_array,
+    brooks_pool_category_entry,
+    brooks_pool_category_value,
+    brooks_pool_category_string,
+    brooks_pool_category_cursor,
+    brooks_pool_category_shape,
+    brooks_pool_category_garbage,          // blocks left behind by a pooled resize
+    brooks_pool_category_count
+} brooks_pool_category_e;
+
+typedef struct brooks_pool_stats_t
+{
+    size_t                num_allocations;
+    size_t                bytes_requested;
+    size_t                bytes_reserved;     // estimated, including allocator overhead and the pool's block table
+    size_t                bytes_live;         // requested bytes not left behind as garbage
+    size_t                peak_reserved;
+    size_t                bytes_recycled;     // garbage held for reuse, see brooks_pool_recycle
+    size_t                num_reused;
+    double                fragmentation;      // share of reserved bytes that is not live
+    size_t                category_bytes[brooks_pool_category_count];
+    size_t                category_allocations[brooks_pool_category_count];
+} brooks_pool_stats_t;
+
+/**
+ * The structures a caller lays out in one block, by category (see brooks_pool_malloc_layout).
+ */
+typedef struct brooks_pool_layout_t
+{
+    size_t                num_bytes;          // of the block, including padding between structures
+    size_t                category_bytes[brooks_pool_category_count];
+    size_t                category_allocations[brooks_pool_category_count];
+} brooks_pool_layout_t;
+
 // ---------------------------------------------------------------------------------------------------------------------
 // I N T E R F A C E   D E C L A R A T I O N
 // ---------------------------------------------------------------------------------------------------------------------
@@ -68,6 +117,46 @@ brooks_status_e brooks_pool_dispose(brooks_pool_t *pool);
 
 void *brooks_pool_malloc(brooks_pool_t *pool, size_t size);
 
+/**
+ * Allocates like brooks_pool_malloc and attributes the block to 'category' in the pool's statistics.
+ */
+void *brooks_pool_malloc_tagged(brooks_pool_t *pool, size_t size, brooks_pool_category_e category);
+
+/**
+ * Reattributes 'size' bytes of 'category' to garbage, e.g., the old block of a resized array.
+ */
+void brooks_pool_discard(brooks_pool_t *pool, size_t size, brooks_pool_category_e category);
+
+/**
+ * Allocates one block of 'layout->num_bytes' for many structures that the caller places in it, e.g., a document in
+ * traversal order (see brooks_doc_clone). The structures are accounted by category as if each was allocated on its
+ * own, such that they can be discarded and recycled one by one; padding is accounted as other.
+ */
+void *brooks_pool_malloc_layout(brooks_pool_t *pool, const brooks_pool_layout_t *layout);
+
+/**
+ * Discards 'block' like brooks_pool_discard and keeps it for reuse: the next request of exactly 'size' bytes is
+ * served from the recycled blocks instead of a new allocation. 'block' must not be referenced anymore. Blocks smaller
+ * than a pointer, and sizes beyond the first BROOKS_POOL_FREE_LISTS distinct ones, are discarded only.
+ */
+void brooks_pool_recycle(brooks_pool_t *pool, void *block, size_t size, brooks_pool_category_e category);
+
+/**
+ * Total number of bytes requested from the pool since its creation.
+ */
+size_t brooks_pool_num_bytes(const brooks_pool_t *pool);
+
+brooks_status_e brooks_pool_get_stats(brooks_pool_stats_t *stats, const brooks_pool_t *pool);
+
+brooks_status_e brooks_pool_print_stats(FILE *file, const brooks_pool_t *pool);
+
+/**
+ * The registry of the shapes of objects allocated in 'pool', created on first use (see brooks_shape_registry_t).
+ */
+brooks_shape_registry_t *brooks_pool_get_shapes(brooks_pool_t *pool);
+
+const char *brooks_pool_category_str(brooks_pool_category_e category);
+
 
 #ifdef __cplusplus
 }
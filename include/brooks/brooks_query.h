@@ -26,6 +26,9 @@
 #include <stdbool.h>
 
 #include <brooks/brooks.h>
+#include <brooks/index/brooks_index_value.h>
+#include <brooks/index/brooks_index_inverted.h>
+#include <brooks/brooks_stats.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -48,6 +51,25 @@ extern "C" {
     #define XJSON_QUERY_TERMINATORS_CAPACITY_DEFAULT           5
 #endif
 
+#ifndef XJSON_QUERY_INDEXES_CAPACITY_DEFAULT
+    #define XJSON_QUERY_INDEXES_CAPACITY_DEFAULT               2
+#endif
+
+#ifndef BROOKS_QUERY_TRAVERSAL_CAPACITY
+    #define BROOKS_QUERY_TRAVERSAL_CAPACITY                    64
+#endif
+
+#ifndef BROOKS_FILTER_ADAPT_INTERVAL
+    #define BROOKS_FILTER_ADAPT_INTERVAL                       1024
+#endif
+
+#ifndef BROOKS_QUERY_STREAM_LINE_CAPACITY
+    #define BROOKS_QUERY_STREAM_LINE_CAPACITY                  4096
+#endif
+#ifndef BROOKS_FILTER_SAMPLE_RATE
+    #define BROOKS_FILTER_SAMPLE_RATE                          64         // power of two
+#endif
+
 // ---------------------------------------------------------------------------------------------------------------------
 // F O R W A R D   D E C L A R A T I O N S
 // ---------------------------------------------------------------------------------------------------------------------
@@ -58,6 +80,8 @@ typedef struct brooks_pool_t             brooks_pool_t;
 
 typedef struct brooks_element_t          brooks_element_t;
 
+typedef struct brooks_cursor_t           brooks_cursor_t;
+
 // ---------------------------------------------------------------------------------------------------------------------
 // T Y P E S
 // ---------------------------------------------------------------------------------------------------------------------
@@ -66,6 +90,8 @@ typedef struct brooks_query_t            brooks_query_t;
 
 typedef struct brooks_result_t           brooks_result_t;
 
+typedef struct brooks_prepared_t         brooks_prepared_t;
+
 typedef enum {
     brooks_entry_kind_key_value_pair,
     brooks_entry_kind_single_value,
@@ -93,6 +119,23 @@ typedef enum brooks_selector_e
     brooks_selector_include, brooks_selector_exclude
 } brooks_selector_e;
 
+/**
+ * A value found by brooks_query_stream, by the range of its bytes in the input.
+ */
+typedef struct brooks_stream_match_t
+{
+    size_t                               begin;
+    size_t                               end;            // past the value's last byte
+    size_t                               document;       // the number of the document in the input, from 0
+    const char                          *key;            // NULL for array elements, valid during the visit only
+    size_t                               depth;          // 0 for the properties of a document
+} brooks_stream_match_t;
+
+/**
+ * Returns false to stop the stream.
+ */
+typedef bool (*brooks_stream_visitor_t)(void *capture, const brooks_stream_match_t *match);
+
 // ---------------------------------------------------------------------------------------------------------------------
 // I N T E R F A C E   D E C L A R A T I O N
 // ---------------------------------------------------------------------------------------------------------------------
@@ -103,14 +146,93 @@ brooks_status_e brooks_query_add_path_filter(brooks_query_t *query, const brooks
 
 brooks_status_e brooks_query_add_terminator(brooks_query_t *query, const brooks_filter_t *filter);
 
+brooks_status_e brooks_query_add_index(brooks_query_t *query, brooks_index_value_t *index);
+
+brooks_status_e brooks_query_add_inverted_index(brooks_query_t *query, brooks_index_inverted_t *index);
+
+/**
+ * Statistics of the collection the query runs against. They are used to size result buffers, to evaluate the most
+ * selective path filters first and to prefer traversing a single 'root' over an index lookup that is estimated to
+ * return more values than that document holds.
+ */
+brooks_status_e brooks_query_set_stats(brooks_query_t *query, brooks_stats_t *stats);
+
+/**
+ * Runs the query against 'root'. A terminator that restricts values by key path and by a range or string match is
+ * answered from an index registered for exactly that key path, if any, provided that 'root' was added to that index.
+ * Otherwise, a terminator with a key path is answered by following that path from 'root' if the query has no path
+ * filters, and all other terminators are evaluated by traversing 'root'. Terminators answered from an index or a key
+ * path emit in document order regardless of 'policy'. If 'root' is NULL, the query is answered for all documents
+ * covered by the indexes, which requires that every terminator can be served by an index.
+ */
 brooks_status_e brooks_query_execute(brooks_result_t **result, brooks_pool_t *pool, const brooks_query_t *query,
                                      const brooks_object_t *root, brooks_traversal_policy_e policy);
 
+/**
+ * Compiles the query once for repeated execution: plans for a single root and for the collection, the path filter
+ * order, traversal buffers and result cursors are allocated here and reused by every brooks_prepared_execute. The
+ * query, its filters, indexes and statistics must not be changed while prepared.
+ */
+brooks_status_e brooks_query_prepare(brooks_prepared_t **prepared, const brooks_query_t *query);
+
+/**
+ * Runs a prepared query with the semantics of brooks_query_execute. The returned cursor holds the matching values; it
+ * is owned by 'prepared' and valid until the next execution. Once the buffers have grown to the largest document
+ * seen, executions do not allocate.
+ */
+brooks_status_e brooks_prepared_execute(const brooks_cursor_t **result, brooks_prepared_t *prepared,
+                                        const brooks_object_t *root, brooks_traversal_policy_e policy);
+
+brooks_status_e brooks_prepared_dispose(brooks_prepared_t *prepared);
+
+/**
+ * Runs the query over the documents in 'text' without building them, i.e., over the tokens of brooks_doc_scan, and
+ * visits the matches, which is optional, in the order in which they end: an object or array follows the matches
+ * within it. Terminators and path filters are evaluated by the same predicates as by brooks_query_execute; their key
+ * paths are compiled into an automaton that tracks, per number of keys from the root, the filters whose key path the
+ * keys so far match, such that values that no terminator can reach are skipped without being decoded. A path filter
+ * must not restrict the number of elements, which is known at the end of an object or array only
+ * (brooks_status_wrongusage). Indexes and statistics are not used. Memory depends on the nesting depth and the
+ * longest key and string only.
+ */
+brooks_status_e brooks_query_stream(size_t *num_matches, const brooks_query_t *query, const char *text,
+                                    void *capture, brooks_stream_visitor_t visitor);
+
+/**
+ * Like brooks_query_stream for the documents in 'file', which is read a line at a time, such that each line holds
+ * whole documents as in NDJSON. Offsets are positions in the file, and memory additionally depends on the longest
+ * line.
+ */
+brooks_status_e brooks_query_stream_file(size_t *num_matches, const brooks_query_t *query, FILE *file,
+                                         void *capture, brooks_stream_visitor_t visitor);
+
 brooks_status_e brooks_result_print(FILE *file, const brooks_result_t *result);
 
+brooks_element_t * const *brooks_result_read(size_t *num_elements, const brooks_result_t *result);
+
 brooks_status_e brooks_filter_create(brooks_filter_t **filter, brooks_pool_t *pool,
                                      size_t min_depth, size_t max_depth);
 
+brooks_status_e brooks_filter_set_capture(brooks_filter_t *filter, void *capture);
+
+/**
+ * A filter evaluates its predicates as a conjunction. If adaptive (the default), it counts how often each predicate
+ * passes, times every BROOKS_FILTER_SAMPLE_RATE-th evaluation, and every BROOKS_FILTER_ADAPT_INTERVAL evaluations
+ * reorders its predicates by ascending cost per rejected candidate.
+ */
+brooks_status_e brooks_filter_set_adaptive(brooks_filter_t *filter, bool adaptive);
+
+brooks_status_e brooks_filter_set_key_path(brooks_filter_t *filter, const char *key_path);
+
+brooks_status_e brooks_filter_set_value_range(brooks_filter_t *filter, const brooks_index_key_t *lower,
+                                              bool lower_inclusive, const brooks_index_key_t *upper,
+                                              bool upper_inclusive);
+
+brooks_status_e brooks_filter_set_value_equals(brooks_filter_t *filter, const brooks_index_key_t *key);
+
+brooks_status_e brooks_filter_set_value_str_match(brooks_filter_t *filter, brooks_index_match_e match,
+                                                  const char *needle);
+
 brooks_status_e brooks_filter_set_prop_key_name(brooks_filter_t *filter, brooks_pred_string_t pred);
 
 brooks_status_e brooks_filter_set_prop_index(brooks_filter_t *filter, brook_pred_integer_t pred);
@@ -0,0 +1,170 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef BROOKS_SHAPE_H
+#define BROOKS_SHAPE_H
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <brooks/brooks.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// C O N F I G
+// ---------------------------------------------------------------------------------------------------------------------
+
+#ifndef BROOKS_SHAPE_TABLE_CAPACITY
+    #define BROOKS_SHAPE_TABLE_CAPACITY                 64
+#endif
+#ifndef BROOKS_SHAPE_INDEX_THRESHOLD
+    #define BROOKS_SHAPE_INDEX_THRESHOLD                8          // keys from which lookups are hashed
+#endif
+#ifndef BROOKS_SHAPE_CACHE_SIZE
+    #define BROOKS_SHAPE_CACHE_SIZE                     4
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// F O R W A R D   D E C L A R A T I O N S
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef struct brooks_pool_t     brooks_pool_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+/**
+ * The ordered key list of an object, shared by all objects that got the same keys in the same order (a "hidden
+ * class"). Shapes form a transition tree rooted in the empty shape: adding a key to an object moves it to the child
+ * shape for that key, which is created once per registry and reused afterwards. A shape is immutable, such that
+ * two objects have the same keys at the same positions if and only if they point to the same shape. Keys are interned
+ * in the registry, and a chain of shapes shares one key array as long as it does not branch.
+ */
+typedef struct brooks_shape_t brooks_shape_t;
+
+/**
+ * Shapes and interned keys of one pool, see brooks_pool_get_shapes. Memory is attributed to the pool's shape
+ * category and released with the pool.
+ */
+typedef struct brooks_shape_registry_t brooks_shape_registry_t;
+
+typedef struct brooks_shape_stats_t
+{
+    size_t                          num_shapes;
+    size_t                          num_keys;           // distinct interned keys
+    size_t                          num_key_arrays;     // shared key arrays, one per branch of the tree
+    size_t                          max_num_keys;       // of the largest shape
+    size_t                          bytes;              // shapes, key arrays, keys and hash tables
+} brooks_shape_stats_t;
+
+typedef struct brooks_shape_cache_entry_t
+{
+    uint64_t                        shape_id;           // see brooks_shape_get_id, 0 for an empty entry
+    size_t                          first;              // SIZE_MAX if the shape does not have the key
+    size_t                          last;
+} brooks_shape_cache_entry_t;
+
+/**
+ * A polymorphic inline cache for the lookup of one key, to be placed at a lookup site that sees many objects, such
+ * as a component of a compiled key path. It remembers the positions of the key in the last BROOKS_SHAPE_CACHE_SIZE
+ * shapes it was asked for, such that a lookup in an object of a known shape costs a compare and a load; other shapes
+ * fall back to brooks_shape_lookup and replace the oldest entry. 'first' and 'last' are the first and the last
+ * position of the key, which differ only for objects with duplicate keys.
+ */
+typedef struct brooks_shape_cache_t
+{
+    const char                     *key;
+    brooks_shape_cache_entry_t      entries[BROOKS_SHAPE_CACHE_SIZE];
+    size_t                          next;               // the entry replaced on the next miss
+    size_t                          num_hits;
+    size_t                          num_misses;
+} brooks_shape_cache_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e brooks_shape_registry_create(brooks_shape_registry_t **registry, brooks_pool_t *pool);
+
+brooks_shape_t *brooks_shape_registry_get_root(brooks_shape_registry_t *registry);
+
+/**
+ * Returns the registry's copy of 'key', which is equal by address for equal keys.
+ */
+const char *brooks_shape_registry_intern(brooks_shape_registry_t *registry, const char *key);
+
+brooks_status_e brooks_shape_registry_get_stats(brooks_shape_stats_t *stats, const brooks_shape_registry_t *registry);
+
+/**
+ * Sets 'child' to the shape of an object in 'shape' after 'key' was added, creating it on first use.
+ */
+brooks_status_e brooks_shape_transition(brooks_shape_t **child, brooks_shape_t *shape, const char *key);
+
+size_t brooks_shape_get_num_keys(const brooks_shape_t *shape);
+
+const char *brooks_shape_get_key(const brooks_shape_t *shape, size_t idx);
+
+const brooks_shape_t *brooks_shape_get_parent(const brooks_shape_t *shape);
+
+/**
+ * Identifier of 'shape' that is unique in the process, unlike its address, which may be reused once the pool of the
+ * shape was disposed.
+ */
+uint64_t brooks_shape_get_id(const brooks_shape_t *shape);
+
+/**
+ * Sets 'idx' to the position of the first occurrence of 'key' in 'shape', returns brooks_status_false if there is
+ * none. Shapes of BROOKS_SHAPE_INDEX_THRESHOLD keys or more are searched through a hash index of their key array.
+ */
+brooks_status_e brooks_shape_lookup(size_t *idx, const brooks_shape_t *shape, const char *key);
+
+/**
+ * Number of keys objects in 'shape' will likely end up with, estimated by following the most frequently taken
+ * transitions. Objects reserve that many slots when they grow, such that homogeneous objects are allocated once.
+ */
+size_t brooks_shape_get_extent(const brooks_shape_t *shape);
+
+/**
+ * Whether a key occurs more than once in 'shape', which happens for documents with duplicate keys.
+ */
+bool brooks_shape_has_duplicates(const brooks_shape_t *shape);
+
+/**
+ * Prepares 'cache' for lookups of 'key', which must outlive it.
+ */
+void brooks_shape_cache_init(brooks_shape_cache_t *cache, const char *key);
+
+/**
+ * Sets 'first' and 'last' to the first and the last position of the cache's key in 'shape', returns
+ * brooks_status_false if 'shape' does not have the key.
+ */
+brooks_status_e brooks_shape_cache_lookup(size_t *first, size_t *last, brooks_shape_cache_t *cache,
+                                          const brooks_shape_t *shape);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BROOKS_SHAPE_H
@@ -0,0 +1,129 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef BROOKS_STATS_H
+#define BROOKS_STATS_H
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <stdbool.h>
+
+#include <brooks/brooks.h>
+#include <brooks/index/brooks_index_value.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// C O N F I G
+// ---------------------------------------------------------------------------------------------------------------------
+
+#ifndef BROOKS_STATS_PATHS_CAPACITY
+    #define BROOKS_STATS_PATHS_CAPACITY                     64
+#endif
+#ifndef BROOKS_STATS_SAMPLE_SIZE
+    #define BROOKS_STATS_SAMPLE_SIZE                        1024
+#endif
+#ifndef BROOKS_STATS_HISTOGRAM_BUCKETS
+    #define BROOKS_STATS_HISTOGRAM_BUCKETS                  32
+#endif
+#ifndef BROOKS_STATS_SKETCH_BITS
+    #define BROOKS_STATS_SKETCH_BITS                        10
+#endif
+#ifndef BROOKS_STATS_DEFAULT_SELECTIVITY
+    #define BROOKS_STATS_DEFAULT_SELECTIVITY                0.1
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// F O R W A R D   D E C L A R A T I O N S
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef struct brooks_object_t   brooks_object_t;
+typedef struct brooks_pool_t     brooks_pool_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Statistics over a collection of documents, grouped by key path (see brooks_path.h). Per path, the collector counts
+ * values by type, tracks the lengths of the containers found there, estimates the number of distinct values with a
+ * HyperLogLog sketch and keeps a reservoir sample of the numbers from which an equi-depth histogram is derived.
+ */
+typedef struct brooks_stats_t brooks_stats_t;
+
+/**
+ * Counters of a single key path. Like for brooks_path_t, arrays are transparent: the values at a path are the elements
+ * of arrays reached by that path, the arrays themselves are counted in 'num_arrays' only. The path "" addresses the
+ * documents.
+ */
+typedef struct brooks_stats_path_t
+{
+    const char                   *key_path;
+    size_t                        num_documents;
+    size_t                        num_values;
+    size_t                        num_objects;
+    size_t                        num_numbers;
+    size_t                        num_strings;
+    size_t                        num_booleans;
+    size_t                        num_true;
+    size_t                        num_nulls;
+    size_t                        num_arrays;
+    size_t                        sum_array_lengths;
+    size_t                        max_array_length;
+    size_t                        sum_object_lengths;
+    size_t                        max_object_length;
+} brooks_stats_path_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e brooks_stats_create(brooks_stats_t **stats, brooks_pool_t *pool);
+
+brooks_status_e brooks_stats_add(brooks_stats_t *stats, const brooks_object_t *document);
+
+size_t brooks_stats_num_documents(const brooks_stats_t *stats);
+
+size_t brooks_stats_num_values(const brooks_stats_t *stats);
+
+const brooks_stats_path_t *brooks_stats_get(const brooks_stats_t *stats, const char *key_path);
+
+double brooks_stats_distinct(const brooks_stats_t *stats, const char *key_path);
+
+const double *brooks_stats_histogram(size_t *num_bounds, brooks_stats_t *stats, const char *key_path);
+
+/**
+ * Estimated fraction of the values at 'key_path' that fall into the range from 'lower' to 'upper' (NULL for
+ * unbounded), respectively that equal 'key'. Numbers are estimated from the sample, strings from the number of
+ * distinct values.
+ */
+double brooks_stats_selectivity_range(brooks_stats_t *stats, const char *key_path, const brooks_index_key_t *lower,
+                                      bool lower_inclusive, const brooks_index_key_t *upper, bool upper_inclusive);
+
+double brooks_stats_selectivity_equals(brooks_stats_t *stats, const char *key_path, const brooks_index_key_t *key);
+
+brooks_status_e brooks_stats_dispose(brooks_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BROOKS_STATS_H
@@ -0,0 +1,106 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef BROOKS_INDEX_INVERTED_H
+#define BROOKS_INDEX_INVERTED_H
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <stdbool.h>
+
+#include <brooks/brooks.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// C O N F I G
+// ---------------------------------------------------------------------------------------------------------------------
+
+#ifndef BROOKS_INDEX_INVERTED_TERMS_CAPACITY
+    #define BROOKS_INDEX_INVERTED_TERMS_CAPACITY            1024
+#endif
+
+#ifndef BROOKS_INDEX_INVERTED_VALUES_CAPACITY
+    #define BROOKS_INDEX_INVERTED_VALUES_CAPACITY           1024
+#endif
+
+#ifndef BROOKS_INDEX_INVERTED_TOKEN_BUFFER
+    #define BROOKS_INDEX_INVERTED_TOKEN_BUFFER              256
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// F O R W A R D   D E C L A R A T I O N S
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef struct brooks_object_t   brooks_object_t;
+typedef struct brooks_pool_t     brooks_pool_t;
+typedef struct brooks_cursor_t   brooks_cursor_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Inverted index over the string values reachable by a key path (see brooks_path.h) in a set of documents. Each string
+ * is tokenized into lower-case alphanumeric terms; every term maps to a posting list of the values containing it. The
+ * whole string is additionally kept in an exact-match dictionary. Posting lists store delta-encoded value ids as
+ * variable-length integers. Documents can be added at any time; ids grow monotonically, hence no rebuild is needed.
+ */
+typedef struct brooks_index_inverted_t brooks_index_inverted_t;
+
+typedef enum brooks_index_match_e
+{
+    brooks_index_match_equals,      // value is byte-wise equal to the needle
+    brooks_index_match_contains     // value contains every term of the needle (case-insensitive)
+} brooks_index_match_e;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e brooks_index_inverted_create(brooks_index_inverted_t **index, brooks_pool_t *pool,
+                                             const char *key_path);
+
+brooks_status_e brooks_index_inverted_add(brooks_index_inverted_t *index, const brooks_object_t *document);
+
+/**
+ * Whether 'document' was added to the index.
+ */
+bool brooks_index_inverted_covers(const brooks_index_inverted_t *index, const brooks_object_t *document);
+
+brooks_status_e brooks_index_inverted_lookup(brooks_cursor_t *result, const brooks_index_inverted_t *index,
+                                             brooks_index_match_e match, const char *needle);
+
+bool brooks_index_inverted_matches(brooks_index_match_e match, const char *value, const char *needle);
+
+size_t brooks_index_inverted_num_terms(const brooks_index_inverted_t *index);
+
+size_t brooks_index_inverted_num_values(const brooks_index_inverted_t *index);
+
+const char *brooks_index_inverted_key_path(const brooks_index_inverted_t *index);
+
+brooks_status_e brooks_index_inverted_dispose(brooks_index_inverted_t *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BROOKS_INDEX_INVERTED_H
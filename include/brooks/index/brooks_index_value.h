@@ -0,0 +1,108 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef BROOKS_INDEX_VALUE_H
+#define BROOKS_INDEX_VALUE_H
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <brooks/brooks.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// C O N F I G
+// ---------------------------------------------------------------------------------------------------------------------
+
+#ifndef BROOKS_INDEX_VALUE_CAPACITY
+    #define BROOKS_INDEX_VALUE_CAPACITY                     1024
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// F O R W A R D   D E C L A R A T I O N S
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef struct brooks_object_t   brooks_object_t;
+typedef struct brooks_value_t    brooks_value_t;
+typedef struct brooks_pool_t     brooks_pool_t;
+typedef struct brooks_cursor_t   brooks_cursor_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Typed search key. Keys of different types are ordered null < boolean < number < string; integers and decimals
+ * compare numerically with each other.
+ */
+typedef struct brooks_index_key_t
+{
+    brooks_type_e                 type;
+    union {
+        uint64_t                  integer;
+        double                    decimal;
+        const char               *string;
+        bool                      boolean;
+    };
+} brooks_index_key_t;
+
+/**
+ * Secondary index on the scalar values reachable by a key path (see brooks_path.h) across many documents. Entries are
+ * kept in a sorted array that is searched through an Eytzinger (BFS-ordered) copy of its keys, such that the top levels
+ * of the implicit search tree share cache lines. Added documents are staged and merged on the next lookup.
+ */
+typedef struct brooks_index_value_t brooks_index_value_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e brooks_index_value_create(brooks_index_value_t **index, brooks_pool_t *pool, const char *key_path);
+
+brooks_status_e brooks_index_value_add(brooks_index_value_t *index, const brooks_object_t *document);
+
+/**
+ * Whether 'document' was added to the index.
+ */
+bool brooks_index_value_covers(const brooks_index_value_t *index, const brooks_object_t *document);
+
+brooks_status_e brooks_index_value_lookup(brooks_cursor_t *result, brooks_index_value_t *index,
+                                          const brooks_index_key_t *lower, bool lower_inclusive,
+                                          const brooks_index_key_t *upper, bool upper_inclusive);
+
+int brooks_index_key_compare(const brooks_index_key_t *lhs, const brooks_index_key_t *rhs);
+
+bool brooks_index_key_from_value(brooks_index_key_t *key, const brooks_value_t *value);
+
+size_t brooks_index_value_num_entries(const brooks_index_value_t *index);
+
+const char *brooks_index_value_key_path(const brooks_index_value_t *index);
+
+brooks_status_e brooks_index_value_dispose(brooks_index_value_t *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BROOKS_INDEX_VALUE_H
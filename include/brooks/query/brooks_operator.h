@@ -35,6 +35,7 @@ extern "C" {
 typedef struct brooks_object_t   brooks_object_t;
 typedef struct brooks_array_t    brooks_array_t;
 typedef struct brooks_cursor_t   brooks_cursor_t;
+typedef struct brooks_profile_node_t brooks_profile_node_t;
 
 // ---------------------------------------------------------------------------------------------------------------------
 // T Y P E   D E F I N I T I O N
@@ -42,7 +43,8 @@ typedef struct brooks_cursor_t   brooks_cursor_t;
 
 typedef enum brooks_opp_tag_e {
     brooks_opp_tag_scan_objects_default,
-    brooks_opp_tag_scan_arrays_default
+    brooks_opp_tag_scan_arrays_default,
+    brooks_opp_tag_scan_strings_index
 } brooks_opp_tag_e;
 
 typedef struct brooks_operator_t
@@ -52,12 +54,17 @@ typedef struct brooks_operator_t
     const brooks_cursor_t *(*next)(struct brooks_operator_t *self);
     brooks_opp_tag_e         tag;
     void                    *extra;
+    brooks_profile_node_t   *profile;           // NULL unless attached to a profile, see brooks_profile.h
 } brooks_operator_t;
 
 // ---------------------------------------------------------------------------------------------------------------------
 // I N T E R F A C E   D E C L A R A T I O N
 // ---------------------------------------------------------------------------------------------------------------------
 
+/**
+ * Opens the operator for a (new) run over its input. An operator may be opened again after a run to restart it, which
+ * reuses the cursor allocated on its first open. Closing the operator releases its state and cursor.
+ */
 brooks_status_e brooks_operator_open(brooks_operator_t *opp);
 
 const brooks_cursor_t *brooks_operator_next(brooks_operator_t *opp);
@@ -0,0 +1,131 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef BROOKS_PROFILE_H
+#define BROOKS_PROFILE_H
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <brooks/brooks.h>
+#include <brooks/query/brooks_operator.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// C O N F I G
+// ---------------------------------------------------------------------------------------------------------------------
+
+#ifndef BROOKS_PROFILE_NODES_CAPACITY
+    #define BROOKS_PROFILE_NODES_CAPACITY                  8
+#endif
+
+// ---------------------------------------------------------------------------------------------------------------------
+// F O R W A R D   D E C L A R A T I O N S
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef struct brooks_pool_t brooks_pool_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Collects per-operator counters of a plan (EXPLAIN ANALYZE). Operators are attached to the profile as a tree; while
+ * the profile is enabled, every open, next and close of an attached operator is timed and counted. Detached operators
+ * pay a single branch, attached operators of a disabled profile a function call.
+ */
+typedef struct brooks_profile_t brooks_profile_t;
+
+typedef struct brooks_profile_node_t brooks_profile_node_t;
+
+typedef struct brooks_profile_counters_t
+{
+    const char              *name;
+    uint64_t                 time_ns;           // inclusive the time spent in children
+    uint64_t                 self_ns;
+    size_t                   num_opens;
+    size_t                   num_calls;         // calls to next
+    size_t                   num_batches_in;
+    size_t                   num_rows_in;
+    size_t                   num_batches_out;
+    size_t                   num_rows_out;
+    size_t                   pool_bytes;        // inclusive the bytes allocated by children
+    double                   selectivity;       // rows out per row in, negative if the input is unknown
+} brooks_profile_counters_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Creates a disabled profile. Bytes are counted as allocations from 'pool' (may be NULL) during operator calls.
+ */
+brooks_status_e brooks_profile_create(brooks_profile_t **profile, brooks_pool_t *pool);
+
+brooks_status_e brooks_profile_set_enabled(brooks_profile_t *profile, bool enabled);
+
+/**
+ * Attaches 'opp' as a child of the already attached operator 'parent', or as a root if 'parent' is NULL. The input of
+ * an operator that does not report its input itself is the output of its children.
+ */
+brooks_status_e brooks_profile_attach(brooks_profile_t *profile, brooks_operator_t *opp,
+                                      const brooks_operator_t *parent, const char *name);
+
+brooks_status_e brooks_profile_detach(brooks_operator_t *opp);
+
+brooks_status_e brooks_profile_reset(brooks_profile_t *profile);
+
+brooks_status_e brooks_profile_get(brooks_profile_counters_t *counters, const brooks_profile_t *profile,
+                                   const brooks_operator_t *opp);
+
+brooks_status_e brooks_profile_print(FILE *file, const brooks_profile_t *profile);
+
+brooks_status_e brooks_profile_print_json(FILE *file, const brooks_profile_t *profile);
+
+/**
+ * The profile must outlive its attached operators, or the operators must be detached first.
+ */
+brooks_status_e brooks_profile_dispose(brooks_profile_t *profile);
+
+// ---------------------------------------------------------------------------------------------------------------------
+// O P E R A T O R   H O O K S
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e brooks_profile_open(brooks_operator_t *opp);
+
+const brooks_cursor_t *brooks_profile_next(brooks_operator_t *opp);
+
+brooks_status_e brooks_profile_close(brooks_operator_t *opp);
+
+/**
+ * Reported by operators that consume an input other than child operators, e.g., scans.
+ */
+void brooks_profile_count_input(brooks_profile_node_t *node, size_t num_batches, size_t num_rows);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BROOKS_PROFILE_H
@@ -15,8 +15,10 @@
 // OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <stdbool.h>
 #include <brooks/brooks.h>
 #include <brooks/query/brooks_operator.h>
+#include <brooks/index/brooks_index_value.h>
 
 #ifndef SCAN_ARRAYS_H
 #define SCAN_ARRAYS_H
@@ -34,6 +36,7 @@ extern "C" {
 // ---------------------------------------------------------------------------------------------------------------------
 
 typedef struct brooks_pool_t brooks_pool_t;
+typedef struct brooks_stats_t brooks_stats_t;
 
 // ---------------------------------------------------------------------------------------------------------------------
 // I N T E R F A C E   D E C L A R A T I O N
@@ -42,6 +45,28 @@ typedef struct brooks_pool_t brooks_pool_t;
 brooks_status_e brooks_operators_scan_arrays_create(brooks_operator_t *opp, brooks_array_t ** arrs, size_t num,
                                                     brooks_pool_t *pool);
 
+/**
+ * Points the operator to new input arrays, keeping its range predicate. See brooks_operators_scan_objects_rebind.
+ */
+brooks_status_e brooks_operators_scan_arrays_rebind(brooks_operator_t *opp, brooks_array_t ** arrs, size_t num);
+
+/**
+ * Scans the elements of number arrays that fall into the range given by 'lower' and 'upper' (NULL for unbounded).
+ * Blocks of arrays with a zone map (see brooks_doc_array_enable_zone_map) are skipped if their range is disjoint to
+ * the predicate.
+ */
+brooks_status_e brooks_operators_scan_arrays_create_range(brooks_operator_t *opp, brooks_array_t ** arrs, size_t num,
+                                                          const brooks_index_key_t *lower, bool lower_inclusive,
+                                                          const brooks_index_key_t *upper, bool upper_inclusive,
+                                                          brooks_pool_t *pool);
+
+/**
+ * Sizes the operator's cursor from the statistics of the arrays at 'key_path', scaled by the estimated selectivity of
+ * a range predicate. Must be called before the operator is opened.
+ */
+brooks_status_e brooks_operators_scan_arrays_set_stats(brooks_operator_t *opp, brooks_stats_t *stats,
+                                                       const char *key_path);
+
 #ifdef __cplusplus
 }
 #endif
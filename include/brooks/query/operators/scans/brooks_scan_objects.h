@@ -34,6 +34,7 @@ extern "C" {
 // ---------------------------------------------------------------------------------------------------------------------
 
 typedef struct brooks_pool_t brooks_pool_t;
+typedef struct brooks_stats_t brooks_stats_t;
 
 // ---------------------------------------------------------------------------------------------------------------------
 // I N T E R F A C E   D E C L A R A T I O N
@@ -42,6 +43,20 @@ typedef struct brooks_pool_t brooks_pool_t;
 brooks_status_e brooks_operators_scan_objects_create(brooks_operator_t *opp, brooks_object_t * const * objs,
                                                      size_t num, brooks_pool_t *pool);
 
+/**
+ * Points the operator to new input objects. The operator restarts on its next open and keeps its cursor, such that a
+ * rebound operator scans without allocations as long as the cursor is large enough.
+ */
+brooks_status_e brooks_operators_scan_objects_rebind(brooks_operator_t *opp, brooks_object_t * const * objs,
+                                                     size_t num);
+
+/**
+ * Sizes the operator's cursor from the statistics of the objects at 'key_path' instead of inspecting all inputs on
+ * open. Must be called before the operator is opened.
+ */
+brooks_status_e brooks_operators_scan_objects_set_stats(brooks_operator_t *opp, brooks_stats_t *stats,
+                                                        const char *key_path);
+
 #ifdef __cplusplus
 }
 #endif
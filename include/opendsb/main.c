@@ -1,164 +1,1089 @@
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <opendsb/odsb_datagen.h>
+#include <opendsb/odsb_bench.h>
+#include <opendsb/odsb_writer.h>
+#include <opendsb/odsb_querygen.h>
+#include <brooks/brooks_path.h>
+#include <brooks/brooks_patch.h>
+#include <brooks/brooks_query.h>
+#include <brooks/query/brooks_cursor.h>
+#include <brooks/index/brooks_index_value.h>
+#include <stdint.h>
 #include <time.h>
 
-int main(void) {
+#define ODSB_DEFAULT_NUM_DOCS             2000
+#define ODSB_DEFAULT_NUM_RUNS             3
+#define ODSB_DEFAULT_NUM_LOOKUPS          20000
+#define ODSB_DEFAULT_SEED                 42
+#define ODSB_FILTER_SELECTIVITY_PERCENT   1
+#define ODSB_MIXED_LOOKUP_PERCENT         50
+#define ODSB_MIXED_FILTER_PERCENT         30     // remainder is aggregation
+#define ODSB_DEFAULT_NUM_QUERIES          8
+#define ODSB_DEFAULT_SELECTIVITIES        "0.01,1,50"
+#define ODSB_MAX_SELECTIVITIES            16
+#define ODSB_VALUE_DOMAIN                 100000
+#define ODSB_VALUE_INT_BASE               (1ull << 32)    // above any "id", such that ids are outside the domain
 
-    odsb_prop_gen_params_t props = {
-        .hist_num_integer    = 10,
-        .hist_num_boolean    = 10,
-        .hist_num_decimal    = 10,
-        .hist_num_string     = 10,
-
-        .hist_num_array_integer = 10,
-        .hist_num_array_boolean = 10,
-        .hist_num_array_decimal = 10,
-        .hist_num_array_string = 10,
-        .hist_num_array_object = 10,
-        .hist_num_array_array = 10,
+typedef struct odsb_bench_config_t
+{
+    size_t num_docs;
+    size_t num_runs;
+    size_t num_lookups;
+    unsigned seed;
+    const char *workload;
+    const char *corpus;
+    bool json;
+    const char *write_prefix;
+    unsigned num_threads;
+    size_t target_bytes;
+    double selectivities[ODSB_MAX_SELECTIVITIES];
+    size_t num_selectivities;
+    size_t num_queries;
+    odsb_query_spec_t query_spec;
+    bool footprint;
+} odsb_bench_config_t;
+
+/**
+ * A generated collection of documents, each carrying a unique integer "id" next to the generated properties. The
+ * serialized form is created on demand for the 'parse' workload.
+ */
+typedef struct odsb_corpus_t
+{
+    const char *name;
+    odsb_doc_gen_t *gen;
+    brooks_pool_t *pool;
+    brooks_object_t **docs;
+    size_t num_docs;
+    size_t num_values;
+    char *text;
+    const char **texts;
+    size_t num_bytes;
+} odsb_corpus_t;
+
+typedef struct odsb_query_state_t
+{
+    brooks_pool_t *pool;
+    brooks_index_value_t *index;
+    brooks_cursor_t *cursor;
+    brooks_prepared_t *filter;
+    brooks_prepared_t *aggregation;
+    size_t filter_width;
+} odsb_query_state_t;
+
+/**
+ * A set of generated queries of the same shape and target selectivity, prepared for execution per document or, if
+ * 'index' is set, against the whole collection through a value index on their key path.
+ */
+typedef struct odsb_sweep_t
+{
+    brooks_pool_t *pool;
+    brooks_index_value_t *index;
+    odsb_query_t **queries;
+    brooks_prepared_t **prepared;
+    size_t num_queries;
+    size_t population;
+    double expected_selectivity;
+} odsb_sweep_t;
+
+typedef void (*odsb_workload_t)(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                                const odsb_bench_config_t *config);
+
+static const char *workload_names[] = {
+    "build", "parse", "parse_lazy", "parse_projected", "stream", "clone", "patch", "serialize", "full_scan",
+    "point_lookup", "selective_filter", "aggregation", "mixed", "sel_filter", "sel_index"
+};
+
+// workloads that are run once per selectivity of the configuration
+static const bool workload_sweeps[] = {
+    false, false, false, false, false, false, false, false, false, false, false, false, false, true, true
+};
+
+static const char *corpus_names[] = { "flat", "nested" };
+
+static void count_value(void *capture, const brooks_value_t *value)
+{
+    (*(size_t *) capture)++;
+}
+
+static brooks_path_t *all_values;
+
+static size_t document_num_values(const brooks_object_t *document)
+{
+    size_t num_values = 0;
+    brooks_path_visit(all_values, document, &num_values, count_value);
+    return num_values;
+}
 
+static bool is_number(void *capture, const brooks_type_e type)
+{
+    return (type == brooks_type_number_integer || type == brooks_type_number_double);
+}
+
+static odsb_doc_gen_t *corpus_generator(const char *name)
+{
+    odsb_prop_gen_params_t props = {
+        .hist_num_integer = 10, .hist_num_boolean = 10, .hist_num_decimal = 10, .hist_num_string = 10,
+        .hist_num_array_integer = 10, .hist_num_array_boolean = 10, .hist_num_array_decimal = 10,
+        .hist_num_array_string = 10, .hist_num_array_object = 10, .hist_num_array_array = 10,
         .hist_num_object = 10
     };
+    odsb_shape_gen_params_t flat = {
+        .max_depth = 1, .min_fanout = 8, .max_fanout = 16, .fanout_decay_percent = 100,
+        .min_array_length = 0, .max_array_length = 8
+    };
+    odsb_shape_gen_params_t nested = {
+        .max_depth = 4, .min_fanout = 2, .max_fanout = 6, .fanout_decay_percent = 75,
+        .min_array_length = 0, .max_array_length = 5
+    };
+
+    const char *prefixes[] = {
+        "int", "bool", "dec", "str", "arr-int", "arr-bool", "arr-dec", "arr-str", "arr-arr", "arr-obj", "obj"
+    };
+    odsb_histogram_t *keys[11];
+    char key[32];
+    for (size_t i = 0; i < 11; i++) {
+        keys[i] = odsb_histogram_new(4);
+        for (unsigned k = 1; k <= 4; k++) {
+            snprintf(key, sizeof(key), "%s-key_%u", prefixes[i], k);
+            odsb_histogram_key_add(keys[i], key, 10 * k);
+        }
+    }
+    odsb_key_gen_params_t *key_gen = odsb_key_gen_new(keys[0], keys[1], keys[2], keys[3], keys[4], keys[5], keys[6],
+                                                      keys[7], keys[8], keys[9], keys[10]);
+
+    // fine-grained domains let generated queries hit small selectivities, see odsb_querygen.h
+    odsb_histogram_t *val_int = odsb_histogram_new(ODSB_VALUE_DOMAIN);
+    odsb_histogram_t *val_boolean = odsb_histogram_new(2);
+    odsb_histogram_t *val_decimal = odsb_histogram_new(ODSB_VALUE_DOMAIN);
+    odsb_histogram_t *val_string = odsb_histogram_new(ODSB_VALUE_DOMAIN);
+    for (unsigned k = 0; k < ODSB_VALUE_DOMAIN; k++) {
+        char value[32];
+        snprintf(value, sizeof(value), "value-%06u", k);
+        odsb_histogram_value_int_add(val_int, ODSB_VALUE_INT_BASE + k, 1 + 2 * (k % 2));
+        odsb_histogram_value_double_add(val_decimal, k * 0.25, 1 + 2 * (k % 2));
+        odsb_histogram_value_string_add(val_string, value, 3 - 2 * (k % 2));
+    }
+    odsb_histogram_value_boolean_add(val_boolean, true, 3);
+    odsb_histogram_value_boolean_add(val_boolean, false, 1);
+    odsb_values_gen_params_t *values_gen = odsb_values_gen_new(val_int, val_boolean, val_decimal, val_string,
+                                                               NULL, NULL, NULL, NULL);
+
+    return odsb_doc_gen_new(&props, strcmp(name, "flat") == 0 ? &flat : &nested, key_gen, values_gen);
+}
+
+static void corpus_dispose(odsb_corpus_t *corpus)
+{
+    if (corpus->pool != NULL) {
+        brooks_pool_dispose(corpus->pool);
+    }
+    odsb_key_gen_free(corpus->gen->key_gen_params);
+    odsb_values_gen_free((odsb_values_gen_params_t *) corpus->gen->values_gen_params);
+    odsb_doc_gen_free(corpus->gen);
+    free(corpus->docs);
+    free(corpus->text);
+    free(corpus->texts);
+}
+
+// Serializes every document into one buffer, separated by terminating zeros
+static void corpus_serialize(odsb_corpus_t *corpus)
+{
+    if (corpus->text == NULL) {
+        FILE *file = tmpfile();
+        size_t *offsets = malloc(corpus->num_docs * sizeof(size_t));
+        for (size_t i = 0; i < corpus->num_docs; i++) {
+            offsets[i] = (size_t) ftell(file);
+            brooks_doc_print(file, corpus->docs[i]);
+            fputc('\0', file);
+        }
+        size_t length = (size_t) ftell(file);
+        corpus->text = malloc(length);
+        corpus->texts = malloc(corpus->num_docs * sizeof(char *));
+        rewind(file);
+        if (fread(corpus->text, 1, length, file) != length) {
+            length = 0;
+        }
+        for (size_t i = 0; i < corpus->num_docs; i++) {
+            corpus->texts[i] = corpus->text + offsets[i];
+        }
+        corpus->num_bytes = length - corpus->num_docs;
+        free(offsets);
+        fclose(file);
+    }
+}
+
+// Creates the corpus; the time to create each document is recorded as the 'build' workload
+static void workload_build(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                           const odsb_bench_config_t *config)
+{
+    corpus->num_docs = config->num_docs;
+    corpus->docs = malloc(config->num_docs * sizeof(brooks_object_t *));
+    brooks_pool_create(&corpus->pool);
+
+    for (size_t i = 0; i < config->num_docs; i++) {
+        uint64_t id = i, begin = odsb_now_ns();
+        odbs_document_make(&corpus->docs[i], corpus->pool, corpus->gen);
+        brooks_doc_add_integer(corpus->docs[i], "id", &id);
+        uint64_t elapsed = odsb_now_ns() - begin;
+        odsb_latencies_add(latencies, elapsed);
+        result->total_ns += elapsed;
+        corpus->num_values += document_num_values(corpus->docs[i]);
+    }
+    result->num_values = corpus->num_values;
+    result->pool_bytes = odsb_pool_bytes(corpus->pool);
+    result->checksum = corpus->num_values;
+}
+
+static void workload_serialize(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                               const odsb_bench_config_t *config)
+{
+    FILE *sink = tmpfile();
+    for (size_t run = 0; run < config->num_runs; run++) {
+        rewind(sink);
+        for (size_t i = 0; i < corpus->num_docs; i++) {
+            uint64_t begin = odsb_now_ns();
+            brooks_doc_print(sink, corpus->docs[i]);
+            uint64_t elapsed = odsb_now_ns() - begin;
+            odsb_latencies_add(latencies, elapsed);
+            result->total_ns += elapsed;
+        }
+        fflush(sink);
+        result->checksum = (uint64_t) ftell(sink);
+        result->num_bytes += (size_t) result->checksum;
+    }
+    result->num_values = corpus->num_values;
+    fclose(sink);
+}
+
+static void workload_parse(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                           const odsb_bench_config_t *config)
+{
+    corpus_serialize(corpus);
+    for (size_t run = 0; run < config->num_runs; run++) {
+        brooks_pool_t *pool;
+        brooks_object_t *document;
+        brooks_pool_create(&pool);
+        result->checksum = 0;
+        for (size_t i = 0; i < corpus->num_docs; i++) {
+            uint64_t begin = odsb_now_ns();
+            brooks_status_e status = brooks_doc_parse(&document, pool, corpus->texts[i]);
+            uint64_t elapsed = odsb_now_ns() - begin;
+            odsb_latencies_add(latencies, elapsed);
+            result->total_ns += elapsed;
+            result->checksum += (status == brooks_status_ok ? document_num_values(document) : 0);
+        }
+        result->num_bytes += corpus->num_bytes;
+        result->pool_bytes = odsb_pool_bytes(pool);
+        brooks_pool_dispose(pool);
+    }
+    result->num_values = corpus->num_values;
+}
+
+// Parses each document lazily and reads its "id" only, as when routing documents by a key; the checksum counts all
+// values outside of the measurement, which builds the rest of each document
+static void workload_parse_lazy(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                                const odsb_bench_config_t *config)
+{
+    corpus_serialize(corpus);
+    for (size_t run = 0; run < config->num_runs; run++) {
+        brooks_pool_t *pool;
+        brooks_object_t *document;
+        const brooks_value_t *id;
+        brooks_pool_create(&pool);
+        result->checksum = 0;
+        for (size_t i = 0; i < corpus->num_docs; i++) {
+            uint64_t begin = odsb_now_ns();
+            brooks_status_e status = brooks_doc_parse_lazy(&document, pool, corpus->texts[i]);
+            if (status == brooks_status_ok) {
+                status = brooks_doc_locate(&id, document, "id");
+            }
+            uint64_t elapsed = odsb_now_ns() - begin;
+            odsb_latencies_add(latencies, elapsed);
+            result->total_ns += elapsed;
+            result->checksum += (status == brooks_status_ok ? document_num_values(document) : 0);
+        }
+        result->num_bytes += corpus->num_bytes;
+        result->pool_bytes = odsb_pool_bytes(pool);
+        brooks_pool_dispose(pool);
+    }
+    result->num_values = corpus->num_values;
+}
+
+// Parses the "id" of each document only, skipping the other properties in the text
+static void workload_parse_projected(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                                     const odsb_bench_config_t *config)
+{
+    corpus_serialize(corpus);
+    for (size_t run = 0; run < config->num_runs; run++) {
+        brooks_pool_t *pool;
+        brooks_object_t *document;
+        brooks_path_t *id;
+        brooks_pool_create(&pool);
+        brooks_path_create(&id, pool, "id");
+        const brooks_path_t *paths[] = { id };
+        result->checksum = 0;
+        for (size_t i = 0; i < corpus->num_docs; i++) {
+            uint64_t begin = odsb_now_ns();
+            brooks_status_e status = brooks_doc_parse_projected(&document, pool, corpus->texts[i], paths, 1);
+            uint64_t elapsed = odsb_now_ns() - begin;
+            odsb_latencies_add(latencies, elapsed);
+            result->total_ns += elapsed;
+            result->checksum += (status == brooks_status_ok ? document_num_values(document) : 0);
+        }
+        result->num_bytes += corpus->num_bytes;
+        result->pool_bytes = odsb_pool_bytes(pool);
+        brooks_pool_dispose(pool);
+    }
+    result->num_values = corpus->num_values;
+}
+
+// Finds the numbers of each document in its text without building it, as an ETL filter does; the checksum counts
+// the matches
+static void workload_stream(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                            const odsb_bench_config_t *config)
+{
+    corpus_serialize(corpus);
+    for (size_t run = 0; run < config->num_runs; run++) {
+        brooks_pool_t *pool;
+        brooks_filter_t *numbers;
+        brooks_query_t *query;
+        brooks_pool_create(&pool);
+        brooks_filter_create(&numbers, pool, 0, SIZE_MAX);
+        brooks_filter_set_value_type(numbers, is_number);
+        brooks_query_create(&query, pool);
+        brooks_query_add_terminator(query, numbers);
+        result->checksum = 0;
+        for (size_t i = 0; i < corpus->num_docs; i++) {
+            size_t num_matches;
+            uint64_t begin = odsb_now_ns();
+            brooks_status_e status = brooks_query_stream(&num_matches, query, corpus->texts[i], NULL, NULL);
+            uint64_t elapsed = odsb_now_ns() - begin;
+            odsb_latencies_add(latencies, elapsed);
+            result->total_ns += elapsed;
+            result->checksum += (status == brooks_status_ok ? num_matches : 0);
+        }
+        result->num_bytes += corpus->num_bytes;
+        result->pool_bytes = odsb_pool_bytes(pool);
+        brooks_pool_dispose(pool);
+    }
+    result->num_values = corpus->num_values;
+}
+
+// Copies each document into a pool of its own, as when moving documents from a request into a cache
+static void workload_clone(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                           const odsb_bench_config_t *config)
+{
+    for (size_t run = 0; run < config->num_runs; run++) {
+        brooks_pool_t *pool;
+        brooks_object_t *document;
+        brooks_pool_create(&pool);
+        result->checksum = 0;
+        for (size_t i = 0; i < corpus->num_docs; i++) {
+            uint64_t begin = odsb_now_ns();
+            brooks_status_e status = brooks_doc_clone(&document, pool, corpus->docs[i]);
+            uint64_t elapsed = odsb_now_ns() - begin;
+            odsb_latencies_add(latencies, elapsed);
+            result->total_ns += elapsed;
+            result->checksum += (status == brooks_status_ok ? document_num_values(document) : 0);
+        }
+        result->pool_bytes = odsb_pool_bytes(pool);
+        brooks_pool_dispose(pool);
+    }
+    result->num_values = corpus->num_values;
+}
+
+// Diffs each document against the next one and applies the patch to a copy of the first, as when replicating
+// changes; the checksum counts the copies that end up equal to their target, i.e., whose diff to it is empty
+static void workload_patch(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                           const odsb_bench_config_t *config)
+{
+    FILE *sink = tmpfile();
+    char *text = NULL;
+    size_t capacity = 0;
+    for (size_t run = 0; sink != NULL && run < config->num_runs; run++) {
+        brooks_pool_t *pool;
+        brooks_pool_create(&pool);
+        result->checksum = 0;
+        for (size_t i = 0; i + 1 < corpus->num_docs; i++) {
+            brooks_object_t *copy;
+            brooks_array_t *patch;
+            size_t num_operations, length;
+            rewind(sink);
+            uint64_t begin = odsb_now_ns();
+            brooks_status_e status = brooks_patch_diff(&num_operations, sink, corpus->docs[i], corpus->docs[i + 1]);
+            fputc('\0', sink);
+            if ((length = (size_t) ftell(sink)) > capacity) {
+                capacity = 2 * length;
+                text = realloc(text, capacity);
+            }
+            rewind(sink);
+            if (status == brooks_status_ok && fread(text, 1, length, sink) == length &&
+                (status = brooks_doc_clone(&copy, pool, corpus->docs[i])) == brooks_status_ok &&
+                (status = brooks_patch_parse(&patch, pool, text)) == brooks_status_ok) {
+                status = brooks_patch_apply(copy, patch);
+            }
+            uint64_t elapsed = odsb_now_ns() - begin;
+            odsb_latencies_add(latencies, elapsed);
+            result->total_ns += elapsed;
+            result->num_bytes += length;
+
+            rewind(sink);
+            if (status == brooks_status_ok &&
+                brooks_patch_diff(&num_operations, sink, copy, corpus->docs[i + 1]) == brooks_status_ok &&
+                num_operations == 0) {
+                result->checksum++;
+            } else if (run == 0) {
+                fprintf(stderr, "patch from document %zu does not reproduce document %zu (status %d)\n", i, i + 1,
+                        status);
+            }
+        }
+        result->pool_bytes = odsb_pool_bytes(pool);
+        brooks_pool_dispose(pool);
+    }
+    result->num_values = corpus->num_values;
+    free(text);
+    if (sink != NULL) {
+        fclose(sink);
+    }
+}
+
+static void workload_full_scan(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                               const odsb_bench_config_t *config)
+{
+    for (size_t run = 0; run < config->num_runs; run++) {
+        result->checksum = 0;
+        for (size_t i = 0; i < corpus->num_docs; i++) {
+            uint64_t begin = odsb_now_ns();
+            result->checksum += document_num_values(corpus->docs[i]);
+            uint64_t elapsed = odsb_now_ns() - begin;
+            odsb_latencies_add(latencies, elapsed);
+            result->total_ns += elapsed;
+        }
+    }
+    result->num_values = corpus->num_values;
+}
+
+static void query_state_create(odsb_query_state_t *state, odsb_corpus_t *corpus)
+{
+    brooks_filter_t *filter, *numbers;
+    brooks_query_t *query;
 
-    odsb_table_t *prop_table = odbs_table_by_prop(&props);
-    srandom(time(NULL));
+    brooks_pool_create(&state->pool);
+    brooks_cursor_create(&state->cursor, 16, state->pool);
+    brooks_index_value_create(&state->index, state->pool, "id");
+    for (size_t i = 0; i < corpus->num_docs; i++) {
+        brooks_index_value_add(state->index, corpus->docs[i]);
+    }
+
+    // the first lookup merges the staged entries, which is not part of the measurement
+    brooks_index_key_t key = { .type = brooks_type_number_integer, .integer = 0 };
+    brooks_index_value_lookup(state->cursor, state->index, &key, true, &key, true);
+
+    state->filter_width = corpus->num_docs * ODSB_FILTER_SELECTIVITY_PERCENT / 100;
+    state->filter_width = (state->filter_width > 0 ? state->filter_width : 1);
+    brooks_index_key_t lower = { .type = brooks_type_number_integer,
+                                 .integer = odsb_random((long) (corpus->num_docs - state->filter_width + 1)) };
+    brooks_index_key_t upper = { .type = brooks_type_number_integer, .integer = lower.integer + state->filter_width };
+    brooks_filter_create(&filter, state->pool, 0, 0);
+    brooks_filter_set_key_path(filter, "id");
+    brooks_filter_set_value_range(filter, &lower, true, &upper, false);
+    brooks_query_create(&query, state->pool);
+    brooks_query_add_terminator(query, filter);
+    brooks_query_prepare(&state->filter, query);
+
+    brooks_filter_create(&numbers, state->pool, 0, SIZE_MAX);
+    brooks_filter_set_value_type(numbers, is_number);
+    brooks_query_create(&query, state->pool);
+    brooks_query_add_terminator(query, numbers);
+    brooks_query_prepare(&state->aggregation, query);
+}
+
+static void query_state_dispose(odsb_query_state_t *state)
+{
+    brooks_prepared_dispose(state->filter);
+    brooks_prepared_dispose(state->aggregation);
+    brooks_index_value_dispose(state->index);
+    brooks_cursor_dispose(state->cursor);
+    brooks_pool_dispose(state->pool);
+}
+
+static uint64_t query_point_lookup(odsb_query_state_t *state, size_t num_docs)
+{
+    size_t num_results;
+    brooks_index_key_t key = { .type = brooks_type_number_integer, .integer = odsb_random((long) num_docs) };
+    brooks_cursor_clear(state->cursor);
+    brooks_index_value_lookup(state->cursor, state->index, &key, true, &key, true);
+    brooks_cursor_read(&num_results, state->cursor);
+    return num_results;
+}
+
+static uint64_t query_filter(odsb_query_state_t *state, const brooks_object_t *document)
+{
+    size_t num_results;
+    const brooks_cursor_t *cursor;
+    brooks_prepared_execute(&cursor, state->filter, document, brooks_traversal_breadth_first);
+    brooks_cursor_read(&num_results, cursor);
+    return num_results;
+}
+
+// Sums up all numbers in the document; the checksum takes the integral part
+static uint64_t query_aggregate(odsb_query_state_t *state, const brooks_object_t *document)
+{
+    size_t num_results;
+    const brooks_cursor_t *cursor;
+    double sum = 0;
+    brooks_prepared_execute(&cursor, state->aggregation, document, brooks_traversal_depth_first);
+    brooks_value_t **values = brooks_cursor_read(&num_results, cursor);
+    for (size_t i = 0; i < num_results; i++) {
+        brooks_type_e type;
+        brooks_doc_value_get_type(&type, values[i]);
+        sum += (type == brooks_type_number_integer ? (double) brooks_doc_value_as_integer(values[i]) :
+                                                      brooks_doc_value_as_double(values[i]));
+    }
+    return (uint64_t) sum;
+}
+
+static void workload_point_lookup(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                                  const odsb_bench_config_t *config)
+{
+    odsb_query_state_t state;
+    query_state_create(&state, corpus);
+    for (size_t i = 0; i < config->num_lookups; i++) {
+        uint64_t begin = odsb_now_ns();
+        result->checksum += query_point_lookup(&state, corpus->num_docs);
+        uint64_t elapsed = odsb_now_ns() - begin;
+        odsb_latencies_add(latencies, elapsed);
+        result->total_ns += elapsed;
+    }
+    result->num_values = corpus->num_values;
+    result->pool_bytes = odsb_pool_bytes(state.pool);
+    query_state_dispose(&state);
+}
+
+static void workload_selective_filter(odsb_bench_result_t *result, odsb_latencies_t *latencies,
+                                      odsb_corpus_t *corpus, const odsb_bench_config_t *config)
+{
+    odsb_query_state_t state;
+    query_state_create(&state, corpus);
+    for (size_t run = 0; run < config->num_runs; run++) {
+        for (size_t i = 0; i < corpus->num_docs; i++) {
+            uint64_t begin = odsb_now_ns();
+            result->checksum += query_filter(&state, corpus->docs[i]);
+            uint64_t elapsed = odsb_now_ns() - begin;
+            odsb_latencies_add(latencies, elapsed);
+            result->total_ns += elapsed;
+        }
+    }
+    result->num_values = corpus->num_values;
+    result->pool_bytes = odsb_pool_bytes(state.pool);
+    query_state_dispose(&state);
+}
+
+static void workload_aggregation(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                                 const odsb_bench_config_t *config)
+{
+    odsb_query_state_t state;
+    query_state_create(&state, corpus);
+    for (size_t run = 0; run < config->num_runs; run++) {
+        for (size_t i = 0; i < corpus->num_docs; i++) {
+            uint64_t begin = odsb_now_ns();
+            result->checksum += query_aggregate(&state, corpus->docs[i]);
+            uint64_t elapsed = odsb_now_ns() - begin;
+            odsb_latencies_add(latencies, elapsed);
+            result->total_ns += elapsed;
+        }
+    }
+    result->num_values = corpus->num_values;
+    result->pool_bytes = odsb_pool_bytes(state.pool);
+    query_state_dispose(&state);
+}
+
+// Point lookups, selective filters and aggregations over random documents, interleaved
+static void workload_mixed(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                           const odsb_bench_config_t *config)
+{
+    odsb_query_state_t state;
+    query_state_create(&state, corpus);
+    for (size_t i = 0; i < config->num_lookups; i++) {
+        size_t dice = odsb_random(100);
+        const brooks_object_t *document = corpus->docs[odsb_random((long) corpus->num_docs)];
+        uint64_t begin = odsb_now_ns();
+        if (dice < ODSB_MIXED_LOOKUP_PERCENT) {
+            result->checksum += query_point_lookup(&state, corpus->num_docs);
+        } else if (dice < ODSB_MIXED_LOOKUP_PERCENT + ODSB_MIXED_FILTER_PERCENT) {
+            result->checksum += query_filter(&state, document);
+        } else {
+            result->checksum += query_aggregate(&state, document);
+        }
+        uint64_t elapsed = odsb_now_ns() - begin;
+        odsb_latencies_add(latencies, elapsed);
+        result->total_ns += elapsed;
+    }
+    result->num_values = corpus->num_values;
+    result->pool_bytes = odsb_pool_bytes(state.pool);
+    query_state_dispose(&state);
+}
+
+static void sweep_create(odsb_sweep_t *sweep, odsb_corpus_t *corpus, const odsb_bench_config_t *config,
+                         double selectivity, bool indexed)
+{
+    odsb_query_spec_t spec = config->query_spec;
+    spec.selectivity = selectivity;
+
+    *sweep = (odsb_sweep_t) { .num_queries = 0 };
+    brooks_pool_create(&sweep->pool);
+    sweep->queries = malloc(config->num_queries * sizeof(odsb_query_t *));
+    sweep->prepared = malloc(config->num_queries * sizeof(brooks_prepared_t *));
+    for (size_t i = 0; i < config->num_queries; i++) {
+        if (odsb_query_make(&sweep->queries[i], sweep->pool, corpus->gen->values_gen_params, &spec) !=
+                brooks_status_ok) {
+            break;
+        }
+        sweep->expected_selectivity += sweep->queries[i]->expected_selectivity / config->num_queries;
+        sweep->num_queries++;
+    }
+    if (sweep->num_queries == 0) {
+        return;
+    }
+
+    // all queries of a sweep share key path, type and domain, hence their population
+    for (size_t i = 0; i < corpus->num_docs; i++) {
+        sweep->population += odsb_query_population(sweep->queries[0], corpus->docs[i]);
+    }
+
+    if (indexed) {
+        brooks_cursor_t *cursor;
+        brooks_index_value_create(&sweep->index, sweep->pool, sweep->queries[0]->key_path);
+        for (size_t i = 0; i < corpus->num_docs; i++) {
+            brooks_index_value_add(sweep->index, corpus->docs[i]);
+        }
+        // the first lookup merges the staged entries, which is not part of the measurement
+        brooks_cursor_create(&cursor, 16, sweep->pool);
+        brooks_index_value_lookup(cursor, sweep->index, &sweep->queries[0]->lower, true, &sweep->queries[0]->lower,
+                                  true);
+        brooks_cursor_dispose(cursor);
+    }
+    for (size_t i = 0; i < sweep->num_queries; i++) {
+        if (indexed) {
+            brooks_query_add_index(sweep->queries[i]->query, sweep->index);
+        }
+        brooks_query_prepare(&sweep->prepared[i], sweep->queries[i]->query);
+    }
+}
+
+// Reports the sweep's selectivities from the matches of one run, which are summed up in the checksum
+static void sweep_finish(odsb_bench_result_t *result, odsb_sweep_t *sweep, odsb_corpus_t *corpus)
+{
+    double num_candidates = (double) sweep->population * sweep->num_queries;
+    result->selectivity_expected = sweep->expected_selectivity;
+    result->selectivity_observed = (num_candidates > 0 ? result->checksum / num_candidates : 0);
+    result->num_values = corpus->num_values;
+    result->pool_bytes = odsb_pool_bytes(sweep->pool);
+
+    for (size_t i = 0; i < sweep->num_queries; i++) {
+        brooks_prepared_dispose(sweep->prepared[i]);
+    }
+    if (sweep->index != NULL) {
+        brooks_index_value_dispose(sweep->index);
+    }
+    brooks_pool_dispose(sweep->pool);
+    free(sweep->queries);
+    free(sweep->prepared);
+}
 
-    for (int i = 0; i < 10; i++) {
+// Runs generated queries of the target selectivity through a traversal of each document
+static void workload_sel_filter(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                                const odsb_bench_config_t *config)
+{
+    odsb_sweep_t sweep;
+    sweep_create(&sweep, corpus, config, result->selectivity_target, false);
+    for (size_t run = 0; run < config->num_runs; run++) {
+        result->checksum = 0;
+        for (size_t q = 0; q < sweep.num_queries; q++) {
+            for (size_t i = 0; i < corpus->num_docs; i++) {
+                size_t num_results;
+                const brooks_cursor_t *cursor;
+                uint64_t begin = odsb_now_ns();
+                brooks_prepared_execute(&cursor, sweep.prepared[q], corpus->docs[i], brooks_traversal_breadth_first);
+                brooks_cursor_read(&num_results, cursor);
+                uint64_t elapsed = odsb_now_ns() - begin;
+                odsb_latencies_add(latencies, elapsed);
+                result->total_ns += elapsed;
+                result->checksum += num_results;
+            }
+        }
+    }
+    sweep_finish(result, &sweep, corpus);
+}
 
-        const void *random = odbs_table_random(prop_table);
-        printf("%d\n", *(odsb_prop_type_e *) random);
+// Runs generated queries of the target selectivity against the whole collection through a value index
+static void workload_sel_index(odsb_bench_result_t *result, odsb_latencies_t *latencies, odsb_corpus_t *corpus,
+                               const odsb_bench_config_t *config)
+{
+    odsb_sweep_t sweep;
+    sweep_create(&sweep, corpus, config, result->selectivity_target, true);
+    for (size_t run = 0; run < config->num_runs; run++) {
+        result->checksum = 0;
+        for (size_t q = 0; q < sweep.num_queries; q++) {
+            size_t num_results;
+            const brooks_cursor_t *cursor;
+            uint64_t begin = odsb_now_ns();
+            brooks_prepared_execute(&cursor, sweep.prepared[q], NULL, brooks_traversal_breadth_first);
+            brooks_cursor_read(&num_results, cursor);
+            uint64_t elapsed = odsb_now_ns() - begin;
+            odsb_latencies_add(latencies, elapsed);
+            result->total_ns += elapsed;
+            result->checksum += num_results;
+        }
     }
+    sweep_finish(result, &sweep, corpus);
+}
+
+static const odsb_workload_t workloads[] = {
+    workload_build, workload_parse, workload_parse_lazy, workload_parse_projected, workload_stream, workload_clone,
+    workload_patch, workload_serialize, workload_full_scan, workload_point_lookup, workload_selective_filter,
+    workload_aggregation, workload_mixed, workload_sel_filter, workload_sel_index
+};
+
+static bool selected(const char *selection, const char *name)
+{
+    return (strcmp(selection, "all") == 0 || strcmp(selection, name) == 0);
+}
 
-    odsb_histogram_t *histogram = odsb_histogram_new(3);
-    odsb_histogram_key_add(histogram, "Hello World", 5);
-    odsb_histogram_key_add(histogram, "Hello Mister", 5);
-    odsb_histogram_key_add(histogram, "Max Mustermann", 5);
-    odsb_histogram_key_add(histogram, "Hanna Montana", 100);
+// Accepts an optional binary suffix, e.g., "50G"
+static size_t parse_size(const char *text, size_t fallback)
+{
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    const char *suffixes = "KMGT";
+    const char *suffix = (*end != '\0' ? strchr(suffixes, *end) : NULL);
+    if (suffix != NULL && end[1] == '\0') {
+        value <<= 10 * (suffix - suffixes + 1);
+        end++;
+    }
+    return (*end == '\0' && value > 0 ? (size_t) value : fallback);
+}
 
+// Parses a comma separated list of percentages, e.g., "0.01,1,50"
+static bool parse_selectivities(odsb_bench_config_t *config, const char *text)
+{
+    char *end;
+    config->num_selectivities = 0;
+    while (*text != '\0' && config->num_selectivities < ODSB_MAX_SELECTIVITIES) {
+        double percent = strtod(text, &end);
+        if (end == text || !(percent > 0 && percent <= 100) || (*end != ',' && *end != '\0')) {
+            return false;
+        }
+        config->selectivities[config->num_selectivities++] = percent / 100;
+        text = (*end == ',' ? end + 1 : end);
+    }
+    return (*text == '\0' && config->num_selectivities > 0);
+}
 
-    odsb_histogram_t *val_int = odsb_histogram_new(3);
-    odsb_histogram_t *val_boolean = odsb_histogram_new(3);
-    odsb_histogram_t *val_decimal = odsb_histogram_new(3);
-    odsb_histogram_t *val_string = odsb_histogram_new(3);
-    odsb_histogram_t *array_int = odsb_histogram_new(3);
-    odsb_histogram_t *array_decimal = odsb_histogram_new(3);
-    odsb_histogram_t *array_boolean = odsb_histogram_new(3);
-    odsb_histogram_t *array_string = odsb_histogram_new(3);
-    odsb_histogram_t *array_array = odsb_histogram_new(3);
-    odsb_histogram_t *array_object = odsb_histogram_new(3);
-    odsb_histogram_t *object = odsb_histogram_new(3);
+// Streams a corpus to disk instead of running the benchmarks
+static int write_corpus(const odsb_bench_config_t *config, bool docs_given)
+{
+    const char *corpus = (strcmp(config->corpus, "flat") == 0 ? "flat" : "nested");
+    odsb_doc_gen_t *gen = corpus_generator(corpus);
+    odsb_writer_config_t writer = {
+        .prefix = config->write_prefix, .gen = gen, .num_threads = config->num_threads, .seed = config->seed,
+        .num_docs = (docs_given || config->target_bytes == 0 ? config->num_docs : 0),
+        .target_bytes = config->target_bytes, .buffer_size = ODSB_WRITER_BUFFER_SIZE
+    };
+    odsb_writer_stats_t stats;
+    brooks_status_e status = odsb_writer_run(&stats, &writer);
+    double seconds = stats.elapsed_ns / 1e9;
+    double mb_per_sec = (seconds > 0 ? stats.num_bytes / (1024.0 * 1024.0) / seconds : 0);
 
-    odsb_histogram_key_add(val_int, "int-key_1", 10);
-    odsb_histogram_key_add(val_int, "int-key_2", 20);
-    odsb_histogram_key_add(val_int, "int-key_3", 30);
+    if (status != brooks_status_ok) {
+        fprintf(stderr, "unable to write corpus '%s' (status %d)\n", config->write_prefix, status);
+    } else if (config->json) {
+        printf("{ \"corpus\": \"%s\", \"prefix\": \"%s\", \"partitions\": %u, \"docs\": %zu, \"bytes\": %zu, "
+               "\"total_ns\": %llu, \"mb_per_sec\": %.3f, \"peak_rss_kb\": %zu }\n", corpus, config->write_prefix,
+               stats.num_partitions, stats.num_docs, stats.num_bytes, (unsigned long long) stats.elapsed_ns,
+               mb_per_sec, odsb_peak_rss_kb());
+    } else {
+        printf("wrote %zu %s documents (%zu bytes) to %u partition(s) of '%s' in %.3f s (%.2f MiB/s, peak RSS %zu KiB)"
+               "\n", stats.num_docs, corpus, stats.num_bytes, stats.num_partitions, config->write_prefix, seconds,
+               mb_per_sec, odsb_peak_rss_kb());
+    }
 
-    odsb_histogram_key_add(val_boolean, "bool-key_1", 10);
-    odsb_histogram_key_add(val_boolean, "bool-key_2", 20);
-    odsb_histogram_key_add(val_boolean, "bool-key_3", 30);
-
-    odsb_histogram_key_add(val_decimal, "dec-key_1", 10);
-    odsb_histogram_key_add(val_decimal, "dec-key_2", 20);
-    odsb_histogram_key_add(val_decimal, "dec-key_3", 30);
+    odsb_key_gen_free(gen->key_gen_params);
+    odsb_values_gen_free((odsb_values_gen_params_t *) gen->values_gen_params);
+    odsb_doc_gen_free(gen);
+    return (status == brooks_status_ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
 
-    odsb_histogram_key_add(val_string, "str-key_1", 10);
-    odsb_histogram_key_add(val_string, "str-key_2", 20);
-    odsb_histogram_key_add(val_string, "str-key_3", 30);
+static void footprint_print_row(const char *name, size_t count, size_t bytes, size_t total)
+{
+    printf("  %-24s %12zu %14zu %10.1f %7.1f%%\n", name, count, bytes, (count > 0 ? (double) bytes / count : 0),
+           (total > 0 ? 100.0 * bytes / total : 0));
+}
 
-    odsb_histogram_key_add(array_int, "arr-int-key_1", 10);
-    odsb_histogram_key_add(array_int, "arr-int-key_2", 20);
-    odsb_histogram_key_add(array_int, "arr-int-key_3", 30);
+/**
+ * Loads a corpus by parsing its serialized form into a fresh pool and reports where the memory goes: the document
+ * structures (see brooks_doc_footprint_t), blocks abandoned by resizes and the allocator's overhead (see
+ * brooks_pool_stats_t), in relation to the number of values and the size of the raw JSON text.
+ */
+static void footprint_report(const char *name, const odsb_bench_config_t *config, bool first)
+{
+    odsb_seed(config->seed, 0);
+    odsb_corpus_t corpus = { .name = name, .gen = corpus_generator(name), .num_docs = config->num_docs };
+    corpus.docs = malloc(corpus.num_docs * sizeof(brooks_object_t *));
+    brooks_pool_create(&corpus.pool);
+    for (uint64_t i = 0; i < corpus.num_docs; i++) {
+        odbs_document_make(&corpus.docs[i], corpus.pool, corpus.gen);
+        brooks_doc_add_integer(corpus.docs[i], "id", &i);
+    }
+    corpus_serialize(&corpus);
 
-    odsb_histogram_key_add(array_decimal, "arr-dec-key_1", 10);
-    odsb_histogram_key_add(array_decimal, "arr-dec-key_2", 20);
-    odsb_histogram_key_add(array_decimal, "arr-dec-key_3", 30);
+    brooks_pool_t *pool;
+    brooks_object_t *document;
+    brooks_doc_footprint_t footprint;
+    brooks_pool_stats_t stats;
+    brooks_shape_stats_t shape_stats;
+    brooks_pool_create(&pool);
+    memset(&footprint, 0, sizeof(footprint));
+    for (size_t i = 0; i < corpus.num_docs; i++) {
+        if (brooks_doc_parse(&document, pool, corpus.texts[i]) == brooks_status_ok) {
+            brooks_doc_footprint(&footprint, document);
+        }
+    }
+    brooks_pool_get_stats(&stats, pool);
+    brooks_shape_registry_get_stats(&shape_stats, brooks_pool_get_shapes(pool));
 
-    odsb_histogram_key_add(array_boolean, "arr-bool-key_1", 10);
-    odsb_histogram_key_add(array_boolean, "arr-bool-key_2", 20);
-    odsb_histogram_key_add(array_boolean, "arr-bool-key_3", 30);
+    size_t doc_bytes = footprint.bytes_objects + footprint.bytes_arrays + footprint.bytes_unnamed_entries +
+                       footprint.bytes_values + footprint.bytes_slots + footprint.bytes_slack + footprint.bytes_zones +
+                       footprint.bytes_strings + footprint.bytes_lazy;
+    size_t garbage = stats.category_bytes[brooks_pool_category_garbage];
+    size_t shapes = stats.category_bytes[brooks_pool_category_shape];
+    size_t allocator = stats.bytes_reserved - stats.bytes_requested;
+    size_t accounted = garbage + shapes + doc_bytes;
+    size_t other = (stats.bytes_requested > accounted ? stats.bytes_requested - accounted : 0);
+    double raw = (double) corpus.num_bytes;
+    double values = (double) footprint.num_values;
 
-    odsb_histogram_key_add(array_string, "arr-str-key_1", 10);
-    odsb_histogram_key_add(array_string, "arr-str-key_2", 20);
-    odsb_histogram_key_add(array_string, "arr-str-key_3", 30);
+    if (config->json) {
+        printf("%s\n  { \"corpus\": \"%s\", \"documents\": %zu, \"values\": %zu, \"raw_bytes\": %zu, "
+               "\"reserved_bytes\": %zu, \"requested_bytes\": %zu, \"document_bytes\": %zu, "
+               "\"bytes_per_value\": %.3f, \"raw_bytes_per_value\": %.3f, \"overhead_vs_raw\": %.3f, ",
+               first ? "" : ",", name, footprint.num_documents, footprint.num_values, corpus.num_bytes,
+               stats.bytes_reserved, stats.bytes_requested, doc_bytes, stats.bytes_reserved / values, raw / values,
+               stats.bytes_reserved / raw);
+        printf("\"objects\": %zu, \"object_bytes\": %zu, \"arrays\": %zu, \"array_bytes\": %zu, "
+               "\"properties\": %zu, \"unnamed_entries\": %zu, \"unnamed_entry_bytes\": %zu, \"value_bytes\": %zu, "
+               "\"slot_bytes\": %zu, \"slack_bytes\": %zu, \"zone_bytes\": %zu, \"string_bytes\": %zu, "
+               "\"lazy_bytes\": %zu, \"pointer_bytes\": %zu, \"shapes\": %zu, \"shape_keys\": %zu, "
+               "\"shape_bytes\": %zu, \"garbage_bytes\": %zu, \"allocator_bytes\": %zu, \"other_bytes\": %zu, "
+               "\"types\": {",
+               footprint.num_objects, footprint.bytes_objects, footprint.num_arrays, footprint.bytes_arrays,
+               footprint.num_properties, footprint.num_unnamed_entries, footprint.bytes_unnamed_entries,
+               footprint.bytes_values, footprint.bytes_slots, footprint.bytes_slack, footprint.bytes_zones,
+               footprint.bytes_strings, footprint.bytes_lazy, footprint.bytes_pointers, shape_stats.num_shapes,
+               shape_stats.num_keys, shapes, garbage, allocator, other);
+        for (brooks_type_e type = brooks_type_object; type <= brooks_type_null; type++) {
+            printf("%s \"%s\": { \"values\": %zu, \"bytes\": %zu }", type > brooks_type_object ? "," : "",
+                   brooks_doc_type_str(type), footprint.type_values[type], footprint.type_bytes[type]);
+        }
+        printf(" } }");
+    } else {
+        printf("%s%s: %zu documents, %zu values, %zu bytes of JSON (%.1f B/value), %zu bytes reserved (%.1f B/value, "
+               "%.2fx JSON)\n", first ? "" : "\n", name, footprint.num_documents, footprint.num_values,
+               corpus.num_bytes, raw / values, stats.bytes_reserved, stats.bytes_reserved / values,
+               stats.bytes_reserved / raw);
+        printf("  %-24s %12s %14s %10s %8s\n", "structure", "count", "bytes", "B/each", "share");
+        footprint_print_row("brooks_object_t", footprint.num_objects, footprint.bytes_objects, stats.bytes_reserved);
+        footprint_print_row("brooks_array_t", footprint.num_arrays, footprint.bytes_arrays, stats.bytes_reserved);
+        footprint_print_row("brooks_unnamed_entry_t", footprint.num_unnamed_entries, footprint.bytes_unnamed_entries,
+                            stats.bytes_reserved);
+        footprint_print_row("brooks_value_t", footprint.num_values, footprint.bytes_values, stats.bytes_reserved);
+        footprint_print_row("entries (used slots)", footprint.num_unnamed_entries, footprint.bytes_slots,
+                            stats.bytes_reserved);
+        footprint_print_row("slots (over capacity)", footprint.num_objects + footprint.num_arrays,
+                            footprint.bytes_slack, stats.bytes_reserved);
+        footprint_print_row("zone maps", footprint.num_arrays, footprint.bytes_zones, stats.bytes_reserved);
+        footprint_print_row("shapes (shared)", shape_stats.num_shapes, shapes, stats.bytes_reserved);
+        footprint_print_row("strings", footprint.type_values[brooks_type_string], footprint.bytes_strings,
+                            stats.bytes_reserved);
+        footprint_print_row("lazy texts and indexes", footprint.bytes_lazy > 0 ? footprint.num_documents : 0,
+                            footprint.bytes_lazy, stats.bytes_reserved);
+        footprint_print_row("abandoned resize buffers", stats.category_allocations[brooks_pool_category_garbage],
+                            garbage, stats.bytes_reserved);
+        footprint_print_row("allocator overhead", stats.num_allocations, allocator, stats.bytes_reserved);
+        footprint_print_row("other", 0, other, stats.bytes_reserved);
+        printf("  pointers: %zu bytes, %.1f%% of the document structures\n", footprint.bytes_pointers,
+               (doc_bytes > 0 ? 100.0 * footprint.bytes_pointers / doc_bytes : 0));
+        printf("  %-24s %12s %14s %10s %8s\n", "type", "values", "bytes", "B/value", "share");
+        for (brooks_type_e type = brooks_type_object; type <= brooks_type_null; type++) {
+            footprint_print_row(brooks_doc_type_str(type), footprint.type_values[type], footprint.type_bytes[type],
+                                doc_bytes);
+        }
+    }
+    fflush(stdout);
 
-    odsb_histogram_key_add(array_array, "arr-arr-key_1", 10);
-    odsb_histogram_key_add(array_array, "arr-arr-key_2", 20);
-    odsb_histogram_key_add(array_array, "arr-arr-key_3", 30);
+    brooks_pool_dispose(pool);
+    corpus_dispose(&corpus);
+}
 
-    odsb_histogram_key_add(array_object, "arr-obj-key_1", 10);
-    odsb_histogram_key_add(array_object, "arr-obj-key_2", 20);
-    odsb_histogram_key_add(array_object, "arr-obj-key_3", 30);
+static void usage(FILE *file, const char *program)
+{
+    fprintf(file, "usage: %s [--workload NAME|all] [--corpus flat|nested|all] [--docs N] [--runs N] [--lookups N] "
+                  "[--seed N] [--json]\n", program);
+    fprintf(file, "       %*s [--selectivity PERCENT,...] [--predicate NAME] [--path-depth N] [--conjuncts N] "
+                  "[--queries N]\n", (int) strlen(program), "");
+    fprintf(file, "       %s --footprint [--corpus flat|nested|all] [--docs N] [--seed N] [--json]\n", program);
+    fprintf(file, "       %s --write PREFIX [--corpus flat|nested] [--threads N] [--docs N] [--target-size SIZE] "
+                  "[--seed N] [--json]\n", program);
+    fprintf(file, "workloads:");
+    for (size_t i = 0; i < sizeof(workload_names) / sizeof(workload_names[0]); i++) {
+        fprintf(file, " %s", workload_names[i]);
+    }
+    fprintf(file, "\npredicates:");
+    for (size_t i = 0; i < sizeof(odsb_predicate_names) / sizeof(odsb_predicate_names[0]); i++) {
+        fprintf(file, " %s", odsb_predicate_names[i]);
+    }
+    fprintf(file, "\n");
+}
 
-    odsb_histogram_key_add(object, "obj-key_1", 10);
-    odsb_histogram_key_add(object, "obj-key_2", 20);
-    odsb_histogram_key_add(object, "obj-key_3", 30);
+int main(int argc, char *argv[])
+{
+    odsb_bench_config_t config = {
+        .num_docs = ODSB_DEFAULT_NUM_DOCS, .num_runs = ODSB_DEFAULT_NUM_RUNS,
+        .num_lookups = ODSB_DEFAULT_NUM_LOOKUPS, .seed = ODSB_DEFAULT_SEED, .workload = "all", .corpus = "all",
+        .json = false, .write_prefix = NULL, .num_threads = 1, .target_bytes = 0,
+        .num_queries = ODSB_DEFAULT_NUM_QUERIES,
+        .query_spec = { .predicate = odsb_predicate_int_range, .path_depth = 1, .num_conjuncts = 1 }
+    };
+    parse_selectivities(&config, ODSB_DEFAULT_SELECTIVITIES);
+    bool docs_given = false;
 
-    odsb_key_gen_params_t *key_gen = odsb_key_gen_new(val_int, val_boolean, val_decimal, val_string,
-                                             array_int, array_boolean, array_decimal, array_string, array_array,
-                                             array_object, object);
+    for (int i = 1; i < argc; i++) {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--json") == 0) {
+            config.json = true;
+        } else if (strcmp(argv[i], "--footprint") == 0) {
+            config.footprint = true;
+        } else if (strcmp(argv[i], "--workload") == 0 && has_value) {
+            config.workload = argv[++i];
+        } else if (strcmp(argv[i], "--corpus") == 0 && has_value) {
+            config.corpus = argv[++i];
+        } else if (strcmp(argv[i], "--docs") == 0 && has_value) {
+            config.num_docs = parse_size(argv[++i], config.num_docs);
+            docs_given = true;
+        } else if (strcmp(argv[i], "--runs") == 0 && has_value) {
+            config.num_runs = parse_size(argv[++i], config.num_runs);
+        } else if (strcmp(argv[i], "--lookups") == 0 && has_value) {
+            config.num_lookups = parse_size(argv[++i], config.num_lookups);
+        } else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            config.seed = (unsigned) parse_size(argv[++i], config.seed);
+        } else if (strcmp(argv[i], "--write") == 0 && has_value) {
+            config.write_prefix = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+            config.num_threads = (unsigned) parse_size(argv[++i], config.num_threads);
+        } else if (strcmp(argv[i], "--target-size") == 0 && has_value) {
+            config.target_bytes = parse_size(argv[++i], config.target_bytes);
+        } else if (strcmp(argv[i], "--selectivity") == 0 && has_value && parse_selectivities(&config, argv[i + 1])) {
+            i++;
+        } else if (strcmp(argv[i], "--predicate") == 0 && has_value &&
+                   odsb_predicate_by_name(&config.query_spec.predicate, argv[i + 1])) {
+            i++;
+        } else if (strcmp(argv[i], "--path-depth") == 0 && has_value) {
+            config.query_spec.path_depth = (unsigned) parse_size(argv[++i], config.query_spec.path_depth);
+        } else if (strcmp(argv[i], "--conjuncts") == 0 && has_value) {
+            config.query_spec.num_conjuncts = (unsigned) parse_size(argv[++i], config.query_spec.num_conjuncts);
+        } else if (strcmp(argv[i], "--queries") == 0 && has_value) {
+            config.num_queries = parse_size(argv[++i], config.num_queries);
+        } else {
+            usage(stderr, argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
 
+    if (config.query_spec.path_depth > ODSB_QUERY_MAX_PATH_DEPTH ||
+        config.query_spec.num_conjuncts > ODSB_QUERY_MAX_CONJUNCTS) {
+        usage(stderr, argv[0]);
+        return EXIT_FAILURE;
+    }
 
-    for (int i = 0; i < 100; i++) {
-        printf("%s\n", odsb_key_gen_random(key_gen, prop_type_integer));
-        printf("%s\n", odsb_key_gen_random(key_gen, prop_type_boolean));
-        printf("%s\n", odsb_key_gen_random(key_gen, prop_type_decimal));
-        printf("%s\n", odsb_key_gen_random(key_gen, prop_type_string));
-        printf("%s\n", odsb_key_gen_random(key_gen, prop_type_array_integer));
-        printf("%s\n", odsb_key_gen_random(key_gen, prop_type_array_boolean));
-        printf("%s\n", odsb_key_gen_random(key_gen, prpo_type_array_decimal));
-        printf("%s\n", odsb_key_gen_random(key_gen, prop_type_array_string));
-        printf("%s\n", odsb_key_gen_random(key_gen, prop_type_array_object));
-        printf("%s\n", odsb_key_gen_random(key_gen, prop_type_array_array));
-        printf("%s\n", odsb_key_gen_random(key_gen, prop_type_object));
+    if (config.write_prefix != NULL) {
+        return write_corpus(&config, docs_given);
+    } else if (config.footprint) {
+        if (config.json) {
+            printf("{ \"suite\": \"opendsb-footprint\", \"docs\": %zu, \"seed\": %u, \"corpora\": [",
+                   config.num_docs, config.seed);
+        }
+        for (size_t c = 0, num = 0; c < sizeof(corpus_names) / sizeof(corpus_names[0]); c++) {
+            if (selected(config.corpus, corpus_names[c])) {
+                footprint_report(corpus_names[c], &config, num++ == 0);
+            }
+        }
+        if (config.json) {
+            printf("\n] }\n");
+        }
+        return EXIT_SUCCESS;
     }
 
+    brooks_pool_t *pool;
+    brooks_pool_create(&pool);
+    brooks_path_create(&all_values, pool, "");
+    odsb_latencies_t *latencies = odsb_latencies_new(config.num_docs * config.num_runs);
+    bool first = true;
 
+    if (config.json) {
+        printf("{ \"suite\": \"opendsb\", \"docs\": %zu, \"runs\": %zu, \"lookups\": %zu, \"seed\": %u, "
+               "\"queries\": %zu, \"predicate\": \"%s\", \"path_depth\": %u, \"conjuncts\": %u, \"results\": [",
+               config.num_docs, config.num_runs, config.num_lookups, config.seed, config.num_queries,
+               odsb_predicate_names[config.query_spec.predicate], config.query_spec.path_depth,
+               config.query_spec.num_conjuncts);
+    } else {
+        odsb_bench_print_header(stdout);
+    }
 
+    for (size_t c = 0; c < sizeof(corpus_names) / sizeof(corpus_names[0]); c++) {
+        if (!selected(config.corpus, corpus_names[c])) {
+            continue;
+        }
+        odsb_seed(config.seed, 0);
+        odsb_corpus_t corpus = { .name = corpus_names[c], .gen = corpus_generator(corpus_names[c]) };
 
+        // the corpus is always built, but reported only if requested
+        for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+            size_t num_points = (workload_sweeps[w] ? config.num_selectivities : 1);
+            for (size_t point = 0; point < num_points && (w == 0 || selected(config.workload, workload_names[w]));
+                 point++) {
+                char label[32];
+                odsb_bench_result_t result = { .workload = workload_names[w], .corpus = corpus.name };
+                if (workload_sweeps[w]) {
+                    result.selectivity_target = config.selectivities[point];
+                    snprintf(label, sizeof(label), "%s@%g%%", workload_names[w], 100 * config.selectivities[point]);
+                    result.workload = label;
+                }
+                odsb_latencies_clear(latencies);
+                workloads[w](&result, latencies, &corpus, &config);
+                odsb_bench_finish(&result, latencies);
 
-    odsb_histogram_t *values_val_int = odsb_histogram_new(3);
-    odsb_histogram_t *values_val_boolean = odsb_histogram_new(3);
-    odsb_histogram_t *values_val_decimal = odsb_histogram_new(3);
-    odsb_histogram_t *values_val_string = odsb_histogram_new(3);
-    /*odsb_histogram_t *values_array_int = odsb_histogram_new(3);
-    odsb_histogram_t *values_array_decimal = odsb_histogram_new(3);
-    odsb_histogram_t *values_array_boolean = odsb_histogram_new(3);
-    odsb_histogram_t *values_array_string = odsb_histogram_new(3);
-    odsb_histogram_t *values_array_array = odsb_histogram_new(3);
-    odsb_histogram_t *values_array_object = odsb_histogram_new(3);
-    odsb_histogram_t *values_object = odsb_histogram_new(3);*/
-
-    odsb_histogram_value_int_add(values_val_int, 123, 10);
-    odsb_histogram_value_int_add(values_val_int, 456, 20);
-    odsb_histogram_value_int_add(values_val_int, 789, 30);
-
-    odsb_histogram_value_boolean_add(values_val_boolean, true, 3);
-    odsb_histogram_value_boolean_add(values_val_boolean, false, 1);
-
-    odsb_histogram_value_double_add(values_val_decimal, 1.0, 10);
-    odsb_histogram_value_double_add(values_val_decimal, 2.5, 20);
-    odsb_histogram_value_double_add(values_val_decimal, 3.145, 30);
-
-    odsb_histogram_value_string_add(values_val_string, "Value1", 10);
-    odsb_histogram_value_string_add(values_val_string, "Value2", 20);
-    odsb_histogram_value_string_add(values_val_string, "Value3", 30);
-
-    odsb_key_gen_params_t *value_gen = odsb_key_gen_new(values_val_int, values_val_boolean, values_val_decimal, values_val_string,
-                                                      NULL, NULL, NULL, NULL, NULL,
-                                                        NULL, NULL);
-
-    for (int i = 0; i < 100; i++) {
-        printf("%llu\n", *(uint64_t *) odsb_value_gen_random(value_gen, prop_type_integer));
-        printf("%d\n", *(bool *) odsb_value_gen_random(value_gen, prop_type_boolean));
-        printf("%f\n", *(double *) odsb_value_gen_random(value_gen, prop_type_decimal));
-        printf("%s\n", odsb_value_gen_random(value_gen, prop_type_string));
-        /*printf("%s\n", odsb_value_gen_random(value_gen, prop_type_array_integer));
-        printf("%s\n", odsb_value_gen_random(value_gen, prop_type_array_boolean));
-        printf("%s\n", odsb_value_gen_random(value_gen, prpo_type_array_decimal));
-        printf("%s\n", odsb_value_gen_random(value_gen, prop_type_array_string));
-        printf("%s\n", odsb_value_gen_random(value_gen, prop_type_array_object));
-        printf("%s\n", odsb_value_gen_random(value_gen, prop_type_array_array));
-        printf("%s\n", odsb_value_gen_random(value_gen, prop_type_object));*/
-    }
+                if (!selected(config.workload, workload_names[w])) {
+                    continue;
+                } else if (config.json) {
+                    printf("%s\n  ", first ? "" : ",");
+                    odsb_bench_print_json(stdout, &result);
+                } else {
+                    odsb_bench_print_result(stdout, &result);
+                }
+                fflush(stdout);
+                first = false;
+            }
+        }
+        corpus_dispose(&corpus);
+    }
 
-    return 0;
-}
\ No newline at end of file
+    if (config.json) {
+        printf("\n] }\n");
+    }
+    odsb_latencies_free(latencies);
+    brooks_pool_dispose(pool);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+#ifndef BROOKS_MB_BENCH_H
+#define BROOKS_MB_BENCH_H
+
+#include <brooks/brooks_pool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+/**
+ * Outcome of one workload over one corpus. Latencies are measured per operation, where the meaning of an operation
+ * depends on the workload (e.g., one document for 'parse', one key for 'point_lookup'). 'pool_bytes' is the memory
+ * reserved in pools by the workload, 'peak_rss_kb' the peak resident set size of the process so far. 'checksum' is a
+ * workload specific digest of the results, such that changes in behavior show up next to changes in speed. Query
+ * workloads that sweep over selectivities report the targeted, the expected and the observed selectivity.
+ */
+typedef struct odsb_bench_result_t
+{
+    const char *workload;
+    const char *corpus;
+    size_t num_ops;
+    size_t num_values;
+    size_t num_bytes;
+    uint64_t total_ns;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+    double ops_per_sec;
+    double mb_per_sec;
+    size_t pool_bytes;
+    double pool_bytes_per_value;
+    size_t peak_rss_kb;
+    uint64_t checksum;
+    double selectivity_target;
+    double selectivity_expected;
+    double selectivity_observed;
+} odsb_bench_result_t;
+
+typedef struct odsb_latencies_t
+{
+    uint64_t *ns;
+    size_t num_entries;
+    size_t capacity;
+} odsb_latencies_t;
+
+static inline uint64_t odsb_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+static inline size_t odsb_peak_rss_kb(void)
+{
+    struct rusage usage;
+    return (getrusage(RUSAGE_SELF, &usage) == 0 ? (size_t) usage.ru_maxrss : 0);
+}
+
+static inline odsb_latencies_t *odsb_latencies_new(size_t capacity)
+{
+    odsb_latencies_t *result = malloc(sizeof(odsb_latencies_t));
+    result->capacity = (capacity > 0 ? capacity : 1);
+    result->ns = malloc(result->capacity * sizeof(uint64_t));
+    result->num_entries = 0;
+    return result;
+}
+
+static inline void odsb_latencies_add(odsb_latencies_t *latencies, uint64_t ns)
+{
+    if (latencies->num_entries == latencies->capacity) {
+        latencies->capacity *= 2;
+        latencies->ns = realloc(latencies->ns, latencies->capacity * sizeof(uint64_t));
+    }
+    latencies->ns[latencies->num_entries++] = ns;
+}
+
+static inline void odsb_latencies_clear(odsb_latencies_t *latencies)
+{
+    latencies->num_entries = 0;
+}
+
+static inline void odsb_latencies_free(odsb_latencies_t *latencies)
+{
+    free(latencies->ns);
+    free(latencies);
+}
+
+static inline int odsb_latencies_compare(const void *lhs, const void *rhs)
+{
+    uint64_t a = *(const uint64_t *) lhs, b = *(const uint64_t *) rhs;
+    return (a > b) - (a < b);
+}
+
+// Nearest-rank percentile; sorts the recorded latencies in place
+static inline uint64_t odsb_latencies_percentile(odsb_latencies_t *latencies, unsigned percent)
+{
+    if (latencies->num_entries == 0) {
+        return 0;
+    }
+    qsort(latencies->ns, latencies->num_entries, sizeof(uint64_t), odsb_latencies_compare);
+    size_t rank = (latencies->num_entries * percent + 99) / 100;
+    return latencies->ns[rank > 0 ? rank - 1 : 0];
+}
+
+// Derives throughput, percentiles and memory figures once a workload has filled 'result' and 'latencies'
+static inline void odsb_bench_finish(odsb_bench_result_t *result, odsb_latencies_t *latencies)
+{
+    double seconds = (double) result->total_ns / 1e9;
+    result->num_ops = latencies->num_entries;
+    result->p50_ns = odsb_latencies_percentile(latencies, 50);
+    result->p99_ns = odsb_latencies_percentile(latencies, 99);
+    result->max_ns = odsb_latencies_percentile(latencies, 100);
+    result->ops_per_sec = (seconds > 0 ? (double) result->num_ops / seconds : 0);
+    result->mb_per_sec = (seconds > 0 ? (double) result->num_bytes / (1024.0 * 1024.0) / seconds : 0);
+    result->pool_bytes_per_value = (result->num_values > 0 ? (double) result->pool_bytes / result->num_values : 0);
+    result->peak_rss_kb = odsb_peak_rss_kb();
+}
+
+static inline void odsb_bench_print_header(FILE *file)
+{
+    fprintf(file, "%-16s %-8s %10s %12s %9s %11s %11s %10s %11s %11s %18s\n", "workload", "corpus", "ops",
+            "ops/s", "MiB/s", "p50 (us)", "p99 (us)", "pool B/v", "pool (KiB)", "RSS (KiB)", "checksum");
+}
+
+static inline void odsb_bench_print_result(FILE *file, const odsb_bench_result_t *result)
+{
+    fprintf(file, "%-16s %-8s %10zu %12.0f %9.2f %11.3f %11.3f %10.1f %11zu %11zu %18llu\n", result->workload,
+            result->corpus, result->num_ops, result->ops_per_sec, result->mb_per_sec, result->p50_ns / 1e3,
+            result->p99_ns / 1e3, result->pool_bytes_per_value, result->pool_bytes / 1024, result->peak_rss_kb,
+            (unsigned long long) result->checksum);
+}
+
+static inline void odsb_bench_print_json(FILE *file, const odsb_bench_result_t *result)
+{
+    fprintf(file, "{ \"workload\": \"%s\", \"corpus\": \"%s\", \"ops\": %zu, \"values\": %zu, \"bytes\": %zu, "
+                  "\"total_ns\": %llu, \"ops_per_sec\": %.3f, \"mb_per_sec\": %.3f, \"p50_ns\": %llu, "
+                  "\"p99_ns\": %llu, \"max_ns\": %llu, \"pool_bytes\": %zu, \"pool_bytes_per_value\": %.3f, "
+                  "\"peak_rss_kb\": %zu, \"checksum\": %llu",
+            result->workload, result->corpus, result->num_ops, result->num_values, result->num_bytes,
+            (unsigned long long) result->total_ns, result->ops_per_sec, result->mb_per_sec,
+            (unsigned long long) result->p50_ns, (unsigned long long) result->p99_ns,
+            (unsigned long long) result->max_ns, result->pool_bytes, result->pool_bytes_per_value,
+            result->peak_rss_kb, (unsigned long long) result->checksum);
+    if (result->selectivity_target > 0) {
+        fprintf(file, ", \"selectivity_target\": %.6f, \"selectivity_expected\": %.6f, "
+                      "\"selectivity_observed\": %.6f", result->selectivity_target, result->selectivity_expected,
+                result->selectivity_observed);
+    }
+    fprintf(file, " }");
+}
+
+static inline size_t odsb_pool_bytes(const brooks_pool_t *pool)
+{
+    brooks_pool_stats_t stats;
+    return (brooks_pool_get_stats(&stats, pool) == brooks_status_ok ? stats.bytes_reserved : 0);
+}
+
+#endif //BROOKS_MB_BENCH_H
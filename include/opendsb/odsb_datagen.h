@@ -4,6 +4,7 @@
 #include <brooks/brooks_pool.h>
 #include <brooks/brooks_doc.h>
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -43,72 +44,255 @@ typedef struct odsb_prop_gen_params_t
 
 } odsb_prop_gen_params_t;
 
+/**
+ * xoshiro256** generator. Every thread draws from its own generator (see odsb_seed), such that generation is
+ * reproducible from a seed and threads do not contend on shared state.
+ */
+typedef struct odsb_rng_t
+{
+    uint64_t s[4];
+} odsb_rng_t;
+
+/**
+ * Vose alias table: draws one of 'num_entries' outcomes with probability proportional to its weight in O(1), using
+ * one slot per outcome regardless of the total weight.
+ */
+typedef struct odsb_alias_t
+{
+    size_t num_entries;
+    double *prob;
+    size_t *alias;
+} odsb_alias_t;
+
+/**
+ * Weighted table of fixed-size elements. Each distinct element is stored once together with its weight. The alias
+ * table is rebuilt on the first draw after an addition; call odbs_table_seal before sharing a table across threads.
+ */
 typedef struct odsb_table_t
 {
     void *base;
     size_t elem_size;
     size_t num_entries;
     size_t capacity;
+    uint64_t *weights;
+    odsb_alias_t alias;
 } odsb_table_t;
 
-// Random number in right-open interval [0, max)
-static inline size_t odsb_random(long max) {
-    size_t num;
+// Generator state of the calling thread, seeded as by odsb_seed(0, 0) until reseeded
+static _Thread_local odsb_rng_t odsb_thread_rng = {
+    { 0xe220a8397b1dcdafull, 0x6e789e6aa1b965f4ull, 0x06c45d188009454full, 0xf88bb8a8724c81ecull }
+};
+
+static inline uint64_t odsb_splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t odsb_rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
 
-    size_t bins = (size_t) max;
-    size_t rand = (size_t) RAND_MAX + 1;
-    size_t size = rand / bins;
-    size_t outline   = rand % bins;
+static inline uint64_t odsb_rng_next(odsb_rng_t *rng)
+{
+    uint64_t *s = rng->s;
+    uint64_t result = odsb_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = odsb_rotl(s[3], 45);
+    return result;
+}
 
+// Advances by 2^128 draws, i.e., splits the sequence into non-overlapping streams
+static inline void odsb_rng_jump(odsb_rng_t *rng)
+{
+    static const uint64_t jump[] = {
+        0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull, 0x39abdc4529b1661cull
+    };
+    uint64_t s[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (jump[i] & (1ull << b)) {
+                s[0] ^= rng->s[0];
+                s[1] ^= rng->s[1];
+                s[2] ^= rng->s[2];
+                s[3] ^= rng->s[3];
+            }
+            odsb_rng_next(rng);
+        }
+    }
+    memcpy(rng->s, s, sizeof(s));
+}
+
+// Seeds 'rng' with stream 'stream' of 'seed'; threads that use the same seed and distinct streams draw disjoint
+// sequences
+static inline void odsb_rng_seed(odsb_rng_t *rng, uint64_t seed, unsigned stream)
+{
+    uint64_t state = seed;
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = odsb_splitmix64(&state);
+    }
+    while (stream--) {
+        odsb_rng_jump(rng);
+    }
+}
+
+// Unbiased random number in right-open interval [0, bound)
+static inline uint64_t odsb_rng_below(odsb_rng_t *rng, uint64_t bound)
+{
+    if (bound <= 1) {
+        return 0;
+    }
+    uint64_t threshold = (0 - bound) % bound;
+    uint64_t num;
     do {
-        num = random();
-    } while (rand - outline <= (size_t)num);
+        num = odsb_rng_next(rng);
+    } while (num < threshold);
+    return num % bound;
+}
+
+// Random number in right-open interval [0, 1)
+static inline double odsb_rng_unit(odsb_rng_t *rng)
+{
+    return (double) (odsb_rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+static inline odsb_rng_t *odsb_rng(void)
+{
+    return &odsb_thread_rng;
+}
+
+static inline void odsb_seed(uint64_t seed, unsigned stream)
+{
+    odsb_rng_seed(&odsb_thread_rng, seed, stream);
+}
+
+// Random number in right-open interval [0, max), drawn from the calling thread's generator
+static inline size_t odsb_random(long max) {
+    return (max > 0 ? (size_t) odsb_rng_below(&odsb_thread_rng, (uint64_t) max) : 0);
+}
 
-    return num/size;
+static inline void odsb_alias_free(odsb_alias_t *alias)
+{
+    free(alias->prob);
+    free(alias->alias);
+    alias->prob = NULL;
+    alias->alias = NULL;
+    alias->num_entries = 0;
+}
+
+static inline void odsb_alias_build(odsb_alias_t *alias, const uint64_t *weights, size_t num_entries)
+{
+    double total = 0;
+    for (size_t i = 0; i < num_entries; i++) {
+        total += (double) weights[i];
+    }
+    odsb_alias_free(alias);
+    if (num_entries == 0 || total <= 0) {
+        return;
+    }
+
+    alias->num_entries = num_entries;
+    alias->prob = malloc(num_entries * sizeof(double));
+    alias->alias = malloc(num_entries * sizeof(size_t));
+
+    // 'work' holds the underfull outcomes growing from the front and the overfull ones growing from the back
+    size_t *work = malloc(num_entries * sizeof(size_t));
+    size_t num_small = 0, large_begin = num_entries;
+    for (size_t i = 0; i < num_entries; i++) {
+        alias->prob[i] = (double) weights[i] * num_entries / total;
+        alias->alias[i] = i;
+        if (alias->prob[i] < 1.0) {
+            work[num_small++] = i;
+        } else {
+            work[--large_begin] = i;
+        }
+    }
+    while (num_small > 0 && large_begin < num_entries) {
+        size_t small = work[--num_small];
+        size_t large = work[large_begin++];
+        alias->alias[small] = large;
+        alias->prob[large] -= 1.0 - alias->prob[small];
+        if (alias->prob[large] < 1.0) {
+            work[num_small++] = large;
+        } else {
+            work[--large_begin] = large;
+        }
+    }
+    // leftovers are full up to rounding errors
+    while (num_small > 0) {
+        alias->prob[work[--num_small]] = 1.0;
+    }
+    for (size_t i = large_begin; i < num_entries; i++) {
+        alias->prob[work[i]] = 1.0;
+    }
+    free(work);
+}
+
+static inline size_t odsb_alias_sample(const odsb_alias_t *alias, odsb_rng_t *rng)
+{
+    size_t column = (size_t) odsb_rng_below(rng, alias->num_entries);
+    return (odsb_rng_unit(rng) < alias->prob[column] ? column : alias->alias[column]);
 }
 
 static inline odsb_table_t *odbs_table_new(size_t num_elements, size_t elem_size)
 {
     odsb_table_t *result = malloc(sizeof(odsb_table_t));
-    result->base = malloc(num_elements * elem_size);
-    result->capacity = num_elements;
+    result->capacity = (num_elements > 0 ? num_elements : 1);
+    result->base = malloc(result->capacity * elem_size);
+    result->weights = malloc(result->capacity * sizeof(uint64_t));
     result->num_entries = 0;
     result->elem_size = elem_size;
+    result->alias = (odsb_alias_t) { .num_entries = 0, .prob = NULL, .alias = NULL };
     return result;
 }
 
+static inline void odbs_table_free(odsb_table_t *table)
+{
+    odsb_alias_free(&table->alias);
+    free(table->weights);
+    free(table->base);
+    free(table);
+}
+
+static inline void odbs_table_seal(odsb_table_t *table)
+{
+    if (table->alias.num_entries != table->num_entries) {
+        odsb_alias_build(&table->alias, table->weights, table->num_entries);
+    }
+}
+
 static inline const void *odbs_table_random(odsb_table_t *table)
 {
-    return (table->base + odsb_random(table->num_entries) * table->elem_size);
+    odbs_table_seal(table);
+    return (table->alias.num_entries > 0 ?
+            (char *) table->base + odsb_alias_sample(&table->alias, &odsb_thread_rng) * table->elem_size : NULL);
 }
 
+// Adds 'data' with weight 'multiplier'
 static inline void odbs_table_add(odsb_table_t *table, const void *data, size_t multiplier)
 {
-    for (size_t i = 0; i < multiplier; i++) {
-        if (table->num_entries < table->capacity) {
-            memcpy(table->base + table->num_entries * table->elem_size, data, table->elem_size);
-            table->num_entries++;
-        } else {
-            abort();
+    if (multiplier > 0) {
+        if (table->num_entries == table->capacity) {
+            table->capacity *= 2;
+            table->base = realloc(table->base, table->capacity * table->elem_size);
+            table->weights = realloc(table->weights, table->capacity * sizeof(uint64_t));
         }
+        memcpy((char *) table->base + table->num_entries * table->elem_size, data, table->elem_size);
+        table->weights[table->num_entries++] = multiplier;
     }
 }
 
 static inline odsb_table_t *odbs_table_by_prop(const odsb_prop_gen_params_t *params)
 {
-    size_t total = params->hist_num_integer +
-            params->hist_num_boolean +
-            params->hist_num_decimal +
-            params->hist_num_string +
-            params->hist_num_array_integer +
-            params->hist_num_array_boolean +
-            params->hist_num_array_decimal +
-            params->hist_num_array_string +
-            params->hist_num_array_object +
-            params->hist_num_array_array +
-            params->hist_num_object;
-
-    odsb_table_t *result = odbs_table_new(total, sizeof(odsb_prop_type_e));
+    odsb_table_t *result = odbs_table_new(prop_type_object + 1, sizeof(odsb_prop_type_e));
 
     odbs_table_add(result, &(odsb_prop_type_e) {prop_type_integer}, params->hist_num_integer);
     odbs_table_add(result, &(odsb_prop_type_e) {prop_type_boolean}, params->hist_num_boolean);
@@ -121,49 +305,73 @@ static inline odsb_table_t *odbs_table_by_prop(const odsb_prop_gen_params_t *par
     odbs_table_add(result, &(odsb_prop_type_e) {prop_type_array_object}, params->hist_num_array_object);
     odbs_table_add(result, &(odsb_prop_type_e) {prop_type_array_array}, params->hist_num_array_array);
     odbs_table_add(result, &(odsb_prop_type_e) {prop_type_object}, params->hist_num_object);
+    odbs_table_seal(result);
 
     return result;
 }
 
+/**
+ * Histogram over keys or values. Like odsb_table_t, each distinct entry is stored once with its weight ('nums') and
+ * drawn through an alias table that is (re)built lazily or by odsb_histogram_seal.
+ */
 typedef struct odsb_histogram_t
 {
     void **data_list;
     unsigned num_elements_data_list;
     unsigned capacity_data_list;
-    unsigned *histogram;
-    unsigned hist_capacity;
-    unsigned num_hist_entries;
+    uint64_t *weights;
+    odsb_alias_t alias;
 } odsb_histogram_t;
 
 static inline odsb_histogram_t *odsb_histogram_new(size_t key_capacity)
 {
     odsb_histogram_t *result = malloc(sizeof(odsb_histogram_t));
+    key_capacity = (key_capacity > 0 ? key_capacity : 1);
     result->data_list = malloc(key_capacity * sizeof(void *));
-    result->histogram = malloc(key_capacity * sizeof(unsigned));
-    result->num_elements_data_list = result->num_hist_entries = 0;
-    result->capacity_data_list = result->hist_capacity = key_capacity;
+    result->weights = malloc(key_capacity * sizeof(uint64_t));
+    result->num_elements_data_list = 0;
+    result->capacity_data_list = key_capacity;
+    result->alias = (odsb_alias_t) { .num_entries = 0, .prob = NULL, .alias = NULL };
     return result;
 }
 
 static inline void odsb_generic_histogram_add(odsb_histogram_t *hist, const void *data, size_t data_sizeof, size_t num_data, unsigned nums)
 {
+    if (nums == 0) {
+        return;
+    }
     if (hist->num_elements_data_list + 1 > hist->capacity_data_list) {
         hist->capacity_data_list = (hist->capacity_data_list) * 2;
         hist->data_list = realloc(hist->data_list, hist->capacity_data_list * sizeof(char *));
-    }
-    if (hist->num_hist_entries + nums > hist->hist_capacity) {
-        hist->hist_capacity = (hist->hist_capacity + nums + 1) * 2;
-        hist->histogram = realloc(hist->histogram, hist->hist_capacity * sizeof(unsigned));
+        hist->weights = realloc(hist->weights, hist->capacity_data_list * sizeof(uint64_t));
     }
     void *data_entry = malloc(num_data * data_sizeof);
     memcpy(data_entry, data, num_data * data_sizeof);
     hist->data_list[hist->num_elements_data_list] = data_entry;
-    while (nums--) {
-        hist->histogram[hist->num_hist_entries++] = hist->num_elements_data_list;
-    }
+    hist->weights[hist->num_elements_data_list] = nums;
     hist->num_elements_data_list++;
 }
 
+static inline void odsb_histogram_seal(odsb_histogram_t *hist)
+{
+    if (hist != NULL && hist->alias.num_entries != hist->num_elements_data_list) {
+        odsb_alias_build(&hist->alias, hist->weights, hist->num_elements_data_list);
+    }
+}
+
+static inline void odsb_histogram_free(odsb_histogram_t *hist)
+{
+    if (hist != NULL) {
+        for (unsigned i = 0; i < hist->num_elements_data_list; i++) {
+            free(hist->data_list[i]);
+        }
+        free(hist->data_list);
+        free(hist->weights);
+        odsb_alias_free(&hist->alias);
+        free(hist);
+    }
+}
+
 static inline void odsb_histogram_key_add(odsb_histogram_t *hist, const char *key, unsigned nums)
 {
     odsb_generic_histogram_add(hist, key, sizeof(char), strlen(key) + 1, nums);
@@ -201,7 +409,11 @@ static inline void odsb_histogram_value_object_add(odsb_histogram_t *hist, const
 
 static inline const void *odsb_histogram_random(const odsb_histogram_t *hist)
 {
-    return hist->data_list[hist->histogram[odsb_random(hist->num_hist_entries)]];
+    if (hist == NULL || hist->num_elements_data_list == 0) {
+        return NULL;
+    }
+    odsb_histogram_seal((odsb_histogram_t *) hist);
+    return hist->data_list[odsb_alias_sample(&hist->alias, &odsb_thread_rng)];
 }
 
 typedef struct odsb_key_gen_params_t
@@ -248,6 +460,39 @@ static inline odsb_key_gen_params_t *odsb_key_gen_new(odsb_histogram_t *val_int,
     return result;
 }
 
+// Builds the alias tables of all histograms, such that the parameters can be shared across threads
+static inline void odsb_key_gen_seal(const odsb_key_gen_params_t *params)
+{
+    odsb_histogram_seal(params->val_int);
+    odsb_histogram_seal(params->val_boolean);
+    odsb_histogram_seal(params->val_decimal);
+    odsb_histogram_seal(params->val_string);
+    odsb_histogram_seal(params->array_int);
+    odsb_histogram_seal(params->array_boolean);
+    odsb_histogram_seal(params->array_decimal);
+    odsb_histogram_seal(params->array_string);
+    odsb_histogram_seal(params->array_array);
+    odsb_histogram_seal(params->array_object);
+    odsb_histogram_seal(params->object);
+}
+
+// Frees the parameters including their histograms
+static inline void odsb_key_gen_free(odsb_key_gen_params_t *params)
+{
+    odsb_histogram_free(params->val_int);
+    odsb_histogram_free(params->val_boolean);
+    odsb_histogram_free(params->val_decimal);
+    odsb_histogram_free(params->val_string);
+    odsb_histogram_free(params->array_int);
+    odsb_histogram_free(params->array_boolean);
+    odsb_histogram_free(params->array_decimal);
+    odsb_histogram_free(params->array_string);
+    odsb_histogram_free(params->array_array);
+    odsb_histogram_free(params->array_object);
+    odsb_histogram_free(params->object);
+    free(params);
+}
+
 typedef struct odsb_value_gen_params_t
 {
     odsb_histogram_t *val_int;
@@ -335,86 +580,220 @@ static inline const void *odsb_value_gen_random(odsb_key_gen_params_t *hist, ods
 
 
 
-typedef struct odsb_value_histogram_t
-{
-    void **values;
-    unsigned num_values;
-    unsigned *histogram;
-} odsb_value_histogram_t;
-
+/**
+ * Value histograms used by the document generator. Array elements are drawn from the 'array_*' histograms, or from
+ * the corresponding 'val_*' histogram if NULL, or uniformly at random if both are NULL.
+ */
 typedef struct odsb_values_gen_params_t
 {
-    odsb_value_histogram_t val_int;
-    odsb_value_histogram_t val_boolean;
-    odsb_value_histogram_t val_decimal;
-    odsb_value_histogram_t val_string;
-
-    odsb_value_histogram_t array_int;
-    odsb_value_histogram_t array_boolean;
-    odsb_value_histogram_t array_decimal;
-    odsb_value_histogram_t array_string;
-    odsb_value_histogram_t array_array;
-    odsb_value_histogram_t array_object;
-
-    odsb_value_histogram_t object_int;
-    odsb_value_histogram_t object_boolean;
-    odsb_value_histogram_t object_decimal;
-    odsb_value_histogram_t object_string;
-    odsb_value_histogram_t object_array;
-    odsb_value_histogram_t object_object;
+    odsb_histogram_t *val_int;
+    odsb_histogram_t *val_boolean;
+    odsb_histogram_t *val_decimal;
+    odsb_histogram_t *val_string;
+
+    odsb_histogram_t *array_int;
+    odsb_histogram_t *array_boolean;
+    odsb_histogram_t *array_decimal;
+    odsb_histogram_t *array_string;
 } odsb_values_gen_params_t;
 
+/**
+ * Shape of generated documents. Objects get between 'min_fanout' and 'max_fanout' properties, where the upper bound
+ * shrinks by 'fanout_decay_percent' per nesting level (100 keeps it constant). Containers are not created below
+ * 'max_depth', so deeper properties are primitives.
+ */
+typedef struct odsb_shape_gen_params_t
+{
+    unsigned max_depth;
+    unsigned min_fanout;
+    unsigned max_fanout;
+    unsigned fanout_decay_percent;
+    unsigned min_array_length;
+    unsigned max_array_length;
+} odsb_shape_gen_params_t;
+
+typedef struct odsb_doc_gen_t
+{
+    odsb_table_t *prop_table;
+    odsb_shape_gen_params_t shape;
+    odsb_key_gen_params_t *key_gen_params;
+    const odsb_values_gen_params_t *values_gen_params;
+} odsb_doc_gen_t;
+
+#define ODSB_KEY_RETRIES         4
+
+static inline odsb_values_gen_params_t *odsb_values_gen_new(odsb_histogram_t *val_int,
+                                                            odsb_histogram_t *val_boolean,
+                                                            odsb_histogram_t *val_decimal,
+                                                            odsb_histogram_t *val_string,
+                                                            odsb_histogram_t *array_int,
+                                                            odsb_histogram_t *array_boolean,
+                                                            odsb_histogram_t *array_decimal,
+                                                            odsb_histogram_t *array_string)
+{
+    odsb_values_gen_params_t *result = malloc(sizeof(odsb_values_gen_params_t));
+    result->val_int = val_int;
+    result->val_boolean = val_boolean;
+    result->val_decimal = val_decimal;
+    result->val_string = val_string;
+    result->array_int = array_int;
+    result->array_boolean = array_boolean;
+    result->array_decimal = array_decimal;
+    result->array_string = array_string;
+    return result;
+}
+
+static inline void odsb_values_gen_seal(const odsb_values_gen_params_t *params)
+{
+    odsb_histogram_seal(params->val_int);
+    odsb_histogram_seal(params->val_boolean);
+    odsb_histogram_seal(params->val_decimal);
+    odsb_histogram_seal(params->val_string);
+    odsb_histogram_seal(params->array_int);
+    odsb_histogram_seal(params->array_boolean);
+    odsb_histogram_seal(params->array_decimal);
+    odsb_histogram_seal(params->array_string);
+}
 
+// Frees the parameters including their histograms
+static inline void odsb_values_gen_free(odsb_values_gen_params_t *params)
+{
+    odsb_histogram_free(params->val_int);
+    odsb_histogram_free(params->val_boolean);
+    odsb_histogram_free(params->val_decimal);
+    odsb_histogram_free(params->val_string);
+    odsb_histogram_free(params->array_int);
+    odsb_histogram_free(params->array_boolean);
+    odsb_histogram_free(params->array_decimal);
+    odsb_histogram_free(params->array_string);
+    free(params);
+}
 
-static inline void odbs_document_make(brooks_object_t *document, brooks_pool_t *pool)
+static inline odsb_doc_gen_t *odsb_doc_gen_new(const odsb_prop_gen_params_t *prop_hist,
+                                               const odsb_shape_gen_params_t *shape,
+                                               odsb_key_gen_params_t *key_gen_params,
+                                               const odsb_values_gen_params_t *values_gen_params)
 {
-    brooks_doc_create(&document, pool);
+    odsb_doc_gen_t *result = malloc(sizeof(odsb_doc_gen_t));
+    odsb_key_gen_seal(key_gen_params);
+    odsb_values_gen_seal(values_gen_params);
+    result->prop_table = odbs_table_by_prop(prop_hist);
+    result->shape = *shape;
+    result->key_gen_params = key_gen_params;
+    result->values_gen_params = values_gen_params;
+    return result;
+}
 
+static inline void odsb_doc_gen_free(odsb_doc_gen_t *gen)
+{
+    odbs_table_free(gen->prop_table);
+    free(gen);
 }
 
+// Random number in closed interval [min, max]
+static inline size_t odsb_random_between(size_t min, size_t max)
+{
+    return (max > min ? min + odsb_random(max - min + 1) : min);
+}
 
+static inline bool odsb_prop_is_container(odsb_prop_type_e type)
+{
+    return (type >= prop_type_array_integer);
+}
 
-static inline odsb_table_t *odbs_table_make_by_prop(const odsb_prop_gen_params_t *prop)
+static inline brooks_type_e odsb_prop_element_type(odsb_prop_type_e type)
+{
+    switch (type) {
+        case prop_type_integer:
+        case prop_type_array_integer:   return brooks_type_number_integer;
+        case prop_type_boolean:
+        case prop_type_array_boolean:   return brooks_type_boolean;
+        case prop_type_decimal:
+        case prpo_type_array_decimal:   return brooks_type_number_double;
+        case prop_type_string:
+        case prop_type_array_string:    return brooks_type_string;
+        case prop_type_array_object:
+        case prop_type_object:          return brooks_type_object;
+        case prop_type_array_array:     return brooks_type_array;
+        default: abort();
+    }
+}
+
+static inline bool odsb_object_has_key(const brooks_object_t *object, const char *key)
 {
-    odsb_table_t *result = malloc(sizeof(odsb_table_t *));
     size_t idx;
-    size_t total = prop->hist_num_integer + prop->hist_num_boolean + prop->hist_num_decimal +
-            prop->hist_num_string + prop->hist_num_array_integer + prop->hist_num_array_boolean +
-            prop->hist_num_array_decimal + prop->hist_num_array_string +
-            prop->hist_num_array_object + prop->hist_num_array_array +
-            prop->hist_num_object;
-
-    odsb_prop_type_e *tab_properties = malloc(total * sizeof(odsb_prop_type_e));
-    idx = 0;
-
-    for (size_t i = 0; i < prop->hist_num_integer; i++)
-        tab_properties[idx++] = prop_type_integer;
-    for (size_t i = 0; i < prop->hist_num_boolean; i++)
-        tab_properties[idx++] = prop_type_boolean;
-    for (size_t i = 0; i < prop->hist_num_decimal; i++)
-        tab_properties[idx++] = prop_type_decimal;
-    for (size_t i = 0; i < prop->hist_num_string; i++)
-        tab_properties[idx++] = prop_type_string;
-    for (size_t i = 0; i < prop->hist_num_array_integer; i++)
-        tab_properties[idx++] = prop_type_array_integer;
-    for (size_t i = 0; i < prop->hist_num_array_boolean; i++)
-        tab_properties[idx++] = prop_type_array_boolean;
-    for (size_t i = 0; i < prop->hist_num_array_decimal; i++)
-        tab_properties[idx++] = prpo_type_array_decimal;
-    for (size_t i = 0; i < prop->hist_num_array_string; i++)
-        tab_properties[idx++] = prop_type_array_string;
-    for (size_t i = 0; i < prop->hist_num_array_object; i++)
-        tab_properties[idx++] = prop_type_array_object;
-    for (size_t i = 0; i < prop->hist_num_array_array; i++)
-        tab_properties[idx++] = prop_type_array_array;
-    for (size_t i = 0; i < prop->hist_num_object; i++)
-        tab_properties[idx++] = prop_type_object;
-
-    result->num_entries = total;
-    result->base = tab_properties;
-    return result;
+    return (brooks_shape_lookup(&idx, brooks_doc_object_get_shape(object), key) == brooks_status_true);
 }
 
+/**
+ * Draws a primitive of 'type' from 'hist', or from 'fallback' if 'hist' is NULL, and writes it to 'data' in the form
+ * expected by brooks_doc_add_value. Strings are returned by pointer and may point to 'buffer'.
+ */
+static inline const void *odsb_value_draw(brooks_type_e type, const odsb_histogram_t *hist,
+                                          const odsb_histogram_t *fallback, void *data, char *buffer)
+{
+    const void *drawn = odsb_histogram_random(hist != NULL ? hist : fallback);
+    if (drawn != NULL) {
+        return (type == brooks_type_string ? drawn : memcpy(data, drawn, type == brooks_type_boolean ?
+                                                                          sizeof(bool) : sizeof(uint64_t)));
+    }
+    switch (type) {
+        case brooks_type_number_integer: *(uint64_t *) data = odsb_random(1000000); return data;
+        case brooks_type_number_double:  *(double *) data = odsb_random(1000000) / 100.0; return data;
+        case brooks_type_boolean:        *(bool *) data = odsb_random(2); return data;
+        default:                         sprintf(buffer, "value-%zu", odsb_random(1000000)); return buffer;
+    }
+}
+
+static inline brooks_status_e odbs_object_make(brooks_object_t *parent, const odsb_doc_gen_t *gen, unsigned depth);
+
+static inline brooks_status_e odbs_array_fill(brooks_array_t *array, const odsb_doc_gen_t *gen,
+                                              odsb_prop_type_e type, unsigned depth)
+{
+    const odsb_values_gen_params_t *values = gen->values_gen_params;
+    size_t length = odsb_random_between(gen->shape.min_array_length, gen->shape.max_array_length);
+    brooks_status_e status = brooks_status_ok;
+    uint64_t data;
+    char buffer[32];
+
+    for (size_t i = 0; status == brooks_status_ok && i < length; i++) {
+        switch (type) {
+            case prop_type_array_integer:
+                status = brooks_doc_add_value(array, odsb_value_draw(brooks_type_number_integer, values->array_int,
+                                                                     values->val_int, &data, buffer));
+                break;
+            case prop_type_array_boolean:
+                status = brooks_doc_add_value(array, odsb_value_draw(brooks_type_boolean, values->array_boolean,
+                                                                     values->val_boolean, &data, buffer));
+                break;
+            case prpo_type_array_decimal:
+                status = brooks_doc_add_value(array, odsb_value_draw(brooks_type_number_double, values->array_decimal,
+                                                                     values->val_decimal, &data, buffer));
+                break;
+            case prop_type_array_string:
+                status = brooks_doc_add_value(array, odsb_value_draw(brooks_type_string, values->array_string,
+                                                                     values->val_string, &data, buffer));
+                break;
+            case prop_type_array_object: {
+                brooks_object_t *element;
+                if ((status = brooks_doc_array_add_object(&element, array)) == brooks_status_ok) {
+                    status = odbs_object_make(element, gen, depth + 1);
+                }
+            } break;
+            case prop_type_array_array: {
+                // inner arrays hold primitives of one type, nested arrays deeper than that are rare in practice
+                odsb_prop_type_e inner_type = prop_type_array_integer + (odsb_prop_type_e) odsb_random(4);
+                brooks_array_t *element;
+                status = brooks_doc_array_add_array(&element, odsb_prop_element_type(inner_type), array);
+                if (status == brooks_status_ok) {
+                    status = odbs_array_fill(element, gen, inner_type, depth + 1);
+                }
+            } break;
+            default: abort();
+        }
+    }
+    return status;
+}
 
 /**
  * Create an object having randomly generated properties (objects, arrays, primitives) according a given histogram.
@@ -422,14 +801,80 @@ static inline odsb_table_t *odbs_table_make_by_prop(const odsb_prop_gen_params_t
  * distribution by this histogram. For ideas on how to generate numbers according a nun-uniform distribution, see
  * see https://oroboro.com/non-uniform-random-numbers/.
  */
-static inline void odbs_object_make(brooks_object_t *parent, brooks_pool_t *pool,
-                                    const odsb_prop_gen_params_t *prop_hist,
-                                    const odsb_key_gen_params_t *key_gen_params,
-                                    const odsb_values_gen_params_t *values_gen_params)
+static inline brooks_status_e odbs_object_make(brooks_object_t *parent, const odsb_doc_gen_t *gen, unsigned depth)
 {
+    const odsb_shape_gen_params_t *shape = &gen->shape;
+    const odsb_values_gen_params_t *values = gen->values_gen_params;
 
+    size_t max_fanout = shape->max_fanout;
+    for (unsigned level = 0; level < depth; level++) {
+        max_fanout = max_fanout * shape->fanout_decay_percent / 100;
+    }
+    size_t fanout = odsb_random_between(shape->min_fanout, max_fanout > shape->min_fanout ? max_fanout :
+                                                                                          shape->min_fanout);
+
+    brooks_status_e status = brooks_status_ok;
+    for (size_t i = 0; status == brooks_status_ok && i < fanout; i++) {
+        odsb_prop_type_e type = *(const odsb_prop_type_e *) odbs_table_random(gen->prop_table);
+        if (odsb_prop_is_container(type) && depth >= shape->max_depth) {
+            continue;
+        }
+
+        const char *key = NULL;
+        for (unsigned retry = 0; key == NULL && retry < ODSB_KEY_RETRIES; retry++) {
+            // a missing key histogram yields NULL, such properties are not generated
+            key = odsb_key_gen_random(gen->key_gen_params, type);
+            key = (key != NULL && odsb_object_has_key(parent, key) ? NULL : key);
+        }
+        if (key == NULL) {
+            continue;
+        }
 
+        uint64_t data;
+        char buffer[32];
+        switch (type) {
+            case prop_type_integer:
+                status = brooks_doc_add_integer(parent, key, odsb_value_draw(brooks_type_number_integer,
+                                                                             values->val_int, NULL, &data, buffer));
+                break;
+            case prop_type_boolean:
+                status = brooks_doc_add_boolean(parent, key, odsb_value_draw(brooks_type_boolean,
+                                                                             values->val_boolean, NULL, &data, buffer));
+                break;
+            case prop_type_decimal:
+                status = brooks_doc_add_decimal(parent, key, odsb_value_draw(brooks_type_number_double,
+                                                                             values->val_decimal, NULL, &data, buffer));
+                break;
+            case prop_type_string:
+                status = brooks_doc_add_string(parent, key, odsb_value_draw(brooks_type_string,
+                                                                            values->val_string, NULL, &data, buffer));
+                break;
+            case prop_type_object: {
+                brooks_object_t *object;
+                if ((status = brooks_doc_add_object(&object, parent, key)) == brooks_status_ok) {
+                    status = odbs_object_make(object, gen, depth + 1);
+                }
+            } break;
+            default: {
+                brooks_array_t *array;
+                if ((status = brooks_doc_add_array(&array, parent, odsb_prop_element_type(type), key)) ==
+                        brooks_status_ok) {
+                    status = odbs_array_fill(array, gen, type, depth + 1);
+                }
+            } break;
+        }
+    }
+    return status;
+}
 
+static inline brooks_status_e odbs_document_make(brooks_object_t **document, brooks_pool_t *pool,
+                                                 const odsb_doc_gen_t *gen)
+{
+    brooks_status_e status;
+    if ((status = brooks_doc_create(document, pool)) == brooks_status_ok) {
+        status = odbs_object_make(*document, gen, 0);
+    }
+    return status;
 }
 
 #endif //BROOKS_MB_DATAGEN_H
@@ -0,0 +1,314 @@
+#ifndef BROOKS_MB_QUERYGEN_H
+#define BROOKS_MB_QUERYGEN_H
+
+#include <opendsb/odsb_datagen.h>
+#include <brooks/brooks_misc.h>
+#include <brooks/brooks_path.h>
+#include <brooks/brooks_query.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ODSB_QUERY_MAX_CONJUNCTS       3
+#define ODSB_QUERY_MAX_PATH_DEPTH      16
+
+typedef enum odsb_predicate_e {
+    odsb_predicate_int_range,
+    odsb_predicate_int_equals,
+    odsb_predicate_dec_range,
+    odsb_predicate_str_range
+} odsb_predicate_e;
+
+static const char *odsb_predicate_names[] = { "int_range", "int_equals", "dec_range", "str_range" };
+
+/**
+ * What a generated query should look like. The population of a query are the values of the predicate's type that are
+ * reached by a key path of 'path_depth' wildcards (i.e., below 'path_depth' keys, see brooks_path.h) and that lie in
+ * the domain of the value histogram the generator draws them from. The query selects the fraction 'selectivity' of
+ * its population, through 'num_conjuncts' predicates that are evaluated by one filter:
+ *
+ *   1  the value window [lower, upper] as value range
+ *   2  the value window as value range, and the value type
+ *   3  the lower end as value range, the upper end as typed value predicate, and the value type
+ *
+ * Since values are drawn independently from the histograms, the expected selectivity of a window is its share of the
+ * histogram's weight. Windows are chosen to come closest to the target, which is exact up to the weight of a single
+ * histogram entry ('int_equals' is limited to the weight of one entry by nature).
+ */
+typedef struct odsb_query_spec_t
+{
+    odsb_predicate_e predicate;
+    double selectivity;
+    unsigned path_depth;
+    unsigned num_conjuncts;
+} odsb_query_spec_t;
+
+typedef struct odsb_query_t
+{
+    odsb_query_spec_t spec;
+    brooks_type_e type;
+    char key_path[2 * ODSB_QUERY_MAX_PATH_DEPTH];
+    brooks_path_t *path;
+    brooks_index_key_t lower;
+    brooks_index_key_t upper;
+    brooks_index_key_t domain_min;
+    brooks_index_key_t domain_max;
+    double expected_selectivity;
+    brooks_filter_t *filter;
+    brooks_query_t *query;
+} odsb_query_t;
+
+typedef struct odsb_query_entry_t
+{
+    brooks_index_key_t key;
+    uint64_t weight;
+} odsb_query_entry_t;
+
+static inline bool odsb_predicate_by_name(odsb_predicate_e *predicate, const char *name)
+{
+    for (size_t i = 0; i < sizeof(odsb_predicate_names) / sizeof(odsb_predicate_names[0]); i++) {
+        if (strcmp(odsb_predicate_names[i], name) == 0) {
+            *predicate = (odsb_predicate_e) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline brooks_type_e odsb_predicate_type(odsb_predicate_e predicate)
+{
+    switch (predicate) {
+        case odsb_predicate_int_range:
+        case odsb_predicate_int_equals: return brooks_type_number_integer;
+        case odsb_predicate_dec_range:  return brooks_type_number_double;
+        default:                        return brooks_type_string;
+    }
+}
+
+// Property values are drawn from the 'val_*' histograms; the corpora of opendsb draw array elements from them as well
+static inline const odsb_histogram_t *odsb_predicate_histogram(const odsb_values_gen_params_t *values,
+                                                               odsb_predicate_e predicate)
+{
+    switch (odsb_predicate_type(predicate)) {
+        case brooks_type_number_integer: return values->val_int;
+        case brooks_type_number_double:  return values->val_decimal;
+        default:                         return values->val_string;
+    }
+}
+
+static inline int odsb_query_entry_compare(const void *lhs, const void *rhs)
+{
+    return brooks_index_key_compare(&((const odsb_query_entry_t *) lhs)->key,
+                                    &((const odsb_query_entry_t *) rhs)->key);
+}
+
+static inline bool odsb_query_pred_type(void *capture, const brooks_type_e type)
+{
+    return (type == ((const odsb_query_t *) capture)->type);
+}
+
+static inline bool odsb_query_pred_int_upper(void *capture, const uint64_t *integer)
+{
+    return (*integer <= ((const odsb_query_t *) capture)->upper.integer);
+}
+
+static inline bool odsb_query_pred_dec_upper(void *capture, const double *decimal)
+{
+    return (*decimal <= ((const odsb_query_t *) capture)->upper.decimal);
+}
+
+static inline bool odsb_query_pred_str_upper(void *capture, const char **string)
+{
+    return (strcmp(*string, ((const odsb_query_t *) capture)->upper.string) <= 0);
+}
+
+// Index of the first 'end' in (start, num] with a weight of [start, end) of at least 'target', 'num' if there is none
+static inline size_t odsb_query_window_end(const uint64_t *prefix, size_t num, size_t start, double target)
+{
+    size_t lo = start + 1, hi = num;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((double) (prefix[mid] - prefix[start]) >= target) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+// Chooses the window over the sorted 'entries' that comes closest to 'target' weight, starting at a random position
+static inline uint64_t odsb_query_window(size_t *first, size_t *last, const odsb_query_entry_t *entries, size_t num,
+                                         double target, bool single)
+{
+    if (single) {
+        size_t num_best = 0;
+        double best = INFINITY;
+        for (size_t i = 0; i < num; i++) {
+            double distance = fabs((double) entries[i].weight - target);
+            num_best = (distance < best ? 1 : num_best + (distance == best));
+            best = (distance < best ? distance : best);
+        }
+        size_t pick = odsb_random((long) num_best);
+        for (size_t i = 0; i < num; i++) {
+            if (fabs((double) entries[i].weight - target) == best && pick-- == 0) {
+                *first = *last = i;
+                return entries[i].weight;
+            }
+        }
+    }
+
+    uint64_t *prefix = malloc((num + 1) * sizeof(uint64_t));
+    prefix[0] = 0;
+    for (size_t i = 0; i < num; i++) {
+        prefix[i + 1] = prefix[i] + entries[i].weight;
+    }
+
+    // windows may start anywhere such that the remaining weight is sufficient
+    size_t max_start = 0;
+    while (max_start + 1 < num && (double) (prefix[num] - prefix[max_start + 1]) >= target) {
+        max_start++;
+    }
+    size_t start = odsb_random((long) max_start + 1);
+    size_t end = odsb_query_window_end(prefix, num, start, target);
+    double above = (double) (prefix[end] - prefix[start]) - target;
+    if (end > start + 1 && above > target - (double) (prefix[end - 1] - prefix[start])) {
+        end--;
+    }
+
+    uint64_t weight = prefix[end] - prefix[start];
+    *first = start;
+    *last = end - 1;
+    free(prefix);
+    return weight;
+}
+
+static inline brooks_index_key_t odsb_query_key(brooks_type_e type, const void *data)
+{
+    brooks_index_key_t key = { .type = type };
+    switch (type) {
+        case brooks_type_number_integer: key.integer = *(const uint64_t *) data; break;
+        case brooks_type_number_double:  key.decimal = *(const double *) data; break;
+        default:                         key.string = data; break;
+    }
+    return key;
+}
+
+// Strings of histogram entries are copied, such that the query does not depend on the generator's lifetime
+static inline brooks_index_key_t odsb_query_key_copy(brooks_pool_t *pool, const brooks_index_key_t *key)
+{
+    brooks_index_key_t result = *key;
+    if (key->type == brooks_type_string) {
+        result.string = brooks_misc_strdup(pool, key->string);
+    }
+    return result;
+}
+
+/**
+ * Generates a query following 'spec' from the histograms of 'values', i.e., the histograms a corpus was generated
+ * with. The query is prepared by the caller, after indexes on 'key_path' are added if wanted. Random choices are
+ * drawn from the generator of the calling thread (see odsb_seed).
+ */
+static inline brooks_status_e odsb_query_make(odsb_query_t **query, brooks_pool_t *pool,
+                                              const odsb_values_gen_params_t *values, const odsb_query_spec_t *spec)
+{
+    if (query == NULL || pool == NULL || values == NULL || spec == NULL) {
+        return brooks_status_nullptr;
+    }
+    const odsb_histogram_t *hist = odsb_predicate_histogram(values, spec->predicate);
+    if (hist == NULL || hist->num_elements_data_list == 0 || !(spec->selectivity > 0 && spec->selectivity <= 1) ||
+        spec->path_depth == 0 || spec->path_depth > ODSB_QUERY_MAX_PATH_DEPTH || spec->num_conjuncts == 0 ||
+        spec->num_conjuncts > ODSB_QUERY_MAX_CONJUNCTS) {
+        return brooks_status_illegalarg;
+    }
+
+    odsb_query_t *result = brooks_pool_malloc(pool, sizeof(odsb_query_t));
+    if (result == NULL) {
+        return brooks_status_pmalloc_err;
+    }
+    result->spec = *spec;
+    result->type = odsb_predicate_type(spec->predicate);
+    char *it = result->key_path;
+    for (unsigned i = 0; i < spec->path_depth; i++) {
+        it += sprintf(it, i > 0 ? ".*" : "*");
+    }
+
+    size_t num = hist->num_elements_data_list;
+    uint64_t total = 0;
+    odsb_query_entry_t *entries = malloc(num * sizeof(odsb_query_entry_t));
+    for (size_t i = 0; i < num; i++) {
+        entries[i] = (odsb_query_entry_t) {
+            .key = odsb_query_key(result->type, hist->data_list[i]), .weight = hist->weights[i]
+        };
+        total += hist->weights[i];
+    }
+    qsort(entries, num, sizeof(odsb_query_entry_t), odsb_query_entry_compare);
+
+    size_t first, last;
+    uint64_t weight = odsb_query_window(&first, &last, entries, num, spec->selectivity * total,
+                                        spec->predicate == odsb_predicate_int_equals);
+    result->expected_selectivity = (double) weight / total;
+    result->lower = odsb_query_key_copy(pool, &entries[first].key);
+    result->upper = odsb_query_key_copy(pool, &entries[last].key);
+    result->domain_min = odsb_query_key_copy(pool, &entries[0].key);
+    result->domain_max = odsb_query_key_copy(pool, &entries[num - 1].key);
+    free(entries);
+
+    brooks_status_e status;
+    brooks_filter_t *filter;
+    if ((status = brooks_path_create(&result->path, pool, result->key_path)) != brooks_status_ok ||
+        (status = brooks_filter_create(&filter, pool, 0, SIZE_MAX)) != brooks_status_ok ||
+        (status = brooks_filter_set_key_path(filter, result->key_path)) != brooks_status_ok ||
+        (status = brooks_filter_set_capture(filter, result)) != brooks_status_ok) {
+        return status;
+    }
+    if (spec->num_conjuncts < 3) {
+        status = brooks_filter_set_value_range(filter, &result->lower, true, &result->upper, true);
+    } else {
+        status = brooks_filter_set_value_range(filter, &result->lower, true, NULL, false);
+        switch (result->type) {
+            case brooks_type_number_integer: brooks_filter_set_value_int(filter, odsb_query_pred_int_upper); break;
+            case brooks_type_number_double:  brooks_filter_set_value_dec(filter, odsb_query_pred_dec_upper); break;
+            default:                         brooks_filter_set_value_str(filter, odsb_query_pred_str_upper); break;
+        }
+    }
+    if (status == brooks_status_ok && spec->num_conjuncts > 1) {
+        status = brooks_filter_set_value_type(filter, odsb_query_pred_type);
+    }
+    if (status == brooks_status_ok && (status = brooks_query_create(&result->query, pool)) == brooks_status_ok &&
+        (status = brooks_query_add_terminator(result->query, filter)) == brooks_status_ok) {
+        result->filter = filter;
+        *query = result;
+    }
+    return status;
+}
+
+typedef struct odsb_query_population_t
+{
+    const odsb_query_t *query;
+    size_t num_values;
+} odsb_query_population_t;
+
+static inline void odsb_query_population_visit(void *capture, const brooks_value_t *value)
+{
+    odsb_query_population_t *population = capture;
+    const odsb_query_t *query = population->query;
+    brooks_index_key_t key;
+    if (brooks_index_key_from_value(&key, value) && key.type == query->type &&
+        brooks_index_key_compare(&key, &query->domain_min) >= 0 &&
+        brooks_index_key_compare(&key, &query->domain_max) <= 0) {
+        population->num_values++;
+    }
+}
+
+// Number of values in 'document' a query generated by odsb_query_make selects from
+static inline size_t odsb_query_population(const odsb_query_t *query, const brooks_object_t *document)
+{
+    odsb_query_population_t population = { .query = query, .num_values = 0 };
+    brooks_path_visit(query->path, document, &population, odsb_query_population_visit);
+    return population.num_values;
+}
+
+#endif //BROOKS_MB_QUERYGEN_H
@@ -0,0 +1,160 @@
+#ifndef BROOKS_MB_WRITER_H
+#define BROOKS_MB_WRITER_H
+
+#include <opendsb/odsb_datagen.h>
+#include <opendsb/odsb_bench.h>
+#include <brooks/brooks_doc.h>
+#include <brooks/brooks_pool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <threads.h>
+
+#define ODSB_WRITER_BUFFER_SIZE        (4 * 1024 * 1024)
+#define ODSB_WRITER_DOCS_PER_POOL      1024
+#define ODSB_WRITER_MAX_THREADS        256
+
+/**
+ * Writes generated documents as NDJSON into one file per worker thread, named "<prefix>.<partition>.ndjson". Each
+ * partition is generated from its own stream of 'seed' (see odsb_seed), such that the files are reproducible for a
+ * given seed and number of threads. Generation stops once 'num_docs' documents or 'target_bytes' bytes (0 for no
+ * limit, but at least one must be set) are written; both are split evenly among the partitions. Memory is bounded:
+ * documents are created in a pool that is recycled every ODSB_WRITER_DOCS_PER_POOL documents and written through a
+ * buffer of 'buffer_size' bytes per worker. Documents get a unique integer "id".
+ */
+typedef struct odsb_writer_config_t
+{
+    const char *prefix;
+    const odsb_doc_gen_t *gen;
+    unsigned num_threads;
+    uint64_t seed;
+    size_t num_docs;
+    size_t target_bytes;
+    size_t buffer_size;
+} odsb_writer_config_t;
+
+typedef struct odsb_writer_stats_t
+{
+    unsigned num_partitions;
+    size_t num_docs;
+    size_t num_bytes;
+    uint64_t elapsed_ns;
+} odsb_writer_stats_t;
+
+typedef struct odsb_writer_partition_t
+{
+    const odsb_writer_config_t *config;
+    unsigned idx;
+    size_t max_docs;
+    size_t max_bytes;
+    size_t num_docs;
+    size_t num_bytes;
+    brooks_status_e status;
+} odsb_writer_partition_t;
+
+// Share of 'total' assigned to partition 'idx' of 'num', 0 if 'total' is 0 (i.e., unlimited)
+static inline size_t odsb_writer_share(size_t total, unsigned idx, unsigned num)
+{
+    return (total == 0 ? 0 : total / num + (idx < total % num));
+}
+
+static inline int odsb_writer_worker(void *arg)
+{
+    odsb_writer_partition_t *partition = arg;
+    const odsb_writer_config_t *config = partition->config;
+    char path[4096];
+    FILE *file;
+
+    snprintf(path, sizeof(path), "%s.%u.ndjson", config->prefix, partition->idx);
+    if ((file = fopen(path, "wb")) == NULL) {
+        partition->status = brooks_status_failed;
+        return thrd_error;
+    }
+    char *buffer = malloc(config->buffer_size);
+    if (buffer == NULL || setvbuf(file, buffer, _IOFBF, config->buffer_size) != 0) {
+        partition->status = (buffer == NULL ? brooks_status_malloc_err : brooks_status_failed);
+        fclose(file);
+        free(buffer);
+        return thrd_error;
+    }
+    odsb_seed(config->seed, partition->idx);
+
+    brooks_pool_t *pool = NULL;
+    brooks_object_t *document;
+    partition->status = brooks_status_ok;
+    while (partition->status == brooks_status_ok &&
+           (partition->max_docs == 0 || partition->num_docs < partition->max_docs) &&
+           (partition->max_bytes == 0 || partition->num_bytes < partition->max_bytes)) {
+        if (partition->num_docs % ODSB_WRITER_DOCS_PER_POOL == 0) {
+            if (pool != NULL) {
+                brooks_pool_dispose(pool);
+            }
+            brooks_pool_create(&pool);
+        }
+        uint64_t id = (uint64_t) partition->num_docs * config->num_threads + partition->idx;
+        if ((partition->status = odbs_document_make(&document, pool, config->gen)) == brooks_status_ok &&
+            (partition->status = brooks_doc_add_integer(document, "id", &id)) == brooks_status_ok &&
+            (partition->status = brooks_doc_print(file, document)) == brooks_status_ok) {
+            fputc('\n', file);
+            partition->num_docs++;
+            partition->num_bytes = (size_t) ftell(file);
+        }
+    }
+
+    if (ferror(file)) {
+        partition->status = brooks_status_failed;
+    }
+    fclose(file);
+    free(buffer);
+    if (pool != NULL) {
+        brooks_pool_dispose(pool);
+    }
+    return (partition->status == brooks_status_ok ? thrd_success : thrd_error);
+}
+
+static inline brooks_status_e odsb_writer_run(odsb_writer_stats_t *stats, const odsb_writer_config_t *config)
+{
+    if (stats == NULL || config == NULL || config->prefix == NULL || config->gen == NULL) {
+        return brooks_status_nullptr;
+    } else if (config->num_threads == 0 || config->num_threads > ODSB_WRITER_MAX_THREADS ||
+               (config->num_docs == 0 && config->target_bytes == 0)) {
+        return brooks_status_illegalarg;
+    }
+
+    odsb_writer_config_t worker_config = *config;
+    worker_config.buffer_size = (config->buffer_size > 0 ? config->buffer_size : ODSB_WRITER_BUFFER_SIZE);
+
+    unsigned num = config->num_threads;
+    odsb_writer_partition_t partitions[ODSB_WRITER_MAX_THREADS];
+    thrd_t threads[ODSB_WRITER_MAX_THREADS];
+    bool started[ODSB_WRITER_MAX_THREADS];
+    brooks_status_e status = brooks_status_ok;
+
+    uint64_t begin = odsb_now_ns();
+    for (unsigned i = 0; i < num; i++) {
+        partitions[i] = (odsb_writer_partition_t) {
+            .config = &worker_config, .idx = i, .max_docs = odsb_writer_share(config->num_docs, i, num),
+            .max_bytes = odsb_writer_share(config->target_bytes, i, num), .status = brooks_status_ok
+        };
+        if (config->num_docs > 0 && partitions[i].max_docs == 0) {
+            started[i] = false;
+            continue;
+        }
+        started[i] = (thrd_create(&threads[i], odsb_writer_worker, &partitions[i]) == thrd_success);
+        status = (started[i] ? status : brooks_status_failed);
+    }
+
+    *stats = (odsb_writer_stats_t) { .num_partitions = 0 };
+    for (unsigned i = 0; i < num; i++) {
+        if (started[i]) {
+            thrd_join(threads[i], NULL);
+            status = (partitions[i].status == brooks_status_ok ? status : partitions[i].status);
+            stats->num_partitions++;
+            stats->num_docs += partitions[i].num_docs;
+            stats->num_bytes += partitions[i].num_bytes;
+        }
+    }
+    stats->elapsed_ns = odsb_now_ns() - begin;
+    return status;
+}
+
+#endif //BROOKS_MB_WRITER_H
@@ -92,7 +92,11 @@ int main(int argc, char* argv[])
     fprintf(stdout, "\n\n\n");
 
     const char *text = "{ \"snapshot_date\": \"Oct 23th, 2017\", \"source\": { \"site\": \"http://www.imdb.com/title/tt1396484/?ref_=nv_sr_1\" }, \"movies\": [ { \"title\": \"It (2017)\", \"actors\": [ { \"name\": \"Bill Skarsgård\", \"role\": \"Pennywise\" }, { \"name\": \"Jaeden Lieberher\", \"role\": \"Bill\" } ] } ], \"movies\": [ { \"title\": \"It (2017)\", \"actors\": [ { \"name\": \"Bill Skarsgård\", \"role\": \"Pennywise\" }, { \"name\": \"Jaeden Lieberher\", \"role\": \"Bill\" } ], \"keywords\": [ \"clown\", \"based on novel\", \"supernatural\", \"balloon\", \"fear\" ], \"poster_url\": null, \"reviews\": 928, \"rating\": 7.800000 }, { \"title\": \"Jigsaw (2017)\", \"actors\": [ { \"name\": \"Tobin Bell\", \"role\": \"John Kramer\" }, { \"name\": \"Matt Passmore\", \"role\": \"Logan Nelson\" } ], \"keywords\": [ \"copycat killer\", \"one word title\", \"cop\", \"murder investigation\" ], \"poster_url\": \"https://images-na.ssl-images-amazon.com/images/M/MV5BNmRiZDM4ZmMtOTVjMi00YTNlLTkyNjMtMjI2OTAxNjgwMWM1XkEyXkFqcGdeQXVyMjMxOTE0ODA@._V1_SY1000_CR0,0,648,1000_AL_.jpg\" } ] }";
-    brooks_doc_parse(document2, text);
+    if (brooks_doc_parse(&document2, pool, text) == brooks_status_ok) {
+        printf("JSON parsed:\n\t");
+        brooks_doc_print(stdout, document2);
+        fprintf(stdout, "\n\n\n");
+    }
 
 /*
     brooks_operator_t scan_object, scan_array;
@@ -21,22 +21,90 @@
 
 #include <stdlib.h>
 #include <memory.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <ctype.h>
 
 #include <brooks/brooks.h>
 #include <brooks/brooks_doc.h>
 #include <brooks/brooks_misc.h>
+#include <brooks/brooks_path.h>
+#include <brooks/brooks_shape.h>
 #include <math.h>
 
 #include <json-parser/json.h>
 
+// ---------------------------------------------------------------------------------------------------------------------
+// C O N S T A N T S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#define CLONE_ALIGNMENT                      _Alignof(brooks_value_t)
+
 // ---------------------------------------------------------------------------------------------------------------------
 // T Y P E S
 // ---------------------------------------------------------------------------------------------------------------------
 
+typedef struct lazy_container_t
+{
+    uint32_t                       begin;                    // offset of the opening bracket in the text
+    uint32_t                       end;                      // offset of the closing bracket
+    uint32_t                       next;                     // the first container after this one's descendants
+    uint32_t                       length;                   // number of properties or elements
+    brooks_type_e                  type;                     // of the elements of an array
+} lazy_container_t;
+
+// The structural index of a lazily parsed document: its containers in the order of their opening brackets, such that
+// the children of a container follow it, each skipped through its 'next' to get to its next sibling
+typedef struct lazy_t
+{
+    char                          *text;                     // a copy, whose strings are decoded in place
+    size_t                         length;                   // of the text
+    lazy_container_t              *containers;
+    size_t                         num_containers;
+} lazy_t;
+
+// pointers held by lazy_t: text and containers
+#define LAZY_NUM_POINTERS                    2
+
+typedef struct lazy_scan_t
+{
+    const char                    *text;
+    const char                    *it;
+    lazy_container_t              *containers;
+    size_t                         num_containers;
+    size_t                         capacity;
+    brooks_status_e                status;
+} lazy_scan_t;
+
+// A parse that builds what 'paths' address only; 'active' holds, per depth, the paths whose components matched the
+// keys from the root so far
+typedef struct projection_t
+{
+    const brooks_path_t * const   *paths;
+    size_t                         num_paths;
+    size_t                        *active;
+    char                          *key;                 // the last key read, decoded
+    size_t                         key_capacity;
+    lazy_scan_t                    scan;                // of the values that are kept, reused
+} projection_t;
+
+typedef struct token_scan_t
+{
+    const char                    *text;
+    const char                    *it;
+    char                          *key;                 // decoded, the buffers are reused for all tokens
+    size_t                         key_capacity;
+    char                          *string;
+    size_t                         string_capacity;
+    void                          *capture;
+    brooks_doc_token_handler_t     handler;
+    bool                           stopped;
+} token_scan_t;
+
 typedef struct entry_desc_t
 {
     union {
-        brooks_named_entry_t         *named_entry;
+        brooks_object_t              *object;                 // of a named entry, the object that holds it
         brooks_unnamed_entry_t       *unnamed_entry;
     } context;
     brooks_entry_type_e               context_type;
@@ -45,22 +113,41 @@ typedef struct entry_desc_t
 typedef struct brooks_object_t
 {
     entry_desc_t                  context_desc;
-    brooks_named_entry_t         **entries;
-    size_t                        num_entries;
+    brooks_shape_t               *shape;
+    brooks_value_t               *values;                     // in the order of the shape's keys
     size_t                        capacity;
-    size_t                        idx;
+    size_t                        idx;                        // position in the parent object, if any
     brooks_pool_t                 *pool;
+    bool                          frozen;
+    bool                          lazy_pending;               // not materialized yet
+    bool                          text_strings;               // some strings are decoded in a text, see value_recycle
+    uint32_t                      lazy_container;             // see 'lazy'
+    const lazy_t                 *lazy;                       // of a lazily parsed object, the root keeps it
 } brooks_object_t;
 
+// pointers held by brooks_object_t: context, shape, values, pool and lazy
+#define OBJECT_NUM_POINTERS                  5
+
 typedef struct brooks_array_t
 {
     entry_desc_t             context_desc;
+    size_t                         idx;                      // position in the parent object, if any
     size_t                         num_entries;
     size_t                         capacity;
     brooks_type_e                  type;
+    bool                           frozen;
+    bool                           text_strings;             // some strings are decoded in a text, see value_recycle
     brooks_unnamed_entry_t       **entries;
+    brooks_zone_t                 *zones;
+    size_t                         num_zones;
+    size_t                         zones_capacity;
+    const lazy_t                  *lazy;                     // of a lazily parsed array not materialized yet
+    uint32_t                       lazy_container;
 } brooks_array_t;
 
+// pointers held by brooks_array_t: context, entries, zones and lazy
+#define ARRAY_NUM_POINTERS                   4
+
 typedef struct  brooks_unnamed_entry_t
 {
     brooks_array_t                *context;
@@ -69,12 +156,8 @@ typedef struct  brooks_unnamed_entry_t
 
 } brooks_unnamed_entry_t;
 
-typedef struct brooks_named_entry_t
-{
-    brooks_object_t               *context;
-    char                         *key;
-    brooks_value_t                *value;
-} brooks_named_entry_t;
+// pointers held by brooks_unnamed_entry_t: context and value
+#define UNNAMED_ENTRY_NUM_POINTERS           2
 
 typedef struct brooks_element_t {
     entry_desc_t            entry;
@@ -95,6 +178,37 @@ typedef struct brooks_value_t
     };
 } brooks_value_t;
 
+typedef struct brooks_doc_history_t
+{
+    brooks_pool_t                         *pool;
+    _Atomic(const brooks_object_t **)      versions;
+    size_t                                 capacity;
+    atomic_size_t                          num_versions;
+} brooks_doc_history_t;
+
+typedef struct history_update_t
+{
+    brooks_pool_t                 *pool;
+    char                         **components;
+    size_t                         num_components;
+    brooks_type_e                  type;
+    const void                    *data;
+    bool                           remove;
+} history_update_t;
+
+typedef struct clone_t
+{
+    brooks_pool_t                 *pool;
+    brooks_pool_layout_t           layout;
+    char                          *next;                     // where the next structure is placed in the block
+    bool                           same_shapes;              // whether source and clone share a shape registry
+    bool                           freeze;
+    const brooks_shape_t         **sources;                  // shapes of the source, open addressing
+    brooks_shape_t               **shapes;                   // their counterparts in the pool of the clone
+    size_t                         num_shapes;
+    size_t                         shapes_capacity;
+} clone_t;
+
 // ---------------------------------------------------------------------------------------------------------------------
 // H E L P E R   D E C L A R A T I O N
 // ---------------------------------------------------------------------------------------------------------------------
@@ -104,18 +218,98 @@ static brooks_status_e property_add(brooks_object_t *parent, brooks_type_e type,
 static brooks_status_e value_set(brooks_value_t *value, brooks_pool_t *pool, brooks_type_e type, const void *data);
 
 static brooks_object_t *json_create(brooks_pool_t *pool, brooks_entry_type_e parent_type, void *parent_ptr);
-static brooks_status_e json_autoresize(brooks_object_t *object);
+static brooks_status_e json_reserve(brooks_object_t *object, size_t capacity);
 static brooks_status_e array_autoresize(brooks_array_t *array);
-static void json_add_entry(brooks_object_t *object, brooks_named_entry_t *entry);
+static brooks_value_t *json_add_entry(brooks_object_t *object, brooks_type_e type, const char *key);
 static brooks_status_e json_add_complex(brooks_object_t **object, brooks_array_t **array, brooks_object_t *parent,
-                                       const char *key, brooks_type_e complex_type, brooks_type_e array_type);
+                                       const char *key, brooks_type_e complex_type, brooks_type_e array_type,
+                                       size_t array_capacity);
+static brooks_status_e array_add_array(brooks_array_t **array, brooks_type_e type, brooks_array_t *parent,
+                                       size_t capacity);
 static brooks_value_t *value_create(brooks_pool_t *pool, brooks_type_e type, brooks_entry_type_e context,
                                    void *parent_ptr);
-static brooks_named_entry_t *entry_create(brooks_object_t *object, brooks_type_e type, const char *key);
-static brooks_array_t *array_create(brooks_type_e type, brooks_entry_type_e context, void *parent_ptr);
+static brooks_array_t *array_create(brooks_type_e type, size_t capacity, brooks_entry_type_e context,
+                                    void *parent_ptr);
 static brooks_pool_t *context_get_pool(entry_desc_t *desc);
 static brooks_unnamed_entry_t *array_entry_create(brooks_pool_t *pool, brooks_array_t *context);
 static brooks_element_t *element_create(brooks_pool_t *pool, brooks_entry_type_e entry_type, void *entry, size_t idx);
+static bool context_is_root(const entry_desc_t *desc);
+static const entry_desc_t *context_get_parent(const entry_desc_t *desc);
+static brooks_status_e zone_map_update(brooks_array_t *array, size_t idx, const brooks_value_t *value);
+static brooks_status_e parse_object(brooks_object_t *object, const json_value *value);
+static brooks_status_e parse_array(brooks_array_t *array, const json_value *value);
+static brooks_type_e parse_array_type(const json_value *value);
+static brooks_status_e print_value(FILE *file, const brooks_value_t *value);
+static void print_string(FILE *file, const char *string);
+static size_t footprint_object(brooks_doc_footprint_t *footprint, const brooks_object_t *object, const lazy_t *lazy);
+static size_t footprint_array(brooks_doc_footprint_t *footprint, const brooks_array_t *array, const lazy_t *lazy);
+static void footprint_value(brooks_doc_footprint_t *footprint, const brooks_value_t *value, size_t bytes,
+                            const lazy_t *lazy);
+static brooks_status_e history_update(brooks_doc_history_t *history, const char *location, brooks_type_e type,
+                                      const void *data, bool remove);
+static brooks_status_e history_update_object(brooks_object_t *object, const history_update_t *update, size_t idx);
+static brooks_status_e history_update_array(brooks_array_t *array, const history_update_t *update, size_t idx);
+static brooks_status_e history_update_value(brooks_value_t *value, const history_update_t *update, size_t idx);
+static brooks_status_e history_publish(brooks_doc_history_t *history, const brooks_object_t *version);
+static brooks_object_t *object_copy(brooks_pool_t *pool, const brooks_object_t *object, entry_desc_t context,
+                                    size_t num_add);
+static brooks_status_e object_remove(brooks_object_t *object, size_t idx);
+static brooks_array_t *array_copy(brooks_pool_t *pool, const brooks_array_t *array, entry_desc_t context,
+                                  size_t num_add);
+static brooks_unnamed_entry_t *array_entry_copy(brooks_pool_t *pool, brooks_array_t *array,
+                                                const brooks_unnamed_entry_t *entry, size_t idx);
+static brooks_status_e value_assign(brooks_value_t *value, brooks_pool_t *pool, brooks_type_e type, const void *data);
+static bool value_data_valid(brooks_type_e type, const void *data);
+static void value_recycle(brooks_pool_t *pool, const brooks_value_t *value);
+static void object_recycle(brooks_pool_t *pool, brooks_object_t *object);
+static void array_recycle(brooks_pool_t *pool, brooks_array_t *array);
+static size_t json_grow_capacity(const brooks_object_t *object, const brooks_shape_t *shape);
+static brooks_status_e json_shrink(brooks_object_t *object);
+static brooks_status_e array_shrink(brooks_array_t *array);
+static brooks_status_e zone_map_refresh(brooks_array_t *array, size_t idx, bool following);
+static brooks_status_e array_entry_insert(brooks_array_t *array, size_t idx, brooks_unnamed_entry_t *entry);
+static brooks_status_e value_copy(brooks_value_t *copy, brooks_pool_t *pool, const brooks_value_t *value,
+                                  entry_desc_t context);
+static brooks_status_e doc_clone(brooks_object_t **clone, brooks_pool_t *pool, const brooks_object_t *doc,
+                                 bool freeze);
+static brooks_status_e clone_measure(clone_t *clone, const brooks_value_t *value);
+static brooks_status_e clone_measure_object(clone_t *clone, const brooks_object_t *object);
+static void clone_account(clone_t *clone, size_t size, brooks_pool_category_e category);
+static void *clone_place(clone_t *clone, size_t size);
+static brooks_object_t *clone_object(clone_t *clone, const brooks_object_t *object, entry_desc_t context);
+static brooks_array_t *clone_array(clone_t *clone, const brooks_array_t *array, entry_desc_t context);
+static brooks_status_e clone_value(clone_t *clone, brooks_value_t *copy, const brooks_value_t *value,
+                                   entry_desc_t context);
+static brooks_shape_t *clone_shape(clone_t *clone, const brooks_shape_t *shape);
+static char **location_split(size_t *num_components, const char *location);
+static bool location_position(size_t *position, const char *component);
+static brooks_status_e object_materialize(const brooks_object_t *object);
+static brooks_status_e array_materialize(const brooks_array_t *array);
+static brooks_status_e lazy_value(brooks_value_t *value, brooks_pool_t *pool, const lazy_t *lazy, char **it,
+                                  uint32_t *child);
+static bool lazy_scan_value(lazy_scan_t *scan, brooks_type_e *type);
+static bool lazy_scan_container(lazy_scan_t *scan, brooks_type_e *type);
+static bool lazy_scan_string(lazy_scan_t *scan);
+static bool lazy_scan_number(lazy_scan_t *scan, brooks_type_e *type);
+static brooks_type_e lazy_array_type(lazy_scan_t *scan, brooks_type_e result, brooks_type_e type, size_t idx);
+static char *lazy_skip(const char *it);
+static char *lazy_string(char **it);
+static char *lazy_number(char *it, brooks_value_t *value);
+static long lazy_hex(const char *it);
+static const char *lazy_string_copy(char **buffer, size_t *capacity, const char **it);
+static const char *lazy_skip_value(const char *it, size_t *num_elements);
+static brooks_status_e value_materialize(const brooks_value_t *value);
+static brooks_status_e projection_object(projection_t *projection, brooks_object_t *object, const char **it,
+                                         size_t depth, size_t num_active);
+static brooks_status_e projection_array(projection_t *projection, brooks_array_t *array, const char **it,
+                                        size_t depth, size_t num_active);
+static brooks_status_e projection_keep(projection_t *projection, brooks_object_t *object, const char *key,
+                                       const char **it);
+static brooks_type_e projection_array_type(const char *it);
+static brooks_status_e token_value(token_scan_t *scan, const char *key);
+static brooks_status_e token_container(token_scan_t *scan, const char *key);
+static bool token_emit(token_scan_t *scan, brooks_doc_token_e kind, const char *key, const brooks_value_t *value,
+                       const char *begin, size_t num_elements, brooks_doc_scan_e *action);
 
 // ---------------------------------------------------------------------------------------------------------------------
 // I N T E R F A C E   I M P L E M E N T A T I O N
@@ -127,130 +321,142 @@ brooks_status_e brooks_doc_create(brooks_object_t **json, brooks_pool_t *pool)
     return (*json != NULL ? brooks_status_ok : (pool != NULL ? brooks_status_failed : brooks_status_nopool));
 }
 
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-static void process_value(json_value* value, int depth, brooks_object_t *obj);
-
-static void process_object(json_value* value, int depth, brooks_object_t *obj)
+brooks_status_e brooks_doc_parse(brooks_object_t **doc, brooks_pool_t *pool, const char *text)
 {
-    int length, x;
-    if (value == NULL) {
-        return;
-    }
-    length = value->u.object.length;
-    for (x = 0; x < length; x++) {
-        printf("object[%d].name = %s\n", x, value->u.object.values[x].name);
-        process_value(value->u.object.values[x].value, depth+1);
-    }
+    json_value *value;
+    brooks_status_e status;
+    if (doc && pool && text) {
+        if ((value = json_parse(text, strlen(text))) == NULL) {
+            return brooks_status_failed;
+        } else if (value->type != json_object) {
+            json_value_free(value);
+            return brooks_status_illegalarg;
+        } else {
+            if ((status = brooks_doc_create(doc, pool)) == brooks_status_ok) {
+                status = parse_object(*doc, value);
+            }
+            json_value_free(value);
+            return status;
+        }
+    } else return brooks_status_nullptr;
 }
 
-static void process_array(json_value* value, int depth, brooks_object_t *obj)
+brooks_status_e brooks_doc_parse_lazy(brooks_object_t **doc, brooks_pool_t *pool, const char *text)
 {
-    int length, x;
-    if (value == NULL) {
-        return;
-    }
-    length = value->u.array.length;
-    printf("array\n");
-    for (x = 0; x < length; x++) {
-        process_value(value->u.array.values[x], depth);
-    }
+    if (doc && pool && text) {
+        size_t length = strlen(text);
+        lazy_scan_t scan = { .text = text, .it = text, .status = brooks_status_ok };
+        brooks_type_e type;
+        if (length >= UINT32_MAX) {
+            // offsets in the index take 32 bits
+            return brooks_doc_parse(doc, pool, text);
+        } else if (!lazy_scan_value(&scan, &type) || *lazy_skip(scan.it) != '\0') {
+            free(scan.containers);
+            return (scan.status == brooks_status_malloc_err ? scan.status : brooks_status_failed);
+        } else if (type != brooks_type_object || scan.status != brooks_status_ok) {
+            free(scan.containers);
+            return (type != brooks_type_object ? brooks_status_illegalarg : scan.status);
+        }
+
+        lazy_t *lazy = brooks_pool_malloc(pool, sizeof(lazy_t));
+        char *copy = brooks_pool_malloc_tagged(pool, length + 1, brooks_pool_category_string);
+        lazy_container_t *containers = brooks_pool_malloc(pool, scan.num_containers * sizeof(lazy_container_t));
+        brooks_status_e status = brooks_status_pmalloc_err;
+        if (lazy != NULL && copy != NULL && containers != NULL &&
+            (status = brooks_doc_create(doc, pool)) == brooks_status_ok) {
+            *lazy = (lazy_t) { .text = memcpy(copy, text, length + 1), .length = length,
+                               .containers = memcpy(containers, scan.containers,
+                                                    scan.num_containers * sizeof(lazy_container_t)),
+                               .num_containers = scan.num_containers };
+            (*doc)->lazy = lazy;
+            (*doc)->lazy_pending = true;
+        }
+        free(scan.containers);
+        return status;
+    } else return brooks_status_nullptr;
 }
 
-static void process_value(json_value* value, int depth, brooks_object_t *obj)
+brooks_status_e brooks_doc_parse_projected(brooks_object_t **doc, brooks_pool_t *pool, const char *text,
+                                           const brooks_path_t * const *paths, size_t num_paths)
 {
-    int j;
-    if (value == NULL) {
-        return;
-    }
-    switch (value->type) {
-        case json_object:
-            process_object(value, depth + 1, obj);
-            break;
-        case json_array:
-            process_array(value, depth + 1, obj);
-            break;
-        case json_integer:
-            printf("int: %10" PRId64 "\n", value->u.integer);
+    if (doc && pool && text && (paths || num_paths == 0)) {
+        projection_t projection = { .paths = paths, .num_paths = num_paths };
+        size_t max_length = 0;
+        for (size_t i = 0; i < num_paths; i++) {
+            if (brooks_path_length(paths[i]) == 0) {
+                return brooks_doc_parse(doc, pool, text);
+            }
+            max_length = (brooks_path_length(paths[i]) > max_length ? brooks_path_length(paths[i]) : max_length);
+        }
+        const char *it = lazy_skip(text), *end;
+        if (*it != '{') {
+            end = lazy_skip_value(it, NULL);
+            return (end != NULL && *lazy_skip(end) == '\0' ? brooks_status_illegalarg : brooks_status_failed);
+        } else if (strlen(text) >= UINT32_MAX) {
+            // offsets in the index of kept values take 32 bits
+            return brooks_doc_parse(doc, pool, text);
+        } else if ((projection.active = malloc((num_paths * (max_length + 1) + 1) * sizeof(size_t))) == NULL) {
+            return brooks_status_malloc_err;
+        }
 
-            break;
-        case json_double:
-            printf("double: %f\n", value->u.dbl);
-            break;
-        case json_string:
-            printf("string: %s\n", value->u.string.ptr);
-            break;
-        case json_boolean:
-            printf("bool: %d\n", value->u.boolean);
-            break;
-    }
+        for (size_t i = 0; i < num_paths; i++) {
+            projection.active[i] = i;
+        }
+        brooks_status_e status = brooks_doc_create(doc, pool);
+        if (status == brooks_status_ok && (status = projection_object(&projection, *doc, &it, 0, num_paths)) ==
+            brooks_status_ok && *lazy_skip(it) != '\0') {
+            status = brooks_status_failed;
+        }
+        free(projection.active);
+        free(projection.key);
+        free(projection.scan.containers);
+        return status;
+    } else return brooks_status_nullptr;
 }
 
+brooks_status_e brooks_doc_scan(const char *text, void *capture, brooks_doc_token_handler_t handler)
+{
+    if (text && handler) {
+        token_scan_t scan = { .text = text, .it = lazy_skip(text), .capture = capture, .handler = handler };
+        brooks_status_e status = brooks_status_ok;
+        while (status == brooks_status_ok && !scan.stopped && *scan.it != '\0') {
+            if (*scan.it != '{') {
+                status = (lazy_skip_value(scan.it, NULL) != NULL ? brooks_status_illegalarg : brooks_status_failed);
+            } else {
+                status = token_container(&scan, NULL);
+                scan.it = lazy_skip(scan.it);
+            }
+        }
+        free(scan.key);
+        free(scan.string);
+        return status;
+    } else return brooks_status_nullptr;
+}
 
+brooks_status_e brooks_doc_clone(brooks_object_t **clone, brooks_pool_t *pool, const brooks_object_t *doc)
+{
+    return doc_clone(clone, pool, doc, false);
+}
 
-
-brooks_status_e brooks_doc_parse(brooks_object_t **doc, brooks_pool_t *pool, const char *text)
+brooks_status_e brooks_doc_freeze(brooks_object_t **frozen, brooks_pool_t *pool, const brooks_object_t *doc)
 {
-    json_value *value;
-    if (brooks_doc_create(doc, pool) == brooks_status_ok) {
-        if ((value = json_parse(text, strlen(text))) == NULL) {
-            perror("Unable to parse data\n");
-            return brooks_status_failed;
-        } else {
-            process_value(value, 0, doc);
-            return brooks_status_ok;
-        }
-    } else return brooks_status_interalerr;
+    return doc_clone(frozen, pool, doc, true);
 }
 
 brooks_status_e brooks_doc_print(FILE *file, const brooks_object_t *json)
 {
     if (file && json) {
+        brooks_status_e status = object_materialize(json);
         fprintf(file, "{ ");
-        for (size_t i = 0; i < json->num_entries; i++) {
-            brooks_named_entry_t *entry = json->entries[i];
-            printf("\"%s\": ", entry->key);
-            switch (entry->value->type) {
-                case brooks_type_object:
-                    brooks_doc_print(file, entry->value->object);
-                    break;
-                case brooks_type_array:
-                    brooks_doc_array_print(file, entry->value->array);
-                    break;
-                case brooks_type_number_integer:
-                    fprintf(file, "%lld", entry->value->integer);
-                    break;
-                case brooks_type_number_double:
-                    fprintf(file, "%f", entry->value->decimal);
-                    break;
-                case brooks_type_string:
-                    fprintf(file, "\"%s\"", entry->value->string);
-                    break;
-                case brooks_type_boolean:
-                    fprintf(file, "\"%s\"", (entry->value->boolean ? "true" : "false"));
-                    break;
-                case brooks_type_null:
-                    fprintf(file, "null");
-                    break;
-                default:
-                    fprintf(file, "(unknown)");
-                    break;
-            }
-            fprintf(file, "%s ", (i + 1 < json->num_entries ? "," : ""));
+        size_t num_entries = (status == brooks_status_ok ? brooks_shape_get_num_keys(json->shape) : 0);
+        for (size_t i = 0; status == brooks_status_ok && i < num_entries; i++) {
+            print_string(file, brooks_shape_get_key(json->shape, i));
+            fprintf(file, ": ");
+            status = print_value(file, json->values + i);
+            fprintf(file, "%s ", (i + 1 < num_entries ? "," : ""));
         }
         fprintf(file, "}");
+        return status;
     }
     return brooks_status_ok;
 }
@@ -283,44 +489,126 @@ brooks_status_e brooks_doc_add_null(brooks_object_t *parent, const char *key)
 
 brooks_status_e brooks_doc_add_object(brooks_object_t **object, brooks_object_t *parent, const char *key)
 {
-    return json_add_complex(object, NULL, parent, key, brooks_type_object, 0);
+    return json_add_complex(object, NULL, parent, key, brooks_type_object, 0, 0);
 }
 
 brooks_status_e brooks_doc_add_array(brooks_array_t **array, brooks_object_t *parent, brooks_type_e type, const char *key)
 {
-    return json_add_complex(NULL, array, parent, key, brooks_type_array, type);
+    return json_add_complex(NULL, array, parent, key, brooks_type_array, type, BROOKS_ARRAY_CAPACITY);
 }
 
 brooks_status_e brooks_doc_add_value(brooks_array_t *parent, const void *data)
 {
     brooks_status_e status;
     if (parent != NULL && data != NULL) {
+        if (parent->frozen) {
+            return brooks_status_badcall;
+        } else if ((status = array_materialize(parent)) != brooks_status_ok) {
+            return status;
+        }
         brooks_pool_t *pool = context_get_pool(&parent->context_desc);
         brooks_unnamed_entry_t *entry = array_entry_create(pool, parent);
-        entry->value = value_create(pool, parent->type, brooks_entry_type_unnamed_entry, parent);
+        entry->value = value_create(pool, parent->type, brooks_entry_type_unnamed_entry, entry);
         if (((status = value_set(entry->value, pool, parent->type, data)) == brooks_status_ok) &&
                 (status = array_autoresize(parent)) == brooks_status_ok) {
             parent->entries[parent->num_entries++] = entry;
-            return brooks_status_ok;
+            return (parent->zones != NULL ? zone_map_update(parent, parent->num_entries - 1, entry->value) :
+                                            brooks_status_ok);
         } else {
             return status;
         }
     } else return brooks_status_nullptr;
 }
 
-brooks_named_entry_t **brooks_doc_object_begin(const brooks_object_t *object)
+size_t brooks_doc_object_num_elements(const brooks_object_t *object)
 {
-    return (object ? object->entries : NULL);
+    if (object && object->lazy_pending) {
+        return object->lazy->containers[object->lazy_container].length;
+    } else return (object ? brooks_shape_get_num_keys(object->shape) : 0);
 }
 
-brooks_named_entry_t **brooks_doc_object_end(const brooks_object_t *object)
+const char *brooks_doc_object_get_key(const brooks_object_t *object, size_t idx)
 {
-    return (object ? (object->entries + object->num_entries) : NULL);
+    return ((object && object_materialize(object) == brooks_status_ok) ? brooks_shape_get_key(object->shape, idx) :
+                                                                        NULL);
 }
 
-size_t brooks_doc_object_num_elements(const brooks_object_t *object)
+const brooks_value_t *brooks_doc_object_get_value(const brooks_object_t *object, size_t idx)
+{
+    return ((object && object_materialize(object) == brooks_status_ok &&
+             idx < brooks_shape_get_num_keys(object->shape)) ? object->values + idx : NULL);
+}
+
+const brooks_shape_t *brooks_doc_object_get_shape(const brooks_object_t *object)
+{
+    return ((object && object_materialize(object) == brooks_status_ok) ? object->shape : NULL);
+}
+
+bool brooks_doc_object_is_frozen(const brooks_object_t *object)
+{
+    return (object && object->frozen);
+}
+
+brooks_status_e brooks_doc_object_set(brooks_object_t *object, const char *key, brooks_type_e type, const void *data)
+{
+    if (object && key && value_data_valid(type, data)) {
+        brooks_value_t *value;
+        size_t idx;
+        brooks_status_e status = (object->frozen ? brooks_status_badcall : object_materialize(object));
+        if (status != brooks_status_ok) {
+            return status;
+        } else if (brooks_shape_lookup(&idx, object->shape, key) == brooks_status_true) {
+            brooks_value_t previous = object->values[idx];
+            if ((status = value_assign(object->values + idx, object->pool, type, data)) == brooks_status_ok) {
+                value_recycle(object->pool, &previous);
+            }
+            return status;
+        } else if ((value = json_add_entry(object, type, key)) != NULL) {
+            return value_assign(value, object->pool, type, data);
+        } else return brooks_status_pmalloc_err;
+    } else return (type == brooks_type_none || type > brooks_type_null ? brooks_status_notype : brooks_status_nullptr);
+}
+
+brooks_status_e brooks_doc_object_set_value(brooks_object_t *object, const char *key, const brooks_value_t *value)
+{
+    if (object && key && value) {
+        entry_desc_t context = { .context.object = object, .context_type = brooks_entry_type_named_entry };
+        brooks_value_t copy, *property;
+        size_t idx;
+        brooks_status_e status = (object->frozen ? brooks_status_badcall : object_materialize(object));
+        if (status != brooks_status_ok) {
+            return status;
+        }
+        // the copy is made before the object changes, since 'value' may be one of its properties
+        if ((status = value_copy(&copy, object->pool, value, context)) != brooks_status_ok) {
+            return status;
+        } else if (brooks_shape_lookup(&idx, object->shape, key) == brooks_status_true) {
+            value_recycle(object->pool, object->values + idx);
+            object->values[idx] = copy;
+        } else if ((property = json_add_entry(object, copy.type, key)) != NULL) {
+            *property = copy;
+        } else return brooks_status_pmalloc_err;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_doc_object_remove(brooks_object_t *object, const char *key)
 {
-    return (object ? (object->num_entries) : 0);
+    if (object && key) {
+        size_t idx;
+        brooks_status_e status = (object->frozen ? brooks_status_badcall : object_materialize(object));
+        if (status != brooks_status_ok) {
+            return status;
+        } else if (brooks_shape_lookup(&idx, object->shape, key) != brooks_status_true) {
+            return brooks_status_false;
+        }
+        brooks_value_t previous = object->values[idx];
+        if ((status = object_remove(object, idx)) == brooks_status_ok) {
+            value_recycle(object->pool, &previous);
+            status = json_shrink(object);
+        }
+        return status;
+    } else return brooks_status_nullptr;
 }
 
 brooks_status_e brooks_doc_array_add_object(brooks_object_t **object, brooks_array_t *parent)
@@ -328,11 +616,15 @@ brooks_status_e brooks_doc_array_add_object(brooks_object_t **object, brooks_arr
     brooks_status_e status;
     if (parent != NULL) {
         brooks_pool_t *pool = context_get_pool(&parent->context_desc);
-        status = array_autoresize(parent);
+        if (parent->frozen) {
+            return brooks_status_badcall;
+        } else if ((status = array_materialize(parent)) != brooks_status_ok ||
+                   (status = array_autoresize(parent)) != brooks_status_ok) {
+            return status;
+        }
         brooks_unnamed_entry_t *entry = array_entry_create(pool, parent);
-        entry->value = brooks_pool_malloc(pool, sizeof(brooks_value_t));
+        entry->value = value_create(pool, parent->type, brooks_entry_type_unnamed_entry, entry);
         entry->value->object = json_create(pool, brooks_entry_type_unnamed_entry, entry);
-        entry->value->type = parent->type;
         parent->entries[parent->num_entries++] = entry;
         *object = entry->value->object;
         return brooks_status_ok;
@@ -341,83 +633,199 @@ brooks_status_e brooks_doc_array_add_object(brooks_object_t **object, brooks_arr
 
 brooks_status_e brooks_doc_array_add_array(brooks_array_t **array, brooks_type_e type, brooks_array_t *parent)
 {
-    brooks_status_e status;
-    if (parent != NULL) {
-        brooks_pool_t *pool = context_get_pool(&parent->context_desc);
-        status = array_autoresize(parent);
-        brooks_unnamed_entry_t *entry = array_entry_create(pool, parent);
-        entry->value = brooks_pool_malloc(pool, sizeof(brooks_value_t));
-        entry->value->array = array_create(type, brooks_entry_type_unnamed_entry, entry);
-        parent->entries[parent->num_entries++] = entry;
-        *array = entry->value->array;
+    return array_add_array(array, type, parent, BROOKS_ARRAY_CAPACITY);
+}
+
+size_t brooks_doc_array_get_length(const brooks_array_t *array)
+{
+    if (array && array->lazy) {
+        return array->lazy->containers[array->lazy_container].length;
+    } else return (array ? array->num_entries : 0);
+}
+
+brooks_type_e brooks_doc_array_get_type(const brooks_array_t *array)
+{
+    return (array ? array->type : brooks_type_none);
+}
+
+brooks_status_e brooks_doc_array_enable_zone_map(brooks_array_t *array)
+{
+    if (array) {
+        if (array->type != brooks_type_number_integer && array->type != brooks_type_number_double) {
+            return brooks_status_illegalarg;
+        }
+        if (array->zones == NULL) {
+            brooks_status_e status = (array->frozen ? brooks_status_badcall : array_materialize(array));
+            if (status != brooks_status_ok) {
+                return status;
+            }
+            brooks_pool_t *pool = context_get_pool(&array->context_desc);
+            array->zones_capacity = array->num_entries / BROOKS_ZONE_MAP_BLOCK_SIZE + 1;
+            array->zones = brooks_pool_malloc_tagged(pool, array->zones_capacity * sizeof(brooks_zone_t),
+                                                     brooks_pool_category_array);
+            array->num_zones = 0;
+            if (array->zones == NULL) {
+                return brooks_status_pmalloc_err;
+            }
+            for (size_t idx = 0; idx < array->num_entries; idx++) {
+                brooks_status_e status = zone_map_update(array, idx, array->entries[idx]->value);
+                if (status != brooks_status_ok) {
+                    return status;
+                }
+            }
+        }
         return brooks_status_ok;
     } else return brooks_status_nullptr;
 }
 
-size_t brooks_doc_array_get_length(const brooks_array_t *array)
+const brooks_zone_t *brooks_doc_array_get_zones(size_t *num_zones, const brooks_array_t *array)
+{
+    if (num_zones && array && array->zones) {
+        *num_zones = array->num_zones;
+        return array->zones;
+    } else return NULL;
+}
+
+brooks_status_e brooks_doc_array_set(brooks_array_t *array, size_t idx, const void *data)
+{
+    if (array && data) {
+        brooks_status_e status = (array->frozen ? brooks_status_badcall : array_materialize(array));
+        if (status != brooks_status_ok) {
+            return status;
+        } else if (array->type == brooks_type_object || array->type == brooks_type_array) {
+            return brooks_status_wrongusage;
+        } else if (idx >= array->num_entries) {
+            return brooks_status_illegalarg;
+        }
+        brooks_pool_t *pool = context_get_pool(&array->context_desc);
+        brooks_value_t *value = array->entries[idx]->value, previous = *value;
+        if ((status = value_set(value, pool, array->type, data)) == brooks_status_ok) {
+            value_recycle(pool, &previous);
+            status = (array->zones != NULL ? zone_map_refresh(array, idx, false) : status);
+        }
+        return status;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_doc_array_insert(brooks_array_t *array, size_t idx, const void *data)
+{
+    if (array && data) {
+        brooks_status_e status = (array->frozen ? brooks_status_badcall : array_materialize(array));
+        if (status != brooks_status_ok) {
+            return status;
+        } else if (array->type == brooks_type_object || array->type == brooks_type_array) {
+            return brooks_status_wrongusage;
+        } else if (idx > array->num_entries) {
+            return brooks_status_illegalarg;
+        }
+        brooks_pool_t *pool = context_get_pool(&array->context_desc);
+        if ((status = array_autoresize(array)) != brooks_status_ok) {
+            return status;
+        }
+        brooks_unnamed_entry_t *entry = array_entry_create(pool, array);
+        entry->value = value_create(pool, array->type, brooks_entry_type_unnamed_entry, entry);
+        if ((status = value_set(entry->value, pool, array->type, data)) != brooks_status_ok) {
+            brooks_pool_recycle(pool, entry->value, sizeof(brooks_value_t), brooks_pool_category_value);
+            brooks_pool_recycle(pool, entry, sizeof(brooks_unnamed_entry_t), brooks_pool_category_entry);
+            return status;
+        }
+        return array_entry_insert(array, idx, entry);
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_doc_array_insert_value(brooks_array_t *array, size_t idx, const brooks_value_t *value)
+{
+    if (array && value) {
+        bool widen = (array->type == brooks_type_number_double && value->type == brooks_type_number_integer);
+        brooks_status_e status = (array->frozen ? brooks_status_badcall : array_materialize(array));
+        if (status != brooks_status_ok) {
+            return status;
+        } else if (idx > array->num_entries) {
+            return brooks_status_illegalarg;
+        } else if (array->type != value->type && !widen) {
+            if (array->num_entries > 0 || array->zones != NULL) {
+                return brooks_status_wrongusage;
+            }
+            array->type = value->type;
+        }
+        brooks_pool_t *pool = context_get_pool(&array->context_desc);
+        brooks_unnamed_entry_t *entry = array_entry_create(pool, array);
+        entry_desc_t context = { .context.unnamed_entry = entry, .context_type = brooks_entry_type_unnamed_entry };
+        // the copy is made before the array changes, since 'value' may be one of its elements
+        entry->value = brooks_pool_malloc_tagged(pool, sizeof(brooks_value_t), brooks_pool_category_value);
+        if (entry->value == NULL) {
+            return brooks_status_pmalloc_err;
+        } else if ((status = value_copy(entry->value, pool, value, context)) != brooks_status_ok ||
+                   (status = array_autoresize(array)) != brooks_status_ok) {
+            return status;
+        }
+        if (widen) {
+            entry->value->type = brooks_type_number_double;
+            entry->value->decimal = (double) (int64_t) value->integer;
+        }
+        return array_entry_insert(array, idx, entry);
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_doc_array_remove(brooks_array_t *array, size_t idx)
 {
-    return (array ? array->num_entries : 0);
+    if (array) {
+        brooks_status_e status = (array->frozen ? brooks_status_badcall : array_materialize(array));
+        if (status != brooks_status_ok) {
+            return status;
+        } else if (idx >= array->num_entries) {
+            return brooks_status_false;
+        }
+        brooks_pool_t *pool = context_get_pool(&array->context_desc);
+        brooks_unnamed_entry_t *entry = array->entries[idx];
+        value_recycle(pool, entry->value);
+        brooks_pool_recycle(pool, entry->value, sizeof(brooks_value_t), brooks_pool_category_value);
+        brooks_pool_recycle(pool, entry, sizeof(brooks_unnamed_entry_t), brooks_pool_category_entry);
+
+        array->num_entries--;
+        memmove(array->entries + idx, array->entries + idx + 1,
+                (array->num_entries - idx) * sizeof(brooks_unnamed_entry_t *));
+        for (size_t i = idx; i < array->num_entries; i++) {
+            array->entries[i]->idx = i;
+        }
+        status = (array->zones != NULL ? zone_map_refresh(array, idx, true) : brooks_status_ok);
+        return (status == brooks_status_ok ? array_shrink(array) : status);
+    } else return brooks_status_nullptr;
 }
 
 brooks_unnamed_entry_t **brooks_doc_array_begin(const brooks_array_t *array)
 {
-    return (array ? array->entries : NULL);
+    return ((array && array_materialize(array) == brooks_status_ok) ? array->entries : NULL);
 }
 
 brooks_unnamed_entry_t **brooks_doc_array_end(const brooks_array_t *array)
 {
-    return (array ? (array->entries + array->num_entries) : NULL);
+    return ((array && array_materialize(array) == brooks_status_ok) ? (array->entries + array->num_entries) : NULL);
 }
 
 brooks_status_e brooks_doc_array_print(FILE *file, const brooks_array_t *array)
 {
     if (file && array) {
-        printf("[ ");
-        for (size_t i = 0; i < array->num_entries; i++) {
-            brooks_unnamed_entry_t *entry = array->entries[i];
-            switch (array->type) {
-                case brooks_type_object:
-                    brooks_doc_print(file, entry->value->object);
-                    break;
-                case brooks_type_array:
-                    brooks_doc_array_print(file, entry->value->array);
-                    break;
-                case brooks_type_number_integer:
-                    fprintf(file, "%lld", entry->value->integer);
-                    break;
-                case brooks_type_number_double:
-                    fprintf(file, "%f", entry->value->decimal);
-                    break;
-                case brooks_type_string:
-                    fprintf(file, "\"%s\"", entry->value->string);
-                    break;
-                case brooks_type_boolean:
-                    fprintf(file, "\"%s\"", (entry->value->boolean ? "true" : "false"));
-                    break;
-                case brooks_type_null:
-                    fprintf(file, "null");
-                    break;
-                default:
-                    fprintf(file, "(unknown)");
-                    break;
-            }
-            fprintf(file, "%s ", (i + 1 < array->num_entries ? "," : ""));
+        brooks_status_e status = array_materialize(array);
+        fprintf(file, "[ ");
+        size_t num_entries = (status == brooks_status_ok ? array->num_entries : 0);
+        for (size_t i = 0; status == brooks_status_ok && i < num_entries; i++) {
+            status = print_value(file, array->entries[i]->value);
+            fprintf(file, "%s ", (i + 1 < num_entries ? "," : ""));
         }
-        printf("]");
-        return brooks_status_ok;
+        fprintf(file, "]");
+        return status;
     } else return brooks_status_nullptr;
 }
 
 brooks_element_t **brooks_doc_fullscan(size_t *num_elements, const brooks_object_t *object)
 {
-    *num_elements = object->num_entries;
+    *num_elements = (object_materialize(object) == brooks_status_ok ? brooks_shape_get_num_keys(object->shape) : 0);
     brooks_element_t **retval = NULL;
-    if (object->num_entries > 0) {
-        retval = brooks_pool_malloc(object->pool, object->num_entries * sizeof(brooks_element_t *));
-        for (size_t idx = 0; idx < object->num_entries; idx++) {
-            brooks_named_entry_t *entry = object->entries[idx];
-            brooks_element_t *result = element_create(object->pool, brooks_entry_type_named_entry, entry, idx);
-            retval[idx] = result;
+    if (*num_elements > 0) {
+        retval = brooks_pool_malloc(object->pool, *num_elements * sizeof(brooks_element_t *));
+        for (size_t idx = 0; idx < *num_elements; idx++) {
+            retval[idx] = element_create(object->pool, brooks_entry_type_named_entry, (void *) object, idx);
         }
     }
     return retval;
@@ -433,14 +841,14 @@ brooks_status_e brooks_doc_element_get(const char **key, const brooks_value_t **
 {
     if (element) {
         if (key && brooks_doc_element_has_key(element)) {
-            *key = element->entry.context.named_entry->key;
+            *key = brooks_shape_get_key(element->entry.context.object->shape, element->idx);
         } else {
             return brooks_status_false;
         }
         if (value) {
             switch (element->entry.context_type) {
                 case brooks_entry_type_named_entry:
-                    *value = element->entry.context.named_entry->value;
+                    *value = element->entry.context.object->values + element->idx;
                     break;
                 case brooks_entry_type_unnamed_entry:
                     *value = element->entry.context.unnamed_entry->value;
@@ -457,7 +865,7 @@ brooks_status_e brooks_doc_element_get_type(brooks_type_e *type, const brooks_el
 {
     switch (element->entry.context_type) {
         case brooks_entry_type_named_entry:
-            *type = element->entry.context.named_entry->value->type;
+            *type = element->entry.context.object->values[element->idx].type;
             break;
         case brooks_entry_type_unnamed_entry:
             *type = element->entry.context.unnamed_entry->context->type;
@@ -517,14 +925,78 @@ const brooks_object_t *brooks_doc_value_as_object(const brooks_value_t *value)
 brooks_status_e brooks_doc_value_print(FILE *file, const brooks_value_t *value)
 {
     if (file && value) {
-        fprintf(file, "{ \"type\": \"%s\", \"address\": %p }", brooks_doc_type_str(value->type), value);
+        return print_value(file, value);
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_doc_string_print(FILE *file, const char *string)
+{
+    if (file && string) {
+        print_string(file, string);
         return brooks_status_ok;
     } else return brooks_status_nullptr;
 }
 
-const brooks_value_t *brooks_doc_named_entry_get_value(const brooks_named_entry_t *entry)
+const char *brooks_doc_value_get_key(const brooks_value_t *value)
 {
-    return (entry != NULL ? entry->value : NULL);
+    if (value && value->context_desc.context_type == brooks_entry_type_named_entry) {
+        const brooks_object_t *object = value->context_desc.context.object;
+        return brooks_shape_get_key(object->shape, (size_t) (value - object->values));
+    } else return NULL;
+}
+
+size_t brooks_doc_value_get_index(const brooks_value_t *value)
+{
+    if (value && value->context_desc.context_type == brooks_entry_type_named_entry) {
+        return (size_t) (value - value->context_desc.context.object->values);
+    } else if (value && value->context_desc.context_type == brooks_entry_type_unnamed_entry) {
+        return value->context_desc.context.unnamed_entry->idx;
+    }
+    return 0;
+}
+
+size_t brooks_doc_value_get_depth(const brooks_value_t *value)
+{
+    size_t depth = 0;
+    if (value) {
+        for (const entry_desc_t *it = context_get_parent(&value->context_desc); !context_is_root(it);
+             it = context_get_parent(it)) {
+            depth++;
+        }
+    }
+    return depth;
+}
+
+const brooks_object_t *brooks_doc_value_get_owner(const brooks_value_t *value)
+{
+    if (value) {
+        const entry_desc_t *it = &value->context_desc;
+        while (it->context_type == brooks_entry_type_unnamed_entry) {
+            it = &it->context.unnamed_entry->context->context_desc;
+        }
+        return it->context.object;
+    } else return NULL;
+}
+
+const brooks_object_t *brooks_doc_value_get_root(const brooks_value_t *value)
+{
+    if (value) {
+        const entry_desc_t *it = &value->context_desc, *parent;
+        while (!context_is_root(parent = context_get_parent(it))) {
+            it = parent;
+        }
+        return it->context.object;
+    } else return NULL;
+}
+
+brooks_element_t *brooks_doc_element_from_value(brooks_pool_t *pool, const brooks_value_t *value)
+{
+    if (pool && value) {
+        void *entry = (value->context_desc.context_type == brooks_entry_type_named_entry ?
+                       (void *) value->context_desc.context.object :
+                       (void *) value->context_desc.context.unnamed_entry);
+        return element_create(pool, value->context_desc.context_type, entry, brooks_doc_value_get_index(value));
+    } else return NULL;
 }
 
 const brooks_value_t *brooks_doc_unnamed_entry_get_value(const brooks_unnamed_entry_t *entry)
@@ -547,23 +1019,124 @@ const char *brooks_doc_type_str(const brooks_type_e type)
     }
 }
 
-// ---------------------------------------------------------------------------------------------------------------------
-// H E L P E R   I M P L E M E N T A T I O N
-// ---------------------------------------------------------------------------------------------------------------------
+brooks_status_e brooks_doc_footprint(brooks_doc_footprint_t *footprint, const brooks_object_t *doc)
+{
+    if (footprint && doc) {
+        size_t bytes = footprint_object(footprint, doc, doc->lazy);
+        if (doc->lazy != NULL) {
+            footprint->bytes_lazy += sizeof(lazy_t) + doc->lazy->length + 1 +
+                                     doc->lazy->num_containers * sizeof(lazy_container_t);
+            footprint->bytes_pointers += LAZY_NUM_POINTERS * sizeof(void *);
+        }
+        footprint->num_documents++;
+        footprint->type_values[brooks_type_object]++;
+        footprint->type_bytes[brooks_type_object] += bytes;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
 
-static brooks_status_e property_add(brooks_object_t *parent, brooks_type_e type, const char *key, const void *data)
+brooks_status_e brooks_doc_locate(const brooks_value_t **value, const brooks_object_t *doc, const char *location)
 {
-    if (parent != NULL && (type == brooks_type_null || data != NULL)) {
-        brooks_named_entry_t *entry = entry_create(parent, type, key);
-        if (entry != NULL && (json_autoresize(parent) == brooks_status_ok)) {
-            brooks_status_e status = value_set(entry->value, parent->pool, type, data);
-            if (status == brooks_status_ok) {
-                json_add_entry(parent, entry);
-                return brooks_status_ok;
+    if (value && doc && location) {
+        size_t num_components, idx;
+        char **components = location_split(&num_components, location);
+        if (components == NULL) {
+            return brooks_status_illegalarg;
+        }
+        const brooks_value_t *result = NULL;
+        for (size_t i = 0; i < num_components; i++) {
+            if (i == 0 || result->type == brooks_type_object) {
+                const brooks_object_t *object = (i == 0 ? doc : result->object);
+                result = (object_materialize(object) == brooks_status_ok &&
+                          brooks_shape_lookup(&idx, object->shape, components[i]) == brooks_status_true ?
+                          object->values + idx : NULL);
+            } else if (result->type == brooks_type_array && array_materialize(result->array) == brooks_status_ok &&
+                       location_position(&idx, components[i]) && idx < result->array->num_entries) {
+                result = result->array->entries[idx]->value;
             } else {
-                return status;
+                result = NULL;
             }
-        } else return brooks_status_pmalloc_err;
+            if (result == NULL) {
+                break;
+            }
+        }
+        free(components);
+        *value = result;
+        return (result != NULL ? brooks_status_true : brooks_status_false);
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_doc_history_create(brooks_doc_history_t **history, brooks_object_t *doc)
+{
+    if (history && doc) {
+        brooks_doc_history_t *result = brooks_pool_malloc(doc->pool, sizeof(brooks_doc_history_t));
+        const brooks_object_t **versions = brooks_pool_malloc(doc->pool, BROOKS_DOC_HISTORY_CAPACITY *
+                                                                         sizeof(brooks_object_t *));
+        if (result == NULL || versions == NULL) {
+            return brooks_status_pmalloc_err;
+        }
+        versions[0] = doc;
+        result->pool = doc->pool;
+        result->capacity = BROOKS_DOC_HISTORY_CAPACITY;
+        atomic_init(&result->versions, versions);
+        atomic_init(&result->num_versions, 1);
+        *history = result;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+const brooks_object_t *brooks_doc_history_snapshot(const brooks_doc_history_t *history)
+{
+    return (history ? brooks_doc_history_get(history, brooks_doc_history_num_versions(history) - 1) : NULL);
+}
+
+const brooks_object_t *brooks_doc_history_get(const brooks_doc_history_t *history, size_t version)
+{
+    // the number of versions is read first: a concurrently grown versions array holds at least as many
+    if (history && version < atomic_load(&((brooks_doc_history_t *) history)->num_versions)) {
+        return atomic_load(&((brooks_doc_history_t *) history)->versions)[version];
+    } else return NULL;
+}
+
+size_t brooks_doc_history_num_versions(const brooks_doc_history_t *history)
+{
+    return (history ? atomic_load(&((brooks_doc_history_t *) history)->num_versions) : 0);
+}
+
+brooks_status_e brooks_doc_history_set(brooks_doc_history_t *history, const char *location, brooks_type_e type,
+                                       const void *data)
+{
+    return history_update(history, location, type, data, false);
+}
+
+brooks_status_e brooks_doc_history_remove(brooks_doc_history_t *history, const char *location)
+{
+    return history_update(history, location, brooks_type_none, NULL, true);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static brooks_status_e property_add(brooks_object_t *parent, brooks_type_e type, const char *key, const void *data)
+{
+    if (parent != NULL && key != NULL && (type == brooks_type_null || data != NULL)) {
+        brooks_value_t content = { .type = type }, *value;
+        brooks_status_e status;
+        if (parent->frozen) {
+            return brooks_status_badcall;
+        } else if ((status = object_materialize(parent)) != brooks_status_ok) {
+            return status;
+        } else if ((status = value_set(&content, parent->pool, type, data)) == brooks_status_ok) {
+            if ((value = json_add_entry(parent, type, key)) != NULL) {
+                content.context_desc = value->context_desc;
+                content.type = type;
+                *value = content;
+                return brooks_status_ok;
+            } else return brooks_status_pmalloc_err;
+        } else {
+            return status;
+        }
     } else return brooks_status_nullptr;
 }
 
@@ -596,15 +1169,17 @@ static brooks_status_e value_set(brooks_value_t *value, brooks_pool_t *pool, bro
 static brooks_object_t *json_create(brooks_pool_t *pool, brooks_entry_type_e parent_type, void *parent_ptr)
 {
     brooks_object_t *retval = NULL;
-    if ((pool != NULL) &&
-        ((retval = brooks_pool_malloc(pool, sizeof(brooks_object_t))) != NULL) &&
-        ((retval->entries = brooks_pool_malloc(pool, BROOKS_OBJECT_CAPACITY * sizeof(brooks_named_entry_t *))) != NULL)) {
-        retval->capacity = BROOKS_OBJECT_CAPACITY;
-        retval->idx = retval->num_entries = 0;
+    brooks_shape_t *shape;
+    if ((pool != NULL) && ((shape = brooks_shape_registry_get_root(brooks_pool_get_shapes(pool))) != NULL) &&
+        ((retval = brooks_pool_malloc_tagged(pool, sizeof(brooks_object_t), brooks_pool_category_object)) != NULL)) {
+        retval->shape = shape;
+        retval->values = NULL;
+        retval->capacity = 0;
+        retval->idx = 0;
         retval->context_desc.context_type = parent_type;
         switch (parent_type) {
             case brooks_entry_type_named_entry:
-                retval->context_desc.context.named_entry = parent_ptr;
+                retval->context_desc.context.object = parent_ptr;
                 break;
             case brooks_entry_type_unnamed_entry:
                 retval->context_desc.context.unnamed_entry = parent_ptr;
@@ -612,70 +1187,125 @@ static brooks_object_t *json_create(brooks_pool_t *pool, brooks_entry_type_e par
             default: return NULL;
         }
         retval->pool = pool;
+        retval->frozen = false;
+        retval->lazy_pending = false;
+        retval->text_strings = false;
+        retval->lazy_container = 0;
+        retval->lazy = NULL;
     }
     return retval;
 }
 
-static brooks_status_e json_autoresize(brooks_object_t *object)
+static brooks_status_e json_reserve(brooks_object_t *object, size_t capacity)
 {
-    object->entries = brooks_misc_pooled_autoresize(object->pool, object->entries, sizeof(brooks_named_entry_t *),
-                                                    object->num_entries, &object->capacity, 1);
-    return (object->entries != NULL ? brooks_status_ok : brooks_status_pmalloc_err);
+    if (capacity > object->capacity) {
+        brooks_value_t *values = brooks_pool_malloc_tagged(object->pool, capacity * sizeof(brooks_value_t),
+                                                           brooks_pool_category_value);
+        if (values == NULL) {
+            return brooks_status_pmalloc_err;
+        }
+        if (object->capacity > 0) {
+            memcpy(values, object->values, brooks_shape_get_num_keys(object->shape) * sizeof(brooks_value_t));
+            brooks_pool_recycle(object->pool, object->values, object->capacity * sizeof(brooks_value_t),
+                                brooks_pool_category_value);
+        }
+        object->values = values;
+        object->capacity = capacity;
+    }
+    return brooks_status_ok;
 }
 
 static brooks_status_e array_autoresize(brooks_array_t *array)
 {
     array->entries = brooks_misc_pooled_autoresize(context_get_pool(&array->context_desc), array->entries,
                                                    sizeof(brooks_unnamed_entry_t *), array->num_entries,
-                                                   &array->capacity, 1);
+                                                   &array->capacity, 1, brooks_pool_category_entry);
     return (array->entries != NULL ? brooks_status_ok : brooks_status_pmalloc_err);
 }
 
-static void json_add_entry(brooks_object_t *object, brooks_named_entry_t *entry)
+static brooks_value_t *json_add_entry(brooks_object_t *object, brooks_type_e type, const char *key)
 {
-    object->entries[object->num_entries++] = entry;
+    // the object moves to the shape that has 'key' appended; a full object grows to the extent of that shape, such
+    // that objects of a common shape are sized right when they add their first key, and doubles beyond it
+    brooks_shape_t *shape;
+    size_t idx = brooks_shape_get_num_keys(object->shape);
+    if (brooks_shape_transition(&shape, object->shape, key) == brooks_status_ok &&
+        (idx < object->capacity || json_reserve(object, json_grow_capacity(object, shape)) == brooks_status_ok)) {
+        brooks_value_t *value = object->values + idx;
+        value->context_desc.context_type = brooks_entry_type_named_entry;
+        value->context_desc.context.object = object;
+        value->type = type;
+        object->shape = shape;
+        return value;
+    } else return NULL;
 }
 
 static brooks_status_e json_add_complex(brooks_object_t **object, brooks_array_t **array, brooks_object_t *parent,
-                                       const char *key, brooks_type_e complex_type, brooks_type_e array_type)
+                                       const char *key, brooks_type_e complex_type, brooks_type_e array_type,
+                                       size_t array_capacity)
 {
-    brooks_object_t *retval_object;
-    brooks_array_t *retval_array;
-    brooks_named_entry_t *entry;
-    brooks_status_e status;
+    brooks_object_t *retval_object = NULL;
+    brooks_array_t *retval_array = NULL;
+    brooks_value_t *value;
 
     if (complex_type != brooks_type_array && complex_type != brooks_type_object) {
         return brooks_status_interalerr;
-    } else {
-        if (parent != NULL && key != NULL && ((entry = entry_create(parent, complex_type, key)) != NULL) &&
-            (((complex_type != brooks_type_object) ||
-                    ((retval_object = json_create(parent->pool, brooks_entry_type_named_entry, entry)) != NULL)) &&
-             ((complex_type != brooks_type_array) ||
-                     ((retval_array = array_create(array_type, brooks_entry_type_named_entry, entry)) != NULL)))) {
-            if ((status = json_autoresize(parent)) == brooks_status_ok) {
-                json_add_entry(parent, entry);
-                if (complex_type == brooks_type_object) {
-                    entry->value->object = retval_object;
-                    *object = retval_object;
-                } else {
-                    entry->value->array = retval_array;
-                    *array = retval_array;
-                }
-                return brooks_status_ok;
-            } return status;
-        } else return brooks_status_nullptr;
-    }
+    } else if (parent != NULL && key != NULL) {
+        brooks_status_e status = (parent->frozen ? brooks_status_badcall : object_materialize(parent));
+        if (status != brooks_status_ok) {
+            return status;
+        }
+        size_t idx = brooks_shape_get_num_keys(parent->shape);
+        if (((complex_type != brooks_type_object) ||
+                ((retval_object = json_create(parent->pool, brooks_entry_type_named_entry, parent)) != NULL)) &&
+            ((complex_type != brooks_type_array) ||
+                ((retval_array = array_create(array_type, array_capacity, brooks_entry_type_named_entry,
+                                              parent)) != NULL)) &&
+            ((value = json_add_entry(parent, complex_type, key)) != NULL)) {
+            if (complex_type == brooks_type_object) {
+                retval_object->idx = idx;
+                value->object = retval_object;
+                *object = retval_object;
+            } else {
+                retval_array->idx = idx;
+                value->array = retval_array;
+                *array = retval_array;
+            }
+            return brooks_status_ok;
+        } else return brooks_status_pmalloc_err;
+    } else return brooks_status_nullptr;
+}
+
+static brooks_status_e array_add_array(brooks_array_t **array, brooks_type_e type, brooks_array_t *parent,
+                                       size_t capacity)
+{
+    brooks_status_e status;
+    if (parent != NULL) {
+        brooks_pool_t *pool = context_get_pool(&parent->context_desc);
+        if (parent->frozen) {
+            return brooks_status_badcall;
+        } else if ((status = array_materialize(parent)) != brooks_status_ok ||
+                   (status = array_autoresize(parent)) != brooks_status_ok) {
+            return status;
+        }
+        brooks_unnamed_entry_t *entry = array_entry_create(pool, parent);
+        entry->value = value_create(pool, parent->type, brooks_entry_type_unnamed_entry, entry);
+        entry->value->array = array_create(type, capacity, brooks_entry_type_unnamed_entry, entry);
+        parent->entries[parent->num_entries++] = entry;
+        *array = entry->value->array;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 static brooks_value_t *value_create(brooks_pool_t *pool, brooks_type_e type, brooks_entry_type_e context,
                                    void *parent_ptr)
 {
-    brooks_value_t *value = brooks_pool_malloc(pool, sizeof(brooks_value_t));
+    brooks_value_t *value = brooks_pool_malloc_tagged(pool, sizeof(brooks_value_t), brooks_pool_category_value);
     value->type = type;
     value->context_desc.context_type = context;
     switch (context) {
         case brooks_entry_type_named_entry:
-            value->context_desc.context.named_entry = parent_ptr;
+            value->context_desc.context.object = parent_ptr;
             break;
         case brooks_entry_type_unnamed_entry:
             value->context_desc.context.unnamed_entry = parent_ptr;
@@ -685,17 +1315,8 @@ static brooks_value_t *value_create(brooks_pool_t *pool, brooks_type_e type, bro
     return value;
 }
 
-static brooks_named_entry_t *entry_create(brooks_object_t *object, brooks_type_e type, const char *key)
-{
-    brooks_named_entry_t *entry = brooks_pool_malloc(object->pool, sizeof(brooks_named_entry_t));
-    brooks_value_t *value = value_create(object->pool, type, brooks_entry_type_named_entry, entry);
-    entry->context = object;
-    entry->key = brooks_misc_strdup(object->pool, key);
-    entry->value = value;
-    return entry;
-}
-
-static brooks_array_t *array_create(brooks_type_e type, brooks_entry_type_e context, void *parent_ptr)
+static brooks_array_t *array_create(brooks_type_e type, size_t capacity, brooks_entry_type_e context,
+                                    void *parent_ptr)
 {
     entry_desc_t context_desc;
     switch (context) {
@@ -703,18 +1324,27 @@ static brooks_array_t *array_create(brooks_type_e type, brooks_entry_type_e cont
             context_desc.context.unnamed_entry = parent_ptr;
             break;
         case brooks_entry_type_named_entry:
-            context_desc.context.named_entry = parent_ptr;
+            context_desc.context.object = parent_ptr;
             break;
         default: return NULL;
     }
     context_desc.context_type = context;
     brooks_pool_t *pool = context_get_pool(&context_desc);
-    brooks_array_t *retval = brooks_pool_malloc(pool, sizeof(brooks_array_t));
+    brooks_array_t *retval = brooks_pool_malloc_tagged(pool, sizeof(brooks_array_t), brooks_pool_category_array);
     retval->context_desc = context_desc;
+    retval->idx = 0;
     retval->num_entries = 0;
     retval->type = type;
-    retval->capacity = BROOKS_ARRAY_CAPACITY;
-    retval->entries = brooks_pool_malloc(pool, BROOKS_ARRAY_CAPACITY * sizeof(brooks_unnamed_entry_t *));
+    retval->frozen = false;
+    retval->text_strings = false;
+    retval->capacity = capacity;
+    retval->entries = (capacity > 0 ? brooks_pool_malloc_tagged(pool, capacity * sizeof(brooks_unnamed_entry_t *),
+                                                                brooks_pool_category_entry) : NULL);
+    retval->zones = NULL;
+    retval->num_zones = 0;
+    retval->zones_capacity = 0;
+    retval->lazy = NULL;
+    retval->lazy_container = 0;
     return retval;
 }
 
@@ -722,7 +1352,7 @@ static brooks_pool_t *context_get_pool(entry_desc_t *desc)
 {
     switch (desc->context_type) {
         case brooks_entry_type_named_entry:
-            return desc->context.named_entry->context->pool;
+            return desc->context.object->pool;
         case brooks_entry_type_unnamed_entry:
             return context_get_pool(&desc->context.unnamed_entry->context->context_desc);
         default: return NULL;
@@ -731,7 +1361,8 @@ static brooks_pool_t *context_get_pool(entry_desc_t *desc)
 
 static brooks_unnamed_entry_t *array_entry_create(brooks_pool_t *pool, brooks_array_t *context)
 {
-    brooks_unnamed_entry_t *entry = brooks_pool_malloc(pool, sizeof(brooks_unnamed_entry_t));
+    brooks_unnamed_entry_t *entry = brooks_pool_malloc_tagged(pool, sizeof(brooks_unnamed_entry_t),
+                                                              brooks_pool_category_entry);
     entry->context = context;
     entry->idx = context->num_entries;
     return entry;
@@ -744,7 +1375,7 @@ static brooks_element_t *element_create(brooks_pool_t *pool, brooks_entry_type_e
     element->idx = idx;
     switch (entry_type) {
         case brooks_entry_type_named_entry:
-            element->entry.context.named_entry = entry;
+            element->entry.context.object = entry;
             break;
         case brooks_entry_type_unnamed_entry:
             element->entry.context.unnamed_entry = entry;
@@ -754,3 +1385,1702 @@ static brooks_element_t *element_create(brooks_pool_t *pool, brooks_entry_type_e
     }
     return element;
 }
+
+static bool context_is_root(const entry_desc_t *desc)
+{
+    return (desc->context_type == brooks_entry_type_named_entry && desc->context.object == BROOKS_OBJECT_ROOT);
+}
+
+static const entry_desc_t *context_get_parent(const entry_desc_t *desc)
+{
+    // the context of the container that holds the entry described by 'desc'
+    switch (desc->context_type) {
+        case brooks_entry_type_named_entry:
+            return &desc->context.object->context_desc;
+        case brooks_entry_type_unnamed_entry:
+            return &desc->context.unnamed_entry->context->context_desc;
+        default: return NULL;
+    }
+}
+
+static brooks_status_e zone_map_update(brooks_array_t *array, size_t idx, const brooks_value_t *value)
+{
+    size_t zone_idx = idx / BROOKS_ZONE_MAP_BLOCK_SIZE;
+    if (zone_idx == array->num_zones) {
+        if (array->num_zones == array->zones_capacity) {
+            array->zones = brooks_misc_pooled_autoresize(context_get_pool(&array->context_desc), array->zones,
+                                                         sizeof(brooks_zone_t), array->num_zones,
+                                                         &array->zones_capacity, 1, brooks_pool_category_array);
+            if (array->zones == NULL) {
+                return brooks_status_pmalloc_err;
+            }
+        }
+        array->zones[array->num_zones++] = (brooks_zone_t) { .num_nulls = 0, .num_elements = 0 };
+    }
+
+    brooks_zone_t *zone = array->zones + zone_idx;
+    bool first = (zone->num_elements == zone->num_nulls);
+    zone->num_elements++;
+
+    if (value->type == brooks_type_number_integer) {
+        if (first || value->integer < zone->min.integer) zone->min.integer = value->integer;
+        if (first || value->integer > zone->max.integer) zone->max.integer = value->integer;
+    } else if (isnan(value->decimal)) {
+        zone->num_nulls++;
+    } else {
+        if (first || value->decimal < zone->min.decimal) zone->min.decimal = value->decimal;
+        if (first || value->decimal > zone->max.decimal) zone->max.decimal = value->decimal;
+    }
+    return brooks_status_ok;
+}
+
+static brooks_status_e parse_object(brooks_object_t *object, const json_value *value)
+{
+    brooks_status_e status = json_reserve(object, brooks_shape_get_num_keys(object->shape) + value->u.object.length);
+    for (unsigned idx = 0; status == brooks_status_ok && idx < value->u.object.length; idx++) {
+        const char *key = value->u.object.values[idx].name;
+        const json_value *property = value->u.object.values[idx].value;
+        brooks_object_t *child_object;
+        brooks_array_t *child_array;
+        uint64_t integer;
+        bool boolean;
+        brooks_type_e type;
+
+        switch (property->type) {
+            case json_object:
+                if ((status = brooks_doc_add_object(&child_object, object, key)) == brooks_status_ok) {
+                    status = parse_object(child_object, property);
+                }
+                break;
+            case json_array:
+                if ((type = parse_array_type(property)) == brooks_type_none) {
+                    status = brooks_status_notype;
+                } else if ((status = json_add_complex(NULL, &child_array, object, key, brooks_type_array, type,
+                                                      property->u.array.length)) == brooks_status_ok) {
+                    status = parse_array(child_array, property);
+                }
+                break;
+            case json_integer:
+                integer = (uint64_t) property->u.integer;
+                status = brooks_doc_add_integer(object, key, &integer);
+                break;
+            case json_double:
+                status = brooks_doc_add_decimal(object, key, &property->u.dbl);
+                break;
+            case json_string:
+                status = brooks_doc_add_string(object, key, property->u.string.ptr);
+                break;
+            case json_boolean:
+                boolean = (property->u.boolean != 0);
+                status = brooks_doc_add_boolean(object, key, &boolean);
+                break;
+            case json_null:
+                status = brooks_doc_add_null(object, key);
+                break;
+            default:
+                status = brooks_status_notype;
+                break;
+        }
+    }
+    return status;
+}
+
+static brooks_status_e parse_array(brooks_array_t *array, const json_value *value)
+{
+    brooks_status_e status = brooks_status_ok;
+    for (unsigned idx = 0; status == brooks_status_ok && idx < value->u.array.length; idx++) {
+        const json_value *element = value->u.array.values[idx];
+        brooks_object_t *child_object;
+        brooks_array_t *child_array;
+        uint64_t integer;
+        double decimal;
+        bool boolean;
+        brooks_type_e type;
+
+        switch (element->type) {
+            case json_object:
+                if ((status = brooks_doc_array_add_object(&child_object, array)) == brooks_status_ok) {
+                    status = parse_object(child_object, element);
+                }
+                break;
+            case json_array:
+                if ((type = parse_array_type(element)) == brooks_type_none) {
+                    status = brooks_status_notype;
+                } else if ((status = array_add_array(&child_array, type, array, element->u.array.length)) ==
+                           brooks_status_ok) {
+                    status = parse_array(child_array, element);
+                }
+                break;
+            case json_integer:
+                if (array->type == brooks_type_number_double) {
+                    decimal = (double) element->u.integer;
+                    status = brooks_doc_add_value(array, &decimal);
+                } else {
+                    integer = (uint64_t) element->u.integer;
+                    status = brooks_doc_add_value(array, &integer);
+                }
+                break;
+            case json_double:
+                status = brooks_doc_add_value(array, &element->u.dbl);
+                break;
+            case json_string:
+                status = brooks_doc_add_value(array, element->u.string.ptr);
+                break;
+            case json_boolean:
+                boolean = (element->u.boolean != 0);
+                status = brooks_doc_add_value(array, &boolean);
+                break;
+            case json_null:
+                status = brooks_doc_add_value(array, element);
+                break;
+            default:
+                status = brooks_status_notype;
+                break;
+        }
+    }
+    return status;
+}
+
+static brooks_type_e parse_array_type(const json_value *value)
+{
+    // arrays are homogeneous; integers mixed with decimals are widened, any other mix is rejected
+    brooks_type_e result = brooks_type_null;
+    for (unsigned idx = 0; idx < value->u.array.length; idx++) {
+        brooks_type_e type;
+        switch (value->u.array.values[idx]->type) {
+            case json_object:  type = brooks_type_object;         break;
+            case json_array:   type = brooks_type_array;          break;
+            case json_integer: type = brooks_type_number_integer; break;
+            case json_double:  type = brooks_type_number_double;  break;
+            case json_string:  type = brooks_type_string;         break;
+            case json_boolean: type = brooks_type_boolean;        break;
+            case json_null:    type = brooks_type_null;           break;
+            default:           return brooks_type_none;
+        }
+        if (idx == 0 || result == type) {
+            result = type;
+        } else if ((result == brooks_type_number_integer || result == brooks_type_number_double) &&
+                   (type == brooks_type_number_integer || type == brooks_type_number_double)) {
+            result = brooks_type_number_double;
+        } else {
+            return brooks_type_none;
+        }
+    }
+    return result;
+}
+
+// Prints the value as JSON; decimals keep a fraction or exponent, such that they parse back as decimals
+static brooks_status_e print_value(FILE *file, const brooks_value_t *value)
+{
+    char decimal[32];
+    switch (value->type) {
+        case brooks_type_object:
+            return brooks_doc_print(file, value->object);
+        case brooks_type_array:
+            return brooks_doc_array_print(file, value->array);
+        case brooks_type_number_integer:
+            // integers are read as signed by the parser, and printed such that they parse back to the same bits
+            fprintf(file, "%" PRId64, (int64_t) value->integer);
+            break;
+        case brooks_type_number_double:
+            // a whole number keeps its fraction, such that it parses back as a decimal; JSON has no NaN or infinity
+            snprintf(decimal, sizeof(decimal), "%.17g", value->decimal);
+            fprintf(file, "%s%s", (isfinite(value->decimal) ? decimal : "null"),
+                    (isfinite(value->decimal) && strpbrk(decimal, ".e") == NULL ? ".0" : ""));
+            break;
+        case brooks_type_string:
+            print_string(file, value->string);
+            break;
+        case brooks_type_boolean:
+            fprintf(file, "%s", (value->boolean ? "true" : "false"));
+            break;
+        case brooks_type_null:
+            fprintf(file, "null");
+            break;
+        default:
+            fprintf(file, "(unknown)");
+            break;
+    }
+    return brooks_status_ok;
+}
+
+static void print_string(FILE *file, const char *string)
+{
+    fputc('"', file);
+    for (; *string; string++) {
+        unsigned char c = (unsigned char) *string;
+        if (c == '"' || c == '\\') {
+            fprintf(file, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(file, "\\u%04x", c);
+        } else fputc(c, file);
+    }
+    fputc('"', file);
+}
+
+// Accounts the object's structure and properties, and returns the size of its structure and value array; 'lazy' is
+// the index of the document, if it was parsed lazily
+static size_t footprint_object(brooks_doc_footprint_t *footprint, const brooks_object_t *object, const lazy_t *lazy)
+{
+    footprint->num_objects++;
+    footprint->bytes_objects += sizeof(brooks_object_t);
+    footprint->bytes_pointers += OBJECT_NUM_POINTERS * sizeof(void *);
+    if (object->lazy_pending) {
+        // its properties are still in the text
+        return sizeof(brooks_object_t);
+    }
+
+    size_t num_entries = brooks_shape_get_num_keys(object->shape);
+    size_t slack = (object->capacity - num_entries) * sizeof(brooks_value_t);
+    footprint->bytes_slack += slack;
+    for (size_t i = 0; i < num_entries; i++) {
+        footprint->num_properties++;
+        footprint_value(footprint, object->values + i, 0, lazy);
+    }
+    return sizeof(brooks_object_t) + slack;
+}
+
+// Accounts the array's structure, entries array and zone map, and returns their size
+static size_t footprint_array(brooks_doc_footprint_t *footprint, const brooks_array_t *array, const lazy_t *lazy)
+{
+    footprint->num_arrays++;
+    footprint->bytes_arrays += sizeof(brooks_array_t);
+    footprint->bytes_pointers += ARRAY_NUM_POINTERS * sizeof(void *);
+    if (array->lazy != NULL) {
+        // its elements are still in the text
+        return sizeof(brooks_array_t);
+    }
+
+    size_t slots = array->num_entries * sizeof(brooks_unnamed_entry_t *);
+    size_t slack = (array->capacity - array->num_entries) * sizeof(brooks_unnamed_entry_t *);
+    size_t zones = array->zones_capacity * sizeof(brooks_zone_t);
+    footprint->bytes_slots += slots;
+    footprint->bytes_slack += slack;
+    footprint->bytes_zones += zones;
+    footprint->bytes_pointers += slots;
+
+    for (size_t i = 0; i < array->num_entries; i++) {
+        footprint->num_unnamed_entries++;
+        footprint->bytes_unnamed_entries += sizeof(brooks_unnamed_entry_t);
+        footprint->bytes_pointers += UNNAMED_ENTRY_NUM_POINTERS * sizeof(void *);
+        footprint_value(footprint, array->entries[i]->value,
+                        sizeof(brooks_unnamed_entry_t) + sizeof(brooks_unnamed_entry_t *), lazy);
+    }
+    return sizeof(brooks_array_t) + slots + slack + zones;
+}
+
+// Accounts the value and its content; 'bytes' are those of its entry and slot, if any. Strings decoded in the text of
+// a lazily parsed document are accounted with the text
+static void footprint_value(brooks_doc_footprint_t *footprint, const brooks_value_t *value, size_t bytes,
+                            const lazy_t *lazy)
+{
+    footprint->num_values++;
+    footprint->bytes_values += sizeof(brooks_value_t);
+    footprint->bytes_pointers += sizeof(void *);
+    bytes += sizeof(brooks_value_t);
+
+    switch (value->type) {
+        case brooks_type_object:
+            footprint->bytes_pointers += sizeof(void *);
+            bytes += footprint_object(footprint, value->object, lazy);
+            break;
+        case brooks_type_array:
+            footprint->bytes_pointers += sizeof(void *);
+            bytes += footprint_array(footprint, value->array, lazy);
+            break;
+        case brooks_type_string:
+            footprint->bytes_pointers += sizeof(void *);
+            if (lazy == NULL || value->string < lazy->text || value->string > lazy->text + lazy->length) {
+                footprint->bytes_strings += strlen(value->string) + 1;
+                bytes += strlen(value->string) + 1;
+            }
+            break;
+        default:
+            break;
+    }
+    footprint->type_values[value->type]++;
+    footprint->type_bytes[value->type] += bytes;
+}
+
+static brooks_status_e history_update(brooks_doc_history_t *history, const char *location, brooks_type_e type,
+                                      const void *data, bool remove)
+{
+    if (history && location) {
+        history_update_t update = { .pool = history->pool, .type = type, .data = data, .remove = remove };
+        if (!remove && !value_data_valid(type, data)) {
+            return brooks_status_notype;
+        } else if ((update.components = location_split(&update.num_components, location)) == NULL) {
+            return brooks_status_illegalarg;
+        }
+        // the root and every container on the way to 'location' are copied, everything else is shared
+        entry_desc_t root = { .context.object = BROOKS_OBJECT_ROOT, .context_type = brooks_entry_type_named_entry };
+        brooks_object_t *version = object_copy(history->pool, brooks_doc_history_snapshot(history), root, 1);
+        brooks_status_e status = (version != NULL ? history_update_object(version, &update, 0) :
+                                                    brooks_status_pmalloc_err);
+        if (status == brooks_status_ok) {
+            status = history_publish(history, version);
+        }
+        free(update.components);
+        return status;
+    } else return brooks_status_nullptr;
+}
+
+// Applies 'update' from its component 'idx' on, where 'object' is a copy that belongs to the new version
+static brooks_status_e history_update_object(brooks_object_t *object, const history_update_t *update, size_t idx)
+{
+    const char *key = update->components[idx];
+    size_t pos;
+    bool found = (brooks_shape_lookup(&pos, object->shape, key) == brooks_status_true);
+    brooks_value_t *value;
+
+    if (idx + 1 < update->num_components) {
+        return (found ? history_update_value(object->values + pos, update, idx + 1) : brooks_status_false);
+    } else if (update->remove) {
+        return (found ? object_remove(object, pos) : brooks_status_false);
+    } else if (found) {
+        return value_assign(object->values + pos, update->pool, update->type, update->data);
+    } else if ((value = json_add_entry(object, update->type, key)) != NULL) {
+        return value_assign(value, update->pool, update->type, update->data);
+    } else return brooks_status_pmalloc_err;
+}
+
+static brooks_status_e history_update_array(brooks_array_t *array, const history_update_t *update, size_t idx)
+{
+    const char *component = update->components[idx];
+    bool last = (idx + 1 == update->num_components);
+    brooks_unnamed_entry_t *entry;
+    brooks_status_e status;
+    size_t pos;
+
+    if (last && !update->remove && strcmp(component, "-") == 0) {
+        if (array->num_entries > 0 && array->type != update->type) {
+            return brooks_status_wrongusage;
+        } else if ((status = array_autoresize(array)) != brooks_status_ok) {
+            return status;
+        }
+        array->type = update->type;
+        entry = array_entry_create(update->pool, array);
+        entry->value = value_create(update->pool, update->type, brooks_entry_type_unnamed_entry, entry);
+        array->entries[array->num_entries++] = entry;
+        return value_assign(entry->value, update->pool, update->type, update->data);
+    } else if (!location_position(&pos, component) || pos >= array->num_entries) {
+        return brooks_status_false;
+    }
+
+    if (last && update->remove) {
+        // the following entries know their position, hence they are copied rather than shared
+        memmove(array->entries + pos, array->entries + pos + 1,
+                (array->num_entries - pos - 1) * sizeof(brooks_unnamed_entry_t *));
+        array->num_entries--;
+        for (size_t i = pos; i < array->num_entries; i++) {
+            array->entries[i] = array_entry_copy(update->pool, array, array->entries[i], i);
+        }
+        return brooks_status_ok;
+    }
+
+    array->entries[pos] = entry = array_entry_copy(update->pool, array, array->entries[pos], pos);
+    if (!last) {
+        return history_update_value(entry->value, update, idx + 1);
+    } else if (array->num_entries > 1 && array->type != update->type) {
+        return brooks_status_wrongusage;
+    }
+    array->type = update->type;
+    return value_assign(entry->value, update->pool, update->type, update->data);
+}
+
+// Replaces the container that 'value' holds by a copy and continues the update in there
+static brooks_status_e history_update_value(brooks_value_t *value, const history_update_t *update, size_t idx)
+{
+    if (value->type == brooks_type_object) {
+        brooks_object_t *object = object_copy(update->pool, value->object, value->context_desc, 1);
+        return ((value->object = object) != NULL ? history_update_object(object, update, idx) :
+                                                   brooks_status_pmalloc_err);
+    } else if (value->type == brooks_type_array) {
+        bool zone_map = (value->array->zones != NULL);
+        brooks_array_t *array = array_copy(update->pool, value->array, value->context_desc, 1);
+        brooks_status_e status = ((value->array = array) != NULL ? history_update_array(array, update, idx) :
+                                                                   brooks_status_pmalloc_err);
+        return ((status == brooks_status_ok && zone_map) ? brooks_doc_array_enable_zone_map(array) : status);
+    } else return brooks_status_false;
+}
+
+static brooks_status_e history_publish(brooks_doc_history_t *history, const brooks_object_t *version)
+{
+    // readers may still hold the old versions array, which stays valid in the pool
+    size_t num_versions = atomic_load(&history->num_versions);
+    const brooks_object_t **versions = atomic_load(&history->versions);
+    if (num_versions == history->capacity) {
+        const brooks_object_t **grown = brooks_pool_malloc(history->pool, 2 * history->capacity *
+                                                                          sizeof(brooks_object_t *));
+        if (grown == NULL) {
+            return brooks_status_pmalloc_err;
+        }
+        memcpy(grown, versions, num_versions * sizeof(brooks_object_t *));
+        brooks_pool_discard(history->pool, history->capacity * sizeof(brooks_object_t *),
+                            brooks_pool_category_other);
+        history->capacity *= 2;
+        atomic_store(&history->versions, versions = grown);
+    }
+    versions[num_versions] = version;
+    atomic_store(&history->num_versions, num_versions + 1);
+    return brooks_status_ok;
+}
+
+// A shallow copy whose values refer to the copy; contained objects and arrays are shared with 'object'
+static brooks_object_t *object_copy(brooks_pool_t *pool, const brooks_object_t *object, entry_desc_t context,
+                                    size_t num_add)
+{
+    if (object_materialize(object) != brooks_status_ok) {
+        return NULL;
+    }
+    size_t num_entries = brooks_shape_get_num_keys(object->shape);
+    brooks_object_t *copy = brooks_pool_malloc_tagged(pool, sizeof(brooks_object_t), brooks_pool_category_object);
+    if (copy != NULL) {
+        *copy = *object;
+        copy->context_desc = context;
+        copy->pool = pool;
+        copy->frozen = false;
+        copy->lazy = NULL;
+        copy->capacity = num_entries + num_add;
+        copy->values = (copy->capacity > 0 ? brooks_pool_malloc_tagged(pool, copy->capacity * sizeof(brooks_value_t),
+                                                                       brooks_pool_category_value) : NULL);
+        if (copy->capacity > 0 && copy->values == NULL) {
+            return NULL;
+        }
+        for (size_t i = 0; i < num_entries; i++) {
+            copy->values[i] = object->values[i];
+            copy->values[i].context_desc.context.object = copy;
+        }
+    }
+    return copy;
+}
+
+// Removes the property at 'idx' by moving the object to the shape of the remaining keys
+static brooks_status_e object_remove(brooks_object_t *object, size_t idx)
+{
+    // the keys before 'idx' keep their shape, the ones after it are re-added to that
+    size_t num_entries = brooks_shape_get_num_keys(object->shape);
+    brooks_shape_t *shape = object->shape;
+    for (size_t i = num_entries; i > idx; i--) {
+        shape = (brooks_shape_t *) brooks_shape_get_parent(shape);
+    }
+    for (size_t i = idx + 1; i < num_entries; i++) {
+        if (brooks_shape_transition(&shape, shape, brooks_shape_get_key(object->shape, i)) != brooks_status_ok) {
+            return brooks_status_pmalloc_err;
+        }
+    }
+    memmove(object->values + idx, object->values + idx + 1, (num_entries - idx - 1) * sizeof(brooks_value_t));
+    object->shape = shape;
+    return brooks_status_ok;
+}
+
+// A copy of the array's structure and entries array; entries and their values are shared with 'array'
+static brooks_array_t *array_copy(brooks_pool_t *pool, const brooks_array_t *array, entry_desc_t context,
+                                  size_t num_add)
+{
+    if (array_materialize(array) != brooks_status_ok) {
+        return NULL;
+    }
+    brooks_array_t *copy = brooks_pool_malloc_tagged(pool, sizeof(brooks_array_t), brooks_pool_category_array);
+    if (copy != NULL) {
+        *copy = *array;
+        copy->context_desc = context;
+        copy->frozen = false;
+        copy->capacity = array->num_entries + num_add;
+        copy->entries = brooks_pool_malloc_tagged(pool, copy->capacity * sizeof(brooks_unnamed_entry_t *),
+                                                  brooks_pool_category_entry);
+        if (copy->entries == NULL) {
+            return NULL;
+        }
+        memcpy(copy->entries, array->entries, array->num_entries * sizeof(brooks_unnamed_entry_t *));
+        copy->zones = NULL;
+        copy->num_zones = copy->zones_capacity = 0;
+    }
+    return copy;
+}
+
+// A copy of 'entry' and its value at position 'idx' of 'array'; a contained object or array is shared
+static brooks_unnamed_entry_t *array_entry_copy(brooks_pool_t *pool, brooks_array_t *array,
+                                                const brooks_unnamed_entry_t *entry, size_t idx)
+{
+    brooks_unnamed_entry_t *copy = array_entry_create(pool, array);
+    brooks_value_t content = *entry->value;
+    copy->idx = idx;
+    copy->value = value_create(pool, content.type, brooks_entry_type_unnamed_entry, copy);
+    content.context_desc = copy->value->context_desc;
+    *copy->value = content;
+    return copy;
+}
+
+// Sets the content of 'value', which keeps its place, to a scalar from 'data', or to an empty object or array
+static brooks_status_e value_assign(brooks_value_t *value, brooks_pool_t *pool, brooks_type_e type, const void *data)
+{
+    void *parent = (value->context_desc.context_type == brooks_entry_type_named_entry ?
+                    (void *) value->context_desc.context.object : (void *) value->context_desc.context.unnamed_entry);
+    brooks_value_t content = { .context_desc = value->context_desc, .type = type };
+    brooks_status_e status = brooks_status_ok;
+
+    if (type == brooks_type_object) {
+        if ((content.object = json_create(pool, value->context_desc.context_type, parent)) == NULL) {
+            return brooks_status_pmalloc_err;
+        }
+        content.object->idx = brooks_doc_value_get_index(value);
+    } else if (type == brooks_type_array) {
+        brooks_type_e element_type = (data != NULL ? *(const brooks_type_e *) data : brooks_type_null);
+        if ((content.array = array_create(element_type, BROOKS_ARRAY_CAPACITY, value->context_desc.context_type,
+                                           parent)) == NULL) {
+            return brooks_status_pmalloc_err;
+        }
+        content.array->idx = brooks_doc_value_get_index(value);
+    } else if ((status = value_set(&content, pool, type, data)) != brooks_status_ok) {
+        return status;
+    }
+    *value = content;
+    return brooks_status_ok;
+}
+
+// Splits a copy of 'location' into its components; the result is one block to be freed by the caller
+static char **location_split(size_t *num_components, const char *location)
+{
+    size_t length = strlen(location);
+    *num_components = 1;
+    for (const char *it = location; *it; it++) {
+        *num_components += (*it == BROOKS_PATH_SEPARATOR);
+    }
+    char **components = malloc(*num_components * sizeof(char *) + length + 1);
+    if (components == NULL) {
+        return NULL;
+    }
+    char *text = memcpy(components + *num_components, location, length + 1);
+    components[0] = text;
+    for (size_t i = 1; *text; text++) {
+        if (*text == BROOKS_PATH_SEPARATOR) {
+            *text = '\0';
+            components[i++] = text + 1;
+        }
+    }
+    for (size_t i = 0; i < *num_components; i++) {
+        if (*components[i] == '\0') {
+            free(components);
+            return NULL;
+        }
+    }
+    return components;
+}
+
+static bool location_position(size_t *position, const char *component)
+{
+    char *end;
+    if (*component < '0' || *component > '9') {
+        return false;
+    }
+    *position = (size_t) strtoull(component, &end, 10);
+    return (*end == '\0');
+}
+
+static bool value_data_valid(brooks_type_e type, const void *data)
+{
+    return (type > brooks_type_none && type <= brooks_type_null &&
+            (data != NULL || type == brooks_type_object || type == brooks_type_array || type == brooks_type_null));
+}
+
+// Recycles what 'value' holds: its string, or its object or array with everything in it. Strings decoded in the text
+// of a lazy parse or a projection are no blocks of their own, and stay where they are
+static void value_recycle(brooks_pool_t *pool, const brooks_value_t *value)
+{
+    bool text_strings = (value->context_desc.context_type == brooks_entry_type_named_entry ?
+                         value->context_desc.context.object->text_strings :
+                         value->context_desc.context.unnamed_entry->context->text_strings);
+    switch (value->type) {
+        case brooks_type_string:
+            if (!text_strings) {
+                brooks_pool_recycle(pool, value->string, strlen(value->string) + 1, brooks_pool_category_string);
+            }
+            break;
+        case brooks_type_object:
+            object_recycle(pool, value->object);
+            break;
+        case brooks_type_array:
+            array_recycle(pool, value->array);
+            break;
+        default:
+            break;
+    }
+}
+
+static void object_recycle(brooks_pool_t *pool, brooks_object_t *object)
+{
+    for (size_t i = 0; i < brooks_shape_get_num_keys(object->shape); i++) {
+        value_recycle(pool, object->values + i);
+    }
+    brooks_pool_recycle(pool, object->values, object->capacity * sizeof(brooks_value_t), brooks_pool_category_value);
+    brooks_pool_recycle(pool, object, sizeof(brooks_object_t), brooks_pool_category_object);
+}
+
+static void array_recycle(brooks_pool_t *pool, brooks_array_t *array)
+{
+    for (size_t i = 0; i < array->num_entries; i++) {
+        value_recycle(pool, array->entries[i]->value);
+        brooks_pool_recycle(pool, array->entries[i]->value, sizeof(brooks_value_t), brooks_pool_category_value);
+        brooks_pool_recycle(pool, array->entries[i], sizeof(brooks_unnamed_entry_t), brooks_pool_category_entry);
+    }
+    brooks_pool_recycle(pool, array->entries, array->capacity * sizeof(brooks_unnamed_entry_t *),
+                        brooks_pool_category_entry);
+    brooks_pool_recycle(pool, array->zones, array->zones_capacity * sizeof(brooks_zone_t),
+                        brooks_pool_category_array);
+    brooks_pool_recycle(pool, array, sizeof(brooks_array_t), brooks_pool_category_array);
+}
+
+static size_t json_grow_capacity(const brooks_object_t *object, const brooks_shape_t *shape)
+{
+    size_t extent = brooks_shape_get_extent(shape);
+    return (object->capacity >= 4 && extent < 2 * object->capacity ? 2 * object->capacity : extent);
+}
+
+// Moves the values of an object that uses less than a quarter of its slots to a block of twice their number
+static brooks_status_e json_shrink(brooks_object_t *object)
+{
+    size_t num_entries = brooks_shape_get_num_keys(object->shape);
+    if (object->capacity > 4 && 4 * num_entries <= object->capacity) {
+        size_t capacity = (num_entries > 2 ? 2 * num_entries : 4);
+        brooks_value_t *values = brooks_pool_malloc_tagged(object->pool, capacity * sizeof(brooks_value_t),
+                                                           brooks_pool_category_value);
+        if (values == NULL) {
+            return brooks_status_pmalloc_err;
+        }
+        memcpy(values, object->values, num_entries * sizeof(brooks_value_t));
+        brooks_pool_recycle(object->pool, object->values, object->capacity * sizeof(brooks_value_t),
+                            brooks_pool_category_value);
+        object->values = values;
+        object->capacity = capacity;
+    }
+    return brooks_status_ok;
+}
+
+static brooks_status_e array_shrink(brooks_array_t *array)
+{
+    if (array->capacity > BROOKS_ARRAY_CAPACITY && 4 * array->num_entries <= array->capacity) {
+        brooks_pool_t *pool = context_get_pool(&array->context_desc);
+        size_t capacity = (2 * array->num_entries > BROOKS_ARRAY_CAPACITY ? 2 * array->num_entries :
+                                                                            BROOKS_ARRAY_CAPACITY);
+        brooks_unnamed_entry_t **entries = brooks_pool_malloc_tagged(pool, capacity * sizeof(brooks_unnamed_entry_t *),
+                                                                     brooks_pool_category_entry);
+        if (entries == NULL) {
+            return brooks_status_pmalloc_err;
+        }
+        memcpy(entries, array->entries, array->num_entries * sizeof(brooks_unnamed_entry_t *));
+        brooks_pool_recycle(pool, array->entries, array->capacity * sizeof(brooks_unnamed_entry_t *),
+                            brooks_pool_category_entry);
+        array->entries = entries;
+        array->capacity = capacity;
+    }
+    return brooks_status_ok;
+}
+
+// Recomputes the zone of the element at 'idx', or all zones from that one on if elements moved
+static brooks_status_e zone_map_refresh(brooks_array_t *array, size_t idx, bool following)
+{
+    size_t zone_idx = idx / BROOKS_ZONE_MAP_BLOCK_SIZE, begin = zone_idx * BROOKS_ZONE_MAP_BLOCK_SIZE;
+    size_t end = (following || begin + BROOKS_ZONE_MAP_BLOCK_SIZE > array->num_entries ?
+                  array->num_entries : begin + BROOKS_ZONE_MAP_BLOCK_SIZE);
+    if (following) {
+        array->num_zones = (zone_idx < array->num_zones ? zone_idx : array->num_zones);
+    } else {
+        array->zones[zone_idx] = (brooks_zone_t) { .num_nulls = 0, .num_elements = 0 };
+    }
+    brooks_status_e status = brooks_status_ok;
+    for (size_t i = begin; status == brooks_status_ok && i < end; i++) {
+        status = zone_map_update(array, i, array->entries[i]->value);
+    }
+    return status;
+}
+
+// Moves the entries from 'idx' on up by one to make room for 'entry'
+static brooks_status_e array_entry_insert(brooks_array_t *array, size_t idx, brooks_unnamed_entry_t *entry)
+{
+    memmove(array->entries + idx + 1, array->entries + idx,
+            (array->num_entries - idx) * sizeof(brooks_unnamed_entry_t *));
+    array->entries[idx] = entry;
+    array->num_entries++;
+    for (size_t i = idx; i < array->num_entries; i++) {
+        array->entries[i]->idx = i;
+    }
+    return (array->zones != NULL ? zone_map_refresh(array, idx, true) : brooks_status_ok);
+}
+
+// Sets 'copy' to a deep copy of 'value' that belongs to 'context' and whose content is allocated in 'pool'
+static brooks_status_e value_copy(brooks_value_t *copy, brooks_pool_t *pool, const brooks_value_t *value,
+                                  entry_desc_t context)
+{
+    void *parent = (context.context_type == brooks_entry_type_named_entry ?
+                    (void *) context.context.object : (void *) context.context.unnamed_entry);
+    brooks_status_e status = brooks_status_ok;
+    *copy = *value;
+    copy->context_desc = context;
+
+    if (value->type == brooks_type_string) {
+        return ((copy->string = brooks_misc_strdup(pool, value->string)) != NULL ? brooks_status_ok :
+                                                                                   brooks_status_pmalloc_err);
+    } else if (value->type == brooks_type_object) {
+        const brooks_object_t *object = value->object;
+        if ((status = object_materialize(object)) != brooks_status_ok) {
+            return status;
+        } else if ((copy->object = json_create(pool, context.context_type, parent)) == NULL) {
+            return brooks_status_pmalloc_err;
+        }
+        size_t num_entries = brooks_shape_get_num_keys(object->shape);
+        status = json_reserve(copy->object, num_entries);
+        for (size_t i = 0; status == brooks_status_ok && i < num_entries; i++) {
+            brooks_value_t *property = json_add_entry(copy->object, object->values[i].type,
+                                                      brooks_shape_get_key(object->shape, i));
+            status = (property != NULL ? value_copy(property, pool, object->values + i, property->context_desc) :
+                                         brooks_status_pmalloc_err);
+        }
+    } else if (value->type == brooks_type_array) {
+        const brooks_array_t *array = value->array;
+        if ((status = array_materialize(array)) != brooks_status_ok) {
+            return status;
+        } else if ((copy->array = array_create(array->type, array->num_entries, context.context_type,
+                                               parent)) == NULL) {
+            return brooks_status_pmalloc_err;
+        }
+        for (size_t i = 0; status == brooks_status_ok && i < array->num_entries; i++) {
+            brooks_unnamed_entry_t *entry = array_entry_create(pool, copy->array);
+            entry_desc_t entry_context = { .context.unnamed_entry = entry,
+                                           .context_type = brooks_entry_type_unnamed_entry };
+            if ((entry->value = brooks_pool_malloc_tagged(pool, sizeof(brooks_value_t),
+                                                          brooks_pool_category_value)) == NULL) {
+                return brooks_status_pmalloc_err;
+            } else if ((status = value_copy(entry->value, pool, array->entries[i]->value, entry_context)) ==
+                       brooks_status_ok && (status = array_autoresize(copy->array)) == brooks_status_ok) {
+                copy->array->entries[copy->array->num_entries++] = entry;
+            }
+        }
+        if (status == brooks_status_ok && array->zones != NULL) {
+            status = brooks_doc_array_enable_zone_map(copy->array);
+        }
+    }
+    return status;
+}
+
+static brooks_status_e doc_clone(brooks_object_t **clone, brooks_pool_t *pool, const brooks_object_t *doc,
+                                 bool freeze)
+{
+    if (clone && pool && doc) {
+        entry_desc_t root = { .context.object = BROOKS_OBJECT_ROOT, .context_type = brooks_entry_type_named_entry };
+        clone_t state = { .pool = pool, .freeze = freeze };
+        brooks_status_e status;
+        state.same_shapes = (brooks_pool_get_shapes(pool) == brooks_pool_get_shapes(doc->pool));
+        if ((status = clone_measure_object(&state, doc)) != brooks_status_ok) {
+            return status;
+        } else if ((state.next = brooks_pool_malloc_layout(pool, &state.layout)) == NULL) {
+            return brooks_status_pmalloc_err;
+        }
+        *clone = clone_object(&state, doc, root);
+        free(state.sources);
+        free(state.shapes);
+        return (*clone != NULL ? brooks_status_ok : brooks_status_pmalloc_err);
+    } else return brooks_status_nullptr;
+}
+
+// Accounts the structures a clone of 'value' places in the block; the layout matches the one of clone_value
+static brooks_status_e clone_measure(clone_t *clone, const brooks_value_t *value)
+{
+    brooks_status_e status = brooks_status_ok;
+    if (value->type == brooks_type_string) {
+        clone_account(clone, strlen(value->string) + 1, brooks_pool_category_string);
+    } else if (value->type == brooks_type_object) {
+        status = clone_measure_object(clone, value->object);
+    } else if (value->type == brooks_type_array) {
+        const brooks_array_t *array = value->array;
+        if ((status = array_materialize(array)) != brooks_status_ok) {
+            return status;
+        }
+        clone_account(clone, sizeof(brooks_array_t), brooks_pool_category_array);
+        clone_account(clone, array->num_entries * sizeof(brooks_unnamed_entry_t *), brooks_pool_category_entry);
+        if (array->zones != NULL) {
+            clone_account(clone, array->num_zones * sizeof(brooks_zone_t), brooks_pool_category_array);
+        }
+        for (size_t i = 0; status == brooks_status_ok && i < array->num_entries; i++) {
+            clone_account(clone, sizeof(brooks_unnamed_entry_t), brooks_pool_category_entry);
+            clone_account(clone, sizeof(brooks_value_t), brooks_pool_category_value);
+            status = clone_measure(clone, array->entries[i]->value);
+        }
+    }
+    return status;
+}
+
+static brooks_status_e clone_measure_object(clone_t *clone, const brooks_object_t *object)
+{
+    brooks_status_e status = object_materialize(object);
+    size_t num_entries = brooks_shape_get_num_keys(object->shape);
+    clone_account(clone, sizeof(brooks_object_t), brooks_pool_category_object);
+    clone_account(clone, num_entries * sizeof(brooks_value_t), brooks_pool_category_value);
+    for (size_t i = 0; status == brooks_status_ok && i < num_entries; i++) {
+        status = clone_measure(clone, object->values + i);
+    }
+    return status;
+}
+
+static void clone_account(clone_t *clone, size_t size, brooks_pool_category_e category)
+{
+    if (size > 0) {
+        clone->layout.num_bytes += (size + CLONE_ALIGNMENT - 1) / CLONE_ALIGNMENT * CLONE_ALIGNMENT;
+        clone->layout.category_bytes[category] += size;
+        clone->layout.category_allocations[category]++;
+    }
+}
+
+static void *clone_place(clone_t *clone, size_t size)
+{
+    void *result = clone->next;
+    clone->next += (size + CLONE_ALIGNMENT - 1) / CLONE_ALIGNMENT * CLONE_ALIGNMENT;
+    return result;
+}
+
+// Places the object, then its values, then the content of each value, such that the clone is laid out in the order
+// of a depth-first traversal and containers have no unused slots
+static brooks_object_t *clone_object(clone_t *clone, const brooks_object_t *object, entry_desc_t context)
+{
+    size_t num_entries = brooks_shape_get_num_keys(object->shape);
+    brooks_object_t *copy = clone_place(clone, sizeof(brooks_object_t));
+    *copy = (brooks_object_t) { .context_desc = context, .shape = clone_shape(clone, object->shape),
+                                .capacity = num_entries, .idx = object->idx, .pool = clone->pool,
+                                .frozen = clone->freeze };
+    copy->values = clone_place(clone, num_entries * sizeof(brooks_value_t));
+    if (copy->shape == NULL) {
+        return NULL;
+    }
+    entry_desc_t property = { .context.object = copy, .context_type = brooks_entry_type_named_entry };
+    for (size_t i = 0; i < num_entries; i++) {
+        if (clone_value(clone, copy->values + i, object->values + i, property) != brooks_status_ok) {
+            return NULL;
+        }
+    }
+    return copy;
+}
+
+// Frozen arrays of scalars are packed: their entries, values and strings are placed in three runs, such that a scan
+// reads each of them sequentially
+static brooks_array_t *clone_array(clone_t *clone, const brooks_array_t *array, entry_desc_t context)
+{
+    bool packed = (clone->freeze && array->type != brooks_type_object && array->type != brooks_type_array);
+    brooks_array_t *copy = clone_place(clone, sizeof(brooks_array_t));
+    *copy = *array;
+    copy->context_desc = context;
+    copy->frozen = clone->freeze;
+    copy->text_strings = false;
+    copy->capacity = array->num_entries;
+    copy->entries = clone_place(clone, array->num_entries * sizeof(brooks_unnamed_entry_t *));
+    if (array->zones != NULL) {
+        copy->zones_capacity = array->num_zones;
+        copy->zones = clone_place(clone, array->num_zones * sizeof(brooks_zone_t));
+        memcpy(copy->zones, array->zones, array->num_zones * sizeof(brooks_zone_t));
+    }
+    for (size_t i = 0; i < array->num_entries; i++) {
+        brooks_unnamed_entry_t *entry = clone_place(clone, sizeof(brooks_unnamed_entry_t));
+        entry_desc_t element = { .context.unnamed_entry = entry, .context_type = brooks_entry_type_unnamed_entry };
+        *entry = (brooks_unnamed_entry_t) { .context = copy, .idx = i,
+                                            .value = (packed ? NULL : clone_place(clone, sizeof(brooks_value_t))) };
+        copy->entries[i] = entry;
+        if (!packed && clone_value(clone, entry->value, array->entries[i]->value, element) != brooks_status_ok) {
+            return NULL;
+        }
+    }
+    if (packed) {
+        for (size_t i = 0; i < array->num_entries; i++) {
+            copy->entries[i]->value = clone_place(clone, sizeof(brooks_value_t));
+        }
+        for (size_t i = 0; i < array->num_entries; i++) {
+            entry_desc_t element = { .context.unnamed_entry = copy->entries[i],
+                                     .context_type = brooks_entry_type_unnamed_entry };
+            if (clone_value(clone, copy->entries[i]->value, array->entries[i]->value, element) != brooks_status_ok) {
+                return NULL;
+            }
+        }
+    }
+    return copy;
+}
+
+static brooks_status_e clone_value(clone_t *clone, brooks_value_t *copy, const brooks_value_t *value,
+                                   entry_desc_t context)
+{
+    *copy = *value;
+    copy->context_desc = context;
+    if (value->type == brooks_type_string) {
+        size_t length = strlen(value->string) + 1;
+        copy->string = memcpy(clone_place(clone, length), value->string, length);
+    } else if (value->type == brooks_type_object) {
+        copy->object = clone_object(clone, value->object, context);
+        return (copy->object != NULL ? brooks_status_ok : brooks_status_pmalloc_err);
+    } else if (value->type == brooks_type_array) {
+        copy->array = clone_array(clone, value->array, context);
+        return (copy->array != NULL ? brooks_status_ok : brooks_status_pmalloc_err);
+    }
+    return brooks_status_ok;
+}
+
+// The shape of the clone's pool with the keys of 'shape', created by following the transitions of its ancestors once
+// per distinct shape of the source
+static brooks_shape_t *clone_shape(clone_t *clone, const brooks_shape_t *shape)
+{
+    if (clone->same_shapes) {
+        return (brooks_shape_t *) shape;
+    }
+    size_t num_keys = brooks_shape_get_num_keys(shape), slot, mask = clone->shapes_capacity - 1;
+    if (num_keys == 0) {
+        return brooks_shape_registry_get_root(brooks_pool_get_shapes(clone->pool));
+    }
+    for (slot = (size_t) brooks_shape_get_id(shape) & mask; clone->shapes_capacity > 0 &&
+         clone->sources[slot] != NULL; slot = (slot + 1) & mask) {
+        if (clone->sources[slot] == shape) {
+            return clone->shapes[slot];
+        }
+    }
+
+    brooks_shape_t *parent = clone_shape(clone, brooks_shape_get_parent(shape)), *result;
+    if (parent == NULL || brooks_shape_transition(&result, parent, brooks_shape_get_key(shape, num_keys - 1)) !=
+                          brooks_status_ok) {
+        return NULL;
+    }
+    if (2 * (clone->num_shapes + 1) > clone->shapes_capacity) {
+        size_t capacity = (clone->shapes_capacity > 0 ? 2 * clone->shapes_capacity : 64);
+        const brooks_shape_t **sources = calloc(capacity, sizeof(brooks_shape_t *));
+        brooks_shape_t **shapes = malloc(capacity * sizeof(brooks_shape_t *));
+        if (sources == NULL || shapes == NULL) {
+            free(sources);
+            free(shapes);
+            return result;
+        }
+        for (size_t i = 0; i < clone->shapes_capacity; i++) {
+            if (clone->sources[i] != NULL) {
+                for (slot = (size_t) brooks_shape_get_id(clone->sources[i]) & (capacity - 1); sources[slot] != NULL;
+                     slot = (slot + 1) & (capacity - 1))
+                    ;
+                sources[slot] = clone->sources[i];
+                shapes[slot] = clone->shapes[i];
+            }
+        }
+        free(clone->sources);
+        free(clone->shapes);
+        clone->sources = sources;
+        clone->shapes = shapes;
+        clone->shapes_capacity = capacity;
+    }
+    mask = clone->shapes_capacity - 1;
+    for (slot = (size_t) brooks_shape_get_id(shape) & mask; clone->sources[slot] != NULL; slot = (slot + 1) & mask)
+        ;
+    clone->sources[slot] = shape;
+    clone->shapes[slot] = result;
+    clone->num_shapes++;
+    return result;
+}
+
+// Builds the properties of an object of a lazily parsed document, whose objects and arrays are left to be built
+// on their own first access
+static brooks_status_e object_materialize(const brooks_object_t *object)
+{
+    if (!object->lazy_pending) {
+        return brooks_status_ok;
+    }
+    brooks_object_t *target = (brooks_object_t *) object;
+    const lazy_t *lazy = object->lazy;
+    const lazy_container_t *container = lazy->containers + object->lazy_container;
+    uint32_t child = object->lazy_container + 1;
+    char *it = lazy->text + container->begin + 1;
+    brooks_status_e status = json_reserve(target, container->length);
+    // the root keeps the index and the text for brooks_doc_footprint
+    target->lazy = (context_is_root(&target->context_desc) ? lazy : NULL);
+    target->lazy_pending = false;
+    for (uint32_t i = 0; status == brooks_status_ok && i < container->length; i++) {
+        it = lazy_skip(*(it = lazy_skip(it)) == ',' ? it + 1 : it);
+        const char *key = lazy_string(&it);
+        brooks_value_t *value = json_add_entry(target, brooks_type_null, key);
+        it = lazy_skip(lazy_skip(it) + 1);
+        status = (value != NULL ? lazy_value(value, target->pool, lazy, &it, &child) : brooks_status_pmalloc_err);
+    }
+    return status;
+}
+
+static brooks_status_e array_materialize(const brooks_array_t *array)
+{
+    if (array->lazy == NULL) {
+        return brooks_status_ok;
+    }
+    brooks_array_t *target = (brooks_array_t *) array;
+    brooks_pool_t *pool = context_get_pool(&target->context_desc);
+    const lazy_t *lazy = array->lazy;
+    const lazy_container_t *container = lazy->containers + array->lazy_container;
+    uint32_t child = array->lazy_container + 1;
+    char *it = lazy->text + container->begin + 1;
+    target->lazy = NULL;
+    // an empty array gets a slot as well, such that its entries are never NULL
+    target->capacity = (container->length > 0 ? container->length : 1);
+    target->entries = brooks_pool_malloc_tagged(pool, target->capacity * sizeof(brooks_unnamed_entry_t *),
+                                                brooks_pool_category_entry);
+    if (target->entries == NULL) {
+        return brooks_status_pmalloc_err;
+    }
+    for (uint32_t i = 0; i < container->length; i++) {
+        it = lazy_skip(*(it = lazy_skip(it)) == ',' ? it + 1 : it);
+        brooks_unnamed_entry_t *entry = array_entry_create(pool, target);
+        brooks_status_e status;
+        entry->value = value_create(pool, target->type, brooks_entry_type_unnamed_entry, entry);
+        if ((status = lazy_value(entry->value, pool, lazy, &it, &child)) != brooks_status_ok) {
+            return status;
+        } else if (target->type == brooks_type_number_double && entry->value->type == brooks_type_number_integer) {
+            entry->value->type = brooks_type_number_double;
+            entry->value->decimal = (double) (int64_t) entry->value->integer;
+        }
+        target->entries[target->num_entries++] = entry;
+    }
+    return brooks_status_ok;
+}
+
+// Sets 'value' to the value at 'it' and moves 'it' past it; an object or array becomes a container to be built on
+// first access, which is the container 'child' of the index, and 'child' moves to its next sibling
+static brooks_status_e lazy_value(brooks_value_t *value, brooks_pool_t *pool, const lazy_t *lazy, char **it,
+                                  uint32_t *child)
+{
+    void *parent = (value->context_desc.context_type == brooks_entry_type_named_entry ?
+                    (void *) value->context_desc.context.object : (void *) value->context_desc.context.unnamed_entry);
+    size_t idx = (value->context_desc.context_type == brooks_entry_type_named_entry ?
+                  (size_t) (value - value->context_desc.context.object->values) : 0);
+
+    switch (**it) {
+        case '{':
+            value->type = brooks_type_object;
+            if ((value->object = json_create(pool, value->context_desc.context_type, parent)) == NULL) {
+                return brooks_status_pmalloc_err;
+            }
+            value->object->idx = idx;
+            value->object->lazy = lazy;
+            value->object->lazy_pending = true;
+            value->object->lazy_container = *child;
+            break;
+        case '[':
+            value->type = brooks_type_array;
+            if ((value->array = array_create(lazy->containers[*child].type, 0, value->context_desc.context_type,
+                                             parent)) == NULL) {
+                return brooks_status_pmalloc_err;
+            }
+            value->array->idx = idx;
+            value->array->lazy = lazy;
+            value->array->lazy_container = *child;
+            break;
+        case '"':
+            // strings are decoded in the copy of the text, which lives as long as the pool
+            value->type = brooks_type_string;
+            value->string = lazy_string(it);
+            if (value->context_desc.context_type == brooks_entry_type_named_entry) {
+                value->context_desc.context.object->text_strings = true;
+            } else value->context_desc.context.unnamed_entry->context->text_strings = true;
+            return brooks_status_ok;
+        case 't':
+        case 'f':
+            value->type = brooks_type_boolean;
+            value->boolean = (**it == 't');
+            *it += (value->boolean ? 4 : 5);
+            return brooks_status_ok;
+        case 'n':
+            value->type = brooks_type_null;
+            *it += 4;
+            return brooks_status_ok;
+        default:
+            *it = lazy_number(*it, value);
+            return brooks_status_ok;
+    }
+    *it = lazy->text + lazy->containers[*child].end + 1;
+    *child = lazy->containers[*child].next;
+    return brooks_status_ok;
+}
+
+// Validates the value at the scan's position, moves past it, and records the objects and arrays in it; arrays that
+// mix types are recorded with brooks_type_none and set the scan's status to brooks_status_notype
+static bool lazy_scan_value(lazy_scan_t *scan, brooks_type_e *type)
+{
+    scan->it = lazy_skip(scan->it);
+    switch (*scan->it) {
+        case '{':
+        case '[':
+            return lazy_scan_container(scan, type);
+        case '"':
+            *type = brooks_type_string;
+            return lazy_scan_string(scan);
+        case 't':
+        case 'f':
+        case 'n': {
+            const char *literal = (*scan->it == 't' ? "true" : (*scan->it == 'f' ? "false" : "null"));
+            size_t length = strlen(literal);
+            *type = (*scan->it == 'n' ? brooks_type_null : brooks_type_boolean);
+            if (strncmp(scan->it, literal, length) != 0) {
+                return false;
+            }
+            scan->it += length;
+            return true;
+        }
+        default:
+            return lazy_scan_number(scan, type);
+    }
+}
+
+static bool lazy_scan_container(lazy_scan_t *scan, brooks_type_e *type)
+{
+    bool object = (*scan->it == '{');
+    char close = (object ? '}' : ']');
+    size_t idx = scan->num_containers, length = 0;
+    brooks_type_e elements = brooks_type_null, element;
+
+    if (scan->num_containers == scan->capacity) {
+        size_t capacity = (scan->capacity > 0 ? 2 * scan->capacity : 64);
+        lazy_container_t *containers = realloc(scan->containers, capacity * sizeof(lazy_container_t));
+        if (containers == NULL) {
+            scan->status = brooks_status_malloc_err;
+            return false;
+        }
+        scan->containers = containers;
+        scan->capacity = capacity;
+    }
+    scan->containers[scan->num_containers++].begin = (uint32_t) (scan->it - scan->text);
+    scan->it = lazy_skip(scan->it + 1);
+    if (*scan->it != close) {
+        for (;;) {
+            if (object) {
+                if (*(scan->it = lazy_skip(scan->it)) != '"' || !lazy_scan_string(scan) ||
+                    *(scan->it = lazy_skip(scan->it)) != ':') {
+                    return false;
+                }
+                scan->it++;
+            }
+            if (!lazy_scan_value(scan, &element)) {
+                return false;
+            }
+            elements = (object ? elements : lazy_array_type(scan, elements, element, length));
+            length++;
+            if (*(scan->it = lazy_skip(scan->it)) != ',') {
+                break;
+            } else if (*(scan->it = lazy_skip(scan->it + 1)) == close) {
+                // a trailing comma, which json-parser accepts as well
+                break;
+            }
+        }
+        if (*scan->it != close) {
+            return false;
+        }
+    }
+    // the index may have moved while the children were recorded
+    lazy_container_t *container = scan->containers + idx;
+    container->end = (uint32_t) (scan->it++ - scan->text);
+    container->next = (uint32_t) scan->num_containers;
+    container->length = (uint32_t) length;
+    container->type = (object ? brooks_type_object : elements);
+    *type = (object ? brooks_type_object : brooks_type_array);
+    return true;
+}
+
+static bool lazy_scan_string(lazy_scan_t *scan)
+{
+    const char *it = scan->it + 1;
+    for (; *it != '"'; it++) {
+        if (*it == '\0') {
+            return false;
+        } else if (*it == '\\' && *++it == 'u') {
+            long code = lazy_hex(it + 1);
+            it += 4;
+            if (code < 0 || ((code & 0xF800) == 0xD800 && (it[1] != '\\' || it[2] != 'u' || lazy_hex(it + 3) < 0))) {
+                return false;
+            }
+            it += ((code & 0xF800) == 0xD800 ? 6 : 0);
+        } else if (*it == '\0') {
+            return false;
+        }
+    }
+    scan->it = it + 1;
+    return true;
+}
+
+static bool lazy_scan_number(lazy_scan_t *scan, brooks_type_e *type)
+{
+    const char *it = scan->it + (*scan->it == '-');
+    *type = brooks_type_number_integer;
+    if (!isdigit((unsigned char) *it) || (*it == '0' && isdigit((unsigned char) it[1]))) {
+        return false;
+    }
+    while (isdigit((unsigned char) *it)) {
+        it++;
+    }
+    if (*it == '.') {
+        *type = brooks_type_number_double;
+        if (!isdigit((unsigned char) *++it)) {
+            return false;
+        }
+        while (isdigit((unsigned char) *it)) {
+            it++;
+        }
+    }
+    if (*it == 'e' || *it == 'E') {
+        *type = brooks_type_number_double;
+        it += (it[1] == '+' || it[1] == '-' ? 2 : 1);
+        if (!isdigit((unsigned char) *it)) {
+            return false;
+        }
+        while (isdigit((unsigned char) *it)) {
+            it++;
+        }
+    }
+    scan->it = it;
+    return true;
+}
+
+// Combines the type of the elements of an array so far with the one of its element 'idx', like parse_array_type
+static brooks_type_e lazy_array_type(lazy_scan_t *scan, brooks_type_e result, brooks_type_e type, size_t idx)
+{
+    if (idx == 0 || result == type) {
+        return type;
+    } else if ((result == brooks_type_number_integer || result == brooks_type_number_double) &&
+               (type == brooks_type_number_integer || type == brooks_type_number_double)) {
+        return brooks_type_number_double;
+    } else {
+        scan->status = (scan->status == brooks_status_ok ? brooks_status_notype : scan->status);
+        return brooks_type_none;
+    }
+}
+
+static char *lazy_skip(const char *it)
+{
+    while (*it == ' ' || *it == '\t' || *it == '\r' || *it == '\n') {
+        it++;
+    }
+    return (char *) it;
+}
+
+// Decodes the string that starts at 'it' in place, as json-parser does, and moves 'it' past its closing quote
+static char *lazy_string(char **it)
+{
+    char *result = *it + 1, *read = result, *write = result;
+    while (*read != '"') {
+        if (*read != '\\') {
+            *write++ = *read++;
+            continue;
+        }
+        switch (*++read) {
+            case 'b': *write++ = '\b'; break;
+            case 'f': *write++ = '\f'; break;
+            case 'n': *write++ = '\n'; break;
+            case 'r': *write++ = '\r'; break;
+            case 't': *write++ = '\t'; break;
+            case 'u': {
+                long code = lazy_hex(read + 1);
+                if ((code & 0xF800) == 0xD800) {
+                    code = 0x010000 | ((code & 0x3FF) << 10) | (lazy_hex(read + 7) & 0x3FF);
+                    read += 6;
+                }
+                read += 4;
+                if (code <= 0x7F) {
+                    *write++ = (char) code;
+                } else if (code <= 0x7FF) {
+                    *write++ = (char) (0xC0 | (code >> 6));
+                    *write++ = (char) (0x80 | (code & 0x3F));
+                } else if (code <= 0xFFFF) {
+                    *write++ = (char) (0xE0 | (code >> 12));
+                    *write++ = (char) (0x80 | ((code >> 6) & 0x3F));
+                    *write++ = (char) (0x80 | (code & 0x3F));
+                } else {
+                    *write++ = (char) (0xF0 | (code >> 18));
+                    *write++ = (char) (0x80 | ((code >> 12) & 0x3F));
+                    *write++ = (char) (0x80 | ((code >> 6) & 0x3F));
+                    *write++ = (char) (0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default: *write++ = *read; break;
+        }
+        read++;
+    }
+    *write = '\0';
+    *it = read + 1;
+    return result;
+}
+
+// Sets 'value' to the number that starts at 'it' and returns the position after it; the arithmetic is the one of
+// json-parser, such that lazily and eagerly parsed numbers are equal
+static char *lazy_number(char *it, brooks_value_t *value)
+{
+    bool negative = (*it == '-');
+    uint64_t whole = 0, fraction = 0;
+    long num_digits = 0, exponent = 0;
+    for (it += negative; isdigit((unsigned char) *it); it++) {
+        whole = whole * 10 + (uint64_t) (*it - '0');
+    }
+    value->type = brooks_type_number_integer;
+    value->integer = whole;
+    if (*it == '.') {
+        for (it++; isdigit((unsigned char) *it); it++, num_digits++) {
+            fraction = fraction * 10 + (uint64_t) (*it - '0');
+        }
+        value->type = brooks_type_number_double;
+        value->decimal = (double) (int64_t) whole + ((double) (int64_t) fraction) / pow(10.0, (double) num_digits);
+    }
+    if (*it == 'e' || *it == 'E') {
+        bool exponent_negative = (it[1] == '-');
+        if (value->type == brooks_type_number_integer) {
+            value->type = brooks_type_number_double;
+            value->decimal = (double) (int64_t) whole;
+        }
+        for (it += (it[1] == '+' || it[1] == '-' ? 2 : 1); isdigit((unsigned char) *it); it++) {
+            exponent = exponent * 10 + (*it - '0');
+        }
+        value->decimal *= pow(10.0, (double) (exponent_negative ? -exponent : exponent));
+    }
+    if (negative && value->type == brooks_type_number_integer) {
+        value->integer = 0 - whole;
+    } else if (negative) {
+        value->decimal = -value->decimal;
+    }
+    return it;
+}
+
+// The code point of the four hex digits at 'it', or -1 if they are not
+static long lazy_hex(const char *it)
+{
+    long result = 0;
+    for (size_t i = 0; i < 4; i++) {
+        char c = it[i];
+        if (!isxdigit((unsigned char) c)) {
+            return -1;
+        }
+        result = (result << 4) | (isdigit((unsigned char) c) ? c - '0' : (c | 0x20) - 'a' + 10);
+    }
+    return result;
+}
+
+// Builds the objects and arrays in 'value' that are left to be built on first access
+static brooks_status_e value_materialize(const brooks_value_t *value)
+{
+    brooks_status_e status = brooks_status_ok;
+    if (value->type == brooks_type_object && (status = object_materialize(value->object)) == brooks_status_ok) {
+        const brooks_object_t *object = value->object;
+        for (size_t i = 0; status == brooks_status_ok && i < brooks_shape_get_num_keys(object->shape); i++) {
+            status = value_materialize(object->values + i);
+        }
+    } else if (value->type == brooks_type_array && (status = array_materialize(value->array)) == brooks_status_ok) {
+        const brooks_array_t *array = value->array;
+        for (size_t i = 0; status == brooks_status_ok && i < array->num_entries; i++) {
+            status = value_materialize(array->entries[i]->value);
+        }
+    }
+    return status;
+}
+
+// Reads the object at 'it' into 'object', and moves 'it' past it; 'depth' is the number of keys from the root, and
+// the first 'num_active' paths of that depth are the ones that may continue below 'object'
+static brooks_status_e projection_object(projection_t *projection, brooks_object_t *object, const char **it,
+                                         size_t depth, size_t num_active)
+{
+    const size_t *active = projection->active + depth * projection->num_paths;
+    size_t *next = projection->active + (depth + 1) * projection->num_paths;
+    brooks_status_e status = brooks_status_ok;
+
+    *it = lazy_skip(*it + 1);
+    while (**it != '}') {
+        const char *key = lazy_string_copy(&projection->key, &projection->key_capacity, it);
+        size_t num_next = 0;
+        bool keep = false;
+        if (key == NULL || *(*it = lazy_skip(*it)) != ':') {
+            return brooks_status_failed;
+        }
+        *it = lazy_skip(*it + 1);
+        for (size_t i = 0; i < num_active; i++) {
+            const brooks_path_t *path = projection->paths[active[i]];
+            if (brooks_path_matches_component(path, depth, key)) {
+                keep |= (brooks_path_length(path) == depth + 1);
+                next[num_next++] = active[i];
+            }
+        }
+
+        brooks_object_t *child_object;
+        brooks_array_t *child_array;
+        if (keep) {
+            status = projection_keep(projection, object, key, it);
+        } else if (num_next > 0 && **it == '{') {
+            if ((status = brooks_doc_add_object(&child_object, object, key)) == brooks_status_ok) {
+                status = projection_object(projection, child_object, it, depth + 1, num_next);
+            }
+        } else if (num_next > 0 && **it == '[') {
+            if ((status = brooks_doc_add_array(&child_array, object, projection_array_type(*it), key)) ==
+                brooks_status_ok) {
+                status = projection_array(projection, child_array, it, depth + 1, num_next);
+            }
+        } else if ((*it = lazy_skip_value(*it, NULL)) == NULL) {
+            return brooks_status_failed;
+        }
+
+        if (status != brooks_status_ok) {
+            return status;
+        } else if (*(*it = lazy_skip(*it)) == ',') {
+            *it = lazy_skip(*it + 1);
+        } else if (**it != '}') {
+            return brooks_status_failed;
+        }
+    }
+    (*it)++;
+    return brooks_status_ok;
+}
+
+// Reads the array at 'it' into 'array', whose objects and arrays are read against the paths of 'depth' as their
+// parent is; other elements are skipped
+static brooks_status_e projection_array(projection_t *projection, brooks_array_t *array, const char **it,
+                                        size_t depth, size_t num_active)
+{
+    brooks_status_e status = brooks_status_ok;
+
+    *it = lazy_skip(*it + 1);
+    while (**it != ']') {
+        brooks_object_t *child_object;
+        brooks_array_t *child_array;
+        if (**it == '{' && array->type == brooks_type_object) {
+            if ((status = brooks_doc_array_add_object(&child_object, array)) == brooks_status_ok) {
+                status = projection_object(projection, child_object, it, depth, num_active);
+            }
+        } else if (**it == '[' && array->type == brooks_type_array) {
+            if ((status = brooks_doc_array_add_array(&child_array, projection_array_type(*it), array)) ==
+                brooks_status_ok) {
+                status = projection_array(projection, child_array, it, depth, num_active);
+            }
+        } else if (**it == '{' || **it == '[' || array->type == brooks_type_object ||
+                   array->type == brooks_type_array) {
+            // objects and arrays mixed with each other or with other types
+            return brooks_status_notype;
+        } else if ((*it = lazy_skip_value(*it, NULL)) == NULL) {
+            return brooks_status_failed;
+        }
+
+        if (status != brooks_status_ok) {
+            return status;
+        } else if (*(*it = lazy_skip(*it)) == ',') {
+            *it = lazy_skip(*it + 1);
+        } else if (**it != ']') {
+            return brooks_status_failed;
+        }
+    }
+    (*it)++;
+    return brooks_status_ok;
+}
+
+// Adds the value at 'it' to 'object' with everything in it, and moves 'it' past it. The value is validated and
+// indexed as by brooks_doc_parse_lazy, and then built from a copy of its text in the pool
+static brooks_status_e projection_keep(projection_t *projection, brooks_object_t *object, const char *key,
+                                       const char **it)
+{
+    lazy_scan_t *scan = &projection->scan;
+    brooks_value_t *value = json_add_entry(object, brooks_type_null, key);
+    brooks_type_e type;
+    scan->text = scan->it = *it;
+    scan->num_containers = 0;
+    scan->status = brooks_status_ok;
+
+    if (value == NULL) {
+        return brooks_status_pmalloc_err;
+    } else if (!lazy_scan_value(scan, &type)) {
+        return (scan->status == brooks_status_malloc_err ? scan->status : brooks_status_failed);
+    } else if (scan->status != brooks_status_ok) {
+        return scan->status;
+    }
+
+    size_t length = (size_t) (scan->it - *it);
+    char *copy = brooks_pool_malloc_tagged(object->pool, length + 1, brooks_pool_category_string);
+    if (copy == NULL) {
+        return brooks_status_pmalloc_err;
+    }
+    memcpy(copy, *it, length);
+    copy[length] = '\0';
+    *it = scan->it;
+
+    // the index is needed while the value is built only
+    lazy_t lazy = { .text = copy, .containers = scan->containers, .num_containers = scan->num_containers };
+    uint32_t child = 0;
+    brooks_status_e status = lazy_value(value, object->pool, &lazy, &copy, &child);
+    return (status == brooks_status_ok ? value_materialize(value) : status);
+}
+
+// Type of the array at 'it' as far as a projection keeps it: its objects or arrays, and nothing of other elements
+static brooks_type_e projection_array_type(const char *it)
+{
+    it = lazy_skip(it + 1);
+    return (*it == '{' ? brooks_type_object : (*it == '[' ? brooks_type_array : brooks_type_null));
+}
+
+// Reads the value at the scan's position and moves past it
+static brooks_status_e token_value(token_scan_t *scan, const char *key)
+{
+    const char *begin = scan->it;
+    brooks_value_t value = { .type = brooks_type_null };
+    lazy_scan_t number = { .text = scan->text, .it = scan->it };
+    brooks_doc_scan_e action;
+
+    switch (*scan->it) {
+        case '{':
+        case '[':
+            return token_container(scan, key);
+        case '"':
+            value.type = brooks_type_string;
+            if ((value.string = (char *) lazy_string_copy(&scan->string, &scan->string_capacity, &scan->it)) == NULL) {
+                return brooks_status_failed;
+            }
+            break;
+        case 't':
+        case 'f':
+        case 'n': {
+            const char *literal = (*scan->it == 't' ? "true" : (*scan->it == 'f' ? "false" : "null"));
+            if (strncmp(scan->it, literal, strlen(literal)) != 0) {
+                return brooks_status_failed;
+            }
+            value.type = (*scan->it == 'n' ? brooks_type_null : brooks_type_boolean);
+            value.boolean = (*scan->it == 't');
+            scan->it += strlen(literal);
+            break;
+        }
+        default:
+            if (!lazy_scan_number(&number, &value.type)) {
+                return brooks_status_failed;
+            }
+            scan->it = lazy_number((char *) scan->it, &value);
+            break;
+    }
+    token_emit(scan, brooks_doc_token_scalar, key, &value, begin, 0, &action);
+    return brooks_status_ok;
+}
+
+static brooks_status_e token_container(token_scan_t *scan, const char *key)
+{
+    bool object = (*scan->it == '{');
+    char close = (object ? '}' : ']');
+    const char *begin = scan->it;
+    brooks_value_t value = { .type = (object ? brooks_type_object : brooks_type_array) };
+    size_t num_elements = 0;
+    brooks_doc_scan_e action;
+
+    if (!token_emit(scan, (object ? brooks_doc_token_object_begin : brooks_doc_token_array_begin), key, &value, begin,
+                    0, &action)) {
+        return brooks_status_ok;
+    } else if (action == brooks_doc_scan_skip) {
+        if ((scan->it = lazy_skip_value(scan->it, &num_elements)) == NULL) {
+            return brooks_status_failed;
+        }
+    } else {
+        scan->it = lazy_skip(scan->it + 1);
+        while (*scan->it != close) {
+            brooks_status_e status = brooks_status_ok;
+            if (!object) {
+                status = token_value(scan, NULL);
+            } else {
+                const char *member = lazy_string_copy(&scan->key, &scan->key_capacity, &scan->it);
+                if (member == NULL || *(scan->it = lazy_skip(scan->it)) != ':') {
+                    return brooks_status_failed;
+                }
+                scan->it = lazy_skip(scan->it + 1);
+                if (!token_emit(scan, brooks_doc_token_key, member, NULL, scan->it, 0, &action)) {
+                    return brooks_status_ok;
+                } else if (action == brooks_doc_scan_skip) {
+                    status = ((scan->it = lazy_skip_value(scan->it, NULL)) != NULL ? brooks_status_ok :
+                                                                                       brooks_status_failed);
+                } else {
+                    status = token_value(scan, member);
+                }
+            }
+            num_elements++;
+
+            if (status != brooks_status_ok || scan->stopped) {
+                return status;
+            } else if (*(scan->it = lazy_skip(scan->it)) == ',') {
+                scan->it = lazy_skip(scan->it + 1);
+            } else if (*scan->it != close) {
+                return brooks_status_failed;
+            }
+        }
+        scan->it++;
+    }
+    token_emit(scan, (object ? brooks_doc_token_object_end : brooks_doc_token_array_end), NULL, &value, begin,
+               num_elements, &action);
+    return brooks_status_ok;
+}
+
+// Passes a token that begins at 'begin' and ends at the scan's position to the handler, and returns false if the
+// scan is to stop
+static bool token_emit(token_scan_t *scan, brooks_doc_token_e kind, const char *key, const brooks_value_t *value,
+                       const char *begin, size_t num_elements, brooks_doc_scan_e *action)
+{
+    brooks_doc_token_t token = {
+        .kind = kind, .key = key, .value = value, .begin = (size_t) (begin - scan->text),
+        .end = (size_t) (scan->it - scan->text), .num_elements = num_elements
+    };
+    *action = scan->handler(scan->capture, &token);
+    scan->stopped = (*action == brooks_doc_scan_stop);
+    return !scan->stopped;
+}
+
+// Decodes the string at 'it' into 'buffer', which grows as needed, and moves 'it' past it; returns NULL for an
+// invalid string
+static const char *lazy_string_copy(char **buffer, size_t *capacity, const char **it)
+{
+    lazy_scan_t scan = { .text = *it, .it = *it };
+    if (**it != '"' || !lazy_scan_string(&scan)) {
+        return NULL;
+    }
+    size_t length = (size_t) (scan.it - *it);
+    if (length + 1 > *capacity) {
+        char *resized = realloc(*buffer, 2 * (length + 1));
+        if (resized == NULL) {
+            return NULL;
+        }
+        *buffer = resized;
+        *capacity = 2 * (length + 1);
+    }
+    char *copy = memcpy(*buffer, *it, length);
+    copy[length] = '\0';
+    *it = scan.it;
+    return lazy_string(&copy);
+}
+
+// Moves past the value at 'it' by matching brackets and quotes only, and counts the properties or elements of an
+// object or array into 'num_elements' unless it is NULL; returns NULL if the text ends within the value
+static const char *lazy_skip_value(const char *it, size_t *num_elements)
+{
+    size_t depth = 0, count = 0;
+    bool element = false;
+    if (*it != '"' && *it != '{' && *it != '[') {
+        // a number or a literal
+        const char *begin = it;
+        while (*it != '\0' && *it != ',' && *it != '}' && *it != ']' && !isspace((unsigned char) *it)) {
+            it++;
+        }
+        return (it > begin ? it : NULL);
+    }
+    do {
+        // an element starts with the first character after the opening bracket or a comma
+        if (element && depth == 1 && *it != ',' && *it != '}' && *it != ']' && !isspace((unsigned char) *it)) {
+            count++;
+            element = false;
+        }
+        if (*it == '"') {
+            for (it++; *it != '"'; it++) {
+                if (*it == '\0' || (*it == '\\' && *++it == '\0')) {
+                    return NULL;
+                }
+            }
+        } else if (*it == '{' || *it == '[') {
+            element = (++depth == 1);
+        } else if (*it == '}' || *it == ']') {
+            depth--;
+        } else if (*it == ',') {
+            element = (depth == 1);
+        } else if (*it == '\0') {
+            return NULL;
+        }
+        it++;
+    } while (depth > 0);
+    if (num_elements != NULL) {
+        *num_elements = count;
+    }
+    return it;
+}
@@ -19,27 +19,42 @@
 // I N C L U D E S
 // ---------------------------------------------------------------------------------------------------------------------
 
+// clock_gettime
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L
+#endif
+
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <brooks/brooks_misc.h>
 
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static size_t set_slot(const brooks_misc_set_t *set, const void *entry);
+
 // ---------------------------------------------------------------------------------------------------------------------
 // I N T E R F A C E   I M P L E M E N T A T I O N
 // ---------------------------------------------------------------------------------------------------------------------
 
 void *brooks_misc_pooled_autoresize(brooks_pool_t *pool, void *base, size_t elem_size, size_t num_entries,
-                                    size_t *capacity, size_t num_add)
+                                    size_t *capacity, size_t num_add, brooks_pool_category_e category)
 {
     size_t new_num_entires = num_entries + num_add;
     if (new_num_entires > *capacity) {
+        brooks_pool_discard(pool, *capacity * elem_size, category);
         while (new_num_entires >= *capacity) {
             *capacity = (*capacity + 1) * 1.7f;
         }
-    }
-    void *result = brooks_pool_malloc(pool, *capacity * elem_size);
-    memcpy(result, base, num_entries * elem_size);
-    return result;
+        void *result = brooks_pool_malloc_tagged(pool, *capacity * elem_size, category);
+        if (num_entries > 0) {
+            memcpy(result, base, num_entries * elem_size);
+        }
+        return result;
+    } else return base;
 }
 
 void *brooks_misc_autoresize(void *base, size_t elem_size, size_t num_entries, size_t *capacity, size_t num_add)
@@ -55,8 +70,86 @@ void *brooks_misc_autoresize(void *base, size_t elem_size, size_t num_entries, s
 
 char *brooks_misc_strdup(brooks_pool_t *pool, const char *str)
 {
-    char *cpy = brooks_pool_malloc(pool, strlen(str) + 1);
+    char *cpy = brooks_pool_malloc_tagged(pool, strlen(str) + 1, brooks_pool_category_string);
     strcpy(cpy, str);
     return cpy;
 }
 
+uint64_t brooks_misc_hash_str(const char *str)
+{
+    // FNV-1a, 64 bit
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    while (*str) {
+        hash ^= (unsigned char) *str++;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+uint64_t brooks_misc_clock_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+brooks_status_e brooks_misc_set_create(brooks_misc_set_t *set)
+{
+    if (set) {
+        set->capacity = 16;
+        set->num_entries = 0;
+        set->slots = calloc(set->capacity, sizeof(void *));
+        return (set->slots != NULL ? brooks_status_ok : brooks_status_malloc_err);
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_misc_set_insert(brooks_misc_set_t *set, const void *entry)
+{
+    if (set && entry) {
+        if ((set->num_entries + 1) * 2 > set->capacity) {
+            brooks_misc_set_t resized = { .capacity = 2 * set->capacity };
+            if ((resized.slots = calloc(resized.capacity, sizeof(void *))) == NULL) {
+                return brooks_status_malloc_err;
+            }
+            for (size_t i = 0; i < set->capacity; i++) {
+                if (set->slots[i] != NULL) {
+                    resized.slots[set_slot(&resized, set->slots[i])] = set->slots[i];
+                    resized.num_entries++;
+                }
+            }
+            free(set->slots);
+            *set = resized;
+        }
+        size_t slot = set_slot(set, entry);
+        set->num_entries += (set->slots[slot] == NULL);
+        set->slots[slot] = entry;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+bool brooks_misc_set_contains(const brooks_misc_set_t *set, const void *entry)
+{
+    return (set && entry && set->slots[set_slot(set, entry)] == entry);
+}
+
+void brooks_misc_set_dispose(brooks_misc_set_t *set)
+{
+    if (set) {
+        free(set->slots);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+// The slot that holds 'entry', or the empty slot it is inserted into; the capacity is a power of two
+static size_t set_slot(const brooks_misc_set_t *set, const void *entry)
+{
+    size_t mask = set->capacity - 1;
+    size_t slot = (size_t) ((((uintptr_t) entry) >> 4) * 0x9e3779b97f4a7c15ULL) & mask;
+    while (set->slots[slot] != NULL && set->slots[slot] != entry) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
@@ -0,0 +1,876 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <brooks/brooks_patch.h>
+#include <brooks/brooks_doc.h>
+#include <brooks/brooks_misc.h>
+#include <brooks/brooks_pool.h>
+#include <brooks/brooks_shape.h>
+
+// ---------------------------------------------------------------------------------------------------------------------
+// C O N S T A N T S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#define PATCH_PROPERTY                       "patch"
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+// The container that holds the value a JSON Pointer addresses, which is the document itself for the pointer ""
+typedef struct patch_target_t
+{
+    brooks_object_t              *object;
+    brooks_array_t               *array;
+    const char                   *key;                        // unescaped last token, NULL for the document
+    size_t                        idx;                        // in 'array', its length for "-"
+    bool                          exists;
+    char                         *text;                       // tokens of the pointer, freed by the caller
+} patch_target_t;
+
+typedef struct patch_diff_t
+{
+    FILE                         *file;
+    size_t                        num_operations;
+    brooks_status_e               status;
+    char                         *path;                       // JSON Pointer of the values compared
+    size_t                        path_length;
+    size_t                        path_capacity;
+    const void                  **hashed;                     // containers whose hash is known, open addressing
+    uint64_t                     *hashes;
+    size_t                        num_hashed;
+    size_t                        hashed_capacity;
+} patch_diff_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static brooks_status_e patch_operation(brooks_object_t *doc, const brooks_object_t *operation);
+static brooks_status_e patch_add(brooks_object_t *doc, const char *path, const brooks_value_t *value);
+static brooks_status_e patch_remove(brooks_object_t *doc, const char *path);
+static brooks_status_e patch_replace(brooks_object_t *doc, const char *path, const brooks_value_t *value);
+static brooks_status_e patch_move(brooks_object_t *doc, const char *from, const char *path);
+static brooks_status_e patch_test(brooks_object_t *doc, const char *path, const brooks_value_t *value);
+static brooks_status_e patch_replace_doc(brooks_object_t *doc, const brooks_value_t *value);
+static brooks_status_e patch_get(const brooks_value_t **value, brooks_object_t *doc, const char *path);
+static const brooks_value_t *patch_member(const brooks_object_t *object, const char *key);
+static brooks_object_t *patch_object(const brooks_value_t *value);
+static bool patch_equal(const brooks_value_t *lhs, const brooks_value_t *rhs);
+static bool patch_equal_object(const brooks_object_t *lhs, const brooks_object_t *rhs);
+static bool patch_equal_number(const brooks_value_t *lhs, const brooks_value_t *rhs);
+static brooks_status_e pointer_resolve(patch_target_t *target, brooks_object_t *doc, const char *pointer);
+static const brooks_value_t *pointer_child(const brooks_object_t *object, const brooks_array_t *array,
+                                           const char *token);
+static bool pointer_unescape(char *token);
+static bool pointer_position(size_t *position, const char *token);
+static void diff_object(patch_diff_t *diff, const brooks_object_t *from, const brooks_object_t *to);
+static void diff_array(patch_diff_t *diff, const brooks_array_t *from, const brooks_array_t *to);
+static void diff_array_by_position(patch_diff_t *diff, const brooks_array_t *from, const brooks_array_t *to,
+                                   size_t begin, size_t num_from, size_t num_to);
+static bool diff_array_by_edits(patch_diff_t *diff, const brooks_array_t *from, const brooks_array_t *to,
+                                size_t begin, size_t num_from, size_t num_to);
+static void diff_value(patch_diff_t *diff, const brooks_value_t *from, const brooks_value_t *to);
+static bool diff_array_compatible(const brooks_array_t *from, const brooks_array_t *to);
+static bool diff_equal(patch_diff_t *diff, const brooks_value_t *lhs, const brooks_value_t *rhs);
+static uint64_t diff_hash(patch_diff_t *diff, const brooks_value_t *value);
+static bool diff_hash_find(size_t *slot, const patch_diff_t *diff, const void *container);
+static bool diff_hash_insert(patch_diff_t *diff, const void *container, uint64_t hash);
+static void diff_emit(patch_diff_t *diff, const char *operation, const brooks_value_t *value);
+static size_t diff_push_key(patch_diff_t *diff, const char *key);
+static size_t diff_push_position(patch_diff_t *diff, size_t position);
+static bool diff_path_reserve(patch_diff_t *diff, size_t length);
+static const brooks_value_t *array_get(const brooks_array_t *array, size_t idx);
+static uint64_t hash_mix(uint64_t hash);
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e brooks_patch_parse(brooks_array_t **patch, brooks_pool_t *pool, const char *text)
+{
+    if (patch && pool && text) {
+        // documents are objects, hence the operations are parsed as a property of one
+        size_t length = strlen(text) + sizeof(PATCH_PROPERTY) + 8;
+        char *wrapped = malloc(length);
+        const brooks_value_t *value;
+        brooks_object_t *doc;
+        brooks_type_e type;
+        if (wrapped == NULL) {
+            return brooks_status_malloc_err;
+        }
+        snprintf(wrapped, length, "{ \"%s\": %s }", PATCH_PROPERTY, text);
+        brooks_status_e status = brooks_doc_parse(&doc, pool, wrapped);
+        free(wrapped);
+        if (status != brooks_status_ok) {
+            return status;
+        } else if ((value = patch_member(doc, PATCH_PROPERTY)) == NULL ||
+                   brooks_doc_value_get_type(&type, value) != brooks_status_ok || type != brooks_type_array ||
+                   (brooks_doc_array_get_length(brooks_doc_value_as_array(value)) > 0 &&
+                    brooks_doc_array_get_type(brooks_doc_value_as_array(value)) != brooks_type_object)) {
+            return brooks_status_illegalarg;
+        }
+        *patch = brooks_doc_value_as_array(value);
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_patch_apply(brooks_object_t *doc, const brooks_array_t *patch)
+{
+    if (doc && patch) {
+        brooks_status_e status = brooks_status_ok;
+        if (brooks_doc_array_get_length(patch) > 0 && brooks_doc_array_get_type(patch) != brooks_type_object) {
+            return brooks_status_illegalarg;
+        }
+        for (size_t i = 0; status == brooks_status_ok && i < brooks_doc_array_get_length(patch); i++) {
+            status = patch_operation(doc, brooks_doc_value_as_object(array_get(patch, i)));
+        }
+        return status;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_patch_merge(brooks_object_t *doc, const brooks_object_t *patch)
+{
+    if (doc && patch) {
+        brooks_status_e status = brooks_status_ok;
+        for (size_t i = 0; status == brooks_status_ok && i < brooks_doc_object_num_elements(patch); i++) {
+            const char *key = brooks_doc_object_get_key(patch, i);
+            const brooks_value_t *value = brooks_doc_object_get_value(patch, i), *target;
+            brooks_type_e type, target_type;
+            brooks_doc_value_get_type(&type, value);
+
+            if (type == brooks_type_null) {
+                while ((status = brooks_doc_object_remove(doc, key)) == brooks_status_true)
+                    ;
+                status = (status == brooks_status_false ? brooks_status_ok : status);
+            } else if (type == brooks_type_object) {
+                // a property that is no object is replaced by an empty one, which the patch is merged into
+                if ((target = patch_member(doc, key)) == NULL ||
+                    brooks_doc_value_get_type(&target_type, target) != brooks_status_ok ||
+                    target_type != brooks_type_object) {
+                    status = brooks_doc_object_set(doc, key, brooks_type_object, NULL);
+                    target = patch_member(doc, key);
+                }
+                if (status == brooks_status_ok) {
+                    status = brooks_patch_merge(patch_object(target), brooks_doc_value_as_object(value));
+                }
+            } else {
+                status = brooks_doc_object_set_value(doc, key, value);
+            }
+        }
+        return status;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_patch_diff(size_t *num_operations, FILE *file, const brooks_object_t *from,
+                                  const brooks_object_t *to)
+{
+    if (num_operations && file && from && to) {
+        patch_diff_t diff = { .file = file, .status = brooks_status_ok };
+        fprintf(file, "[ ");
+        if (diff_path_reserve(&diff, 0)) {
+            diff_object(&diff, from, to);
+        }
+        fprintf(file, "%s]", (diff.num_operations > 0 ? " " : ""));
+        free(diff.path);
+        free(diff.hashed);
+        free(diff.hashes);
+        *num_operations = diff.num_operations;
+        return diff.status;
+    } else return brooks_status_nullptr;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static brooks_status_e patch_operation(brooks_object_t *doc, const brooks_object_t *operation)
+{
+    const brooks_value_t *name = patch_member(operation, "op"), *path = patch_member(operation, "path");
+    const brooks_value_t *from = patch_member(operation, "from"), *value = patch_member(operation, "value");
+    brooks_type_e type;
+    const char *op, *from_path = NULL;
+
+    if (name == NULL || brooks_doc_value_get_type(&type, name) != brooks_status_ok || type != brooks_type_string ||
+        path == NULL || brooks_doc_value_get_type(&type, path) != brooks_status_ok || type != brooks_type_string) {
+        return brooks_status_illegalarg;
+    } else if (from != NULL) {
+        if (brooks_doc_value_get_type(&type, from) != brooks_status_ok || type != brooks_type_string) {
+            return brooks_status_illegalarg;
+        }
+        from_path = brooks_doc_value_as_string(from);
+    }
+    op = brooks_doc_value_as_string(name);
+
+    if (!strcmp(op, "add") && value != NULL) {
+        return patch_add(doc, brooks_doc_value_as_string(path), value);
+    } else if (!strcmp(op, "remove")) {
+        return patch_remove(doc, brooks_doc_value_as_string(path));
+    } else if (!strcmp(op, "replace") && value != NULL) {
+        return patch_replace(doc, brooks_doc_value_as_string(path), value);
+    } else if (!strcmp(op, "move") && from_path != NULL) {
+        return patch_move(doc, from_path, brooks_doc_value_as_string(path));
+    } else if (!strcmp(op, "copy") && from_path != NULL && *brooks_doc_value_as_string(path) != '\0') {
+        brooks_status_e status = patch_get(&value, doc, from_path);
+        return (status == brooks_status_ok ? patch_add(doc, brooks_doc_value_as_string(path), value) : status);
+    } else if (!strcmp(op, "test") && value != NULL) {
+        return patch_test(doc, brooks_doc_value_as_string(path), value);
+    } else return brooks_status_illegalarg;
+}
+
+static brooks_status_e patch_add(brooks_object_t *doc, const char *path, const brooks_value_t *value)
+{
+    patch_target_t target;
+    brooks_status_e status = pointer_resolve(&target, doc, path);
+    if (status == brooks_status_ok) {
+        if (target.key == NULL) {
+            status = patch_replace_doc(doc, value);
+        } else if (target.object != NULL) {
+            status = brooks_doc_object_set_value(target.object, target.key, value);
+        } else {
+            status = (target.idx <= brooks_doc_array_get_length(target.array) ?
+                      brooks_doc_array_insert_value(target.array, target.idx, value) : brooks_status_false);
+        }
+    }
+    free(target.text);
+    return status;
+}
+
+static brooks_status_e patch_remove(brooks_object_t *doc, const char *path)
+{
+    patch_target_t target;
+    brooks_status_e status = pointer_resolve(&target, doc, path);
+    if (status == brooks_status_ok) {
+        if (target.key == NULL) {
+            status = brooks_status_illegalarg;
+        } else if (target.object != NULL) {
+            status = brooks_doc_object_remove(target.object, target.key);
+        } else {
+            status = (target.exists ? brooks_doc_array_remove(target.array, target.idx) : brooks_status_false);
+        }
+    }
+    free(target.text);
+    return (status == brooks_status_true ? brooks_status_ok : status);
+}
+
+static brooks_status_e patch_replace(brooks_object_t *doc, const char *path, const brooks_value_t *value)
+{
+    patch_target_t target;
+    brooks_status_e status = pointer_resolve(&target, doc, path);
+    if (status == brooks_status_ok) {
+        if (target.key == NULL) {
+            status = patch_replace_doc(doc, value);
+        } else if (!target.exists) {
+            status = brooks_status_false;
+        } else if (target.object != NULL) {
+            status = brooks_doc_object_set_value(target.object, target.key, value);
+        } else if ((status = brooks_doc_array_insert_value(target.array, target.idx + 1, value)) ==
+                   brooks_status_ok) {
+            status = brooks_doc_array_remove(target.array, target.idx);
+        }
+    }
+    free(target.text);
+    return status;
+}
+
+static brooks_status_e patch_move(brooks_object_t *doc, const char *from, const char *path)
+{
+    size_t length = strlen(from);
+    if (!strcmp(from, path)) {
+        return brooks_status_ok;
+    } else if (*path == '\0' || (!strncmp(from, path, length) && path[length] == '/')) {
+        return brooks_status_illegalarg;
+    }
+
+    // the value is kept in a document of its own while it is removed, since 'path' is resolved after the removal
+    const brooks_value_t *value;
+    brooks_object_t *scratch;
+    brooks_pool_t *pool;
+    brooks_status_e status = patch_get(&value, doc, from);
+    if (status != brooks_status_ok) {
+        return status;
+    } else if ((status = brooks_pool_create(&pool)) != brooks_status_ok) {
+        return status;
+    }
+    if ((status = brooks_doc_create(&scratch, pool)) == brooks_status_ok &&
+        (status = brooks_doc_object_set_value(scratch, PATCH_PROPERTY, value)) == brooks_status_ok &&
+        (status = patch_remove(doc, from)) == brooks_status_ok) {
+        status = patch_add(doc, path, patch_member(scratch, PATCH_PROPERTY));
+    }
+    brooks_pool_dispose(pool);
+    return status;
+}
+
+static brooks_status_e patch_test(brooks_object_t *doc, const char *path, const brooks_value_t *value)
+{
+    const brooks_value_t *actual;
+    brooks_type_e type;
+    brooks_status_e status;
+    if (*path == '\0') {
+        brooks_doc_value_get_type(&type, value);
+        return (type == brooks_type_object && patch_equal_object(doc, brooks_doc_value_as_object(value)) ?
+                brooks_status_ok : brooks_status_false);
+    } else if ((status = patch_get(&actual, doc, path)) != brooks_status_ok) {
+        return status;
+    } else return (patch_equal(actual, value) ? brooks_status_ok : brooks_status_false);
+}
+
+static brooks_status_e patch_replace_doc(brooks_object_t *doc, const brooks_value_t *value)
+{
+    const brooks_object_t *object;
+    brooks_type_e type;
+    brooks_status_e status = brooks_status_ok;
+    brooks_doc_value_get_type(&type, value);
+    if (type != brooks_type_object) {
+        return brooks_status_illegalarg;
+    }
+    object = brooks_doc_value_as_object(value);
+    for (size_t n = brooks_doc_object_num_elements(doc); status == brooks_status_true && n > 0; n--) {
+        status = brooks_doc_object_remove(doc, brooks_doc_object_get_key(doc, n - 1));
+    }
+    for (size_t i = 0; status == brooks_status_ok && i < brooks_doc_object_num_elements(object); i++) {
+        status = brooks_doc_object_set_value(doc, brooks_doc_object_get_key(object, i),
+                                             brooks_doc_object_get_value(object, i));
+    }
+    return status;
+}
+
+static brooks_status_e patch_get(const brooks_value_t **value, brooks_object_t *doc, const char *path)
+{
+    patch_target_t target;
+    brooks_status_e status = pointer_resolve(&target, doc, path);
+    if (status == brooks_status_ok) {
+        if (target.key == NULL) {
+            status = brooks_status_illegalarg;
+        } else if (!target.exists) {
+            status = brooks_status_false;
+        } else {
+            *value = pointer_child(target.object, target.array, target.key);
+        }
+    }
+    free(target.text);
+    return status;
+}
+
+// The first property named 'key', or NULL
+static const brooks_value_t *patch_member(const brooks_object_t *object, const char *key)
+{
+    size_t idx;
+    return (brooks_shape_lookup(&idx, brooks_doc_object_get_shape(object), key) == brooks_status_true ?
+            brooks_doc_object_get_value(object, idx) : NULL);
+}
+
+// The object of 'value' for changes; values are const to protect versions (see brooks_doc_history_t), whereas the
+// documents a patch is applied to belong to the caller
+static brooks_object_t *patch_object(const brooks_value_t *value)
+{
+    return (brooks_object_t *) brooks_doc_value_as_object(value);
+}
+
+static bool patch_equal(const brooks_value_t *lhs, const brooks_value_t *rhs)
+{
+    brooks_type_e lhs_type, rhs_type;
+    brooks_doc_value_get_type(&lhs_type, lhs);
+    brooks_doc_value_get_type(&rhs_type, rhs);
+    if (lhs == rhs) {
+        return true;
+    } else if (lhs_type != rhs_type) {
+        return patch_equal_number(lhs, rhs);
+    }
+    switch (lhs_type) {
+        case brooks_type_object:
+            return patch_equal_object(brooks_doc_value_as_object(lhs), brooks_doc_value_as_object(rhs));
+        case brooks_type_array: {
+            const brooks_array_t *lhs_array = brooks_doc_value_as_array(lhs);
+            const brooks_array_t *rhs_array = brooks_doc_value_as_array(rhs);
+            size_t length = brooks_doc_array_get_length(lhs_array);
+            if (length != brooks_doc_array_get_length(rhs_array)) {
+                return false;
+            }
+            for (size_t i = 0; i < length; i++) {
+                if (!patch_equal(array_get(lhs_array, i), array_get(rhs_array, i))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case brooks_type_string:
+            return !strcmp(brooks_doc_value_as_string(lhs), brooks_doc_value_as_string(rhs));
+        case brooks_type_boolean:
+            return brooks_doc_value_as_boolean(lhs) == brooks_doc_value_as_boolean(rhs);
+        case brooks_type_null:
+            return true;
+        default:
+            return patch_equal_number(lhs, rhs);
+    }
+}
+
+static bool patch_equal_object(const brooks_object_t *lhs, const brooks_object_t *rhs)
+{
+    size_t num_entries = brooks_doc_object_num_elements(lhs);
+    if (num_entries != brooks_doc_object_num_elements(rhs)) {
+        return false;
+    }
+    for (size_t i = 0; i < num_entries; i++) {
+        const brooks_value_t *value = patch_member(rhs, brooks_doc_object_get_key(lhs, i));
+        if (value == NULL || !patch_equal(brooks_doc_object_get_value(lhs, i), value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Numbers are equal by value, regardless of whether they were written as integers or decimals
+static bool patch_equal_number(const brooks_value_t *lhs, const brooks_value_t *rhs)
+{
+    brooks_type_e lhs_type, rhs_type;
+    brooks_doc_value_get_type(&lhs_type, lhs);
+    brooks_doc_value_get_type(&rhs_type, rhs);
+    if (lhs_type == brooks_type_number_integer && rhs_type == brooks_type_number_integer) {
+        return brooks_doc_value_as_integer(lhs) == brooks_doc_value_as_integer(rhs);
+    } else if ((lhs_type != brooks_type_number_integer && lhs_type != brooks_type_number_double) ||
+               (rhs_type != brooks_type_number_integer && rhs_type != brooks_type_number_double)) {
+        return false;
+    }
+    double lhs_decimal = (lhs_type == brooks_type_number_double ? brooks_doc_value_as_double(lhs) :
+                          (double) (int64_t) brooks_doc_value_as_integer(lhs));
+    double rhs_decimal = (rhs_type == brooks_type_number_double ? brooks_doc_value_as_double(rhs) :
+                          (double) (int64_t) brooks_doc_value_as_integer(rhs));
+    return lhs_decimal == rhs_decimal;
+}
+
+static brooks_status_e pointer_resolve(patch_target_t *target, brooks_object_t *doc, const char *pointer)
+{
+    *target = (patch_target_t) { .object = doc };
+    if (*pointer == '\0') {
+        return brooks_status_ok;
+    } else if (*pointer != '/' || (target->text = malloc(strlen(pointer) + 1)) == NULL) {
+        return (*pointer != '/' ? brooks_status_illegalarg : brooks_status_malloc_err);
+    }
+    char *token = strcpy(target->text, pointer) + 1, *next;
+    for (; (next = strchr(token, '/')) != NULL; token = next + 1) {
+        const brooks_value_t *value;
+        brooks_type_e type;
+        *next = '\0';
+        if (!pointer_unescape(token)) {
+            return brooks_status_illegalarg;
+        } else if ((value = pointer_child(target->object, target->array, token)) == NULL) {
+            return brooks_status_false;
+        }
+        brooks_doc_value_get_type(&type, value);
+        if (type == brooks_type_object) {
+            target->object = patch_object(value);
+            target->array = NULL;
+        } else if (type == brooks_type_array) {
+            target->object = NULL;
+            target->array = brooks_doc_value_as_array(value);
+        } else return brooks_status_false;
+    }
+    if (!pointer_unescape(token)) {
+        return brooks_status_illegalarg;
+    }
+    target->key = token;
+    if (target->object != NULL) {
+        target->exists = (patch_member(target->object, token) != NULL);
+    } else if (!strcmp(token, "-")) {
+        target->idx = brooks_doc_array_get_length(target->array);
+    } else if (pointer_position(&target->idx, token)) {
+        target->exists = (target->idx < brooks_doc_array_get_length(target->array));
+    } else return brooks_status_false;
+    return brooks_status_ok;
+}
+
+static const brooks_value_t *pointer_child(const brooks_object_t *object, const brooks_array_t *array,
+                                           const char *token)
+{
+    size_t idx;
+    if (object != NULL) {
+        return patch_member(object, token);
+    } else return (pointer_position(&idx, token) && idx < brooks_doc_array_get_length(array) ?
+                   array_get(array, idx) : NULL);
+}
+
+// Replaces "~1" by '/' and "~0" by '~' in place
+static bool pointer_unescape(char *token)
+{
+    char *write = token;
+    for (const char *read = token; *read; read++) {
+        if (*read == '~') {
+            if (read[1] != '0' && read[1] != '1') {
+                return false;
+            }
+            *write++ = (*++read == '0' ? '~' : '/');
+        } else *write++ = *read;
+    }
+    *write = '\0';
+    return true;
+}
+
+static bool pointer_position(size_t *position, const char *token)
+{
+    if (*token == '\0' || (*token == '0' && token[1] != '\0')) {
+        return false;
+    }
+    *position = 0;
+    for (; *token; token++) {
+        if (*token < '0' || *token > '9') {
+            return false;
+        }
+        *position = *position * 10 + (size_t) (*token - '0');
+    }
+    return true;
+}
+
+static void diff_object(patch_diff_t *diff, const brooks_object_t *from, const brooks_object_t *to)
+{
+    size_t idx;
+    for (size_t i = 0; i < brooks_doc_object_num_elements(from); i++) {
+        const char *key = brooks_doc_object_get_key(from, i);
+        if (brooks_shape_lookup(&idx, brooks_doc_object_get_shape(from), key) == brooks_status_true && idx == i &&
+            patch_member(to, key) == NULL) {
+            size_t length = diff_push_key(diff, key);
+            diff_emit(diff, "remove", NULL);
+            diff->path_length = length;
+        }
+    }
+    for (size_t i = 0; i < brooks_doc_object_num_elements(to); i++) {
+        const char *key = brooks_doc_object_get_key(to, i);
+        const brooks_value_t *value = brooks_doc_object_get_value(to, i), *previous;
+        if (brooks_shape_lookup(&idx, brooks_doc_object_get_shape(to), key) == brooks_status_true && idx == i) {
+            size_t length = diff_push_key(diff, key);
+            if ((previous = patch_member(from, key)) == NULL) {
+                diff_emit(diff, "add", value);
+            } else diff_value(diff, previous, value);
+            diff->path_length = length;
+        }
+    }
+}
+
+static void diff_array(patch_diff_t *diff, const brooks_array_t *from, const brooks_array_t *to)
+{
+    size_t num_from = brooks_doc_array_get_length(from), num_to = brooks_doc_array_get_length(to);
+    size_t begin = 0, num_suffix = 0;
+    while (begin < num_from && begin < num_to && diff_equal(diff, array_get(from, begin), array_get(to, begin))) {
+        begin++;
+    }
+    while (num_suffix < num_from - begin && num_suffix < num_to - begin &&
+           diff_equal(diff, array_get(from, num_from - 1 - num_suffix), array_get(to, num_to - 1 - num_suffix))) {
+        num_suffix++;
+    }
+    num_from -= begin + num_suffix;
+    num_to -= begin + num_suffix;
+    if (num_from > 0 || num_to > 0) {
+        if (!diff_array_by_edits(diff, from, to, begin, num_from, num_to)) {
+            diff_array_by_position(diff, from, to, begin, num_from, num_to);
+        }
+    }
+}
+
+// Compares the elements in [begin, begin + num) pairwise, and removes or adds the ones that are left
+static void diff_array_by_position(patch_diff_t *diff, const brooks_array_t *from, const brooks_array_t *to,
+                                   size_t begin, size_t num_from, size_t num_to)
+{
+    size_t length;
+    for (size_t i = 0; i < num_from && i < num_to; i++) {
+        length = diff_push_position(diff, begin + i);
+        diff_value(diff, array_get(from, begin + i), array_get(to, begin + i));
+        diff->path_length = length;
+    }
+    for (size_t i = num_from; i > num_to; i--) {
+        length = diff_push_position(diff, begin + i - 1);
+        diff_emit(diff, "remove", NULL);
+        diff->path_length = length;
+    }
+    for (size_t i = num_from; i < num_to; i++) {
+        length = diff_push_position(diff, begin + i);
+        diff_emit(diff, "add", array_get(to, begin + i));
+        diff->path_length = length;
+    }
+}
+
+// Emits a shortest edit script, walking back from the end of both ranges such that the positions of the elements
+// before the current one are those of 'from'
+static bool diff_array_by_edits(patch_diff_t *diff, const brooks_array_t *from, const brooks_array_t *to,
+                                size_t begin, size_t num_from, size_t num_to)
+{
+    size_t width = num_to + 1, length;
+    uint32_t *distances;
+    if ((num_from + 1) > BROOKS_PATCH_DIFF_MAX_CELLS / width ||
+        (distances = malloc((num_from + 1) * width * sizeof(uint32_t))) == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i <= num_from; i++) {
+        for (size_t j = 0; j <= num_to; j++) {
+            if (i == 0 || j == 0) {
+                distances[i * width + j] = (uint32_t) (i + j);
+            } else {
+                uint32_t replace = distances[(i - 1) * width + j - 1] +
+                                   !diff_equal(diff, array_get(from, begin + i - 1), array_get(to, begin + j - 1));
+                uint32_t remove = distances[(i - 1) * width + j] + 1, add = distances[i * width + j - 1] + 1;
+                distances[i * width + j] = (replace < remove ? (replace < add ? replace : add) :
+                                                               (remove < add ? remove : add));
+            }
+        }
+    }
+    for (size_t i = num_from, j = num_to; i > 0 || j > 0; ) {
+        uint32_t distance = distances[i * width + j];
+        if (i > 0 && j > 0 && distance == distances[(i - 1) * width + j - 1] +
+                              !diff_equal(diff, array_get(from, begin + i - 1), array_get(to, begin + j - 1))) {
+            length = diff_push_position(diff, begin + i - 1);
+            diff_value(diff, array_get(from, begin + i - 1), array_get(to, begin + j - 1));
+            i--, j--;
+        } else if (i > 0 && distance == distances[(i - 1) * width + j] + 1) {
+            length = diff_push_position(diff, begin + i - 1);
+            diff_emit(diff, "remove", NULL);
+            i--;
+        } else {
+            length = diff_push_position(diff, begin + i);
+            diff_emit(diff, "add", array_get(to, begin + j - 1));
+            j--;
+        }
+        diff->path_length = length;
+    }
+    free(distances);
+    return true;
+}
+
+static void diff_value(patch_diff_t *diff, const brooks_value_t *from, const brooks_value_t *to)
+{
+    brooks_type_e from_type, to_type;
+    brooks_doc_value_get_type(&from_type, from);
+    brooks_doc_value_get_type(&to_type, to);
+    if (diff_equal(diff, from, to)) {
+        return;
+    } else if (from_type == brooks_type_object && to_type == brooks_type_object) {
+        diff_object(diff, brooks_doc_value_as_object(from), brooks_doc_value_as_object(to));
+    } else if (from_type == brooks_type_array && to_type == brooks_type_array &&
+               diff_array_compatible(brooks_doc_value_as_array(from), brooks_doc_value_as_array(to))) {
+        diff_array(diff, brooks_doc_value_as_array(from), brooks_doc_value_as_array(to));
+    } else {
+        diff_emit(diff, "replace", to);
+    }
+}
+
+// Arrays are typed, such that elements of 'to' fit into 'from' only if both have the same type, or 'from' is empty
+// and has none yet; other arrays are replaced as a whole
+static bool diff_array_compatible(const brooks_array_t *from, const brooks_array_t *to)
+{
+    return (brooks_doc_array_get_type(from) == brooks_doc_array_get_type(to) ||
+            (brooks_doc_array_get_length(from) == 0 && brooks_doc_array_get_type(from) == brooks_type_null));
+}
+
+// Scalars are compared, containers by address and then by the hash of their content
+static bool diff_equal(patch_diff_t *diff, const brooks_value_t *lhs, const brooks_value_t *rhs)
+{
+    brooks_type_e lhs_type, rhs_type;
+    brooks_doc_value_get_type(&lhs_type, lhs);
+    brooks_doc_value_get_type(&rhs_type, rhs);
+    if (lhs_type == brooks_type_object && rhs_type == brooks_type_object) {
+        return brooks_doc_value_as_object(lhs) == brooks_doc_value_as_object(rhs) ||
+               diff_hash(diff, lhs) == diff_hash(diff, rhs);
+    } else if (lhs_type == brooks_type_array && rhs_type == brooks_type_array) {
+        return brooks_doc_value_as_array(lhs) == brooks_doc_value_as_array(rhs) ||
+               diff_hash(diff, lhs) == diff_hash(diff, rhs);
+    } else if (lhs_type == brooks_type_object || lhs_type == brooks_type_array ||
+               rhs_type == brooks_type_object || rhs_type == brooks_type_array) {
+        return false;
+    } else return patch_equal(lhs, rhs);
+}
+
+// A hash that is equal for values that are equal in the sense of patch_equal; objects add up the hashes of their
+// properties, such that the order of keys does not matter
+static uint64_t diff_hash(patch_diff_t *diff, const brooks_value_t *value)
+{
+    const void *container = NULL;
+    uint64_t hash;
+    double decimal;
+    size_t slot;
+    brooks_type_e type;
+    brooks_doc_value_get_type(&type, value);
+
+    switch (type) {
+        case brooks_type_object:
+            container = brooks_doc_value_as_object(value);
+            break;
+        case brooks_type_array:
+            container = brooks_doc_value_as_array(value);
+            break;
+        case brooks_type_number_integer:
+            return hash_mix(brooks_doc_value_as_integer(value));
+        case brooks_type_number_double:
+            decimal = brooks_doc_value_as_double(value);
+            if (decimal >= -9223372036854775808.0 && decimal < 9223372036854775808.0 &&
+                decimal == (double) (int64_t) decimal) {
+                return hash_mix((uint64_t) (int64_t) decimal);
+            }
+            memcpy(&hash, &decimal, sizeof(uint64_t));
+            return hash_mix(hash ^ brooks_type_number_double);
+        case brooks_type_string:
+            return hash_mix(brooks_misc_hash_str(brooks_doc_value_as_string(value)) ^ brooks_type_string);
+        case brooks_type_boolean:
+            return hash_mix((uint64_t) brooks_doc_value_as_boolean(value) ^ ((uint64_t) brooks_type_boolean << 32));
+        default:
+            return hash_mix((uint64_t) type << 32);
+    }
+    if (diff_hash_find(&slot, diff, container)) {
+        return diff->hashes[slot];
+    }
+
+    hash = hash_mix((uint64_t) type << 32);
+    if (type == brooks_type_object) {
+        const brooks_object_t *object = container;
+        for (size_t i = 0; i < brooks_doc_object_num_elements(object); i++) {
+            hash += hash_mix(brooks_misc_hash_str(brooks_doc_object_get_key(object, i)) ^
+                             diff_hash(diff, brooks_doc_object_get_value(object, i)));
+        }
+    } else {
+        const brooks_array_t *array = container;
+        for (size_t i = 0; i < brooks_doc_array_get_length(array); i++) {
+            hash = hash_mix(hash ^ diff_hash(diff, array_get(array, i)));
+        }
+    }
+    diff_hash_insert(diff, container, hash);
+    return hash;
+}
+
+// Sets 'slot' to the slot of 'container', or to the free slot where it belongs
+static bool diff_hash_find(size_t *slot, const patch_diff_t *diff, const void *container)
+{
+    if (diff->hashed_capacity == 0) {
+        return false;
+    }
+    size_t mask = diff->hashed_capacity - 1;
+    for (*slot = hash_mix((uint64_t) (uintptr_t) container) & mask; diff->hashed[*slot] != NULL;
+         *slot = (*slot + 1) & mask) {
+        if (diff->hashed[*slot] == container) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool diff_hash_insert(patch_diff_t *diff, const void *container, uint64_t hash)
+{
+    size_t slot;
+    if (2 * (diff->num_hashed + 1) > diff->hashed_capacity) {
+        size_t capacity = (diff->hashed_capacity > 0 ? 2 * diff->hashed_capacity : 64);
+        const void **hashed = calloc(capacity, sizeof(void *));
+        uint64_t *hashes = malloc(capacity * sizeof(uint64_t));
+        if (hashed == NULL || hashes == NULL) {
+            free(hashed);
+            free(hashes);
+            return false;
+        }
+        const void **old_hashed = diff->hashed;
+        uint64_t *old_hashes = diff->hashes;
+        size_t old_capacity = diff->hashed_capacity;
+        diff->hashed = hashed;
+        diff->hashes = hashes;
+        diff->hashed_capacity = capacity;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old_hashed[i] != NULL) {
+                diff_hash_find(&slot, diff, old_hashed[i]);
+                diff->hashed[slot] = old_hashed[i];
+                diff->hashes[slot] = old_hashes[i];
+            }
+        }
+        free(old_hashed);
+        free(old_hashes);
+    }
+    diff_hash_find(&slot, diff, container);
+    diff->hashed[slot] = container;
+    diff->hashes[slot] = hash;
+    diff->num_hashed++;
+    return true;
+}
+
+static void diff_emit(patch_diff_t *diff, const char *operation, const brooks_value_t *value)
+{
+    if (diff->status == brooks_status_ok) {
+        fprintf(diff->file, "%s{ \"op\": \"%s\", \"path\": ", (diff->num_operations > 0 ? ", " : ""), operation);
+        diff->path[diff->path_length] = '\0';
+        brooks_doc_string_print(diff->file, diff->path);
+        if (value != NULL) {
+            fprintf(diff->file, ", \"value\": ");
+            diff->status = brooks_doc_value_print(diff->file, value);
+        }
+        fprintf(diff->file, " }");
+        diff->num_operations++;
+    }
+}
+
+// Appends the escaped token of 'key' to the path, and returns the length of the path before
+static size_t diff_push_key(patch_diff_t *diff, const char *key)
+{
+    size_t length = diff->path_length;
+    if (diff_path_reserve(diff, length + 2 * strlen(key) + 1)) {
+        diff->path[diff->path_length++] = '/';
+        for (; *key; key++) {
+            if (*key == '~' || *key == '/') {
+                diff->path[diff->path_length++] = '~';
+                diff->path[diff->path_length++] = (*key == '~' ? '0' : '1');
+            } else diff->path[diff->path_length++] = *key;
+        }
+    }
+    return length;
+}
+
+static size_t diff_push_position(patch_diff_t *diff, size_t position)
+{
+    size_t length = diff->path_length;
+    if (diff_path_reserve(diff, length + 21)) {
+        diff->path_length += (size_t) sprintf(diff->path + length, "/%zu", position);
+    }
+    return length;
+}
+
+// Makes room for a path of 'length' characters and its terminator
+static bool diff_path_reserve(patch_diff_t *diff, size_t length)
+{
+    if (length + 1 > diff->path_capacity) {
+        size_t capacity = (2 * diff->path_capacity > length + 1 ? 2 * diff->path_capacity : length + 64);
+        char *path = realloc(diff->path, capacity);
+        if (path == NULL) {
+            diff->status = brooks_status_realloc_err;
+            return false;
+        }
+        diff->path = path;
+        diff->path_capacity = capacity;
+    }
+    return true;
+}
+
+static const brooks_value_t *array_get(const brooks_array_t *array, size_t idx)
+{
+    return brooks_doc_unnamed_entry_get_value(brooks_doc_array_begin(array)[idx]);
+}
+
+static uint64_t hash_mix(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    return hash ^ (hash >> 33);
+}
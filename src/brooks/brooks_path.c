@@ -0,0 +1,221 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <string.h>
+
+#include <brooks/brooks_path.h>
+#include <brooks/brooks_doc.h>
+#include <brooks/brooks_misc.h>
+#include <brooks/brooks_shape.h>
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef struct brooks_path_t
+{
+    char                         *text;
+    char                        **components;
+    brooks_shape_cache_t         *caches;                     // one per component, mutable for const paths
+    size_t                        num_components;
+} brooks_path_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void path_visit_object(const brooks_path_t *path, const brooks_object_t *object, size_t idx, bool containers,
+                              void *capture, brooks_path_visitor_t visitor);
+static void path_visit_value(const brooks_path_t *path, const brooks_value_t *value, size_t idx, bool containers,
+                             void *capture, brooks_path_visitor_t visitor);
+static void path_visit_all_object(const brooks_object_t *object, void *capture, brooks_path_visitor_t visitor);
+static void path_visit_all_value(const brooks_value_t *value, void *capture, brooks_path_visitor_t visitor);
+static bool path_component_matches(const char *component, const char *key);
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e brooks_path_create(brooks_path_t **path, brooks_pool_t *pool, const char *text)
+{
+    if (path && pool) {
+        brooks_path_t *result = brooks_pool_malloc(pool, sizeof(brooks_path_t));
+        result->text = brooks_misc_strdup(pool, text ? text : "");
+        result->num_components = 0;
+        result->components = NULL;
+        result->caches = NULL;
+
+        if (*result->text != '\0') {
+            size_t num_components = 1;
+            for (const char *it = result->text; *it; it++) {
+                num_components += (*it == BROOKS_PATH_SEPARATOR);
+            }
+            result->components = brooks_pool_malloc(pool, num_components * sizeof(char *));
+            result->caches = brooks_pool_malloc(pool, num_components * sizeof(brooks_shape_cache_t));
+
+            const char *begin = result->text;
+            for (const char *it = result->text; ; it++) {
+                if (*it == BROOKS_PATH_SEPARATOR || *it == '\0') {
+                    size_t len = (size_t) (it - begin);
+                    if (len == 0) {
+                        return brooks_status_illegalarg;
+                    }
+                    char *component = brooks_pool_malloc(pool, len + 1);
+                    memcpy(component, begin, len);
+                    component[len] = '\0';
+                    brooks_shape_cache_init(result->caches + result->num_components,
+                                            (strcmp(component, BROOKS_PATH_WILDCARD) != 0 ? component : NULL));
+                    result->components[result->num_components++] = component;
+                    begin = it + 1;
+                }
+                if (*it == '\0') {
+                    break;
+                }
+            }
+        }
+
+        *path = result;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_path_visit(const brooks_path_t *path, const brooks_object_t *root, void *capture,
+                                  brooks_path_visitor_t visitor)
+{
+    if (path && root && visitor) {
+        if (path->num_components == 0) {
+            path_visit_all_object(root, capture, visitor);
+        } else {
+            path_visit_object(path, root, 0, false, capture, visitor);
+        }
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_path_visit_matching(const brooks_path_t *path, const brooks_object_t *root, void *capture,
+                                           brooks_path_visitor_t visitor)
+{
+    if (path && root && visitor) {
+        if (path->num_components > 0) {
+            path_visit_object(path, root, 0, true, capture, visitor);
+        }
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+bool brooks_path_matches(const brooks_path_t *path, const char * const *keys, size_t num_keys)
+{
+    if (path && path->num_components == num_keys) {
+        for (size_t i = 0; i < num_keys; i++) {
+            if (!path_component_matches(path->components[i], keys[i])) {
+                return false;
+            }
+        }
+        return true;
+    } else return false;
+}
+
+bool brooks_path_matches_component(const brooks_path_t *path, size_t idx, const char *key)
+{
+    return (path && idx < path->num_components && path_component_matches(path->components[idx], key));
+}
+
+size_t brooks_path_length(const brooks_path_t *path)
+{
+    return (path ? path->num_components : 0);
+}
+
+const char *brooks_path_str(const brooks_path_t *path)
+{
+    return (path ? path->text : NULL);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void path_visit_object(const brooks_path_t *path, const brooks_object_t *object, size_t idx, bool containers,
+                              void *capture, brooks_path_visitor_t visitor)
+{
+    const char *component = path->components[idx];
+    size_t first = 0, last = brooks_doc_object_num_elements(object);
+    bool cached = (path->caches[idx].key != NULL);
+    // objects of the same shape have the key at the same positions, only duplicate keys need to be compared
+    if (cached && brooks_shape_cache_lookup(&first, &last, path->caches + idx,
+                                            brooks_doc_object_get_shape(object)) != brooks_status_true) {
+        return;
+    }
+    for (size_t i = first; i < last + cached; i++) {
+        if ((cached && (i == first || i == last)) || path_component_matches(component,
+                                                                          brooks_doc_object_get_key(object, i))) {
+            path_visit_value(path, brooks_doc_object_get_value(object, i), idx + 1, containers, capture, visitor);
+        }
+    }
+}
+
+static void path_visit_value(const brooks_path_t *path, const brooks_value_t *value, size_t idx, bool containers,
+                             void *capture, brooks_path_visitor_t visitor)
+{
+    brooks_type_e type;
+    brooks_doc_value_get_type(&type, value);
+
+    if (type == brooks_type_array) {
+        if (containers && idx == path->num_components) {
+            visitor(capture, value);
+        }
+        const brooks_array_t *array = brooks_doc_value_as_array(value);
+        for (brooks_unnamed_entry_t **it = brooks_doc_array_begin(array); it < brooks_doc_array_end(array); it++) {
+            path_visit_value(path, brooks_doc_unnamed_entry_get_value(*it), idx, containers, capture, visitor);
+        }
+    } else if (idx == path->num_components) {
+        visitor(capture, value);
+    } else if (type == brooks_type_object) {
+        path_visit_object(path, brooks_doc_value_as_object(value), idx, containers, capture, visitor);
+    }
+}
+
+static void path_visit_all_object(const brooks_object_t *object, void *capture, brooks_path_visitor_t visitor)
+{
+    for (size_t i = 0; i < brooks_doc_object_num_elements(object); i++) {
+        path_visit_all_value(brooks_doc_object_get_value(object, i), capture, visitor);
+    }
+}
+
+static void path_visit_all_value(const brooks_value_t *value, void *capture, brooks_path_visitor_t visitor)
+{
+    brooks_type_e type;
+    brooks_doc_value_get_type(&type, value);
+    visitor(capture, value);
+
+    if (type == brooks_type_object) {
+        path_visit_all_object(brooks_doc_value_as_object(value), capture, visitor);
+    } else if (type == brooks_type_array) {
+        const brooks_array_t *array = brooks_doc_value_as_array(value);
+        for (brooks_unnamed_entry_t **it = brooks_doc_array_begin(array); it < brooks_doc_array_end(array); it++) {
+            path_visit_all_value(brooks_doc_unnamed_entry_get_value(*it), capture, visitor);
+        }
+    }
+}
+
+static bool path_component_matches(const char *component, const char *key)
+{
+    return (key != NULL && (strcmp(component, BROOKS_PATH_WILDCARD) == 0 || strcmp(component, key) == 0));
+}
@@ -24,18 +24,43 @@
 #include <brooks/brooks.h>
 #include <brooks/brooks_pool.h>
 #include <brooks/brooks_misc.h>
+#include <brooks/brooks_shape.h>
 
 // ---------------------------------------------------------------------------------------------------------------------
 // T Y P E S
 // ---------------------------------------------------------------------------------------------------------------------
 
+typedef struct pool_free_list_t
+{
+    size_t size;
+    void *head;                                               // the first word of a block links to the next one
+} pool_free_list_t;
+
 typedef struct brooks_pool_t
 {
     void **base;
     size_t num_elements;
     size_t capacity;
+    size_t num_bytes;
+    size_t num_reserved;                                      // blocks only, the block table is added on read
+    size_t peak_reserved;
+    size_t category_bytes[brooks_pool_category_count];
+    size_t category_allocations[brooks_pool_category_count];
+    pool_free_list_t free_lists[BROOKS_POOL_FREE_LISTS];
+    size_t num_free_lists;
+    size_t bytes_recycled;
+    size_t num_reused;
+    brooks_shape_registry_t *shapes;
 } brooks_pool_t;
 
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static size_t pool_chunk_size(size_t size);
+static size_t pool_reserved(const brooks_pool_t *pool);
+static void *pool_reuse(brooks_pool_t *pool, size_t size, brooks_pool_category_e category);
+
 // ---------------------------------------------------------------------------------------------------------------------
 // I N T E R F A C E   I M P L E M E N T A T I O N
 // ---------------------------------------------------------------------------------------------------------------------
@@ -43,10 +68,11 @@ typedef struct brooks_pool_t
 brooks_status_e brooks_pool_create(brooks_pool_t **pool)
 {
     brooks_pool_t *retval;
-    if ((retval = malloc(sizeof(brooks_pool_t))) != NULL) {
+    if ((retval = calloc(1, sizeof(brooks_pool_t))) != NULL) {
         retval->capacity = BROOKS_POOL_CAPACITY;
         retval->base = malloc(retval->capacity * sizeof(void *));
         retval->num_elements = 0;
+        retval->peak_reserved = pool_reserved(retval);
         *pool = retval;
         return ((retval->base != NULL) ? brooks_status_ok : brooks_status_malloc_err);
     }
@@ -67,8 +93,173 @@ brooks_status_e brooks_pool_dispose(brooks_pool_t *pool)
 
 void *brooks_pool_malloc(brooks_pool_t *pool, size_t size)
 {
-    void *retval = malloc(size);
+    return brooks_pool_malloc_tagged(pool, size, brooks_pool_category_other);
+}
+
+void *brooks_pool_malloc_tagged(brooks_pool_t *pool, size_t size, brooks_pool_category_e category)
+{
+    void *retval;
+    if (pool->bytes_recycled > 0 && (retval = pool_reuse(pool, size, category)) != NULL) {
+        return retval;
+    }
+    retval = malloc(size);
     pool->base = brooks_misc_autoresize(pool->base, sizeof(void *), pool->num_elements, &pool->capacity, 1);
     pool->base[pool->num_elements++] = retval;
+    pool->num_bytes += size;
+    pool->num_reserved += pool_chunk_size(size);
+    pool->category_bytes[category] += size;
+    pool->category_allocations[category]++;
+
+    size_t reserved = pool_reserved(pool);
+    pool->peak_reserved = (reserved > pool->peak_reserved ? reserved : pool->peak_reserved);
+    return retval;
+}
+
+void *brooks_pool_malloc_layout(brooks_pool_t *pool, const brooks_pool_layout_t *layout)
+{
+    void *retval = NULL;
+    if (pool && layout && (retval = brooks_pool_malloc_tagged(pool, layout->num_bytes,
+                                                              brooks_pool_category_other)) != NULL) {
+        size_t padding = layout->num_bytes;
+        pool->category_bytes[brooks_pool_category_other] -= layout->num_bytes;
+        pool->category_allocations[brooks_pool_category_other]--;
+        for (size_t i = 0; i < brooks_pool_category_count; i++) {
+            pool->category_bytes[i] += layout->category_bytes[i];
+            pool->category_allocations[i] += layout->category_allocations[i];
+            padding -= layout->category_bytes[i];
+        }
+        pool->category_bytes[brooks_pool_category_other] += padding;
+    }
     return retval;
-}
\ No newline at end of file
+}
+
+void brooks_pool_discard(brooks_pool_t *pool, size_t size, brooks_pool_category_e category)
+{
+    if (pool && size > 0 && size <= pool->category_bytes[category] && pool->category_allocations[category] > 0) {
+        pool->category_bytes[category] -= size;
+        pool->category_allocations[category]--;
+        pool->category_bytes[brooks_pool_category_garbage] += size;
+        pool->category_allocations[brooks_pool_category_garbage]++;
+    }
+}
+
+void brooks_pool_recycle(brooks_pool_t *pool, void *block, size_t size, brooks_pool_category_e category)
+{
+    if (pool && block && size > 0) {
+        brooks_pool_discard(pool, size, category);
+        pool_free_list_t *list = pool->free_lists;
+        while (list < pool->free_lists + pool->num_free_lists && list->size != size) {
+            list++;
+        }
+        if (size < sizeof(void *) || list == pool->free_lists + BROOKS_POOL_FREE_LISTS) {
+            return;
+        } else if (list == pool->free_lists + pool->num_free_lists) {
+            *list = (pool_free_list_t) { .size = size, .head = NULL };
+            pool->num_free_lists++;
+        }
+        *(void **) block = list->head;
+        list->head = block;
+        pool->bytes_recycled += size;
+    }
+}
+
+size_t brooks_pool_num_bytes(const brooks_pool_t *pool)
+{
+    return (pool ? pool->num_bytes : 0);
+}
+
+brooks_status_e brooks_pool_get_stats(brooks_pool_stats_t *stats, const brooks_pool_t *pool)
+{
+    if (stats && pool) {
+        stats->num_allocations = pool->num_elements;
+        stats->bytes_requested = pool->num_bytes;
+        stats->bytes_reserved = pool_reserved(pool);
+        stats->bytes_live = pool->num_bytes - pool->category_bytes[brooks_pool_category_garbage];
+        stats->peak_reserved = pool->peak_reserved;
+        stats->bytes_recycled = pool->bytes_recycled;
+        stats->num_reused = pool->num_reused;
+        stats->fragmentation = (stats->bytes_reserved > 0 ?
+                                1.0 - (double) stats->bytes_live / stats->bytes_reserved : 0);
+        for (size_t i = 0; i < brooks_pool_category_count; i++) {
+            stats->category_bytes[i] = pool->category_bytes[i];
+            stats->category_allocations[i] = pool->category_allocations[i];
+        }
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_pool_print_stats(FILE *file, const brooks_pool_t *pool)
+{
+    brooks_pool_stats_t stats;
+    if (file && brooks_pool_get_stats(&stats, pool) == brooks_status_ok) {
+        fprintf(file, "allocations: %zu, requested: %zu bytes, reserved: %zu bytes, live: %zu bytes, peak: %zu bytes, "
+                      "recycled: %zu bytes, reused: %zu blocks, fragmentation: %.2f%%\n", stats.num_allocations,
+                stats.bytes_requested, stats.bytes_reserved, stats.bytes_live, stats.peak_reserved,
+                stats.bytes_recycled, stats.num_reused, stats.fragmentation * 100);
+        for (size_t i = 0; i < brooks_pool_category_count; i++) {
+            if (stats.category_allocations[i] > 0) {
+                fprintf(file, "  %-8s %12zu bytes in %zu blocks\n", brooks_pool_category_str(i),
+                        stats.category_bytes[i], stats.category_allocations[i]);
+            }
+        }
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_shape_registry_t *brooks_pool_get_shapes(brooks_pool_t *pool)
+{
+    if (pool && pool->shapes == NULL) {
+        brooks_shape_registry_create(&pool->shapes, pool);
+    }
+    return (pool ? pool->shapes : NULL);
+}
+
+const char *brooks_pool_category_str(brooks_pool_category_e category)
+{
+    switch (category) {
+        case brooks_pool_category_object:  return "objects";
+        case brooks_pool_category_array:   return "arrays";
+        case brooks_pool_category_entry:   return "entries";
+        case brooks_pool_category_value:   return "values";
+        case brooks_pool_category_string:  return "strings";
+        case brooks_pool_category_cursor:  return "cursors";
+        case brooks_pool_category_shape:   return "shapes";
+        case brooks_pool_category_garbage: return "garbage";
+        default:                           return "other";
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static size_t pool_chunk_size(size_t size)
+{
+    size_t chunk = size + BROOKS_POOL_CHUNK_OVERHEAD;
+    return (chunk + BROOKS_POOL_CHUNK_ALIGNMENT - 1) / BROOKS_POOL_CHUNK_ALIGNMENT * BROOKS_POOL_CHUNK_ALIGNMENT;
+}
+
+static size_t pool_reserved(const brooks_pool_t *pool)
+{
+    return (pool->num_reserved + pool_chunk_size(pool->capacity * sizeof(void *)) +
+            pool_chunk_size(sizeof(brooks_pool_t)));
+}
+
+// Pops a recycled block of 'size' bytes and moves it from garbage to 'category', NULL if there is none
+static void *pool_reuse(brooks_pool_t *pool, size_t size, brooks_pool_category_e category)
+{
+    for (pool_free_list_t *list = pool->free_lists; list < pool->free_lists + pool->num_free_lists; list++) {
+        if (list->size == size && list->head != NULL) {
+            void *block = list->head;
+            list->head = *(void **) block;
+            pool->bytes_recycled -= size;
+            pool->num_reused++;
+            pool->category_bytes[brooks_pool_category_garbage] -= size;
+            pool->category_allocations[brooks_pool_category_garbage]--;
+            pool->category_bytes[category] += size;
+            pool->category_allocations[category]++;
+            return block;
+        }
+    }
+    return NULL;
+}
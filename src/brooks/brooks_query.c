@@ -23,13 +23,12 @@
 #include <brooks/brooks_query.h>
 #include <brooks/brooks_doc.h>
 #include <brooks/brooks_misc.h>
+#include <brooks/brooks_path.h>
+#include <brooks/query/brooks_cursor.h>
+#include <stdlib.h>
 #include <string.h>
-
-// ---------------------------------------------------------------------------------------------------------------------
-// H E L P E R   D E C L A R A T I O N
-// ---------------------------------------------------------------------------------------------------------------------
-
-brooks_result_t *result_create(brooks_pool_t *pool);
+#include <limits.h>
+#include <math.h>
 
 // ---------------------------------------------------------------------------------------------------------------------
 // T Y P E   D E F I N I T I O N
@@ -38,6 +37,10 @@ brooks_result_t *result_create(brooks_pool_t *pool);
 typedef struct brooks_query_t {
     brooks_vector_t                      filters;
     brooks_vector_t                      terminators;
+    brooks_vector_t                      indexes;
+    brooks_vector_t                      inverted_indexes;
+    brooks_stats_t                      *stats;
+    brooks_pool_t                       *pool;
 } brooks_query_t;
 
 typedef struct brooks_result_t
@@ -45,6 +48,38 @@ typedef struct brooks_result_t
     brooks_vector_t                      data;
 } brooks_result_t;
 
+typedef struct value_bound_t
+{
+    bool                                 set;
+    bool                                 inclusive;
+    brooks_index_key_t                   key;
+} value_bound_t;
+
+typedef enum filter_predicate_e
+{
+    filter_predicate_depth, filter_predicate_entry_kind, filter_predicate_value_type, filter_predicate_key_name,
+    filter_predicate_index, filter_predicate_key_path, filter_predicate_num_elements, filter_predicate_value,
+    filter_predicate_range, filter_predicate_str_match, filter_predicate_count
+} filter_predicate_e;
+
+typedef struct predicate_stats_t
+{
+    filter_predicate_e                   kind;
+    double                               num_evaluated;
+    double                               num_passed;
+    double                               num_sampled;
+    double                               sampled_ns;
+} predicate_stats_t;
+
+typedef struct filter_adaptive_t
+{
+    predicate_stats_t                    predicates[filter_predicate_count];
+    size_t                               num_predicates;
+    uint64_t                             num_evaluations;
+    bool                                 enabled;
+    bool                                 dirty;         // predicates were set, the active ones must be collected
+} filter_adaptive_t;
+
 typedef struct brooks_filter_t
 {
     size_t                              min_depth;
@@ -62,8 +97,201 @@ typedef struct brooks_filter_t
     brook_pred_integer_t                pred_array_num_elem_max;
     brook_pred_integer_t                pred_object_num_elem_min;
     brook_pred_integer_t                pred_object_num_elem_max;
+    void                                *capture;
+
+    brooks_path_t                       *key_path;
+    value_bound_t                        lower;
+    value_bound_t                        upper;
+    bool                                 str_match_set;
+    brooks_index_match_e                 str_match;
+    char                                *str_needle;
+    filter_adaptive_t                   *adaptive;      // evaluation state, mutable for const filters
+    brooks_pool_t                       *pool;
 } brooks_filter_t;
 
+typedef enum plan_kind_e
+{
+    plan_kind_traverse, plan_kind_key_path, plan_kind_value_index, plan_kind_inverted_index
+} plan_kind_e;
+
+typedef struct plan_t
+{
+    plan_kind_e                          kind;
+    const brooks_filter_t               *filter;
+    void                                *index;
+    double                               selectivity;
+    double                               num_matches;   // in the collection, 0 without statistics
+} plan_t;
+
+typedef struct ranked_filter_t
+{
+    const brooks_filter_t               *filter;
+    double                               selectivity;
+} ranked_filter_t;
+
+typedef struct candidate_t
+{
+    const brooks_value_t                *value;
+    const char                          *key;           // NULL for array elements
+    uint64_t                             idx;
+    size_t                               depth;
+    bool                                 position_known; // false for index hits; 'idx' and 'depth' are derived
+    const char * const                  *key_chain;     // keys from the root (arrays skipped), NULL for index hits
+    size_t                               chain_length;
+    bool                                 streamed;      // 'value' is a scalar or an object or array without content
+    uint64_t                             num_elements;  // of a streamed object or array
+} candidate_t;
+
+typedef struct traversal_item_t
+{
+    const brooks_value_t                *value;
+    const char                          *key;
+    uint64_t                             idx;
+    size_t                               depth;
+    size_t                               parent;
+} traversal_item_t;
+
+typedef struct value_set_t
+{
+    const brooks_value_t               **slots;
+    size_t                               num_values;
+    size_t                               capacity;
+} value_set_t;
+
+typedef enum prepared_plans_e
+{
+    prepared_plans_document, prepared_plans_collection, prepared_plans_count
+} prepared_plans_e;
+
+typedef struct prepared_plans_t
+{
+    plan_t                              *plans;
+    size_t                               num_traverse;
+    size_t                               max_depth;
+    bool                                 needs_chain;
+} prepared_plans_t;
+
+typedef struct brooks_prepared_t
+{
+    const brooks_query_t                *query;
+    prepared_plans_t                     plans[prepared_plans_count];   // for a single root and for the collection
+    size_t                               num_plans;
+    const brooks_filter_t              **path_filters;
+    size_t                               num_path_filters;
+    value_set_t                          seen;
+    traversal_item_t                    *items;
+    size_t                               items_capacity;
+    size_t                              *stack;
+    size_t                               stack_capacity;
+    const char                         **chain;
+    size_t                               chain_capacity;
+    brooks_cursor_t                     *lookup;
+    brooks_cursor_t                     *output;
+} brooks_prepared_t;
+
+typedef struct key_path_run_t
+{
+    brooks_prepared_t                   *prepared;
+    const brooks_filter_t               *filter;
+    value_set_t                         *seen;
+} key_path_run_t;
+
+typedef struct stream_frame_t
+{
+    size_t                               begin;         // offset of the object or array
+    size_t                               key;           // offset of its key in the run's keys, SIZE_MAX for none
+    uint64_t                             idx;
+    uint64_t                             num_children;  // so far, i.e., the index of the next one
+    size_t                               chain_length;
+    bool                                 object;
+} stream_frame_t;
+
+// A query over a token stream: 'filters' are the terminators followed by the path filters, and 'states' is the
+// automaton of their key paths, i.e., per number of keys from the root, the set of filters whose key path the keys
+// so far match; filters without a key path are in every set
+typedef struct stream_run_t
+{
+    const brooks_filter_t              **filters;
+    size_t                               num_terminators;
+    size_t                               num_filters;
+    size_t                               max_depth;
+    size_t                               max_length;    // of the key paths
+    size_t                               num_words;     // of a set of filters
+    uint64_t                            *states;        // max_length + 2 sets
+    stream_frame_t                      *frames;        // the open objects and arrays
+    size_t                               num_frames;
+    size_t                               frames_capacity;
+    char                                *keys;          // of the open objects and arrays
+    size_t                               keys_size;
+    size_t                               keys_capacity;
+    uint64_t                             idx;           // of the property whose key was read last
+    size_t                               base;          // offset of the text in the input
+    size_t                               document;
+    size_t                               num_matches;
+    void                                *capture;
+    brooks_stream_visitor_t              visitor;
+    bool                                 stopped;
+    brooks_status_e                      status;
+} stream_run_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_result_t *result_create(brooks_pool_t *pool, size_t capacity);
+
+static brooks_status_e vector_push(brooks_vector_t *vector, brooks_pool_t *pool, const void *element);
+static void prepared_emit(brooks_prepared_t *prepared, value_set_t *seen, const brooks_value_t *value);
+static brooks_status_e prepared_create(brooks_prepared_t **prepared, const brooks_query_t *query,
+                                       brooks_pool_t *pool);
+
+static plan_t query_plan(const brooks_query_t *query, const brooks_filter_t *filter, bool single_document);
+static plan_t query_plan_index(const brooks_query_t *query, const brooks_filter_t *filter, bool single_document);
+static size_t query_estimate_results(const brooks_query_t *query, const plan_t *plans, size_t num_plans,
+                                     bool single_document);
+static bool plan_covers(const plan_t *plan, const brooks_object_t *root);
+static void query_run_index(brooks_prepared_t *prepared, const plan_t *plan, const brooks_object_t *root,
+                            value_set_t *seen);
+static void query_run_key_path(brooks_prepared_t *prepared, const plan_t *plan, const brooks_object_t *root,
+                               value_set_t *seen);
+static void query_key_path_visitor(void *capture, const brooks_value_t *value);
+static void query_traverse(brooks_prepared_t *prepared, const prepared_plans_t *prepared_plans,
+                           const brooks_object_t *root, brooks_traversal_policy_e policy, value_set_t *seen);
+
+static double filter_selectivity(brooks_stats_t *stats, const brooks_filter_t *filter);
+static int plan_compare_by_selectivity(const void *lhs, const void *rhs);
+static int ranked_filter_compare(const void *lhs, const void *rhs);
+
+static bool filter_matches(const brooks_filter_t *filter, const candidate_t *candidate);
+static bool filter_eval(const brooks_filter_t *filter, filter_predicate_e predicate, const candidate_t *candidate,
+                        brooks_type_e type);
+static bool filter_has_predicate(const brooks_filter_t *filter, filter_predicate_e predicate);
+static void filter_adaptive_collect(const brooks_filter_t *filter);
+static void filter_adaptive_reorder(filter_adaptive_t *adaptive);
+static bool filter_matches_range(const brooks_filter_t *filter, const brooks_value_t *value);
+static bool filter_bound_set(brooks_filter_t *filter, value_bound_t *bound, const brooks_index_key_t *key,
+                             bool inclusive);
+static void bound_widen(brooks_index_key_t *key, brooks_type_e type, bool upper);
+
+static bool value_set_create(value_set_t *set);
+static bool value_set_insert(value_set_t *set, const brooks_value_t *value);
+static void value_set_clear(value_set_t *set);
+static void value_set_dispose(value_set_t *set);
+static brooks_status_e stream_create(stream_run_t *run, const brooks_query_t *query, void *capture,
+                                     brooks_stream_visitor_t visitor);
+static void stream_dispose(stream_run_t *run);
+static brooks_doc_scan_e stream_token(void *capture, const brooks_doc_token_t *token);
+static const uint64_t *stream_states(const stream_run_t *run, size_t chain_length);
+static void stream_advance(stream_run_t *run, size_t chain_length, const char *key);
+static bool stream_viable(const stream_run_t *run, const uint64_t *states, size_t depth);
+static bool stream_emits(const stream_run_t *run, const candidate_t *candidate, const uint64_t *states);
+static bool stream_descends(const stream_run_t *run, const candidate_t *candidate, const uint64_t *states);
+static bool stream_on_path(const stream_run_t *run, size_t filter, const candidate_t *candidate,
+                           const uint64_t *states);
+static brooks_doc_scan_e stream_report(stream_run_t *run, const candidate_t *candidate, size_t begin, size_t end);
+static bool stream_push(stream_run_t *run, const brooks_doc_token_t *token, const candidate_t *candidate);
+static brooks_status_e stream_read_line(size_t *length, char **line, size_t *capacity, FILE *file);
+
 // ---------------------------------------------------------------------------------------------------------------------
 // I N T E R F A C E   I M P L E M E N T A T I O N
 // ---------------------------------------------------------------------------------------------------------------------
@@ -88,11 +316,17 @@ typedef struct brooks_filter_t
 
 brooks_status_e brooks_query_create(brooks_query_t **query, brooks_pool_t *pool)
 {
-    if (pool) {
+    if (query && pool) {
         brooks_query_t *retval = brooks_pool_malloc(pool, sizeof(brooks_query_t));
         if (retval) {
             INIT_VECTOR(retval->filters, sizeof(brooks_filter_t *), XJSON_QUERY_FILTERS_CAPACITY_DEFAULT, pool);
             INIT_VECTOR(retval->terminators, sizeof(brooks_filter_t *), XJSON_QUERY_TERMINATORS_CAPACITY_DEFAULT, pool);
+            INIT_VECTOR(retval->indexes, sizeof(brooks_index_value_t *), XJSON_QUERY_INDEXES_CAPACITY_DEFAULT, pool);
+            INIT_VECTOR(retval->inverted_indexes, sizeof(brooks_index_inverted_t *),
+                        XJSON_QUERY_INDEXES_CAPACITY_DEFAULT, pool);
+            retval->stats = NULL;
+            retval->pool = pool;
+            *query = retval;
         }
         return ((retval != NULL && retval->filters.base != NULL && retval->terminators.base != NULL) ?
                     brooks_status_ok : brooks_status_malloc_err);
@@ -101,124 +335,1346 @@ brooks_status_e brooks_query_create(brooks_query_t **query, brooks_pool_t *pool)
 
 brooks_status_e brooks_query_add_path_filter(brooks_query_t *query, const brooks_filter_t *filter)
 {
-    return brooks_status_interalerr;
+    return ((query && filter) ? vector_push(&query->filters, query->pool, &filter) : brooks_status_nullptr);
 }
 
 brooks_status_e brooks_query_add_terminator(brooks_query_t *query, const brooks_filter_t *filter)
 {
-    return brooks_status_interalerr;
+    return ((query && filter) ? vector_push(&query->terminators, query->pool, &filter) : brooks_status_nullptr);
+}
+
+brooks_status_e brooks_query_add_index(brooks_query_t *query, brooks_index_value_t *index)
+{
+    return ((query && index) ? vector_push(&query->indexes, query->pool, &index) : brooks_status_nullptr);
+}
+
+brooks_status_e brooks_query_add_inverted_index(brooks_query_t *query, brooks_index_inverted_t *index)
+{
+    return ((query && index) ? vector_push(&query->inverted_indexes, query->pool, &index) : brooks_status_nullptr);
+}
+
+brooks_status_e brooks_query_set_stats(brooks_query_t *query, brooks_stats_t *stats)
+{
+    if (query) {
+        query->stats = stats;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 brooks_status_e brooks_query_execute(brooks_result_t **result, brooks_pool_t *pool, const brooks_query_t *query,
                                      const brooks_object_t *root, brooks_traversal_policy_e policy)
 {
+    if (!result || !pool || !query) {
+        return brooks_status_nullptr;
+    }
 
-   /* size_t num_elements_all;
-    brooks_element_t **all = NULL; //brooks_querfullscan(&num_elements_all, root);
-    brooks_result_t *retval = result_create(pool);
-    for (size_t i = 0; i < num_elements_all; i++) {
-        brooks_element_t *element = all[i];
-        //if (pred(capture, all[i])) {
-        retval->data.base = brooks_misc_autoresize(retval->data.base, retval->data.element_size,
-                                                   &retval->data.element_size, &retval->data.capacity_data_list);
-      //  memcpy(retval->data.base + (retval->data.num_elements_data_list++ * retval->data.element_size),
-    //           element, sizeof());
+    brooks_prepared_t *prepared;
+    const brooks_cursor_t *cursor;
+    brooks_status_e status;
+    if ((status = prepared_create(&prepared, query, pool)) != brooks_status_ok) {
+        return status;
+    }
+
+    if ((status = brooks_prepared_execute(&cursor, prepared, root, policy)) == brooks_status_ok) {
+        size_t num_values;
+        brooks_value_t **values = brooks_cursor_read(&num_values, cursor);
+        brooks_result_t *retval = result_create(pool, (num_values > XJSON_RESULT_CAPACITY_DEFAULT ?
+                                                       num_values : XJSON_RESULT_CAPACITY_DEFAULT));
+        for (size_t i = 0; i < num_values; i++) {
+            brooks_element_t *element = brooks_doc_element_from_value(pool, values[i]);
+            vector_push(&retval->data, pool, &element);
+        }
+        *result = retval;
+    }
+    brooks_prepared_dispose(prepared);
+    return status;
+}
+
+brooks_status_e brooks_query_prepare(brooks_prepared_t **prepared, const brooks_query_t *query)
+{
+    return ((prepared && query) ? prepared_create(prepared, query, query->pool) : brooks_status_nullptr);
+}
+
+brooks_status_e brooks_prepared_execute(const brooks_cursor_t **result, brooks_prepared_t *prepared,
+                                        const brooks_object_t *root, brooks_traversal_policy_e policy)
+{
+    if (!result || !prepared) {
+        return brooks_status_nullptr;
+    }
+
+    const prepared_plans_t *plans = prepared->plans + (root != NULL ? prepared_plans_document :
+                                                                     prepared_plans_collection);
+    bool needs_traversal = (plans->num_traverse > 0 || prepared->num_plans == 0);
+    if (root == NULL && needs_traversal) {
+        return brooks_status_illegalarg;
+    }
+
+    // an element may satisfy several terminators, hence duplicates are only possible for more than one terminator
+    value_set_t *dedupe = NULL;
+    if (prepared->num_plans > 1) {
+        value_set_clear(&prepared->seen);
+        dedupe = &prepared->seen;
+    }
 
-         //   retval->elements[retval->num_elements_data_list++] = element;
-        //}
+    brooks_cursor_clear(prepared->output);
+    for (size_t i = 0; i < prepared->num_plans; i++) {
+        // an index answers for a single root only if that root was added to it, otherwise its path is followed
+        if (plans->plans[i].kind == plan_kind_key_path ||
+            (root != NULL && plans->plans[i].kind != plan_kind_traverse && !plan_covers(plans->plans + i, root))) {
+            query_run_key_path(prepared, plans->plans + i, root, dedupe);
+        } else if (plans->plans[i].kind != plan_kind_traverse) {
+            query_run_index(prepared, plans->plans + i, root, dedupe);
+        }
+    }
+    if (needs_traversal) {
+        query_traverse(prepared, plans, root, policy, dedupe);
     }
-    *result = retval;*/
+
+    *result = prepared->output;
     return brooks_status_ok;
 }
 
+brooks_status_e brooks_prepared_dispose(brooks_prepared_t *prepared)
+{
+    if (prepared) {
+        for (size_t i = 0; i < prepared_plans_count; i++) {
+            free(prepared->plans[i].plans);
+        }
+        free(prepared->path_filters);
+        free(prepared->items);
+        free(prepared->stack);
+        free(prepared->chain);
+        value_set_dispose(&prepared->seen);
+        brooks_cursor_dispose(prepared->lookup);
+        brooks_cursor_dispose(prepared->output);
+        free(prepared);
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_query_stream(size_t *num_matches, const brooks_query_t *query, const char *text,
+                                    void *capture, brooks_stream_visitor_t visitor)
+{
+    if (num_matches && query && text) {
+        stream_run_t run;
+        brooks_status_e status = stream_create(&run, query, capture, visitor);
+        if (status != brooks_status_ok) {
+            return status;
+        } else if ((status = brooks_doc_scan(text, &run, stream_token)) == brooks_status_ok) {
+            status = run.status;
+        }
+        *num_matches = run.num_matches;
+        stream_dispose(&run);
+        return status;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_query_stream_file(size_t *num_matches, const brooks_query_t *query, FILE *file,
+                                         void *capture, brooks_stream_visitor_t visitor)
+{
+    if (num_matches && query && file) {
+        stream_run_t run;
+        char *line = NULL;
+        size_t capacity = 0, length;
+        brooks_status_e status = stream_create(&run, query, capture, visitor);
+        if (status != brooks_status_ok) {
+            return status;
+        }
+        while (!run.stopped && (status = stream_read_line(&length, &line, &capacity, file)) == brooks_status_ok) {
+            if ((status = brooks_doc_scan(line, &run, stream_token)) != brooks_status_ok ||
+                (status = run.status) != brooks_status_ok) {
+                break;
+            }
+            run.base += length;
+        }
+        // the end of the file ends the stream as well
+        status = (status == brooks_status_false ? brooks_status_ok : status);
+        *num_matches = run.num_matches;
+        free(line);
+        stream_dispose(&run);
+        return status;
+    } else return brooks_status_nullptr;
+}
+
 brooks_status_e brooks_result_print(FILE *file, const brooks_result_t *result)
 {
     if (file && result) {
+        brooks_element_t * const *elements = result->data.base;
         for (size_t idx = 0; idx < result->data.num_elements; idx++) {
-            brooks_element_t *element = result->data.base + (idx * result->data.element_size);
-            brooks_doc_element_print(file, element);
+            brooks_doc_element_print(file, elements[idx]);
             fprintf(file, "\n");
         }
         return brooks_status_ok;
     } else return brooks_status_nullptr;
 }
 
+brooks_element_t * const *brooks_result_read(size_t *num_elements, const brooks_result_t *result)
+{
+    if (num_elements && result) {
+        *num_elements = result->data.num_elements;
+        return result->data.base;
+    } else return NULL;
+}
+
 brooks_status_e brooks_filter_create(brooks_filter_t **filter, brooks_pool_t *pool,
                                      size_t min_depth, size_t max_depth)
 {
-    return brooks_status_interalerr;
+    if (filter && pool) {
+        if (min_depth > max_depth) {
+            return brooks_status_illegalarg;
+        }
+        brooks_filter_t *result = brooks_pool_malloc(pool, sizeof(brooks_filter_t));
+        if (result == NULL) {
+            return brooks_status_pmalloc_err;
+        }
+        memset(result, 0, sizeof(brooks_filter_t));
+        result->min_depth = min_depth;
+        result->max_depth = max_depth;
+        result->pred_entry_kind = brooks_entry_kind_any;
+        if ((result->adaptive = brooks_pool_malloc(pool, sizeof(filter_adaptive_t))) == NULL) {
+            return brooks_status_pmalloc_err;
+        }
+        result->adaptive->num_predicates = 0;
+        result->adaptive->num_evaluations = 0;
+        result->adaptive->enabled = true;
+        result->adaptive->dirty = true;
+        result->pool = pool;
+        *filter = result;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_filter_set_capture(brooks_filter_t *filter, void *capture)
+{
+    if (filter) {
+        filter->capture = capture;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_filter_set_adaptive(brooks_filter_t *filter, bool adaptive)
+{
+    if (filter) {
+        filter->adaptive->enabled = adaptive;
+        filter->adaptive->dirty = true;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_filter_set_key_path(brooks_filter_t *filter, const char *key_path)
+{
+    if (filter) {
+        filter->adaptive->dirty = true;
+        return brooks_path_create(&filter->key_path, filter->pool, key_path);
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_filter_set_value_range(brooks_filter_t *filter, const brooks_index_key_t *lower,
+                                              bool lower_inclusive, const brooks_index_key_t *upper,
+                                              bool upper_inclusive)
+{
+    if (filter && (lower || upper)) {
+        filter->adaptive->dirty = true;
+        return ((filter_bound_set(filter, &filter->lower, lower, lower_inclusive) &&
+                 filter_bound_set(filter, &filter->upper, upper, upper_inclusive)) ?
+                brooks_status_ok : brooks_status_illegalarg);
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_filter_set_value_equals(brooks_filter_t *filter, const brooks_index_key_t *key)
+{
+    return brooks_filter_set_value_range(filter, key, true, key, true);
+}
+
+brooks_status_e brooks_filter_set_value_str_match(brooks_filter_t *filter, brooks_index_match_e match,
+                                                  const char *needle)
+{
+    if (filter && needle) {
+        filter->adaptive->dirty = true;
+        filter->str_match_set = true;
+        filter->str_match = match;
+        filter->str_needle = brooks_misc_strdup(filter->pool, needle);
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 brooks_status_e brooks_filter_set_prop_key_name(brooks_filter_t *filter, brooks_pred_string_t pred)
 {
-    return brooks_status_interalerr;
+    if (filter) {
+        filter->pred_prop_key_name = pred;
+        filter->adaptive->dirty = true;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 brooks_status_e brooks_filter_set_prop_index(brooks_filter_t *filter, brook_pred_integer_t pred)
 {
-    return brooks_status_interalerr;
+    if (filter) {
+        filter->pred_prop_index = pred;
+        filter->adaptive->dirty = true;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 brooks_status_e brooks_filter_set_value_type(brooks_filter_t *filter, brooks_pred_val_type_t pred)
 {
-    return brooks_status_interalerr;
+    if (filter) {
+        filter->pred_value_type = pred;
+        filter->adaptive->dirty = true;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 brooks_status_e brooks_filter_set_entry_kind(brooks_filter_t *filter, brooks_entry_kind_e pred)
 {
-    return brooks_status_interalerr;
+    if (filter) {
+        filter->pred_entry_kind = pred;
+        filter->adaptive->dirty = true;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 brooks_status_e brooks_filter_set_value_int(brooks_filter_t *filter, brook_pred_integer_t pred)
 {
-    return brooks_status_interalerr;
+    if (filter) {
+        filter->pred_value_int = pred;
+        filter->adaptive->dirty = true;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 brooks_status_e brooks_filter_set_value_dec(brooks_filter_t *filter, brooks_pred_decimal_t pred)
 {
-    return brooks_status_interalerr;
+    if (filter) {
+        filter->pred_value_dec = pred;
+        filter->adaptive->dirty = true;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 brooks_status_e brooks_filter_set_value_str(brooks_filter_t *filter, brooks_pred_string_t pred)
 {
-    return brooks_status_interalerr;
+    if (filter) {
+        filter->pred_value_str = pred;
+        filter->adaptive->dirty = true;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 brooks_status_e brooks_filter_set_value_bool(brooks_filter_t *filter, xjson_pred_boolean_t pred)
 {
-    return brooks_status_interalerr;
+    if (filter) {
+        filter->pred_value_bool = pred;
+        filter->adaptive->dirty = true;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 brooks_status_e brooks_filter_set_array_num_elem_min(brooks_filter_t *filter, brook_pred_integer_t pred)
 {
-    return brooks_status_interalerr;
+    if (filter) {
+        filter->pred_array_num_elem_min = pred;
+        filter->adaptive->dirty = true;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 brooks_status_e brooks_filter_set_array_num_elem_max(brooks_filter_t *filter, brook_pred_integer_t pred)
 {
-    return brooks_status_interalerr;
+    if (filter) {
+        filter->pred_array_num_elem_max = pred;
+        filter->adaptive->dirty = true;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 brooks_status_e brooks_filter_set_object_num_elem_min(brooks_filter_t *filter, brook_pred_integer_t pred)
 {
-    return brooks_status_interalerr;
+    if (filter) {
+        filter->pred_object_num_elem_min = pred;
+        filter->adaptive->dirty = true;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 brooks_status_e brooks_filter_set_object_num_elem_max(brooks_filter_t *filter, brook_pred_integer_t pred)
 {
-    return brooks_status_interalerr;
+    if (filter) {
+        filter->pred_object_num_elem_max = pred;
+        filter->adaptive->dirty = true;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------
 // H E L P E R   I M P L E M E N T A T I O N
 // ---------------------------------------------------------------------------------------------------------------------
 
-brooks_result_t *result_create(brooks_pool_t *pool)
+brooks_result_t *result_create(brooks_pool_t *pool, size_t capacity)
 {
     brooks_result_t *result;
     if ((result = brooks_pool_malloc(pool, sizeof(brooks_result_t))) != NULL) {
-        INIT_VECTOR(result->data, sizeof(brooks_element_t *), XJSON_RESULT_CAPACITY_DEFAULT, pool);
+        INIT_VECTOR(result->data, sizeof(brooks_element_t *), capacity, pool);
         return (result->data.base != NULL ? result : NULL);
     }
     return NULL;
-}
\ No newline at end of file
+}
+
+static brooks_status_e vector_push(brooks_vector_t *vector, brooks_pool_t *pool, const void *element)
+{
+    if (vector->num_elements == vector->capacity) {
+        vector->base = brooks_misc_pooled_autoresize(pool, vector->base, vector->element_size, vector->num_elements,
+                                                     &vector->capacity, 1, brooks_pool_category_other);
+    }
+    if (vector->base != NULL) {
+        memcpy((char *) vector->base + vector->num_elements++ * vector->element_size, element, vector->element_size);
+        return brooks_status_ok;
+    } else return brooks_status_pmalloc_err;
+}
+
+static void prepared_emit(brooks_prepared_t *prepared, value_set_t *seen, const brooks_value_t *value)
+{
+    if (seen == NULL || value_set_insert(seen, value)) {
+        brooks_cursor_append(prepared->output, &value, 1);
+    }
+}
+
+static brooks_status_e prepared_create(brooks_prepared_t **prepared, const brooks_query_t *query,
+                                       brooks_pool_t *pool)
+{
+    // zeroed, such that brooks_prepared_dispose releases what was allocated when an allocation fails
+    brooks_prepared_t *result = calloc(1, sizeof(brooks_prepared_t));
+    if (result == NULL) {
+        return brooks_status_malloc_err;
+    }
+    result->query = query;
+    result->num_plans = query->terminators.num_elements;
+    result->num_path_filters = query->filters.num_elements;
+
+    // terminators are a disjunction that stops at the first match, path filters a conjunction that stops at the
+    // first mismatch: the former are tried least selective first, the latter most selective first
+    size_t num_path_filters = result->num_path_filters;
+    if ((result->path_filters = malloc((num_path_filters + 1) * sizeof(brooks_filter_t *))) == NULL) {
+        brooks_prepared_dispose(result);
+        return brooks_status_malloc_err;
+    }
+    memcpy(result->path_filters, query->filters.base, num_path_filters * sizeof(brooks_filter_t *));
+    if (query->stats != NULL) {
+        ranked_filter_t *ranked = malloc((num_path_filters + 1) * sizeof(ranked_filter_t));
+        if (ranked == NULL) {
+            brooks_prepared_dispose(result);
+            return brooks_status_malloc_err;
+        }
+        for (size_t i = 0; i < num_path_filters; i++) {
+            ranked[i] = (ranked_filter_t) { result->path_filters[i],
+                                            filter_selectivity(query->stats, result->path_filters[i]) };
+        }
+        qsort(ranked, num_path_filters, sizeof(ranked_filter_t), ranked_filter_compare);
+        for (size_t i = 0; i < num_path_filters; i++) {
+            result->path_filters[i] = ranked[i].filter;
+        }
+        free(ranked);
+    }
+
+    size_t lookup_capacity = XJSON_RESULT_CAPACITY_DEFAULT;
+    for (size_t set = 0; set < prepared_plans_count; set++) {
+        prepared_plans_t *plans = result->plans + set;
+        if ((plans->plans = malloc((result->num_plans + 1) * sizeof(plan_t))) == NULL) {
+            brooks_prepared_dispose(result);
+            return brooks_status_malloc_err;
+        }
+        plans->num_traverse = 0;
+        plans->max_depth = (result->num_plans == 0 ? SIZE_MAX : 0);
+        plans->needs_chain = false;
+
+        const brooks_filter_t * const *terminators = query->terminators.base;
+        for (size_t i = 0; i < result->num_plans; i++) {
+            plan_t *plan = plans->plans + i;
+            *plan = query_plan(query, terminators[i], (set == prepared_plans_document));
+            if (plan->kind == plan_kind_traverse) {
+                plans->num_traverse++;
+                // do not descend deeper than the deepest terminator that is not answered by an index
+                plans->max_depth = (plan->filter->max_depth > plans->max_depth ? plan->filter->max_depth :
+                                                                                 plans->max_depth);
+                plans->needs_chain |= (plan->filter->key_path != NULL);
+            } else if (plan->kind != plan_kind_key_path && plan->num_matches > lookup_capacity) {
+                lookup_capacity = (size_t) ceil(plan->num_matches);
+            }
+        }
+        for (size_t i = 0; i < num_path_filters; i++) {
+            plans->needs_chain |= (result->path_filters[i]->key_path != NULL);
+        }
+        if (query->stats != NULL) {
+            qsort(plans->plans, result->num_plans, sizeof(plan_t), plan_compare_by_selectivity);
+        }
+    }
+
+    result->items_capacity = result->stack_capacity = BROOKS_QUERY_TRAVERSAL_CAPACITY;
+    result->items = malloc(result->items_capacity * sizeof(traversal_item_t));
+    result->stack = malloc(result->stack_capacity * sizeof(size_t));
+    result->chain_capacity = 16;
+    result->chain = malloc(result->chain_capacity * sizeof(char *));
+    if (!value_set_create(&result->seen) || result->items == NULL || result->stack == NULL || result->chain == NULL) {
+        brooks_prepared_dispose(result);
+        return brooks_status_malloc_err;
+    }
+
+    size_t output_capacity = query_estimate_results(query, result->plans[prepared_plans_document].plans,
+                                                    result->num_plans, true);
+    brooks_status_e status;
+    if ((status = brooks_cursor_create(&result->lookup, lookup_capacity, pool)) != brooks_status_ok ||
+        (status = brooks_cursor_create(&result->output, output_capacity, pool)) != brooks_status_ok) {
+        brooks_prepared_dispose(result);
+        return status;
+    }
+    *prepared = result;
+    return brooks_status_ok;
+}
+
+static plan_t query_plan(const brooks_query_t *query, const brooks_filter_t *filter, bool single_document)
+{
+    plan_t plan = query_plan_index(query, filter, single_document);
+
+    // a key path without path filters is followed directly instead of traversing the whole document
+    if (plan.kind == plan_kind_traverse && single_document && filter->key_path != NULL &&
+        brooks_path_length(filter->key_path) > 0 && query->filters.num_elements == 0) {
+        plan.kind = plan_kind_key_path;
+    }
+    return plan;
+}
+
+static plan_t query_plan_index(const brooks_query_t *query, const brooks_filter_t *filter, bool single_document)
+{
+    plan_t plan = { .kind = plan_kind_traverse, .filter = filter, .index = NULL, .selectivity = 1, .num_matches = 0 };
+
+    if (query->stats != NULL) {
+        const brooks_stats_path_t *counters = (filter->key_path ?
+                                               brooks_stats_get(query->stats, brooks_path_str(filter->key_path)) :
+                                               NULL);
+        plan.selectivity = filter_selectivity(query->stats, filter);
+        plan.num_matches = plan.selectivity * (counters ? counters->num_values : brooks_stats_num_values(query->stats));
+
+        // an index lookup returns hits of the whole collection that are then restricted to 'root'
+        size_t num_documents = brooks_stats_num_documents(query->stats);
+        double num_values_per_document = (num_documents > 0 ?
+                                          (double) brooks_stats_num_values(query->stats) / num_documents : 0);
+        if (single_document && plan.num_matches > num_values_per_document) {
+            return plan;
+        }
+    }
+
+    // path filters constrain the traversal only, an index cannot check them for the ancestors of a hit
+    if (filter->key_path == NULL || query->filters.num_elements > 0) {
+        return plan;
+    }
+
+    const char *key_path = brooks_path_str(filter->key_path);
+    brooks_index_value_t * const *indexes = query->indexes.base;
+    brooks_index_inverted_t * const *inverted_indexes = query->inverted_indexes.base;
+
+    if (filter->str_match_set) {
+        for (size_t i = 0; i < query->inverted_indexes.num_elements; i++) {
+            if (strcmp(brooks_index_inverted_key_path(inverted_indexes[i]), key_path) == 0) {
+                plan.kind = plan_kind_inverted_index;
+                plan.index = inverted_indexes[i];
+                return plan;
+            }
+        }
+    }
+    if (filter->lower.set || filter->upper.set ||
+        (filter->str_match_set && filter->str_match == brooks_index_match_equals)) {
+        for (size_t i = 0; i < query->indexes.num_elements; i++) {
+            if (strcmp(brooks_index_value_key_path(indexes[i]), key_path) == 0) {
+                plan.kind = plan_kind_value_index;
+                plan.index = indexes[i];
+                return plan;
+            }
+        }
+    }
+    return plan;
+}
+
+static size_t query_estimate_results(const brooks_query_t *query, const plan_t *plans, size_t num_plans,
+                                     bool single_document)
+{
+    if (query->stats == NULL || brooks_stats_num_documents(query->stats) == 0) {
+        return XJSON_RESULT_CAPACITY_DEFAULT;
+    }
+    double num_results = 0;
+    for (size_t i = 0; i < num_plans; i++) {
+        num_results += plans[i].num_matches;
+    }
+    if (num_plans == 0) {
+        num_results = brooks_stats_num_values(query->stats);
+    }
+    if (single_document) {
+        num_results /= brooks_stats_num_documents(query->stats);
+    }
+    return (num_results > XJSON_RESULT_CAPACITY_DEFAULT ? (size_t) ceil(num_results) : XJSON_RESULT_CAPACITY_DEFAULT);
+}
+
+static bool plan_covers(const plan_t *plan, const brooks_object_t *root)
+{
+    return (plan->kind == plan_kind_inverted_index ? brooks_index_inverted_covers(plan->index, root) :
+                                                     brooks_index_value_covers(plan->index, root));
+}
+
+static void query_run_index(brooks_prepared_t *prepared, const plan_t *plan, const brooks_object_t *root,
+                            value_set_t *seen)
+{
+    const brooks_filter_t *filter = plan->filter;
+    brooks_cursor_t *cursor = prepared->lookup;
+    brooks_cursor_clear(cursor);
+
+    if (plan->kind == plan_kind_inverted_index) {
+        brooks_index_inverted_lookup(cursor, plan->index, filter->str_match, filter->str_needle);
+    } else if (filter->lower.set || filter->upper.set) {
+        // a one-sided range is closed at the end of the bound's type such that no other types are scanned
+        brooks_index_key_t lower = filter->lower.key, upper = filter->upper.key;
+        bool lower_inclusive = filter->lower.inclusive, upper_inclusive = filter->upper.inclusive;
+        if (!filter->lower.set) {
+            bound_widen(&lower, filter->upper.key.type, false);
+            lower_inclusive = true;
+        }
+        if (!filter->upper.set) {
+            bound_widen(&upper, filter->lower.key.type, true);
+            upper_inclusive = true;
+        }
+        brooks_index_value_lookup(cursor, plan->index, &lower, lower_inclusive,
+                                  (upper.type != brooks_type_none ? &upper : NULL), upper_inclusive);
+    } else {
+        brooks_index_key_t key = { .type = brooks_type_string, .string = filter->str_needle };
+        brooks_index_value_lookup(cursor, plan->index, &key, true, &key, true);
+    }
+
+    size_t num_values;
+    brooks_value_t **values = brooks_cursor_read(&num_values, cursor);
+    for (size_t i = 0; i < num_values; i++) {
+        candidate_t candidate = {
+            .value = values[i],
+            .key = brooks_doc_value_get_key(values[i]),
+            .position_known = false,
+            .key_chain = NULL
+        };
+        if ((root == NULL || brooks_doc_value_get_root(values[i]) == root) && filter_matches(filter, &candidate)) {
+            prepared_emit(prepared, seen, values[i]);
+        }
+    }
+}
+
+static void query_run_key_path(brooks_prepared_t *prepared, const plan_t *plan, const brooks_object_t *root,
+                               value_set_t *seen)
+{
+    key_path_run_t run = { .prepared = prepared, .filter = plan->filter, .seen = seen };
+    brooks_path_visit_matching(plan->filter->key_path, root, &run, query_key_path_visitor);
+}
+
+static void query_key_path_visitor(void *capture, const brooks_value_t *value)
+{
+    key_path_run_t *run = capture;
+    candidate_t candidate = {
+        .value = value,
+        .key = brooks_doc_value_get_key(value),
+        .position_known = false,
+        .key_chain = NULL
+    };
+    if (filter_matches(run->filter, &candidate)) {
+        prepared_emit(run->prepared, run->seen, value);
+    }
+}
+
+static void query_traverse(brooks_prepared_t *prepared, const prepared_plans_t *prepared_plans,
+                           const brooks_object_t *root, brooks_traversal_policy_e policy, value_set_t *seen)
+{
+    const brooks_filter_t * const *path_filters = prepared->path_filters;
+    const plan_t *plans = prepared_plans->plans;
+    size_t num_path_filters = prepared->num_path_filters;
+    size_t num_terminators = prepared->num_plans;
+    size_t max_depth = prepared_plans->max_depth;
+    bool needs_chain = prepared_plans->needs_chain;
+
+    // the buffers are owned by the prepared query and survive across executions
+    size_t num_root_entries = brooks_doc_object_num_elements(root);
+    size_t items_capacity = prepared->items_capacity, num_items = 0, head = 0;
+    traversal_item_t *items = brooks_misc_autoresize(prepared->items, sizeof(traversal_item_t), 0, &items_capacity,
+                                                     num_root_entries);
+    size_t stack_capacity = prepared->stack_capacity, stack_size = 0;
+    size_t *stack = brooks_misc_autoresize(prepared->stack, sizeof(size_t), 0, &stack_capacity, num_root_entries);
+    size_t chain_capacity = prepared->chain_capacity;
+    const char **chain = prepared->chain;
+
+    // the root's entries are pushed in reverse order, such that depth-first pops them in document order
+    for (size_t i = 0; i < num_root_entries; i++) {
+        items[num_items] = (traversal_item_t) {
+            .value = brooks_doc_object_get_value(root, i), .key = brooks_doc_object_get_key(root, i), .idx = i,
+            .depth = 0, .parent = SIZE_MAX
+        };
+        stack[num_root_entries - 1 - i] = num_items++;
+    }
+    stack_size = num_root_entries;
+
+    while ((policy == brooks_traversal_breadth_first) ? (head < num_items) : (stack_size > 0)) {
+        size_t current = (policy == brooks_traversal_breadth_first ? head++ : stack[--stack_size]);
+        traversal_item_t item = items[current];
+
+        size_t chain_length = 0;
+        if (needs_chain) {
+            for (size_t it = current; it != SIZE_MAX; it = items[it].parent) {
+                chain_length += (items[it].key != NULL);
+            }
+            if (chain_length > chain_capacity) {
+                chain = brooks_misc_autoresize(chain, sizeof(char *), 0, &chain_capacity, chain_length);
+            }
+            size_t pos = chain_length;
+            for (size_t it = current; it != SIZE_MAX; it = items[it].parent) {
+                if (items[it].key != NULL) {
+                    chain[--pos] = items[it].key;
+                }
+            }
+        }
+
+        candidate_t candidate = {
+            .value = item.value, .key = item.key, .idx = item.idx, .depth = item.depth, .position_known = true,
+            .key_chain = chain, .chain_length = chain_length
+        };
+
+        bool emit = (num_terminators == 0);
+        for (size_t i = 0; !emit && i < num_terminators; i++) {
+            emit = (plans[i].kind == plan_kind_traverse && filter_matches(plans[i].filter, &candidate));
+        }
+        if (emit) {
+            prepared_emit(prepared, seen, item.value);
+        }
+
+        brooks_type_e type;
+        brooks_doc_value_get_type(&type, item.value);
+        bool descend = ((type == brooks_type_object || type == brooks_type_array) && item.depth < max_depth);
+        for (size_t i = 0; descend && i < num_path_filters; i++) {
+            descend = filter_matches(path_filters[i], &candidate);
+        }
+        if (!descend) {
+            continue;
+        }
+
+        size_t num_children = (type == brooks_type_object ?
+                               brooks_doc_object_num_elements(brooks_doc_value_as_object(item.value)) :
+                               brooks_doc_array_get_length(brooks_doc_value_as_array(item.value)));
+        items = brooks_misc_autoresize(items, sizeof(traversal_item_t), num_items, &items_capacity, num_children);
+        stack = brooks_misc_autoresize(stack, sizeof(size_t), stack_size, &stack_capacity, num_children);
+
+        for (size_t i = 0; i < num_children; i++) {
+            traversal_item_t *child = items + num_items;
+            if (type == brooks_type_object) {
+                const brooks_object_t *object = brooks_doc_value_as_object(item.value);
+                child->value = brooks_doc_object_get_value(object, i);
+                child->key = brooks_doc_object_get_key(object, i);
+            } else {
+                brooks_unnamed_entry_t *entry = brooks_doc_array_begin(brooks_doc_value_as_array(item.value))[i];
+                child->value = brooks_doc_unnamed_entry_get_value(entry);
+                child->key = NULL;
+            }
+            child->idx = i;
+            child->depth = item.depth + 1;
+            child->parent = current;
+            stack[stack_size + num_children - 1 - i] = num_items++;
+        }
+        stack_size += num_children;
+    }
+
+    prepared->items = items;
+    prepared->items_capacity = items_capacity;
+    prepared->stack = stack;
+    prepared->stack_capacity = stack_capacity;
+    prepared->chain = chain;
+    prepared->chain_capacity = chain_capacity;
+}
+
+static double filter_selectivity(brooks_stats_t *stats, const brooks_filter_t *filter)
+{
+    // filters without declarative predicates cannot be estimated and are assumed to pass everything
+    if (filter->key_path == NULL) {
+        return 1;
+    }
+    const char *key_path = brooks_path_str(filter->key_path);
+    const brooks_stats_path_t *counters = brooks_stats_get(stats, key_path);
+    if (counters == NULL || counters->num_values == 0) {
+        return 0;
+    }
+
+    if (filter->lower.set || filter->upper.set) {
+        return brooks_stats_selectivity_range(stats, key_path, (filter->lower.set ? &filter->lower.key : NULL),
+                                              filter->lower.inclusive, (filter->upper.set ? &filter->upper.key : NULL),
+                                              filter->upper.inclusive);
+    } else if (filter->str_match_set && filter->str_match == brooks_index_match_equals) {
+        brooks_index_key_t key = { .type = brooks_type_string, .string = filter->str_needle };
+        return brooks_stats_selectivity_equals(stats, key_path, &key);
+    } else if (filter->str_match_set) {
+        return BROOKS_STATS_DEFAULT_SELECTIVITY * counters->num_strings / counters->num_values;
+    } else return 1;
+}
+
+static int plan_compare_by_selectivity(const void *lhs, const void *rhs)
+{
+    double a = ((const plan_t *) lhs)->selectivity, b = ((const plan_t *) rhs)->selectivity;
+    return (a < b) - (a > b);
+}
+
+static int ranked_filter_compare(const void *lhs, const void *rhs)
+{
+    double a = ((const ranked_filter_t *) lhs)->selectivity, b = ((const ranked_filter_t *) rhs)->selectivity;
+    return (a > b) - (a < b);
+}
+
+static bool filter_matches(const brooks_filter_t *filter, const candidate_t *candidate)
+{
+    filter_adaptive_t *adaptive = filter->adaptive;
+    if (adaptive->dirty) {
+        filter_adaptive_collect(filter);
+    }
+
+    brooks_type_e type;
+    brooks_doc_value_get_type(&type, candidate->value);
+
+    bool sampled = (adaptive->enabled && (adaptive->num_evaluations++ & (BROOKS_FILTER_SAMPLE_RATE - 1)) == 0);
+    bool passed = true;
+    for (size_t i = 0; passed && i < adaptive->num_predicates; i++) {
+        predicate_stats_t *predicate = adaptive->predicates + i;
+        if (sampled) {
+            uint64_t begin = brooks_misc_clock_ns();
+            passed = filter_eval(filter, predicate->kind, candidate, type);
+            predicate->sampled_ns += (double) (brooks_misc_clock_ns() - begin);
+            predicate->num_sampled++;
+        } else {
+            passed = filter_eval(filter, predicate->kind, candidate, type);
+        }
+        predicate->num_evaluated++;
+        predicate->num_passed += passed;
+    }
+
+    if (adaptive->enabled && (adaptive->num_evaluations % BROOKS_FILTER_ADAPT_INTERVAL) == 0) {
+        filter_adaptive_reorder(adaptive);
+    }
+    return passed;
+}
+
+static bool filter_eval(const brooks_filter_t *filter, filter_predicate_e predicate, const candidate_t *candidate,
+                        brooks_type_e type)
+{
+    const brooks_value_t *value = candidate->value;
+    const char *key = candidate->key;
+    void *capture = filter->capture;
+
+    switch (predicate) {
+        case filter_predicate_depth: {
+            size_t depth = (candidate->position_known ? candidate->depth : brooks_doc_value_get_depth(value));
+            return (depth >= filter->min_depth && depth <= filter->max_depth);
+        }
+        case filter_predicate_entry_kind:
+            return !((filter->pred_entry_kind == brooks_entry_kind_key_value_pair && key == NULL) ||
+                     (filter->pred_entry_kind == brooks_entry_kind_single_value && key != NULL));
+        case filter_predicate_value_type:
+            return filter->pred_value_type(capture, type);
+        case filter_predicate_key_name:
+            return (key != NULL && filter->pred_prop_key_name(capture, &key));
+        case filter_predicate_index: {
+            uint64_t idx = (candidate->position_known ? candidate->idx : brooks_doc_value_get_index(value));
+            return filter->pred_prop_index(capture, &idx);
+        }
+        case filter_predicate_key_path:
+            // index hits carry no key chain, their path is guaranteed by the index; streamed values are checked by
+            // the automaton of the stream
+            return (candidate->key_chain == NULL ||
+                    brooks_path_matches(filter->key_path, candidate->key_chain, candidate->chain_length));
+        case filter_predicate_num_elements:
+            if (type == brooks_type_array) {
+                uint64_t num_elements = (candidate->streamed ? candidate->num_elements :
+                                         brooks_doc_array_get_length(brooks_doc_value_as_array(value)));
+                brook_pred_integer_t min = filter->pred_array_num_elem_min, max = filter->pred_array_num_elem_max;
+                return ((!min || min(capture, &num_elements)) && (!max || max(capture, &num_elements)));
+            } else if (type == brooks_type_object) {
+                uint64_t num_elements = (candidate->streamed ? candidate->num_elements :
+                                         brooks_doc_object_num_elements(brooks_doc_value_as_object(value)));
+                brook_pred_integer_t min = filter->pred_object_num_elem_min, max = filter->pred_object_num_elem_max;
+                return ((!min || min(capture, &num_elements)) && (!max || max(capture, &num_elements)));
+            }
+            return true;
+        case filter_predicate_value:
+            // typed value predicates apply to values of their type only
+            switch (type) {
+                case brooks_type_number_integer:
+                    if (filter->pred_value_int) {
+                        uint64_t integer = brooks_doc_value_as_integer(value);
+                        return filter->pred_value_int(capture, &integer);
+                    }
+                    return true;
+                case brooks_type_number_double:
+                    if (filter->pred_value_dec) {
+                        double decimal = brooks_doc_value_as_double(value);
+                        return filter->pred_value_dec(capture, &decimal);
+                    }
+                    return true;
+                case brooks_type_string:
+                    if (filter->pred_value_str) {
+                        const char *string = brooks_doc_value_as_string(value);
+                        return filter->pred_value_str(capture, &string);
+                    }
+                    return true;
+                case brooks_type_boolean:
+                    if (filter->pred_value_bool) {
+                        bool boolean = brooks_doc_value_as_boolean(value);
+                        return filter->pred_value_bool(capture, &boolean);
+                    }
+                    return true;
+                default:
+                    return true;
+            }
+        case filter_predicate_range:
+            return filter_matches_range(filter, value);
+        case filter_predicate_str_match:
+            return (type == brooks_type_string && brooks_index_inverted_matches(filter->str_match,
+                                                                                brooks_doc_value_as_string(value),
+                                                                                filter->str_needle));
+        default:
+            return true;
+    }
+}
+
+static bool filter_has_predicate(const brooks_filter_t *filter, filter_predicate_e predicate)
+{
+    switch (predicate) {
+        case filter_predicate_depth:
+            return (filter->min_depth > 0 || filter->max_depth < SIZE_MAX);
+        case filter_predicate_entry_kind:
+            return (filter->pred_entry_kind != brooks_entry_kind_any);
+        case filter_predicate_value_type:
+            return (filter->pred_value_type != NULL);
+        case filter_predicate_key_name:
+            return (filter->pred_prop_key_name != NULL);
+        case filter_predicate_index:
+            return (filter->pred_prop_index != NULL);
+        case filter_predicate_key_path:
+            return (filter->key_path != NULL);
+        case filter_predicate_num_elements:
+            return (filter->pred_array_num_elem_min || filter->pred_array_num_elem_max ||
+                    filter->pred_object_num_elem_min || filter->pred_object_num_elem_max);
+        case filter_predicate_value:
+            return (filter->pred_value_int || filter->pred_value_dec || filter->pred_value_str ||
+                    filter->pred_value_bool);
+        case filter_predicate_range:
+            return (filter->lower.set || filter->upper.set);
+        case filter_predicate_str_match:
+            return filter->str_match_set;
+        default:
+            return false;
+    }
+}
+
+static void filter_adaptive_collect(const brooks_filter_t *filter)
+{
+    // the initial order is the static one, cheap structural checks before callbacks and value comparisons
+    filter_adaptive_t *adaptive = filter->adaptive;
+    adaptive->num_predicates = 0;
+    adaptive->num_evaluations = 0;
+    for (filter_predicate_e predicate = 0; predicate < filter_predicate_count; predicate++) {
+        if (filter_has_predicate(filter, predicate)) {
+            adaptive->predicates[adaptive->num_predicates++] = (predicate_stats_t) { .kind = predicate };
+        }
+    }
+    adaptive->dirty = false;
+}
+
+static void filter_adaptive_reorder(filter_adaptive_t *adaptive)
+{
+    // for independent conjuncts, ascending cost per rejection minimizes the expected evaluation cost; pass rates are
+    // smoothed such that predicates never reached so far keep a finite rank
+    double ranks[filter_predicate_count];
+    for (size_t i = 0; i < adaptive->num_predicates; i++) {
+        predicate_stats_t *predicate = adaptive->predicates + i;
+        double cost = (predicate->num_sampled > 0 ? predicate->sampled_ns / predicate->num_sampled : 1);
+        double pass_rate = (predicate->num_passed + 1) / (predicate->num_evaluated + 2);
+        ranks[i] = cost / (1 - pass_rate);
+    }
+    for (size_t i = 1; i < adaptive->num_predicates; i++) {
+        predicate_stats_t predicate = adaptive->predicates[i];
+        double rank = ranks[i];
+        size_t j = i;
+        for (; j > 0 && ranks[j - 1] > rank; j--) {
+            adaptive->predicates[j] = adaptive->predicates[j - 1];
+            ranks[j] = ranks[j - 1];
+        }
+        adaptive->predicates[j] = predicate;
+        ranks[j] = rank;
+    }
+
+    // halve the history, such that the order follows selectivities that drift across documents
+    for (size_t i = 0; i < adaptive->num_predicates; i++) {
+        predicate_stats_t *predicate = adaptive->predicates + i;
+        predicate->num_evaluated /= 2;
+        predicate->num_passed /= 2;
+        predicate->num_sampled /= 2;
+        predicate->sampled_ns /= 2;
+    }
+}
+
+static bool filter_matches_range(const brooks_filter_t *filter, const brooks_value_t *value)
+{
+    brooks_index_key_t key;
+    if (!brooks_index_key_from_value(&key, value)) {
+        return false;
+    }
+
+    // a bound only admits values of its own kind, i.e., numbers match numeric bounds regardless of their precision
+    const brooks_index_key_t *bound = (filter->lower.set ? &filter->lower.key : &filter->upper.key);
+    bool key_numeric = (key.type == brooks_type_number_integer || key.type == brooks_type_number_double);
+    bool bound_numeric = (bound->type == brooks_type_number_integer || bound->type == brooks_type_number_double);
+    if (key_numeric != bound_numeric || (!key_numeric && key.type != bound->type)) {
+        return false;
+    }
+
+    if (filter->lower.set) {
+        int cmp = brooks_index_key_compare(&key, &filter->lower.key);
+        if (cmp < 0 || (cmp == 0 && !filter->lower.inclusive)) {
+            return false;
+        }
+    }
+    if (filter->upper.set) {
+        int cmp = brooks_index_key_compare(&key, &filter->upper.key);
+        if (cmp > 0 || (cmp == 0 && !filter->upper.inclusive)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool filter_bound_set(brooks_filter_t *filter, value_bound_t *bound, const brooks_index_key_t *key,
+                             bool inclusive)
+{
+    bound->set = (key != NULL);
+    if (key != NULL) {
+        switch (key->type) {
+            case brooks_type_number_integer:
+            case brooks_type_number_double:
+            case brooks_type_boolean:
+            case brooks_type_null:
+                bound->key = *key;
+                break;
+            case brooks_type_string:
+                bound->key.type = brooks_type_string;
+                bound->key.string = brooks_misc_strdup(filter->pool, key->string);
+                break;
+            default:
+                return false;
+        }
+        bound->inclusive = inclusive;
+    }
+    return true;
+}
+
+static void bound_widen(brooks_index_key_t *key, brooks_type_e type, bool upper)
+{
+    switch (type) {
+        case brooks_type_number_integer:
+        case brooks_type_number_double:
+            key->type = brooks_type_number_double;
+            key->decimal = (upper ? INFINITY : -INFINITY);
+            break;
+        case brooks_type_boolean:
+            key->type = brooks_type_boolean;
+            key->boolean = upper;
+            break;
+        case brooks_type_string:
+            // strings are ordered last, an open upper end is the end of the index
+            key->type = (upper ? brooks_type_none : brooks_type_string);
+            key->string = "";
+            break;
+        default:
+            key->type = brooks_type_null;
+            break;
+    }
+}
+
+static bool value_set_create(value_set_t *set)
+{
+    set->capacity = 64;
+    set->num_values = 0;
+    set->slots = calloc(set->capacity, sizeof(brooks_value_t *));
+    return (set->slots != NULL);
+}
+
+static bool value_set_insert(value_set_t *set, const brooks_value_t *value)
+{
+    const brooks_value_t **grown;
+    // a set that cannot grow is filled up, and then takes every value as a new one
+    if ((set->num_values + 1) * 2 > set->capacity && (grown = calloc(2 * set->capacity, sizeof(brooks_value_t *)))) {
+        const brooks_value_t **old_slots = set->slots;
+        size_t old_capacity = set->capacity;
+        set->capacity *= 2;
+        set->slots = grown;
+        set->num_values = 0;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old_slots[i] != NULL) {
+                value_set_insert(set, old_slots[i]);
+            }
+        }
+        free(old_slots);
+    } else if (set->num_values == set->capacity) {
+        return true;
+    }
+
+    size_t mask = set->capacity - 1;
+    size_t slot = (size_t) ((((uintptr_t) value) >> 4) * 0x9e3779b97f4a7c15ULL) & mask;
+    while (set->slots[slot] != NULL) {
+        if (set->slots[slot] == value) {
+            return false;
+        }
+        slot = (slot + 1) & mask;
+    }
+    set->slots[slot] = value;
+    set->num_values++;
+    return true;
+}
+
+static void value_set_clear(value_set_t *set)
+{
+    if (set->num_values > 0) {
+        memset(set->slots, 0, set->capacity * sizeof(brooks_value_t *));
+        set->num_values = 0;
+    }
+}
+
+static void value_set_dispose(value_set_t *set)
+{
+    free(set->slots);
+}
+
+static brooks_status_e stream_create(stream_run_t *run, const brooks_query_t *query, void *capture,
+                                     brooks_stream_visitor_t visitor)
+{
+    const brooks_filter_t * const *terminators = query->terminators.base, * const *path_filters = query->filters.base;
+    *run = (stream_run_t) {
+        .num_terminators = query->terminators.num_elements,
+        .num_filters = query->terminators.num_elements + query->filters.num_elements,
+        .max_depth = (query->terminators.num_elements == 0 ? SIZE_MAX : 0), .capture = capture, .visitor = visitor,
+        .status = brooks_status_ok
+    };
+
+    // the number of elements is known at the end of an object or array, after it was decided whether to enter it
+    for (size_t i = 0; i < query->filters.num_elements; i++) {
+        if (filter_has_predicate(path_filters[i], filter_predicate_num_elements)) {
+            return brooks_status_wrongusage;
+        }
+    }
+    if ((run->filters = malloc((run->num_filters + 1) * sizeof(brooks_filter_t *))) == NULL) {
+        return brooks_status_malloc_err;
+    }
+    memcpy(run->filters, terminators, run->num_terminators * sizeof(brooks_filter_t *));
+    memcpy(run->filters + run->num_terminators, path_filters, query->filters.num_elements * sizeof(brooks_filter_t *));
+    for (size_t i = 0; i < run->num_filters; i++) {
+        size_t length = brooks_path_length(run->filters[i]->key_path);
+        run->max_length = (length > run->max_length ? length : run->max_length);
+        if (i < run->num_terminators) {
+            run->max_depth = (run->filters[i]->max_depth > run->max_depth ? run->filters[i]->max_depth :
+                                                                           run->max_depth);
+        }
+    }
+
+    // every filter matches the empty chain of keys of a root
+    run->num_words = (run->num_filters + 63) / 64;
+    if ((run->states = calloc((run->max_length + 2) * run->num_words + 1, sizeof(uint64_t))) == NULL) {
+        free(run->filters);
+        return brooks_status_malloc_err;
+    }
+    for (size_t i = 0; i < run->num_filters; i++) {
+        run->states[i / 64] |= (UINT64_C(1) << (i % 64));
+    }
+    return brooks_status_ok;
+}
+
+static void stream_dispose(stream_run_t *run)
+{
+    free(run->filters);
+    free(run->states);
+    free(run->frames);
+    free(run->keys);
+}
+
+static brooks_doc_scan_e stream_token(void *capture, const brooks_doc_token_t *token)
+{
+    stream_run_t *run = capture;
+    stream_frame_t *parent = (run->num_frames > 0 ? run->frames + run->num_frames - 1 : NULL);
+
+    if (token->kind == brooks_doc_token_key) {
+        run->idx = parent->num_children++;
+        stream_advance(run, parent->chain_length + 1, token->key);
+        return (stream_viable(run, stream_states(run, parent->chain_length + 1), run->num_frames - 1) ?
+                brooks_doc_scan_continue : brooks_doc_scan_skip);
+    } else if (token->kind == brooks_doc_token_object_end || token->kind == brooks_doc_token_array_end) {
+        stream_frame_t frame = run->frames[--run->num_frames];
+        brooks_doc_scan_e action = brooks_doc_scan_continue;
+        if (run->num_frames == 0) {
+            run->document++;
+            return action;
+        }
+        candidate_t candidate = {
+            .value = token->value, .key = (frame.key != SIZE_MAX ? run->keys + frame.key : NULL), .idx = frame.idx,
+            .depth = run->num_frames - 1, .position_known = true, .key_chain = NULL,
+            .chain_length = frame.chain_length, .streamed = true, .num_elements = token->num_elements
+        };
+        if (stream_emits(run, &candidate, stream_states(run, frame.chain_length))) {
+            action = stream_report(run, &candidate, frame.begin, token->end);
+        }
+        run->keys_size = (frame.key != SIZE_MAX ? frame.key : run->keys_size);
+        return action;
+    } else if (parent == NULL) {
+        // a root
+        candidate_t root = { .chain_length = 0 };
+        return (stream_push(run, token, &root) ? brooks_doc_scan_continue : brooks_doc_scan_stop);
+    }
+
+    candidate_t candidate = {
+        .value = token->value, .key = (parent->object ? token->key : NULL),
+        .idx = (parent->object ? run->idx : parent->num_children++), .depth = run->num_frames - 1,
+        .position_known = true, .key_chain = NULL, .chain_length = parent->chain_length + parent->object,
+        .streamed = true
+    };
+    const uint64_t *states = stream_states(run, candidate.chain_length);
+    if (token->kind == brooks_doc_token_scalar) {
+        return (stream_emits(run, &candidate, states) ? stream_report(run, &candidate, token->begin, token->end) :
+                                                        brooks_doc_scan_continue);
+    } else if (!stream_push(run, token, &candidate)) {
+        return brooks_doc_scan_stop;
+    } else return (stream_descends(run, &candidate, states) ? brooks_doc_scan_continue : brooks_doc_scan_skip);
+}
+
+static const uint64_t *stream_states(const stream_run_t *run, size_t chain_length)
+{
+    // chains longer than any key path leave the filters without one only
+    size_t row = (chain_length <= run->max_length + 1 ? chain_length : run->max_length + 1);
+    return run->states + row * run->num_words;
+}
+
+// Computes the set of filters that match a chain of 'chain_length' keys from the set of its prefix and its last key
+static void stream_advance(stream_run_t *run, size_t chain_length, const char *key)
+{
+    if (chain_length > run->max_length + 1) {
+        return;
+    }
+    const uint64_t *prefix = run->states + (chain_length - 1) * run->num_words;
+    uint64_t *states = run->states + chain_length * run->num_words;
+    memset(states, 0, run->num_words * sizeof(uint64_t));
+    for (size_t i = 0; i < run->num_filters; i++) {
+        const brooks_path_t *path = run->filters[i]->key_path;
+        if (((prefix[i / 64] >> (i % 64)) & 1) &&
+            (path == NULL || brooks_path_matches_component(path, chain_length - 1, key))) {
+            states[i / 64] |= (UINT64_C(1) << (i % 64));
+        }
+    }
+}
+
+// Whether a terminator may match a value at 'depth' or below whose chain of keys is in 'states'
+static bool stream_viable(const stream_run_t *run, const uint64_t *states, size_t depth)
+{
+    bool viable = (run->num_terminators == 0);
+    for (size_t i = 0; !viable && i < run->num_terminators; i++) {
+        viable = (((states[i / 64] >> (i % 64)) & 1) &&
+                  (run->filters[i]->key_path != NULL || depth <= run->filters[i]->max_depth));
+    }
+    return viable;
+}
+
+static bool stream_emits(const stream_run_t *run, const candidate_t *candidate, const uint64_t *states)
+{
+    bool emit = (run->num_terminators == 0);
+    for (size_t i = 0; !emit && i < run->num_terminators; i++) {
+        emit = (stream_on_path(run, i, candidate, states) && filter_matches(run->filters[i], candidate));
+    }
+    return emit;
+}
+
+// Whether to enter an object or array, as query_traverse descends, unless no terminator can match within it
+static bool stream_descends(const stream_run_t *run, const candidate_t *candidate, const uint64_t *states)
+{
+    bool descend = (candidate->depth < run->max_depth && stream_viable(run, states, candidate->depth + 1));
+    for (size_t i = run->num_terminators; descend && i < run->num_filters; i++) {
+        descend = (stream_on_path(run, i, candidate, states) && filter_matches(run->filters[i], candidate));
+    }
+    return descend;
+}
+
+// Whether the candidate satisfies the key path of the filter 'filter', if any
+static bool stream_on_path(const stream_run_t *run, size_t filter, const candidate_t *candidate,
+                           const uint64_t *states)
+{
+    const brooks_path_t *path = run->filters[filter]->key_path;
+    return (((states[filter / 64] >> (filter % 64)) & 1) &&
+            (path == NULL || candidate->chain_length == brooks_path_length(path)));
+}
+
+static brooks_doc_scan_e stream_report(stream_run_t *run, const candidate_t *candidate, size_t begin, size_t end)
+{
+    brooks_stream_match_t match = {
+        .begin = run->base + begin, .end = run->base + end, .document = run->document, .key = candidate->key,
+        .depth = candidate->depth
+    };
+    run->num_matches++;
+    run->stopped = (run->visitor != NULL && !run->visitor(run->capture, &match));
+    return (run->stopped ? brooks_doc_scan_stop : brooks_doc_scan_continue);
+}
+
+// Opens a frame for the object or array of 'token', and keeps its key until it ends
+static bool stream_push(stream_run_t *run, const brooks_doc_token_t *token, const candidate_t *candidate)
+{
+    size_t key_length = (candidate->key != NULL ? strlen(candidate->key) + 1 : 0);
+    if (run->num_frames == run->frames_capacity || run->keys_size + key_length > run->keys_capacity) {
+        size_t frames_capacity = (run->num_frames == run->frames_capacity ? 2 * run->frames_capacity + 16 :
+                                                                             run->frames_capacity);
+        size_t keys_capacity = (run->keys_size + key_length > run->keys_capacity ?
+                                2 * (run->keys_size + key_length) : run->keys_capacity);
+        stream_frame_t *frames = realloc(run->frames, frames_capacity * sizeof(stream_frame_t));
+        run->frames = (frames != NULL ? frames : run->frames);
+        char *keys = (frames != NULL ? realloc(run->keys, keys_capacity) : NULL);
+        if (keys == NULL) {
+            run->status = brooks_status_malloc_err;
+            return false;
+        }
+        run->keys = keys;
+        run->frames_capacity = frames_capacity;
+        run->keys_capacity = keys_capacity;
+    }
+    run->frames[run->num_frames++] = (stream_frame_t) {
+        .begin = token->begin, .key = (candidate->key != NULL ? run->keys_size : SIZE_MAX), .idx = candidate->idx,
+        .num_children = 0, .chain_length = candidate->chain_length,
+        .object = (token->kind == brooks_doc_token_object_begin)
+    };
+    if (candidate->key != NULL) {
+        memcpy(run->keys + run->keys_size, candidate->key, key_length);
+        run->keys_size += key_length;
+    }
+    return true;
+}
+
+// Reads the next line of 'file' with its line break into 'line', which grows as needed, and returns
+// brooks_status_false at the end of the file
+static brooks_status_e stream_read_line(size_t *length, char **line, size_t *capacity, FILE *file)
+{
+    *length = 0;
+    for (;;) {
+        if (*capacity - *length < 2) {
+            size_t resized_capacity = (*capacity > 0 ? 2 * *capacity : BROOKS_QUERY_STREAM_LINE_CAPACITY);
+            char *resized = realloc(*line, resized_capacity);
+            if (resized == NULL) {
+                return brooks_status_malloc_err;
+            }
+            *line = resized;
+            *capacity = resized_capacity;
+        }
+        size_t available = *capacity - *length;
+        if (fgets(*line + *length, (int) (available < INT_MAX ? available : INT_MAX), file) == NULL) {
+            return (ferror(file) ? brooks_status_failed : (*length > 0 ? brooks_status_ok : brooks_status_false));
+        }
+        *length += strlen(*line + *length);
+        if ((*line)[*length - 1] == '\n') {
+            return brooks_status_ok;
+        }
+    }
+}
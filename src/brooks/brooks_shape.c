@@ -0,0 +1,532 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <brooks/brooks_shape.h>
+#include <brooks/brooks_pool.h>
+#include <brooks/brooks_misc.h>
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef struct shape_index_t
+{
+    size_t                        capacity;
+    _Atomic uint32_t              slots[];                     // first position + 1 per key, open addressing
+} shape_index_t;
+
+// Key arrays grow while the shapes that share them are read by other threads (see brooks_doc_history_create): a
+// grown key array and a rebuilt index are published once complete, and a position in the index after its key
+typedef struct shape_keys_t
+{
+    _Atomic(const char **)        keys;
+    size_t                        num_keys;
+    size_t                        capacity;
+    _Atomic(shape_index_t *)      index;
+    size_t                        duplicate_at;                // first position repeating a key, SIZE_MAX if none
+} shape_keys_t;
+
+typedef struct brooks_shape_t
+{
+    brooks_shape_registry_t      *registry;
+    brooks_shape_t               *parent;
+    uint64_t                      id;                         // registry serial in the upper half
+    const char                   *key;                        // the key added last, NULL for the empty shape
+    uint64_t                      key_hash;
+    shape_keys_t                 *keys;                       // shared, the first 'num_keys' belong to this shape
+    size_t                        num_keys;
+    bool                          has_duplicates;
+    brooks_shape_t               *likely;                     // the child that was transitioned to most often
+    size_t                        num_hits;
+} brooks_shape_t;
+
+typedef struct brooks_shape_registry_t
+{
+    brooks_pool_t                *pool;
+    uint64_t                      serial;
+    brooks_shape_t               *root;
+    brooks_shape_t              **transitions;                // open addressing on (parent, key)
+    size_t                        num_transitions;
+    size_t                        transitions_capacity;
+    const char                  **keys;                       // open addressing on the key's text
+    size_t                        num_keys;
+    size_t                        keys_capacity;
+    size_t                        num_key_arrays;
+    size_t                        max_num_keys;
+    size_t                        bytes;
+} brooks_shape_registry_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// G L O B A L S
+// ---------------------------------------------------------------------------------------------------------------------
+
+static atomic_uint_fast64_t registry_serial = 0;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void *registry_malloc(brooks_shape_registry_t *registry, size_t size);
+static void registry_discard(brooks_shape_registry_t *registry, size_t size);
+static brooks_shape_t *shape_create(brooks_shape_registry_t *registry, brooks_shape_t *parent, const char *key,
+                                    uint64_t key_hash);
+static shape_keys_t *keys_create(brooks_shape_registry_t *registry, size_t capacity);
+static const char **keys_get(const shape_keys_t *keys);
+static bool keys_append(brooks_shape_registry_t *registry, shape_keys_t *keys, const char *key);
+static size_t keys_find(const shape_keys_t *keys, size_t num_keys, const char *key);
+static bool keys_index(brooks_shape_registry_t *registry, shape_keys_t *keys);
+static size_t index_find(const shape_index_t *index, const shape_keys_t *keys, const char *key, uint64_t key_hash);
+static void index_insert(shape_index_t *index, size_t idx, uint64_t key_hash);
+static size_t transitions_hash(const brooks_shape_t *parent, uint64_t key_hash, size_t capacity);
+static brooks_shape_t **transitions_find(brooks_shape_registry_t *registry, const brooks_shape_t *parent,
+                                         const char *key, uint64_t key_hash);
+static bool transitions_reserve(brooks_shape_registry_t *registry);
+static const char **intern_find(brooks_shape_registry_t *registry, const char *key, uint64_t key_hash);
+static bool intern_reserve(brooks_shape_registry_t *registry);
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e brooks_shape_registry_create(brooks_shape_registry_t **registry, brooks_pool_t *pool)
+{
+    if (registry && pool) {
+        brooks_shape_registry_t *result = brooks_pool_malloc_tagged(pool, sizeof(brooks_shape_registry_t),
+                                                                    brooks_pool_category_shape);
+        if (result == NULL) {
+            return brooks_status_pmalloc_err;
+        }
+        memset(result, 0, sizeof(brooks_shape_registry_t));
+        result->pool = pool;
+        result->serial = atomic_fetch_add(&registry_serial, 1) + 1;
+        result->bytes = sizeof(brooks_shape_registry_t);
+        result->transitions_capacity = result->keys_capacity = BROOKS_SHAPE_TABLE_CAPACITY;
+        if ((result->transitions = registry_malloc(result, result->transitions_capacity * sizeof(void *))) == NULL ||
+            (result->keys = registry_malloc(result, result->keys_capacity * sizeof(char *))) == NULL ||
+            (result->root = shape_create(result, NULL, NULL, 0)) == NULL) {
+            return brooks_status_pmalloc_err;
+        }
+        memset(result->transitions, 0, result->transitions_capacity * sizeof(void *));
+        memset(result->keys, 0, result->keys_capacity * sizeof(char *));
+        *registry = result;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_shape_t *brooks_shape_registry_get_root(brooks_shape_registry_t *registry)
+{
+    return (registry ? registry->root : NULL);
+}
+
+const char *brooks_shape_registry_intern(brooks_shape_registry_t *registry, const char *key)
+{
+    if (registry && key && intern_reserve(registry)) {
+        const char **slot = intern_find(registry, key, brooks_misc_hash_str(key));
+        if (*slot == NULL) {
+            char *copy = registry_malloc(registry, strlen(key) + 1);
+            if (copy == NULL) {
+                return NULL;
+            }
+            *slot = strcpy(copy, key);
+            registry->num_keys++;
+        }
+        return *slot;
+    } else return NULL;
+}
+
+brooks_status_e brooks_shape_registry_get_stats(brooks_shape_stats_t *stats, const brooks_shape_registry_t *registry)
+{
+    if (stats && registry) {
+        stats->num_shapes = registry->num_transitions + 1;
+        stats->num_keys = registry->num_keys;
+        stats->num_key_arrays = registry->num_key_arrays;
+        stats->max_num_keys = registry->max_num_keys;
+        stats->bytes = registry->bytes;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_shape_transition(brooks_shape_t **child, brooks_shape_t *shape, const char *key)
+{
+    if (child && shape && key) {
+        brooks_shape_registry_t *registry = shape->registry;
+        uint64_t key_hash = brooks_misc_hash_str(key);
+        if (!transitions_reserve(registry)) {
+            return brooks_status_pmalloc_err;
+        }
+        brooks_shape_t **slot = transitions_find(registry, shape, key, key_hash);
+        brooks_shape_t *result = *slot;
+        if (result == NULL) {
+            if ((result = shape_create(registry, shape, key, key_hash)) == NULL) {
+                return brooks_status_pmalloc_err;
+            }
+            *slot = result;
+            registry->num_transitions++;
+        }
+        result->num_hits++;
+        if (shape->likely == NULL || result->num_hits > shape->likely->num_hits) {
+            shape->likely = result;
+        }
+        *child = result;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+size_t brooks_shape_get_num_keys(const brooks_shape_t *shape)
+{
+    return (shape ? shape->num_keys : 0);
+}
+
+const char *brooks_shape_get_key(const brooks_shape_t *shape, size_t idx)
+{
+    return ((shape && idx < shape->num_keys) ? keys_get(shape->keys)[idx] : NULL);
+}
+
+const brooks_shape_t *brooks_shape_get_parent(const brooks_shape_t *shape)
+{
+    return (shape ? shape->parent : NULL);
+}
+
+uint64_t brooks_shape_get_id(const brooks_shape_t *shape)
+{
+    return (shape ? shape->id : 0);
+}
+
+brooks_status_e brooks_shape_lookup(size_t *idx, const brooks_shape_t *shape, const char *key)
+{
+    if (idx && shape && key) {
+        size_t result = keys_find(shape->keys, shape->num_keys, key);
+        if (result < shape->num_keys) {
+            *idx = result;
+            return brooks_status_true;
+        } else return brooks_status_false;
+    } else return brooks_status_nullptr;
+}
+
+size_t brooks_shape_get_extent(const brooks_shape_t *shape)
+{
+    if (shape) {
+        while (shape->likely != NULL) {
+            shape = shape->likely;
+        }
+        return shape->num_keys;
+    } else return 0;
+}
+
+bool brooks_shape_has_duplicates(const brooks_shape_t *shape)
+{
+    return (shape && shape->has_duplicates);
+}
+
+void brooks_shape_cache_init(brooks_shape_cache_t *cache, const char *key)
+{
+    if (cache) {
+        memset(cache, 0, sizeof(brooks_shape_cache_t));
+        cache->key = key;
+    }
+}
+
+brooks_status_e brooks_shape_cache_lookup(size_t *first, size_t *last, brooks_shape_cache_t *cache,
+                                          const brooks_shape_t *shape)
+{
+    if (first && last && cache && cache->key && shape) {
+        brooks_shape_cache_entry_t *entry = cache->entries;
+        while (entry < cache->entries + BROOKS_SHAPE_CACHE_SIZE && entry->shape_id != shape->id) {
+            entry++;
+        }
+        if (entry < cache->entries + BROOKS_SHAPE_CACHE_SIZE) {
+            cache->num_hits++;
+        } else {
+            cache->num_misses++;
+            entry = cache->entries + cache->next;
+            cache->next = (cache->next + 1) % BROOKS_SHAPE_CACHE_SIZE;
+            entry->shape_id = shape->id;
+            entry->first = entry->last = SIZE_MAX;
+            if (brooks_shape_lookup(&entry->first, shape, cache->key) == brooks_status_true) {
+                entry->last = entry->first;
+                if (brooks_shape_has_duplicates(shape)) {
+                    const char **keys = keys_get(shape->keys);
+                    for (size_t i = entry->first + 1; i < shape->num_keys; i++) {
+                        entry->last = (keys[i] == keys[entry->first] ? i : entry->last);
+                    }
+                }
+            }
+        }
+        *first = entry->first;
+        *last = entry->last;
+        return (entry->first != SIZE_MAX ? brooks_status_true : brooks_status_false);
+    } else return brooks_status_nullptr;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void *registry_malloc(brooks_shape_registry_t *registry, size_t size)
+{
+    registry->bytes += size;
+    return brooks_pool_malloc_tagged(registry->pool, size, brooks_pool_category_shape);
+}
+
+static void registry_discard(brooks_shape_registry_t *registry, size_t size)
+{
+    registry->bytes -= size;
+    brooks_pool_discard(registry->pool, size, brooks_pool_category_shape);
+}
+
+static brooks_shape_t *shape_create(brooks_shape_registry_t *registry, brooks_shape_t *parent, const char *key,
+                                    uint64_t key_hash)
+{
+    brooks_shape_t *shape = registry_malloc(registry, sizeof(brooks_shape_t));
+    if (shape == NULL) {
+        return NULL;
+    }
+    shape->registry = registry;
+    shape->parent = parent;
+    shape->id = (registry->serial << 32) | (parent != NULL ? registry->num_transitions + 1 : 0);
+    shape->key_hash = key_hash;
+    shape->has_duplicates = false;
+    shape->likely = NULL;
+    shape->num_hits = 0;
+    if (parent == NULL) {
+        shape->key = NULL;
+        shape->num_keys = 0;
+        shape->keys = keys_create(registry, 0);
+        return (shape->keys != NULL ? shape : NULL);
+    }
+
+    shape->num_keys = parent->num_keys + 1;
+    if ((shape->key = brooks_shape_registry_intern(registry, key)) == NULL) {
+        return NULL;
+    }
+    // the first child of the shape at the end of a key array extends it, any other child branches off with a copy
+    if (parent->keys->num_keys == parent->num_keys) {
+        shape->keys = parent->keys;
+    } else if ((shape->keys = keys_create(registry, shape->num_keys)) != NULL) {
+        memcpy(keys_get(shape->keys), keys_get(parent->keys), parent->num_keys * sizeof(char *));
+        shape->keys->num_keys = parent->num_keys;
+        shape->keys->duplicate_at = (parent->keys->duplicate_at < parent->num_keys ? parent->keys->duplicate_at :
+                                     SIZE_MAX);
+    } else {
+        return NULL;
+    }
+    if (!keys_append(registry, shape->keys, shape->key)) {
+        return NULL;
+    }
+    shape->has_duplicates = (shape->keys->duplicate_at < shape->num_keys);
+    registry->max_num_keys = (shape->num_keys > registry->max_num_keys ? shape->num_keys : registry->max_num_keys);
+    return shape;
+}
+
+static shape_keys_t *keys_create(brooks_shape_registry_t *registry, size_t capacity)
+{
+    shape_keys_t *keys = registry_malloc(registry, sizeof(shape_keys_t));
+    if (keys != NULL) {
+        keys->num_keys = 0;
+        keys->capacity = capacity;
+        keys->duplicate_at = SIZE_MAX;
+        const char **array = (capacity > 0 ? registry_malloc(registry, capacity * sizeof(char *)) : NULL);
+        atomic_init(&keys->keys, array);
+        atomic_init(&keys->index, NULL);
+        registry->num_key_arrays++;
+        return ((capacity == 0 || array != NULL) ? keys : NULL);
+    } else return NULL;
+}
+
+static const char **keys_get(const shape_keys_t *keys)
+{
+    return atomic_load_explicit(&keys->keys, memory_order_acquire);
+}
+
+static bool keys_append(brooks_shape_registry_t *registry, shape_keys_t *keys, const char *key)
+{
+    const char **array = keys_get(keys);
+    if (keys->num_keys == keys->capacity) {
+        size_t capacity = (keys->capacity < 4 ? 4 : 2 * keys->capacity);
+        const char **grown = registry_malloc(registry, capacity * sizeof(char *));
+        if (grown == NULL) {
+            return false;
+        }
+        if (keys->capacity > 0) {
+            memcpy(grown, array, keys->num_keys * sizeof(char *));
+            registry_discard(registry, keys->capacity * sizeof(char *));
+        }
+        // readers of the shorter array go on with it, it stays in the pool
+        atomic_store_explicit(&keys->keys, (array = grown), memory_order_release);
+        keys->capacity = capacity;
+    }
+    // keys in key arrays are interned, such that they are equal if and only if their addresses are
+    bool duplicate = (keys_find(keys, keys->num_keys, key) < keys->num_keys);
+    keys->duplicate_at = ((duplicate && keys->duplicate_at == SIZE_MAX) ? keys->num_keys : keys->duplicate_at);
+    array[keys->num_keys++] = key;
+    if (keys->num_keys >= BROOKS_SHAPE_INDEX_THRESHOLD) {
+        shape_index_t *index = atomic_load_explicit(&keys->index, memory_order_relaxed);
+        if (index == NULL || index->capacity < 2 * keys->capacity) {
+            return keys_index(registry, keys);
+        } else if (!duplicate) {
+            index_insert(index, keys->num_keys - 1, brooks_misc_hash_str(key));
+        }
+    }
+    return true;
+}
+
+// Position of the first occurrence of 'key' among the first 'num_keys' keys, 'num_keys' or more if there is none
+static size_t keys_find(const shape_keys_t *keys, size_t num_keys, const char *key)
+{
+    const shape_index_t *index = atomic_load_explicit(&keys->index, memory_order_acquire);
+    if (index != NULL) {
+        return index_find(index, keys, key, brooks_misc_hash_str(key));
+    }
+    const char **array = keys_get(keys);
+    for (size_t i = 0; i < num_keys; i++) {
+        if (array[i] == key || strcmp(array[i], key) == 0) {
+            return i;
+        }
+    }
+    return num_keys;
+}
+
+// (Re-)builds the index of 'keys' at twice the capacity of the key array, such that it is rebuilt when that grows
+static bool keys_index(brooks_shape_registry_t *registry, shape_keys_t *keys)
+{
+    size_t capacity = 2 * keys->capacity;
+    shape_index_t *index = registry_malloc(registry, sizeof(shape_index_t) + capacity * sizeof(uint32_t));
+    if (index == NULL) {
+        return false;
+    }
+    index->capacity = capacity;
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(index->slots + i, 0);
+    }
+    const char **array = keys_get(keys);
+    for (size_t i = 0; i < keys->num_keys; i++) {
+        uint64_t key_hash = brooks_misc_hash_str(array[i]);
+        if (i < keys->duplicate_at || index_find(index, keys, array[i], key_hash) == SIZE_MAX) {
+            index_insert(index, i, key_hash);
+        }
+    }
+    shape_index_t *previous = atomic_load_explicit(&keys->index, memory_order_relaxed);
+    if (previous != NULL) {
+        registry_discard(registry, sizeof(shape_index_t) + previous->capacity * sizeof(uint32_t));
+    }
+    atomic_store_explicit(&keys->index, index, memory_order_release);
+    return true;
+}
+
+// Position of the first occurrence of 'key' in the index, SIZE_MAX if there is none. The key array is loaded after
+// each position, which may have been published after the key array was last grown
+static size_t index_find(const shape_index_t *index, const shape_keys_t *keys, const char *key, uint64_t key_hash)
+{
+    size_t slot = (size_t) (key_hash % index->capacity);
+    for (uint32_t pos; (pos = atomic_load_explicit(index->slots + slot, memory_order_acquire)) != 0;
+         slot = (slot + 1) % index->capacity) {
+        const char *it = keys_get(keys)[pos - 1];
+        if (it == key || strcmp(it, key) == 0) {
+            return pos - 1;
+        }
+    }
+    return SIZE_MAX;
+}
+
+static void index_insert(shape_index_t *index, size_t idx, uint64_t key_hash)
+{
+    size_t slot = (size_t) (key_hash % index->capacity);
+    while (atomic_load_explicit(index->slots + slot, memory_order_relaxed) != 0) {
+        slot = (slot + 1) % index->capacity;
+    }
+    atomic_store_explicit(index->slots + slot, (uint32_t) (idx + 1), memory_order_release);
+}
+
+static size_t transitions_hash(const brooks_shape_t *parent, uint64_t key_hash, size_t capacity)
+{
+    uint64_t hash = key_hash ^ ((uint64_t) (uintptr_t) parent * 0x9e3779b97f4a7c15ULL);
+    hash ^= hash >> 29;
+    return (size_t) (hash % capacity);
+}
+
+static brooks_shape_t **transitions_find(brooks_shape_registry_t *registry, const brooks_shape_t *parent,
+                                         const char *key, uint64_t key_hash)
+{
+    size_t capacity = registry->transitions_capacity;
+    size_t slot = transitions_hash(parent, key_hash, capacity);
+    brooks_shape_t *it;
+    while ((it = registry->transitions[slot]) != NULL &&
+           (it->parent != parent || it->key_hash != key_hash || strcmp(it->key, key) != 0)) {
+        slot = (slot + 1) % capacity;
+    }
+    return registry->transitions + slot;
+}
+
+static bool transitions_reserve(brooks_shape_registry_t *registry)
+{
+    if (2 * (registry->num_transitions + 1) > registry->transitions_capacity) {
+        size_t old_capacity = registry->transitions_capacity, capacity = 2 * old_capacity;
+        brooks_shape_t **old = registry->transitions;
+        if ((registry->transitions = registry_malloc(registry, capacity * sizeof(void *))) == NULL) {
+            registry->transitions = old;
+            return false;
+        }
+        memset(registry->transitions, 0, capacity * sizeof(void *));
+        registry->transitions_capacity = capacity;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old[i] != NULL) {
+                *transitions_find(registry, old[i]->parent, old[i]->key, old[i]->key_hash) = old[i];
+            }
+        }
+        registry_discard(registry, old_capacity * sizeof(void *));
+    }
+    return true;
+}
+
+static const char **intern_find(brooks_shape_registry_t *registry, const char *key, uint64_t key_hash)
+{
+    size_t capacity = registry->keys_capacity;
+    size_t slot = (size_t) (key_hash % capacity);
+    while (registry->keys[slot] != NULL && strcmp(registry->keys[slot], key) != 0) {
+        slot = (slot + 1) % capacity;
+    }
+    return registry->keys + slot;
+}
+
+static bool intern_reserve(brooks_shape_registry_t *registry)
+{
+    if (2 * (registry->num_keys + 1) > registry->keys_capacity) {
+        size_t old_capacity = registry->keys_capacity, capacity = 2 * old_capacity;
+        const char **old = registry->keys;
+        if ((registry->keys = registry_malloc(registry, capacity * sizeof(char *))) == NULL) {
+            registry->keys = old;
+            return false;
+        }
+        memset(registry->keys, 0, capacity * sizeof(char *));
+        registry->keys_capacity = capacity;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old[i] != NULL) {
+                *intern_find(registry, old[i], brooks_misc_hash_str(old[i])) = old[i];
+            }
+        }
+        registry_discard(registry, old_capacity * sizeof(char *));
+    }
+    return true;
+}
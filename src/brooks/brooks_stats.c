@@ -0,0 +1,527 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <brooks/brooks_stats.h>
+#include <brooks/brooks_doc.h>
+#include <brooks/brooks_misc.h>
+#include <brooks/brooks_path.h>
+
+// ---------------------------------------------------------------------------------------------------------------------
+// C O N S T A N T S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#define SKETCH_NUM_REGISTERS     (1 << BROOKS_STATS_SKETCH_BITS)
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef struct path_stats_t
+{
+    brooks_stats_path_t           counters;
+    uint64_t                      hash;
+    size_t                        last_document;
+    uint8_t                       sketch[SKETCH_NUM_REGISTERS];
+    double                       *sample;
+    size_t                        sample_size;
+    bool                          sample_sorted;
+    double                        histogram[BROOKS_STATS_HISTOGRAM_BUCKETS + 1];
+} path_stats_t;
+
+typedef struct brooks_stats_t
+{
+    path_stats_t                **slots;
+    size_t                        num_paths;
+    size_t                        capacity;
+    size_t                        num_documents;
+    size_t                        num_values;
+    uint64_t                      random;
+    char                         *path;
+    size_t                        path_capacity;
+    brooks_pool_t                *pool;
+} brooks_stats_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void stats_visit_object(brooks_stats_t *stats, const brooks_object_t *object, size_t path_length);
+static void stats_visit_value(brooks_stats_t *stats, path_stats_t *entry, const brooks_value_t *value,
+                              size_t path_length);
+static void stats_count_document(const brooks_stats_t *stats, path_stats_t *entry);
+static void stats_sample(brooks_stats_t *stats, path_stats_t *entry, double number);
+static uint64_t stats_random(brooks_stats_t *stats);
+
+static path_stats_t *paths_find(const brooks_stats_t *stats, const char *key_path, uint64_t hash);
+static path_stats_t *paths_upsert(brooks_stats_t *stats, const char *key_path);
+static void paths_rehash(brooks_stats_t *stats);
+
+static uint64_t hash_mix(uint64_t hash);
+static uint64_t hash_number(double number);
+static void sketch_add(uint8_t *sketch, uint64_t hash);
+static double sketch_estimate(const uint8_t *sketch);
+
+static void sample_prepare(path_stats_t *entry);
+static size_t sample_rank(const path_stats_t *entry, double number, bool inclusive);
+static bool key_is_number(const brooks_index_key_t *key);
+static double key_as_number(const brooks_index_key_t *key);
+static int compare_numbers(const void *lhs, const void *rhs);
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e brooks_stats_create(brooks_stats_t **stats, brooks_pool_t *pool)
+{
+    if (stats && pool) {
+        brooks_stats_t *result = brooks_pool_malloc(pool, sizeof(brooks_stats_t));
+        result->capacity = BROOKS_STATS_PATHS_CAPACITY;
+        result->slots = calloc(result->capacity, sizeof(path_stats_t *));
+        result->num_paths = 0;
+        result->num_documents = 0;
+        result->num_values = 0;
+        result->random = 0x9e3779b97f4a7c15ULL;
+        result->path_capacity = 64;
+        result->path = malloc(result->path_capacity);
+        result->pool = pool;
+        if (result->slots == NULL || result->path == NULL) {
+            return brooks_status_malloc_err;
+        }
+        *stats = result;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_stats_add(brooks_stats_t *stats, const brooks_object_t *document)
+{
+    if (stats && document) {
+        size_t num_entries = brooks_doc_object_num_elements(document);
+        stats->num_documents++;
+        stats->path[0] = '\0';
+
+        path_stats_t *root = paths_upsert(stats, stats->path);
+        stats_count_document(stats, root);
+        root->counters.num_values++;
+        root->counters.num_objects++;
+        root->counters.sum_object_lengths += num_entries;
+        root->counters.max_object_length = (num_entries > root->counters.max_object_length ?
+                                            num_entries : root->counters.max_object_length);
+
+        stats_visit_object(stats, document, 0);
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+size_t brooks_stats_num_documents(const brooks_stats_t *stats)
+{
+    return (stats ? stats->num_documents : 0);
+}
+
+size_t brooks_stats_num_values(const brooks_stats_t *stats)
+{
+    return (stats ? stats->num_values : 0);
+}
+
+const brooks_stats_path_t *brooks_stats_get(const brooks_stats_t *stats, const char *key_path)
+{
+    if (stats && key_path) {
+        path_stats_t *entry = paths_find(stats, key_path, brooks_misc_hash_str(key_path));
+        return (entry != NULL ? &entry->counters : NULL);
+    } else return NULL;
+}
+
+double brooks_stats_distinct(const brooks_stats_t *stats, const char *key_path)
+{
+    const path_stats_t *entry = (const path_stats_t *) brooks_stats_get(stats, key_path);
+    if (entry) {
+        double num_scalars = (double) (entry->counters.num_values - entry->counters.num_objects);
+        return fmin(sketch_estimate(entry->sketch), num_scalars);
+    } else return 0;
+}
+
+const double *brooks_stats_histogram(size_t *num_bounds, brooks_stats_t *stats, const char *key_path)
+{
+    path_stats_t *entry = (path_stats_t *) brooks_stats_get(stats, key_path);
+    if (num_bounds && entry && entry->sample_size > 0) {
+        sample_prepare(entry);
+        *num_bounds = BROOKS_STATS_HISTOGRAM_BUCKETS + 1;
+        return entry->histogram;
+    } else return NULL;
+}
+
+double brooks_stats_selectivity_range(brooks_stats_t *stats, const char *key_path, const brooks_index_key_t *lower,
+                                      bool lower_inclusive, const brooks_index_key_t *upper, bool upper_inclusive)
+{
+    path_stats_t *entry = (path_stats_t *) brooks_stats_get(stats, key_path);
+    const brooks_index_key_t *bound = (lower ? lower : upper);
+    if (entry == NULL || bound == NULL || entry->counters.num_values == 0) {
+        return 0;
+    }
+
+    const brooks_stats_path_t *counters = &entry->counters;
+    double num_values = (double) counters->num_values;
+
+    if (key_is_number(bound)) {
+        if (entry->sample_size == 0) {
+            return 0;
+        }
+        sample_prepare(entry);
+        size_t begin = (lower ? sample_rank(entry, key_as_number(lower), !lower_inclusive) : 0);
+        size_t end = (upper ? sample_rank(entry, key_as_number(upper), upper_inclusive) : entry->sample_size);
+        double fraction = (end > begin ? (double) (end - begin) / entry->sample_size : 0);
+        return fraction * counters->num_numbers / num_values;
+    }
+
+    switch (bound->type) {
+        case brooks_type_boolean: {
+            bool admits_false = (lower == NULL || (!lower->boolean && lower_inclusive));
+            bool admits_true = (upper == NULL || (upper->boolean && upper_inclusive));
+            size_t num_false = counters->num_booleans - counters->num_true;
+            return ((admits_false ? num_false : 0) + (admits_true ? counters->num_true : 0)) / num_values;
+        }
+        case brooks_type_null:
+            return counters->num_nulls / num_values;
+        case brooks_type_string:
+            return BROOKS_STATS_DEFAULT_SELECTIVITY * counters->num_strings / num_values;
+        default:
+            return 0;
+    }
+}
+
+double brooks_stats_selectivity_equals(brooks_stats_t *stats, const char *key_path, const brooks_index_key_t *key)
+{
+    path_stats_t *entry = (path_stats_t *) brooks_stats_get(stats, key_path);
+    if (entry == NULL || key == NULL || entry->counters.num_values == 0) {
+        return 0;
+    }
+
+    const brooks_stats_path_t *counters = &entry->counters;
+    double num_values = (double) counters->num_values;
+    double distinct = fmax(brooks_stats_distinct(stats, key_path), 1);
+
+    if (key_is_number(key)) {
+        if (entry->sample_size == 0) {
+            return 0;
+        }
+        sample_prepare(entry);
+        double number = key_as_number(key);
+        size_t count = sample_rank(entry, number, true) - sample_rank(entry, number, false);
+
+        // a number missing in the sample is at most as frequent as a single sample slot
+        double fraction = (count > 0 ? (double) count / entry->sample_size :
+                                       1.0 / fmax(distinct, (double) entry->sample_size));
+        return fraction * counters->num_numbers / num_values;
+    }
+
+    switch (key->type) {
+        case brooks_type_boolean:
+            return (key->boolean ? counters->num_true : counters->num_booleans - counters->num_true) / num_values;
+        case brooks_type_null:
+            return counters->num_nulls / num_values;
+        case brooks_type_string:
+            return counters->num_strings / num_values / distinct;
+        default:
+            return 0;
+    }
+}
+
+brooks_status_e brooks_stats_dispose(brooks_stats_t *stats)
+{
+    if (stats) {
+        for (size_t i = 0; i < stats->capacity; i++) {
+            if (stats->slots[i] != NULL) {
+                free(stats->slots[i]->sample);
+                free(stats->slots[i]);
+            }
+        }
+        free(stats->slots);
+        free(stats->path);
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void stats_visit_object(brooks_stats_t *stats, const brooks_object_t *object, size_t path_length)
+{
+    for (size_t i = 0; i < brooks_doc_object_num_elements(object); i++) {
+        const char *key = brooks_doc_object_get_key(object, i);
+        size_t key_length = strlen(key);
+        size_t child_length = path_length + (path_length > 0) + key_length;
+
+        if (child_length + 1 > stats->path_capacity) {
+            stats->path = brooks_misc_autoresize(stats->path, sizeof(char), path_length + 1, &stats->path_capacity,
+                                                 child_length - path_length);
+        }
+        char *end = stats->path + path_length;
+        if (path_length > 0) {
+            *end++ = BROOKS_PATH_SEPARATOR;
+        }
+        memcpy(end, key, key_length + 1);
+
+        stats_visit_value(stats, paths_upsert(stats, stats->path), brooks_doc_object_get_value(object, i),
+                          child_length);
+        stats->path[path_length] = '\0';
+    }
+}
+
+static void stats_visit_value(brooks_stats_t *stats, path_stats_t *entry, const brooks_value_t *value,
+                              size_t path_length)
+{
+    brooks_stats_path_t *counters = &entry->counters;
+    brooks_type_e type;
+    brooks_doc_value_get_type(&type, value);
+    stats_count_document(stats, entry);
+
+    // arrays are transparent, their elements are the values at the array's path
+    if (type == brooks_type_array) {
+        const brooks_array_t *array = brooks_doc_value_as_array(value);
+        size_t length = brooks_doc_array_get_length(array);
+        counters->num_arrays++;
+        counters->sum_array_lengths += length;
+        counters->max_array_length = (length > counters->max_array_length ? length : counters->max_array_length);
+        for (brooks_unnamed_entry_t **it = brooks_doc_array_begin(array); it < brooks_doc_array_end(array); it++) {
+            stats_visit_value(stats, entry, brooks_doc_unnamed_entry_get_value(*it), path_length);
+        }
+        return;
+    }
+
+    counters->num_values++;
+    stats->num_values++;
+
+    switch (type) {
+        case brooks_type_object: {
+            const brooks_object_t *object = brooks_doc_value_as_object(value);
+            size_t length = brooks_doc_object_num_elements(object);
+            counters->num_objects++;
+            counters->sum_object_lengths += length;
+            counters->max_object_length = (length > counters->max_object_length ?
+                                           length : counters->max_object_length);
+            stats_visit_object(stats, object, path_length);
+            break;
+        }
+        case brooks_type_number_integer:
+        case brooks_type_number_double: {
+            double number = (type == brooks_type_number_integer ? (double) brooks_doc_value_as_integer(value) :
+                                                                  brooks_doc_value_as_double(value));
+            counters->num_numbers++;
+            if (!isnan(number)) {
+                sketch_add(entry->sketch, hash_number(number));
+                stats_sample(stats, entry, number);
+            }
+            break;
+        }
+        case brooks_type_string:
+            counters->num_strings++;
+            sketch_add(entry->sketch, hash_mix(brooks_misc_hash_str(brooks_doc_value_as_string(value))));
+            break;
+        case brooks_type_boolean:
+            counters->num_booleans++;
+            counters->num_true += brooks_doc_value_as_boolean(value);
+            sketch_add(entry->sketch, hash_mix(brooks_type_boolean + brooks_doc_value_as_boolean(value)));
+            break;
+        case brooks_type_null:
+            counters->num_nulls++;
+            sketch_add(entry->sketch, hash_mix(brooks_type_null));
+            break;
+        default:
+            break;
+    }
+}
+
+static void stats_count_document(const brooks_stats_t *stats, path_stats_t *entry)
+{
+    if (entry->last_document != stats->num_documents) {
+        entry->last_document = stats->num_documents;
+        entry->counters.num_documents++;
+    }
+}
+
+static void stats_sample(brooks_stats_t *stats, path_stats_t *entry, double number)
+{
+    // reservoir sampling keeps a uniform sample of all numbers seen at this path
+    if (entry->sample == NULL) {
+        entry->sample = malloc(BROOKS_STATS_SAMPLE_SIZE * sizeof(double));
+    }
+    if (entry->sample_size < BROOKS_STATS_SAMPLE_SIZE) {
+        entry->sample[entry->sample_size++] = number;
+        entry->sample_sorted = false;
+    } else {
+        uint64_t slot = stats_random(stats) % entry->counters.num_numbers;
+        if (slot < BROOKS_STATS_SAMPLE_SIZE) {
+            entry->sample[slot] = number;
+            entry->sample_sorted = false;
+        }
+    }
+}
+
+static uint64_t stats_random(brooks_stats_t *stats)
+{
+    // xorshift64*
+    stats->random ^= stats->random >> 12;
+    stats->random ^= stats->random << 25;
+    stats->random ^= stats->random >> 27;
+    return stats->random * 0x2545f4914f6cdd1dULL;
+}
+
+static path_stats_t *paths_find(const brooks_stats_t *stats, const char *key_path, uint64_t hash)
+{
+    size_t mask = stats->capacity - 1;
+    for (size_t slot = hash & mask; stats->slots[slot] != NULL; slot = (slot + 1) & mask) {
+        path_stats_t *entry = stats->slots[slot];
+        if (entry->hash == hash && strcmp(entry->counters.key_path, key_path) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static path_stats_t *paths_upsert(brooks_stats_t *stats, const char *key_path)
+{
+    uint64_t hash = brooks_misc_hash_str(key_path);
+    path_stats_t *entry = paths_find(stats, key_path, hash);
+    if (entry == NULL) {
+        if ((stats->num_paths + 1) * 2 > stats->capacity) {
+            paths_rehash(stats);
+        }
+        entry = calloc(1, sizeof(path_stats_t));
+        entry->counters.key_path = brooks_misc_strdup(stats->pool, key_path);
+        entry->hash = hash;
+
+        size_t mask = stats->capacity - 1, slot = hash & mask;
+        while (stats->slots[slot] != NULL) {
+            slot = (slot + 1) & mask;
+        }
+        stats->slots[slot] = entry;
+        stats->num_paths++;
+    }
+    return entry;
+}
+
+static void paths_rehash(brooks_stats_t *stats)
+{
+    path_stats_t **old_slots = stats->slots;
+    size_t old_capacity = stats->capacity;
+    stats->capacity *= 2;
+    stats->slots = calloc(stats->capacity, sizeof(path_stats_t *));
+
+    size_t mask = stats->capacity - 1;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_slots[i] != NULL) {
+            size_t slot = old_slots[i]->hash & mask;
+            while (stats->slots[slot] != NULL) {
+                slot = (slot + 1) & mask;
+            }
+            stats->slots[slot] = old_slots[i];
+        }
+    }
+    free(old_slots);
+}
+
+static uint64_t hash_mix(uint64_t hash)
+{
+    // murmur3 finalizer, spreads the entropy of FNV hashes to the high bits used by the sketch
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static uint64_t hash_number(double number)
+{
+    uint64_t bits;
+    number = (number == 0 ? 0 : number);
+    memcpy(&bits, &number, sizeof(bits));
+    return hash_mix(bits);
+}
+
+static void sketch_add(uint8_t *sketch, uint64_t hash)
+{
+    // HyperLogLog: the leading bits select the register, the register keeps the longest run of leading zeros
+    size_t reg = (size_t) (hash >> (64 - BROOKS_STATS_SKETCH_BITS));
+    uint64_t rest = (hash << BROOKS_STATS_SKETCH_BITS) | (1ULL << (BROOKS_STATS_SKETCH_BITS - 1));
+    uint8_t rank = (uint8_t) (__builtin_clzll(rest) + 1);
+    sketch[reg] = (rank > sketch[reg] ? rank : sketch[reg]);
+}
+
+static double sketch_estimate(const uint8_t *sketch)
+{
+    const double m = SKETCH_NUM_REGISTERS;
+    double sum = 0;
+    size_t num_zeros = 0;
+    for (size_t i = 0; i < SKETCH_NUM_REGISTERS; i++) {
+        sum += ldexp(1.0, -sketch[i]);
+        num_zeros += (sketch[i] == 0);
+    }
+    double estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+    return ((estimate <= 2.5 * m && num_zeros > 0) ? m * log(m / num_zeros) : estimate);
+}
+
+static void sample_prepare(path_stats_t *entry)
+{
+    if (!entry->sample_sorted) {
+        qsort(entry->sample, entry->sample_size, sizeof(double), compare_numbers);
+        for (size_t bucket = 0; bucket <= BROOKS_STATS_HISTOGRAM_BUCKETS; bucket++) {
+            entry->histogram[bucket] = entry->sample[bucket * (entry->sample_size - 1) /
+                                                     BROOKS_STATS_HISTOGRAM_BUCKETS];
+        }
+        entry->sample_sorted = true;
+    }
+}
+
+static size_t sample_rank(const path_stats_t *entry, double number, bool inclusive)
+{
+    // number of sampled values less than (or equal to, if 'inclusive') 'number'
+    size_t begin = 0, end = entry->sample_size;
+    while (begin < end) {
+        size_t mid = begin + (end - begin) / 2;
+        if (entry->sample[mid] < number || (inclusive && entry->sample[mid] == number)) {
+            begin = mid + 1;
+        } else {
+            end = mid;
+        }
+    }
+    return begin;
+}
+
+static bool key_is_number(const brooks_index_key_t *key)
+{
+    return (key->type == brooks_type_number_integer || key->type == brooks_type_number_double);
+}
+
+static double key_as_number(const brooks_index_key_t *key)
+{
+    return (key->type == brooks_type_number_integer ? (double) key->integer : key->decimal);
+}
+
+static int compare_numbers(const void *lhs, const void *rhs)
+{
+    double a = *(const double *) lhs, b = *(const double *) rhs;
+    return (a > b) - (a < b);
+}
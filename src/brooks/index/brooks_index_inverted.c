@@ -0,0 +1,457 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <brooks/index/brooks_index_inverted.h>
+#include <brooks/query/brooks_cursor.h>
+#include <brooks/brooks_doc.h>
+#include <brooks/brooks_path.h>
+#include <brooks/brooks_misc.h>
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef struct posting_list_t
+{
+    uint8_t                      *bytes;
+    size_t                        num_bytes;
+    size_t                        capacity;
+    size_t                        num_postings;
+    uint64_t                      last_id;
+} posting_list_t;
+
+typedef struct term_t
+{
+    uint64_t                      hash;
+    char                         *term;
+    posting_list_t                postings;
+} term_t;
+
+typedef struct dictionary_t
+{
+    term_t                       *slots;
+    size_t                        num_terms;
+    size_t                        capacity;
+} dictionary_t;
+
+typedef struct brooks_index_inverted_t
+{
+    brooks_path_t                *path;
+    dictionary_t                  terms;
+    dictionary_t                  exact;
+    const brooks_value_t        **values;
+    size_t                        num_values;
+    size_t                        values_capacity;
+    char                         *scratch;
+    size_t                        scratch_capacity;
+    brooks_misc_set_t             documents;     // added so far
+} brooks_index_inverted_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void index_add_value(void *capture, const brooks_value_t *value);
+
+static void dictionary_create(dictionary_t *dict, size_t capacity);
+static void dictionary_dispose(dictionary_t *dict);
+static term_t *dictionary_find(const dictionary_t *dict, const char *term, uint64_t hash);
+static term_t *dictionary_upsert(dictionary_t *dict, const char *term);
+static void dictionary_rehash(dictionary_t *dict);
+
+static void postings_add(posting_list_t *list, uint64_t id);
+static size_t postings_decode(uint64_t *ids, const posting_list_t *list);
+static size_t postings_intersect(uint64_t *ids, size_t num_ids, const posting_list_t *list);
+static void postings_emit(brooks_cursor_t *result, const brooks_index_inverted_t *index, const posting_list_t *list);
+
+static const char *token_next(char *token, const char **it);
+static int term_compare_by_postings(const void *lhs, const void *rhs);
+static void lookup_emit(brooks_cursor_t *result, const brooks_index_inverted_t *index, const uint64_t *ids,
+                        size_t num_ids);
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e brooks_index_inverted_create(brooks_index_inverted_t **index, brooks_pool_t *pool,
+                                             const char *key_path)
+{
+    if (index && pool) {
+        brooks_index_inverted_t *result = brooks_pool_malloc(pool, sizeof(brooks_index_inverted_t));
+        brooks_status_e status;
+        if ((status = brooks_path_create(&result->path, pool, key_path)) != brooks_status_ok) {
+            return status;
+        }
+        dictionary_create(&result->terms, BROOKS_INDEX_INVERTED_TERMS_CAPACITY);
+        dictionary_create(&result->exact, BROOKS_INDEX_INVERTED_TERMS_CAPACITY);
+        result->values_capacity = BROOKS_INDEX_INVERTED_VALUES_CAPACITY;
+        result->values = malloc(result->values_capacity * sizeof(brooks_value_t *));
+        result->num_values = 0;
+        result->scratch_capacity = 64;
+        result->scratch = malloc(result->scratch_capacity);
+        *index = result;
+        if ((status = brooks_misc_set_create(&result->documents)) != brooks_status_ok) {
+            return status;
+        }
+        return ((result->values && result->scratch && result->terms.slots && result->exact.slots) ?
+                brooks_status_ok : brooks_status_malloc_err);
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_index_inverted_add(brooks_index_inverted_t *index, const brooks_object_t *document)
+{
+    brooks_status_e status = brooks_path_visit(index ? index->path : NULL, document, index, index_add_value);
+    return (status == brooks_status_ok ? brooks_misc_set_insert(&index->documents, document) : status);
+}
+
+bool brooks_index_inverted_covers(const brooks_index_inverted_t *index, const brooks_object_t *document)
+{
+    return (index && brooks_misc_set_contains(&index->documents, document));
+}
+
+brooks_status_e brooks_index_inverted_lookup(brooks_cursor_t *result, const brooks_index_inverted_t *index,
+                                             brooks_index_match_e match, const char *needle)
+{
+    if (!result || !index || !needle) {
+        return brooks_status_nullptr;
+    }
+
+    if (match == brooks_index_match_equals) {
+        const term_t *term = dictionary_find(&index->exact, needle, brooks_misc_hash_str(needle));
+        if (term != NULL) {
+            postings_emit(result, index, &term->postings);
+        }
+        return brooks_status_ok;
+    } else if (match == brooks_index_match_contains) {
+        size_t needle_len = strlen(needle);
+        char *token = malloc(needle_len + 1);
+        const term_t **terms = malloc((needle_len / 2 + 1) * sizeof(term_t *));
+        size_t num_terms = 0;
+        bool missing = false;
+
+        for (const char *it = needle; !missing && token_next(token, &it) != NULL; ) {
+            const term_t *term = dictionary_find(&index->terms, token, brooks_misc_hash_str(token));
+            missing = (term == NULL);
+            terms[num_terms++] = term;
+        }
+        free(token);
+
+        if (!missing && num_terms == 0) {
+            brooks_cursor_append(result, index->values, index->num_values);
+        } else if (!missing) {
+            // intersect smallest lists first to keep the candidate set small
+            qsort(terms, num_terms, sizeof(term_t *), term_compare_by_postings);
+            uint64_t *ids = malloc(terms[0]->postings.num_postings * sizeof(uint64_t));
+            size_t num_ids = postings_decode(ids, &terms[0]->postings);
+            for (size_t i = 1; i < num_terms && num_ids > 0; i++) {
+                num_ids = postings_intersect(ids, num_ids, &terms[i]->postings);
+            }
+            lookup_emit(result, index, ids, num_ids);
+            free(ids);
+        }
+        free(terms);
+        return brooks_status_ok;
+    } else return brooks_status_illegalarg;
+}
+
+bool brooks_index_inverted_matches(brooks_index_match_e match, const char *value, const char *needle)
+{
+    if (!value || !needle) {
+        return false;
+    } else if (match == brooks_index_match_equals) {
+        return (strcmp(value, needle) == 0);
+    } else {
+        // same semantics as the index lookup: every needle term must be a term of the value
+        // short strings are tokenized on the stack, filters evaluate this once per candidate
+        char needle_buffer[BROOKS_INDEX_INVERTED_TOKEN_BUFFER], value_buffer[BROOKS_INDEX_INVERTED_TOKEN_BUFFER];
+        size_t needle_len = strlen(needle), value_len = strlen(value);
+        char *needle_token = (needle_len < sizeof(needle_buffer) ? needle_buffer : malloc(needle_len + 1));
+        char *value_token = (value_len < sizeof(value_buffer) ? value_buffer : malloc(value_len + 1));
+        bool result = true;
+        for (const char *it = needle; result && token_next(needle_token, &it) != NULL; ) {
+            result = false;
+            for (const char *jt = value; !result && token_next(value_token, &jt) != NULL; ) {
+                result = (strcmp(needle_token, value_token) == 0);
+            }
+        }
+        if (needle_token != needle_buffer) {
+            free(needle_token);
+        }
+        if (value_token != value_buffer) {
+            free(value_token);
+        }
+        return result;
+    }
+}
+
+size_t brooks_index_inverted_num_terms(const brooks_index_inverted_t *index)
+{
+    return (index ? index->terms.num_terms : 0);
+}
+
+size_t brooks_index_inverted_num_values(const brooks_index_inverted_t *index)
+{
+    return (index ? index->num_values : 0);
+}
+
+const char *brooks_index_inverted_key_path(const brooks_index_inverted_t *index)
+{
+    return (index ? brooks_path_str(index->path) : NULL);
+}
+
+brooks_status_e brooks_index_inverted_dispose(brooks_index_inverted_t *index)
+{
+    if (index) {
+        dictionary_dispose(&index->terms);
+        dictionary_dispose(&index->exact);
+        free(index->values);
+        free(index->scratch);
+        brooks_misc_set_dispose(&index->documents);
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void index_add_value(void *capture, const brooks_value_t *value)
+{
+    brooks_index_inverted_t *index = (brooks_index_inverted_t *) capture;
+    brooks_type_e type;
+    brooks_doc_value_get_type(&type, value);
+
+    if (type == brooks_type_string) {
+        const char *string = brooks_doc_value_as_string(value);
+        uint64_t id = index->num_values;
+
+        index->values = brooks_misc_autoresize(index->values, sizeof(brooks_value_t *), index->num_values,
+                                               &index->values_capacity, 1);
+        index->values[index->num_values++] = value;
+
+        postings_add(&dictionary_upsert(&index->exact, string)->postings, id);
+
+        size_t len = strlen(string);
+        index->scratch = brooks_misc_autoresize(index->scratch, sizeof(char), 0, &index->scratch_capacity, len + 1);
+        for (const char *it = string; token_next(index->scratch, &it) != NULL; ) {
+            postings_add(&dictionary_upsert(&index->terms, index->scratch)->postings, id);
+        }
+    }
+}
+
+static void dictionary_create(dictionary_t *dict, size_t capacity)
+{
+    // capacity is kept a power of two such that probing can mask instead of divide
+    size_t pow2 = 1;
+    while (pow2 < capacity) {
+        pow2 <<= 1;
+    }
+    dict->capacity = pow2;
+    dict->num_terms = 0;
+    dict->slots = calloc(pow2, sizeof(term_t));
+}
+
+static void dictionary_dispose(dictionary_t *dict)
+{
+    for (size_t i = 0; i < dict->capacity; i++) {
+        if (dict->slots[i].term != NULL) {
+            free(dict->slots[i].term);
+            free(dict->slots[i].postings.bytes);
+        }
+    }
+    free(dict->slots);
+}
+
+static term_t *dictionary_find(const dictionary_t *dict, const char *term, uint64_t hash)
+{
+    size_t mask = dict->capacity - 1;
+    for (size_t slot = hash & mask; dict->slots[slot].term != NULL; slot = (slot + 1) & mask) {
+        if (dict->slots[slot].hash == hash && strcmp(dict->slots[slot].term, term) == 0) {
+            return dict->slots + slot;
+        }
+    }
+    return NULL;
+}
+
+static term_t *dictionary_upsert(dictionary_t *dict, const char *term)
+{
+    uint64_t hash = brooks_misc_hash_str(term);
+    term_t *result = dictionary_find(dict, term, hash);
+    if (result == NULL) {
+        if ((dict->num_terms + 1) * 4 > dict->capacity * 3) {
+            dictionary_rehash(dict);
+        }
+        size_t mask = dict->capacity - 1;
+        size_t slot = hash & mask;
+        while (dict->slots[slot].term != NULL) {
+            slot = (slot + 1) & mask;
+        }
+        result = dict->slots + slot;
+        result->hash = hash;
+        result->term = malloc(strlen(term) + 1);
+        strcpy(result->term, term);
+        memset(&result->postings, 0, sizeof(posting_list_t));
+        dict->num_terms++;
+    }
+    return result;
+}
+
+static void dictionary_rehash(dictionary_t *dict)
+{
+    term_t *old_slots = dict->slots;
+    size_t old_capacity = dict->capacity;
+
+    dict->capacity = old_capacity * 2;
+    dict->slots = calloc(dict->capacity, sizeof(term_t));
+
+    size_t mask = dict->capacity - 1;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_slots[i].term != NULL) {
+            size_t slot = old_slots[i].hash & mask;
+            while (dict->slots[slot].term != NULL) {
+                slot = (slot + 1) & mask;
+            }
+            dict->slots[slot] = old_slots[i];
+        }
+    }
+    free(old_slots);
+}
+
+static void postings_add(posting_list_t *list, uint64_t id)
+{
+    if (list->num_postings > 0 && list->last_id == id) {
+        return;     // term occurs more than once in the same value
+    }
+
+    uint64_t delta = (list->num_postings > 0 ? id - list->last_id : id);
+    list->bytes = brooks_misc_autoresize(list->bytes, sizeof(uint8_t), list->num_bytes, &list->capacity, 10);
+    do {
+        uint8_t byte = delta & 0x7f;
+        delta >>= 7;
+        list->bytes[list->num_bytes++] = byte | (delta ? 0x80 : 0x00);
+    } while (delta);
+
+    list->last_id = id;
+    list->num_postings++;
+}
+
+static size_t postings_decode(uint64_t *ids, const posting_list_t *list)
+{
+    uint64_t id = 0;
+    size_t num_ids = 0;
+    for (size_t pos = 0; pos < list->num_bytes; ) {
+        uint64_t delta = 0;
+        unsigned shift = 0;
+        uint8_t byte;
+        do {
+            byte = list->bytes[pos++];
+            delta |= (uint64_t) (byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        id += delta;
+        ids[num_ids++] = id;
+    }
+    return num_ids;
+}
+
+static void postings_emit(brooks_cursor_t *result, const brooks_index_inverted_t *index, const posting_list_t *list)
+{
+    // decodes on the fly, a single posting list needs no id buffer
+    uint64_t id = 0;
+    for (size_t pos = 0; pos < list->num_bytes; ) {
+        uint64_t delta = 0;
+        unsigned shift = 0;
+        uint8_t byte;
+        do {
+            byte = list->bytes[pos++];
+            delta |= (uint64_t) (byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        id += delta;
+        brooks_cursor_append(result, &index->values[id], 1);
+    }
+}
+
+static size_t postings_intersect(uint64_t *ids, size_t num_ids, const posting_list_t *list)
+{
+    // merge-intersects the sorted candidates 'ids' in-place with the sorted (decoded on the fly) posting list
+    uint64_t id = 0;
+    size_t pos = 0, read = 0, write = 0;
+    while (read < num_ids && pos < list->num_bytes) {
+        uint64_t delta = 0;
+        unsigned shift = 0;
+        uint8_t byte;
+        do {
+            byte = list->bytes[pos++];
+            delta |= (uint64_t) (byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        id += delta;
+
+        while (read < num_ids && ids[read] < id) {
+            read++;
+        }
+        if (read < num_ids && ids[read] == id) {
+            ids[write++] = ids[read++];
+        }
+    }
+    return write;
+}
+
+static const char *token_next(char *token, const char **it)
+{
+    // a token is a maximal run of ASCII alphanumerics or non-ASCII bytes (to keep UTF-8 sequences intact), folded
+    // to lower case
+    const unsigned char *pos = (const unsigned char *) *it;
+    while (*pos && !(*pos >= 0x80 || (*pos >= '0' && *pos <= '9') || ((*pos | 0x20) >= 'a' && (*pos | 0x20) <= 'z'))) {
+        pos++;
+    }
+    if (*pos == '\0') {
+        *it = (const char *) pos;
+        return NULL;
+    }
+    char *out = token;
+    while (*pos >= 0x80 || (*pos >= '0' && *pos <= '9') || ((*pos | 0x20) >= 'a' && (*pos | 0x20) <= 'z')) {
+        *out++ = (char) ((*pos >= 'A' && *pos <= 'Z') ? (*pos | 0x20) : *pos);
+        pos++;
+    }
+    *out = '\0';
+    *it = (const char *) pos;
+    return token;
+}
+
+static int term_compare_by_postings(const void *lhs, const void *rhs)
+{
+    size_t a = (*(const term_t **) lhs)->postings.num_postings;
+    size_t b = (*(const term_t **) rhs)->postings.num_postings;
+    return (a > b) - (a < b);
+}
+
+static void lookup_emit(brooks_cursor_t *result, const brooks_index_inverted_t *index, const uint64_t *ids,
+                        size_t num_ids)
+{
+    for (size_t i = 0; i < num_ids; i++) {
+        brooks_cursor_append(result, &index->values[ids[i]], 1);
+    }
+}
@@ -0,0 +1,291 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <brooks/index/brooks_index_value.h>
+#include <brooks/query/brooks_cursor.h>
+#include <brooks/brooks_doc.h>
+#include <brooks/brooks_path.h>
+#include <brooks/brooks_misc.h>
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef struct index_entry_t
+{
+    brooks_index_key_t            key;
+    const brooks_value_t         *value;
+} index_entry_t;
+
+typedef struct brooks_index_value_t
+{
+    brooks_path_t                *path;
+    index_entry_t                *entries;
+    size_t                        num_entries;
+    size_t                        capacity;
+    index_entry_t                *staged;
+    size_t                        num_staged;
+    size_t                        staged_capacity;
+    brooks_index_key_t           *eytzinger;
+    size_t                       *rank;
+    brooks_misc_set_t             documents;     // added so far
+} brooks_index_value_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void index_add_value(void *capture, const brooks_value_t *value);
+static void index_merge_staged(brooks_index_value_t *index);
+static size_t index_eytzinger_fill(brooks_index_value_t *index, size_t i, size_t k);
+static size_t index_lower_bound(const brooks_index_value_t *index, const brooks_index_key_t *key);
+static int entry_compare(const void *lhs, const void *rhs);
+static int key_type_rank(brooks_type_e type);
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e brooks_index_value_create(brooks_index_value_t **index, brooks_pool_t *pool, const char *key_path)
+{
+    if (index && pool) {
+        brooks_index_value_t *result = brooks_pool_malloc(pool, sizeof(brooks_index_value_t));
+        brooks_status_e status;
+        if ((status = brooks_path_create(&result->path, pool, key_path)) != brooks_status_ok) {
+            return status;
+        }
+        result->num_entries = result->capacity = 0;
+        result->entries = NULL;
+        result->eytzinger = NULL;
+        result->rank = NULL;
+        result->num_staged = 0;
+        result->staged_capacity = BROOKS_INDEX_VALUE_CAPACITY;
+        result->staged = malloc(result->staged_capacity * sizeof(index_entry_t));
+        *index = result;
+        if ((status = brooks_misc_set_create(&result->documents)) != brooks_status_ok) {
+            return status;
+        }
+        return (result->staged != NULL ? brooks_status_ok : brooks_status_malloc_err);
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_index_value_add(brooks_index_value_t *index, const brooks_object_t *document)
+{
+    brooks_status_e status = brooks_path_visit(index ? index->path : NULL, document, index, index_add_value);
+    return (status == brooks_status_ok ? brooks_misc_set_insert(&index->documents, document) : status);
+}
+
+bool brooks_index_value_covers(const brooks_index_value_t *index, const brooks_object_t *document)
+{
+    return (index && brooks_misc_set_contains(&index->documents, document));
+}
+
+brooks_status_e brooks_index_value_lookup(brooks_cursor_t *result, brooks_index_value_t *index,
+                                          const brooks_index_key_t *lower, bool lower_inclusive,
+                                          const brooks_index_key_t *upper, bool upper_inclusive)
+{
+    if (result && index) {
+        if (index->num_staged > 0) {
+            index_merge_staged(index);
+        }
+
+        size_t begin = 0;
+        if (lower != NULL) {
+            begin = index_lower_bound(index, lower);
+            while (!lower_inclusive && begin < index->num_entries &&
+                   brooks_index_key_compare(&index->entries[begin].key, lower) == 0) {
+                begin++;
+            }
+        }
+
+        size_t end = begin;
+        while (end < index->num_entries) {
+            int cmp = (upper != NULL ? brooks_index_key_compare(&index->entries[end].key, upper) : -1);
+            if (cmp > 0 || (cmp == 0 && !upper_inclusive)) {
+                break;
+            }
+            end++;
+        }
+
+        for (size_t i = begin; i < end; i++) {
+            brooks_cursor_append(result, &index->entries[i].value, 1);
+        }
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+int brooks_index_key_compare(const brooks_index_key_t *lhs, const brooks_index_key_t *rhs)
+{
+    int lhs_rank = key_type_rank(lhs->type), rhs_rank = key_type_rank(rhs->type);
+    if (lhs_rank != rhs_rank) {
+        return (lhs_rank > rhs_rank) - (lhs_rank < rhs_rank);
+    }
+    switch (lhs->type) {
+        case brooks_type_null:
+            return 0;
+        case brooks_type_boolean:
+            return (lhs->boolean > rhs->boolean) - (lhs->boolean < rhs->boolean);
+        case brooks_type_string:
+            return strcmp(lhs->string, rhs->string);
+        default:
+            if (lhs->type == brooks_type_number_integer && rhs->type == brooks_type_number_integer) {
+                return (lhs->integer > rhs->integer) - (lhs->integer < rhs->integer);
+            } else {
+                double a = (lhs->type == brooks_type_number_integer ? (double) lhs->integer : lhs->decimal);
+                double b = (rhs->type == brooks_type_number_integer ? (double) rhs->integer : rhs->decimal);
+                return (a > b) - (a < b);
+            }
+    }
+}
+
+bool brooks_index_key_from_value(brooks_index_key_t *key, const brooks_value_t *value)
+{
+    brooks_doc_value_get_type(&key->type, value);
+    switch (key->type) {
+        case brooks_type_number_integer:
+            key->integer = brooks_doc_value_as_integer(value);
+            return true;
+        case brooks_type_number_double:
+            key->decimal = brooks_doc_value_as_double(value);
+            return true;
+        case brooks_type_string:
+            key->string = brooks_doc_value_as_string(value);
+            return true;
+        case brooks_type_boolean:
+            key->boolean = brooks_doc_value_as_boolean(value);
+            return true;
+        case brooks_type_null:
+            return true;
+        default:
+            return false;
+    }
+}
+
+size_t brooks_index_value_num_entries(const brooks_index_value_t *index)
+{
+    return (index ? index->num_entries + index->num_staged : 0);
+}
+
+const char *brooks_index_value_key_path(const brooks_index_value_t *index)
+{
+    return (index ? brooks_path_str(index->path) : NULL);
+}
+
+brooks_status_e brooks_index_value_dispose(brooks_index_value_t *index)
+{
+    if (index) {
+        free(index->entries);
+        free(index->staged);
+        free(index->eytzinger);
+        free(index->rank);
+        brooks_misc_set_dispose(&index->documents);
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void index_add_value(void *capture, const brooks_value_t *value)
+{
+    brooks_index_value_t *index = (brooks_index_value_t *) capture;
+    index_entry_t entry = { .value = value };
+    if (brooks_index_key_from_value(&entry.key, value)) {
+        index->staged = brooks_misc_autoresize(index->staged, sizeof(index_entry_t), index->num_staged,
+                                               &index->staged_capacity, 1);
+        index->staged[index->num_staged++] = entry;
+    }
+}
+
+static void index_merge_staged(brooks_index_value_t *index)
+{
+    qsort(index->staged, index->num_staged, sizeof(index_entry_t), entry_compare);
+
+    size_t num_merged = index->num_entries + index->num_staged;
+    index_entry_t *merged = malloc(num_merged * sizeof(index_entry_t));
+    size_t i = 0, j = 0, k = 0;
+    while (i < index->num_entries && j < index->num_staged) {
+        merged[k++] = (entry_compare(index->entries + i, index->staged + j) <= 0 ?
+                       index->entries[i++] : index->staged[j++]);
+    }
+    while (i < index->num_entries) {
+        merged[k++] = index->entries[i++];
+    }
+    while (j < index->num_staged) {
+        merged[k++] = index->staged[j++];
+    }
+
+    free(index->entries);
+    index->entries = merged;
+    index->num_entries = index->capacity = num_merged;
+    index->num_staged = 0;
+
+    free(index->eytzinger);
+    free(index->rank);
+    index->eytzinger = malloc((num_merged + 1) * sizeof(brooks_index_key_t));
+    index->rank = malloc((num_merged + 1) * sizeof(size_t));
+    index_eytzinger_fill(index, 0, 1);
+}
+
+static size_t index_eytzinger_fill(brooks_index_value_t *index, size_t i, size_t k)
+{
+    // in-order walk of the implicit tree rooted at 'k' assigns the sorted entries in increasing order
+    if (k <= index->num_entries) {
+        i = index_eytzinger_fill(index, i, 2 * k);
+        index->eytzinger[k] = index->entries[i].key;
+        index->rank[k] = i++;
+        i = index_eytzinger_fill(index, i, 2 * k + 1);
+    }
+    return i;
+}
+
+static size_t index_lower_bound(const brooks_index_value_t *index, const brooks_index_key_t *key)
+{
+    size_t k = 1;
+    while (k <= index->num_entries) {
+        __builtin_prefetch(index->eytzinger + 4 * k);
+        k = 2 * k + (brooks_index_key_compare(index->eytzinger + k, key) < 0);
+    }
+    // strip the trailing right-turns (ones) plus the final left-turn to get the last node where we went left
+    k >>= __builtin_ffsll(~k);
+    return (k == 0 ? index->num_entries : index->rank[k]);
+}
+
+static int entry_compare(const void *lhs, const void *rhs)
+{
+    return brooks_index_key_compare(&((const index_entry_t *) lhs)->key, &((const index_entry_t *) rhs)->key);
+}
+
+static int key_type_rank(brooks_type_e type)
+{
+    switch (type) {
+        case brooks_type_null:              return 0;
+        case brooks_type_boolean:           return 1;
+        case brooks_type_number_integer:
+        case brooks_type_number_double:     return 2;
+        case brooks_type_string:            return 3;
+        default:                            return 4;
+    }
+}
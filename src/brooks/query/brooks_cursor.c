@@ -46,10 +46,18 @@ brooks_status_e brooks_cursor_create(brooks_cursor_t **cursor, size_t capacity,
 {
     if (cursor && capacity > 0) {
         brooks_cursor_t *result = malloc(sizeof(brooks_cursor_t));
+        if (result == NULL) {
+            return brooks_status_malloc_err;
+        }
         result->capacity = capacity;
         result->num_values = 0;
-        result->values = brooks_pool_malloc(pool, capacity * sizeof(brooks_value_t *));
+        result->values = brooks_pool_malloc_tagged(pool, capacity * sizeof(brooks_value_t *),
+                                                   brooks_pool_category_cursor);
         result->pool = pool;
+        if (result->values == NULL) {
+            free(result);
+            return brooks_status_pmalloc_err;
+        }
         *cursor = result;
         return brooks_status_ok;
     } else return brooks_status_illegalarg;
@@ -59,7 +67,8 @@ void brooks_cursor_append(brooks_cursor_t *cursor, const brooks_value_t * const
 {
     size_t head = cursor->num_values;
     cursor->values = brooks_misc_pooled_autoresize(cursor->pool, cursor->values, sizeof(brooks_value_t  *),
-                                            cursor->num_values, &cursor->capacity, num_values);
+                                            cursor->num_values, &cursor->capacity, num_values,
+                                            brooks_pool_category_cursor);
     memcpy(cursor->values + head, values, num_values * sizeof(brooks_value_t *));
     cursor->num_values += num_values;
 }
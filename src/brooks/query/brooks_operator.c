@@ -20,6 +20,7 @@
 // ---------------------------------------------------------------------------------------------------------------------
 
 #include <brooks/query/brooks_operator.h>
+#include <brooks/query/brooks_profile.h>
 
 // ---------------------------------------------------------------------------------------------------------------------
 // I N T E R F A C E   I M P L E M E N T A T I O N
@@ -27,15 +28,15 @@
 
 brooks_status_e brooks_operator_open(brooks_operator_t *opp)
 {
-    return (opp? opp->open(opp) : brooks_status_nullptr);
+    return (opp? (opp->profile ? brooks_profile_open(opp) : opp->open(opp)) : brooks_status_nullptr);
 }
 
 const brooks_cursor_t *brooks_operator_next(brooks_operator_t *opp)
 {
-    return (opp? opp->next(opp) : NULL);
+    return (opp? (opp->profile ? brooks_profile_next(opp) : opp->next(opp)) : NULL);
 }
 
 brooks_status_e brooks_operator_close(brooks_operator_t *opp)
 {
-    return (opp? opp->close(opp) : brooks_status_nullptr);
+    return (opp? (opp->profile ? brooks_profile_close(opp) : opp->close(opp)) : brooks_status_nullptr);
 }
@@ -0,0 +1,388 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <brooks/query/brooks_profile.h>
+#include <brooks/query/brooks_cursor.h>
+#include <brooks/brooks_pool.h>
+#include <brooks/brooks_misc.h>
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef struct brooks_profile_node_t
+{
+    brooks_profile_t                    *profile;
+    brooks_operator_t                   *opp;           // NULL once detached
+    size_t                               parent;        // SIZE_MAX for roots
+    char                                *name;
+    bool                                 reports_input;
+    brooks_profile_counters_t            counters;      // derived fields are computed on read
+} brooks_profile_node_t;
+
+typedef struct brooks_profile_t
+{
+    brooks_profile_node_t              **nodes;
+    size_t                               num_nodes;
+    size_t                               capacity;
+    brooks_pool_t                       *pool;
+    bool                                 enabled;
+} brooks_profile_t;
+
+typedef struct profile_sample_t
+{
+    uint64_t                             start_ns;
+    size_t                               start_bytes;
+} profile_sample_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static size_t profile_find(const brooks_profile_t *profile, const brooks_operator_t *opp);
+static void profile_derive(brooks_profile_counters_t *counters, const brooks_profile_t *profile, size_t idx);
+static void profile_sample_begin(profile_sample_t *sample, const brooks_profile_node_t *node);
+static void profile_sample_end(brooks_profile_node_t *node, const profile_sample_t *sample);
+static void profile_print_node(FILE *file, const brooks_profile_t *profile, size_t idx, size_t depth);
+static void profile_print_json_node(FILE *file, const brooks_profile_t *profile, size_t idx);
+static void print_json_string(FILE *file, const char *str);
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e brooks_profile_create(brooks_profile_t **profile, brooks_pool_t *pool)
+{
+    if (profile) {
+        brooks_profile_t *result = malloc(sizeof(brooks_profile_t));
+        if (result == NULL) {
+            return brooks_status_malloc_err;
+        }
+        result->capacity = BROOKS_PROFILE_NODES_CAPACITY;
+        result->nodes = malloc(result->capacity * sizeof(brooks_profile_node_t *));
+        result->num_nodes = 0;
+        result->pool = pool;
+        result->enabled = false;
+        *profile = result;
+        return (result->nodes != NULL ? brooks_status_ok : brooks_status_malloc_err);
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_profile_set_enabled(brooks_profile_t *profile, bool enabled)
+{
+    if (profile) {
+        profile->enabled = enabled;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_profile_attach(brooks_profile_t *profile, brooks_operator_t *opp,
+                                      const brooks_operator_t *parent, const char *name)
+{
+    if (profile && opp && name) {
+        size_t parent_idx = SIZE_MAX;
+        if (parent != NULL && (parent_idx = profile_find(profile, parent)) == SIZE_MAX) {
+            return brooks_status_illegalarg;
+        }
+        if (opp->profile != NULL) {
+            return brooks_status_badcall;
+        }
+
+        brooks_profile_node_t *node = calloc(1, sizeof(brooks_profile_node_t));
+        node->profile = profile;
+        node->opp = opp;
+        node->parent = parent_idx;
+        node->name = malloc(strlen(name) + 1);
+        strcpy(node->name, name);
+        node->counters.name = node->name;
+
+        profile->nodes = brooks_misc_autoresize(profile->nodes, sizeof(brooks_profile_node_t *), profile->num_nodes,
+                                                &profile->capacity, 1);
+        profile->nodes[profile->num_nodes++] = node;
+        opp->profile = node;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_profile_detach(brooks_operator_t *opp)
+{
+    if (opp) {
+        if (opp->profile == NULL) {
+            return brooks_status_badcall;
+        }
+        opp->profile->opp = NULL;
+        opp->profile = NULL;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_profile_reset(brooks_profile_t *profile)
+{
+    if (profile) {
+        for (size_t i = 0; i < profile->num_nodes; i++) {
+            brooks_profile_node_t *node = profile->nodes[i];
+            memset(&node->counters, 0, sizeof(brooks_profile_counters_t));
+            node->counters.name = node->name;
+            node->reports_input = false;
+        }
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_profile_get(brooks_profile_counters_t *counters, const brooks_profile_t *profile,
+                                   const brooks_operator_t *opp)
+{
+    if (counters && profile && opp) {
+        size_t idx = profile_find(profile, opp);
+        if (idx == SIZE_MAX) {
+            return brooks_status_illegalarg;
+        }
+        profile_derive(counters, profile, idx);
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_profile_print(FILE *file, const brooks_profile_t *profile)
+{
+    if (file && profile) {
+        for (size_t i = 0; i < profile->num_nodes; i++) {
+            if (profile->nodes[i]->parent == SIZE_MAX) {
+                profile_print_node(file, profile, i, 0);
+            }
+        }
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_profile_print_json(FILE *file, const brooks_profile_t *profile)
+{
+    if (file && profile) {
+        bool first = true;
+        fprintf(file, "[");
+        for (size_t i = 0; i < profile->num_nodes; i++) {
+            if (profile->nodes[i]->parent == SIZE_MAX) {
+                fprintf(file, "%s", first ? "" : ", ");
+                profile_print_json_node(file, profile, i);
+                first = false;
+            }
+        }
+        fprintf(file, "]\n");
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_profile_dispose(brooks_profile_t *profile)
+{
+    if (profile) {
+        for (size_t i = 0; i < profile->num_nodes; i++) {
+            brooks_profile_node_t *node = profile->nodes[i];
+            if (node->opp != NULL) {
+                node->opp->profile = NULL;
+            }
+            free(node->name);
+            free(node);
+        }
+        free(profile->nodes);
+        free(profile);
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
+brooks_status_e brooks_profile_open(brooks_operator_t *opp)
+{
+    brooks_profile_node_t *node = opp->profile;
+    if (!node->profile->enabled) {
+        return opp->open(opp);
+    }
+    profile_sample_t sample;
+    profile_sample_begin(&sample, node);
+    brooks_status_e status = opp->open(opp);
+    profile_sample_end(node, &sample);
+    node->counters.num_opens++;
+    return status;
+}
+
+const brooks_cursor_t *brooks_profile_next(brooks_operator_t *opp)
+{
+    brooks_profile_node_t *node = opp->profile;
+    if (!node->profile->enabled) {
+        return opp->next(opp);
+    }
+    profile_sample_t sample;
+    profile_sample_begin(&sample, node);
+    const brooks_cursor_t *result = opp->next(opp);
+    profile_sample_end(node, &sample);
+
+    node->counters.num_calls++;
+    if (result != NULL) {
+        size_t num_rows;
+        brooks_cursor_read(&num_rows, result);
+        node->counters.num_batches_out++;
+        node->counters.num_rows_out += num_rows;
+    }
+    return result;
+}
+
+brooks_status_e brooks_profile_close(brooks_operator_t *opp)
+{
+    brooks_profile_node_t *node = opp->profile;
+    if (!node->profile->enabled) {
+        return opp->close(opp);
+    }
+    profile_sample_t sample;
+    profile_sample_begin(&sample, node);
+    brooks_status_e status = opp->close(opp);
+    profile_sample_end(node, &sample);
+    return status;
+}
+
+void brooks_profile_count_input(brooks_profile_node_t *node, size_t num_batches, size_t num_rows)
+{
+    if (node && node->profile->enabled) {
+        node->reports_input = true;
+        node->counters.num_batches_in += num_batches;
+        node->counters.num_rows_in += num_rows;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+static size_t profile_find(const brooks_profile_t *profile, const brooks_operator_t *opp)
+{
+    for (size_t i = 0; i < profile->num_nodes; i++) {
+        if (profile->nodes[i]->opp == opp) {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+static void profile_derive(brooks_profile_counters_t *counters, const brooks_profile_t *profile, size_t idx)
+{
+    const brooks_profile_node_t *node = profile->nodes[idx];
+    *counters = node->counters;
+    counters->self_ns = node->counters.time_ns;
+
+    // time of children is included in the parent, whose input is the children's output unless reported otherwise
+    bool has_children = false;
+    for (size_t i = 0; i < profile->num_nodes; i++) {
+        const brooks_profile_node_t *child = profile->nodes[i];
+        if (child->parent == idx) {
+            has_children = true;
+            counters->self_ns -= (child->counters.time_ns < counters->self_ns ? child->counters.time_ns :
+                                                                                counters->self_ns);
+            if (!node->reports_input) {
+                counters->num_batches_in += child->counters.num_batches_out;
+                counters->num_rows_in += child->counters.num_rows_out;
+            }
+        }
+    }
+
+    if (node->reports_input || has_children) {
+        counters->selectivity = (counters->num_rows_in > 0 ?
+                                 (double) counters->num_rows_out / counters->num_rows_in : 0);
+    } else {
+        counters->selectivity = -1;
+    }
+}
+
+static void profile_sample_begin(profile_sample_t *sample, const brooks_profile_node_t *node)
+{
+    sample->start_bytes = brooks_pool_num_bytes(node->profile->pool);
+    sample->start_ns = brooks_misc_clock_ns();
+}
+
+static void profile_sample_end(brooks_profile_node_t *node, const profile_sample_t *sample)
+{
+    node->counters.time_ns += brooks_misc_clock_ns() - sample->start_ns;
+    node->counters.pool_bytes += brooks_pool_num_bytes(node->profile->pool) - sample->start_bytes;
+}
+
+static void profile_print_node(FILE *file, const brooks_profile_t *profile, size_t idx, size_t depth)
+{
+    brooks_profile_counters_t counters;
+    profile_derive(&counters, profile, idx);
+
+    fprintf(file, "%*s%s%s (time=%.3f ms self=%.3f ms opens=%zu calls=%zu batches=%zu->%zu rows=%zu->%zu",
+            (int) (depth * 4), "", (depth > 0 ? "-> " : ""), counters.name, counters.time_ns / 1e6,
+            counters.self_ns / 1e6, counters.num_opens, counters.num_calls, counters.num_batches_in,
+            counters.num_batches_out, counters.num_rows_in, counters.num_rows_out);
+    if (counters.selectivity >= 0) {
+        fprintf(file, " selectivity=%.4f", counters.selectivity);
+    }
+    fprintf(file, " pool=%zu bytes)\n", counters.pool_bytes);
+
+    for (size_t i = 0; i < profile->num_nodes; i++) {
+        if (profile->nodes[i]->parent == idx) {
+            profile_print_node(file, profile, i, depth + 1);
+        }
+    }
+}
+
+static void profile_print_json_node(FILE *file, const brooks_profile_t *profile, size_t idx)
+{
+    brooks_profile_counters_t counters;
+    profile_derive(&counters, profile, idx);
+
+    fprintf(file, "{\"name\": ");
+    print_json_string(file, counters.name);
+    fprintf(file, ", \"time_ns\": %llu, \"self_ns\": %llu, \"opens\": %zu, \"calls\": %zu, \"batches_in\": %zu, "
+                  "\"rows_in\": %zu, \"batches_out\": %zu, \"rows_out\": %zu, \"pool_bytes\": %zu, ",
+            (unsigned long long) counters.time_ns, (unsigned long long) counters.self_ns, counters.num_opens,
+            counters.num_calls, counters.num_batches_in, counters.num_rows_in, counters.num_batches_out,
+            counters.num_rows_out, counters.pool_bytes);
+    if (counters.selectivity >= 0) {
+        fprintf(file, "\"selectivity\": %g, ", counters.selectivity);
+    } else {
+        fprintf(file, "\"selectivity\": null, ");
+    }
+
+    bool first = true;
+    fprintf(file, "\"children\": [");
+    for (size_t i = 0; i < profile->num_nodes; i++) {
+        if (profile->nodes[i]->parent == idx) {
+            fprintf(file, "%s", first ? "" : ", ");
+            profile_print_json_node(file, profile, i);
+            first = false;
+        }
+    }
+    fprintf(file, "]}");
+}
+
+static void print_json_string(FILE *file, const char *str)
+{
+    fputc('"', file);
+    for (const char *it = str; *it; it++) {
+        if (*it == '"' || *it == '\\') {
+            fprintf(file, "\\%c", *it);
+        } else if ((unsigned char) *it < 0x20) {
+            fprintf(file, "\\u%04x", (unsigned char) *it);
+        } else {
+            fputc(*it, file);
+        }
+    }
+    fputc('"', file);
+}
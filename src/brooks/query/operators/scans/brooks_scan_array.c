@@ -20,14 +20,24 @@
 // ---------------------------------------------------------------------------------------------------------------------
 
 #include <stdlib.h>
+#include <math.h>
 #include <brooks/query/operators/scans/brooks_scan_arrays.h>
 #include <brooks/query/brooks_cursor.h>
+#include <brooks/query/brooks_profile.h>
 #include <brooks/brooks_doc.h>
+#include <brooks/brooks_stats.h>
 
 // ---------------------------------------------------------------------------------------------------------------------
 // T Y P E S
 // ---------------------------------------------------------------------------------------------------------------------
 
+typedef struct scan_arrays_bound_t
+{
+    bool                    set;
+    bool                    inclusive;
+    brooks_index_key_t      key;
+} scan_arrays_bound_t;
+
 typedef struct scan_arrays_extra_t
 {
     brooks_array_t * const *arrays;
@@ -35,6 +45,11 @@ typedef struct scan_arrays_extra_t
     size_t                  current_array_idx;
     brooks_cursor_t         *cursor;
     brooks_pool_t           *pool;
+    bool                    filtered;
+    scan_arrays_bound_t     lower;
+    scan_arrays_bound_t     upper;
+    brooks_stats_t          *stats;
+    const char              *key_path;
 } scan_arrays_extra_t;
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -45,6 +60,13 @@ brooks_status_e scan_arrays_open(struct brooks_operator_t *self);
 brooks_status_e scan_arrays_close(struct brooks_operator_t *self);
 const brooks_cursor_t *scan_arrays_next(struct brooks_operator_t *self);
 
+static bool bound_set(scan_arrays_bound_t *bound, const brooks_index_key_t *key, bool inclusive);
+static bool bound_admits(const scan_arrays_bound_t *bound, const brooks_index_key_t *key, bool is_lower);
+static bool value_in_range(const scan_arrays_extra_t *extra, const brooks_value_t *value);
+static void scan_range(scan_arrays_extra_t *extra, const brooks_array_t *array);
+static void scan_range_block(scan_arrays_extra_t *extra, brooks_unnamed_entry_t **begin,
+                             brooks_unnamed_entry_t **end, bool check);
+
 // ---------------------------------------------------------------------------------------------------------------------
 // I N T E R F A C E   I M P L E M E N T A T I O N
 // ---------------------------------------------------------------------------------------------------------------------
@@ -57,10 +79,15 @@ brooks_status_e brooks_operators_scan_arrays_create(brooks_operator_t *opp, broo
         extra->current_array_idx = 0;
         extra->num_arrays = num;
         extra->arrays = arrs;
+        extra->cursor = NULL;
         extra->pool = pool;
+        extra->filtered = false;
+        extra->stats = NULL;
+        extra->key_path = NULL;
 
         opp->extra = extra;
         opp->tag = brooks_opp_tag_scan_arrays_default;
+        opp->profile = NULL;
         opp->open = scan_arrays_open;
         opp->close = scan_arrays_close;
         opp->next = scan_arrays_next;
@@ -69,6 +96,51 @@ brooks_status_e brooks_operators_scan_arrays_create(brooks_operator_t *opp, broo
     } else return brooks_status_illegalarg;
 }
 
+brooks_status_e brooks_operators_scan_arrays_create_range(brooks_operator_t *opp, brooks_array_t ** arrs, size_t num,
+                                                          const brooks_index_key_t *lower, bool lower_inclusive,
+                                                          const brooks_index_key_t *upper, bool upper_inclusive,
+                                                          brooks_pool_t *pool)
+{
+    brooks_status_e status;
+    if ((lower || upper) && (status = brooks_operators_scan_arrays_create(opp, arrs, num, pool)) == brooks_status_ok) {
+        scan_arrays_extra_t *extra = (scan_arrays_extra_t *) opp->extra;
+        extra->filtered = true;
+        if (bound_set(&extra->lower, lower, lower_inclusive) && bound_set(&extra->upper, upper, upper_inclusive)) {
+            return brooks_status_ok;
+        }
+        free (extra);
+        return brooks_status_illegalarg;
+    } else return ((lower || upper) ? status : brooks_status_illegalarg);
+}
+
+brooks_status_e brooks_operators_scan_arrays_rebind(brooks_operator_t *opp, brooks_array_t ** arrs, size_t num)
+{
+    if (opp && arrs && num > 0) {
+        if (opp->tag != brooks_opp_tag_scan_arrays_default) {
+            return brooks_status_badcall;
+        }
+        scan_arrays_extra_t *extra = (scan_arrays_extra_t *) opp->extra;
+        extra->arrays = arrs;
+        extra->num_arrays = num;
+        extra->current_array_idx = 0;
+        return brooks_status_ok;
+    } else return brooks_status_illegalarg;
+}
+
+brooks_status_e brooks_operators_scan_arrays_set_stats(brooks_operator_t *opp, brooks_stats_t *stats,
+                                                       const char *key_path)
+{
+    if (opp && stats && key_path) {
+        if (opp->tag != brooks_opp_tag_scan_arrays_default) {
+            return brooks_status_badcall;
+        }
+        scan_arrays_extra_t *extra = (scan_arrays_extra_t *) opp->extra;
+        extra->stats = stats;
+        extra->key_path = key_path;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 // H E L P E R   I M P L E M E N T A T I O N
 // ---------------------------------------------------------------------------------------------------------------------
@@ -77,17 +149,36 @@ brooks_status_e scan_arrays_open(struct brooks_operator_t *self)
 {
     if (self->tag == brooks_opp_tag_scan_arrays_default) {
         scan_arrays_extra_t *extra = (scan_arrays_extra_t *) self->extra;
+        extra->current_array_idx = 0;
+        if (extra->cursor != NULL) {
+            // re-opened: the cursor of the previous run is reused and grows on demand
+            brooks_cursor_clear(extra->cursor);
+            return brooks_status_ok;
+        }
 
-        // TODO: consider cardinality estimation for third parameter
+        const brooks_stats_path_t *counters = (extra->stats ? brooks_stats_get(extra->stats, extra->key_path) : NULL);
         size_t approx_result_size___upper_bound = 0;
-        for (size_t i = 0; i < extra->num_arrays; i++) {
-            size_t num_elemens = brooks_doc_array_get_length(extra->arrays[i]);
-            approx_result_size___upper_bound = (approx_result_size___upper_bound < num_elemens) ?
-                                               num_elemens : approx_result_size___upper_bound;
+        if (counters != NULL && counters->max_array_length > 0) {
+            double selectivity = 1;
+            if (extra->filtered) {
+                selectivity = brooks_stats_selectivity_range(extra->stats, extra->key_path,
+                                                             (extra->lower.set ? &extra->lower.key : NULL),
+                                                             extra->lower.inclusive,
+                                                             (extra->upper.set ? &extra->upper.key : NULL),
+                                                             extra->upper.inclusive);
+            }
+            approx_result_size___upper_bound = (size_t) ceil(counters->max_array_length * selectivity);
+        } else {
+            for (size_t i = 0; i < extra->num_arrays; i++) {
+                size_t num_elemens = brooks_doc_array_get_length(extra->arrays[i]);
+                approx_result_size___upper_bound = (approx_result_size___upper_bound < num_elemens) ?
+                                                   num_elemens : approx_result_size___upper_bound;
+            }
         }
+        approx_result_size___upper_bound = (approx_result_size___upper_bound > 0 ?
+                                            approx_result_size___upper_bound : 1);
 
-        brooks_cursor_create(&extra->cursor, approx_result_size___upper_bound, extra->pool);
-        return brooks_status_ok;
+        return brooks_cursor_create(&extra->cursor, approx_result_size___upper_bound, extra->pool);
     }
     return brooks_status_badcall;
 }
@@ -97,6 +188,7 @@ brooks_status_e scan_arrays_close(struct brooks_operator_t *self)
     if (self->tag != brooks_opp_tag_scan_arrays_default) {
         return brooks_status_badcall;
     }
+    brooks_cursor_dispose(((scan_arrays_extra_t *) self->extra)->cursor);
     free (self->extra);
     return brooks_status_ok;
 }
@@ -112,11 +204,102 @@ const brooks_cursor_t *scan_arrays_next(struct brooks_operator_t *self)
 
     if (extra->current_array_idx < extra->num_arrays) {
         const brooks_array_t *array = extra->arrays[extra->current_array_idx++];
+        brooks_profile_count_input(self->profile, 1, brooks_doc_array_get_length(array));
 
-        for (brooks_unnamed_entry_t **it = brooks_doc_array_begin(array); it < brooks_doc_array_end(array); it++) {
-            const brooks_value_t *value = brooks_doc_unnamed_entry_get_value(*it);
-            brooks_cursor_append(extra->cursor, &value, 1);
+        if (extra->filtered) {
+            scan_range(extra, array);
+        } else {
+            for (brooks_unnamed_entry_t **it = brooks_doc_array_begin(array); it < brooks_doc_array_end(array); it++) {
+                const brooks_value_t *value = brooks_doc_unnamed_entry_get_value(*it);
+                brooks_cursor_append(extra->cursor, &value, 1);
+            }
         }
         return extra->cursor;
     } else return NULL;
 }
+
+static bool bound_set(scan_arrays_bound_t *bound, const brooks_index_key_t *key, bool inclusive)
+{
+    bound->set = (key != NULL);
+    bound->inclusive = inclusive;
+    if (key != NULL) {
+        if (key->type != brooks_type_number_integer && key->type != brooks_type_number_double) {
+            return false;
+        }
+        bound->key = *key;
+    }
+    return true;
+}
+
+static bool bound_admits(const scan_arrays_bound_t *bound, const brooks_index_key_t *key, bool is_lower)
+{
+    if (bound->set) {
+        int cmp = brooks_index_key_compare(key, &bound->key);
+        return (is_lower ? (cmp > 0 || (cmp == 0 && bound->inclusive)) : (cmp < 0 || (cmp == 0 && bound->inclusive)));
+    } else return true;
+}
+
+static bool value_in_range(const scan_arrays_extra_t *extra, const brooks_value_t *value)
+{
+    brooks_index_key_t key;
+    brooks_type_e type;
+    brooks_doc_value_get_type(&type, value);
+
+    // NaN has no order and never satisfies a range
+    if ((type != brooks_type_number_integer && type != brooks_type_number_double) ||
+        !brooks_index_key_from_value(&key, value) ||
+        (type == brooks_type_number_double && isnan(key.decimal))) {
+        return false;
+    }
+    return (bound_admits(&extra->lower, &key, true) && bound_admits(&extra->upper, &key, false));
+}
+
+static void scan_range(scan_arrays_extra_t *extra, const brooks_array_t *array)
+{
+    size_t num_zones;
+    const brooks_zone_t *zones = brooks_doc_array_get_zones(&num_zones, array);
+    brooks_unnamed_entry_t **begin = brooks_doc_array_begin(array), **end = brooks_doc_array_end(array);
+
+    if (zones == NULL) {
+        scan_range_block(extra, begin, end, true);
+        return;
+    }
+
+    brooks_type_e type = brooks_doc_array_get_type(array);
+    for (size_t i = 0; i < num_zones; i++) {
+        const brooks_zone_t *zone = zones + i;
+        brooks_unnamed_entry_t **block_begin = begin + i * BROOKS_ZONE_MAP_BLOCK_SIZE;
+        brooks_unnamed_entry_t **block_end = block_begin + zone->num_elements;
+        if (zone->num_nulls == zone->num_elements) {
+            continue;
+        }
+
+        brooks_index_key_t min = { .type = type }, max = { .type = type };
+        if (type == brooks_type_number_integer) {
+            min.integer = zone->min.integer;
+            max.integer = zone->max.integer;
+        } else {
+            min.decimal = zone->min.decimal;
+            max.decimal = zone->max.decimal;
+        }
+
+        // skip blocks whose range is disjoint to the predicate, emit blocks contained in it without checking
+        if (!bound_admits(&extra->lower, &max, true) || !bound_admits(&extra->upper, &min, false)) {
+            continue;
+        }
+        bool contained = (zone->num_nulls == 0 && bound_admits(&extra->lower, &min, true) &&
+                          bound_admits(&extra->upper, &max, false));
+        scan_range_block(extra, block_begin, (block_end < end ? block_end : end), !contained);
+    }
+}
+
+static void scan_range_block(scan_arrays_extra_t *extra, brooks_unnamed_entry_t **begin,
+                             brooks_unnamed_entry_t **end, bool check)
+{
+    for (brooks_unnamed_entry_t **it = begin; it < end; it++) {
+        const brooks_value_t *value = brooks_doc_unnamed_entry_get_value(*it);
+        if (!check || value_in_range(extra, value)) {
+            brooks_cursor_append(extra->cursor, &value, 1);
+        }
+    }
+}
@@ -22,7 +22,9 @@
 #include <stdlib.h>
 #include <brooks/query/operators/scans/brooks_scan_objects.h>
 #include <brooks/query/brooks_cursor.h>
+#include <brooks/query/brooks_profile.h>
 #include <brooks/brooks_doc.h>
+#include <brooks/brooks_stats.h>
 
 // ---------------------------------------------------------------------------------------------------------------------
 // T Y P E S
@@ -35,6 +37,8 @@ typedef struct scan_objects_extra_t
     size_t                   current_object_idx;
     brooks_cursor_t         *cursor;
     brooks_pool_t           *pool;
+    brooks_stats_t          *stats;
+    const char              *key_path;
 } scan_objects_extra_t;
 
 // ---------------------------------------------------------------------------------------------------------------------
@@ -57,10 +61,14 @@ brooks_status_e brooks_operators_scan_objects_create(brooks_operator_t *opp, bro
         extra->current_object_idx = 0;
         extra->num_objects = num;
         extra->objects = objs;
+        extra->cursor = NULL;
         extra->pool = pool;
+        extra->stats = NULL;
+        extra->key_path = NULL;
 
         opp->extra = extra;
         opp->tag = brooks_opp_tag_scan_objects_default;
+        opp->profile = NULL;
         opp->open = scan_objects_open;
         opp->close = scan_objects_close;
         opp->next = scan_objects_next;
@@ -69,6 +77,34 @@ brooks_status_e brooks_operators_scan_objects_create(brooks_operator_t *opp, bro
     } else return brooks_status_illegalarg;
 }
 
+brooks_status_e brooks_operators_scan_objects_rebind(brooks_operator_t *opp, brooks_object_t * const * objs, size_t num)
+{
+    if (opp && objs && num > 0) {
+        if (opp->tag != brooks_opp_tag_scan_objects_default) {
+            return brooks_status_badcall;
+        }
+        scan_objects_extra_t *extra = (scan_objects_extra_t *) opp->extra;
+        extra->objects = objs;
+        extra->num_objects = num;
+        extra->current_object_idx = 0;
+        return brooks_status_ok;
+    } else return brooks_status_illegalarg;
+}
+
+brooks_status_e brooks_operators_scan_objects_set_stats(brooks_operator_t *opp, brooks_stats_t *stats,
+                                                        const char *key_path)
+{
+    if (opp && stats && key_path) {
+        if (opp->tag != brooks_opp_tag_scan_objects_default) {
+            return brooks_status_badcall;
+        }
+        scan_objects_extra_t *extra = (scan_objects_extra_t *) opp->extra;
+        extra->stats = stats;
+        extra->key_path = key_path;
+        return brooks_status_ok;
+    } else return brooks_status_nullptr;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 // H E L P E R   I M P L E M E N T A T I O N
 // ---------------------------------------------------------------------------------------------------------------------
@@ -77,18 +113,28 @@ brooks_status_e scan_objects_open(struct brooks_operator_t *self)
 {
     if (self->tag == brooks_opp_tag_scan_objects_default) {
         scan_objects_extra_t *extra = (scan_objects_extra_t *) self->extra;
+        extra->current_object_idx = 0;
+        if (extra->cursor != NULL) {
+            // re-opened: the cursor of the previous run is reused and grows on demand
+            brooks_cursor_clear(extra->cursor);
+            return brooks_status_ok;
+        }
 
-        // TODO: consider cardinality estimation for third parameter
+        const brooks_stats_path_t *counters = (extra->stats ? brooks_stats_get(extra->stats, extra->key_path) : NULL);
         size_t approx_result_size___upper_bound = 0;
-        for (size_t i = 0; i < extra->num_objects; i++) {
-            size_t num_elemens = brooks_doc_object_num_elements(extra->objects[i]);
-            approx_result_size___upper_bound = (approx_result_size___upper_bound < num_elemens) ?
-                                               num_elemens : approx_result_size___upper_bound;
+        if (counters != NULL && counters->max_object_length > 0) {
+            approx_result_size___upper_bound = counters->max_object_length;
+        } else {
+            for (size_t i = 0; i < extra->num_objects; i++) {
+                size_t num_elemens = brooks_doc_object_num_elements(extra->objects[i]);
+                approx_result_size___upper_bound = (approx_result_size___upper_bound < num_elemens) ?
+                                                   num_elemens : approx_result_size___upper_bound;
+            }
         }
+        approx_result_size___upper_bound = (approx_result_size___upper_bound > 0 ?
+                                            approx_result_size___upper_bound : 1);
 
-
-        brooks_cursor_create(&extra->cursor, approx_result_size___upper_bound, extra->pool);
-        return brooks_status_ok;
+        return brooks_cursor_create(&extra->cursor, approx_result_size___upper_bound, extra->pool);
     }
     return brooks_status_badcall;
 }
@@ -98,6 +144,7 @@ brooks_status_e scan_objects_close(struct brooks_operator_t *self)
     if (self->tag != brooks_opp_tag_scan_objects_default) {
         return brooks_status_badcall;
     }
+    brooks_cursor_dispose(((scan_objects_extra_t *) self->extra)->cursor);
     free (self->extra);
     return brooks_status_ok;
 }
@@ -113,9 +160,10 @@ const brooks_cursor_t *scan_objects_next(struct brooks_operator_t *self)
 
     if (extra->current_object_idx < extra->num_objects) {
         const brooks_object_t *object = extra->objects[extra->current_object_idx++];
+        brooks_profile_count_input(self->profile, 1, brooks_doc_object_num_elements(object));
 
-        for (brooks_named_entry_t **it = brooks_doc_object_begin(object); it < brooks_doc_object_end(object); it++) {
-            const brooks_value_t *value = brooks_doc_named_entry_get_value(*it);
+        for (size_t i = 0; i < brooks_doc_object_num_elements(object); i++) {
+            const brooks_value_t *value = brooks_doc_object_get_value(object, i);
             brooks_cursor_append(extra->cursor, &value, 1);
         }
         return extra->cursor;
@@ -0,0 +1,123 @@
+//
+// Copyright (C) 2017 Marcus Pinnecke
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+// WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+// OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N C L U D E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <brooks/query/operators/scans/brooks_scan_strings.h>
+#include <brooks/query/brooks_cursor.h>
+#include <brooks/query/brooks_profile.h>
+#include <brooks/brooks_misc.h>
+
+// ---------------------------------------------------------------------------------------------------------------------
+// T Y P E S
+// ---------------------------------------------------------------------------------------------------------------------
+
+typedef struct scan_strings_extra_t
+{
+    const brooks_index_inverted_t *index;
+    brooks_index_match_e           match;
+    char                          *needle;
+    bool                           done;
+    brooks_cursor_t               *cursor;
+    brooks_pool_t                 *pool;
+} scan_strings_extra_t;
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   D E C L A R A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e scan_strings_open(struct brooks_operator_t *self);
+brooks_status_e scan_strings_close(struct brooks_operator_t *self);
+const brooks_cursor_t *scan_strings_next(struct brooks_operator_t *self);
+
+// ---------------------------------------------------------------------------------------------------------------------
+// I N T E R F A C E   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e brooks_operators_scan_strings_create(brooks_operator_t *opp, const brooks_index_inverted_t *index,
+                                                     brooks_index_match_e match, const char *needle,
+                                                     brooks_pool_t *pool)
+{
+    if (opp && index && needle && pool) {
+        scan_strings_extra_t *extra = malloc(sizeof(scan_strings_extra_t));
+        extra->index = index;
+        extra->match = match;
+        extra->needle = brooks_misc_strdup(pool, needle);
+        extra->done = false;
+        extra->cursor = NULL;
+        extra->pool = pool;
+
+        opp->extra = extra;
+        opp->tag = brooks_opp_tag_scan_strings_index;
+        opp->profile = NULL;
+        opp->open = scan_strings_open;
+        opp->close = scan_strings_close;
+        opp->next = scan_strings_next;
+
+        return brooks_status_ok;
+    } else return brooks_status_illegalarg;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// H E L P E R   I M P L E M E N T A T I O N
+// ---------------------------------------------------------------------------------------------------------------------
+
+brooks_status_e scan_strings_open(struct brooks_operator_t *self)
+{
+    if (self->tag == brooks_opp_tag_scan_strings_index) {
+        scan_strings_extra_t *extra = (scan_strings_extra_t *) self->extra;
+        extra->done = false;
+        if (extra->cursor != NULL) {
+            brooks_cursor_clear(extra->cursor);
+            return brooks_status_ok;
+        }
+        return brooks_cursor_create(&extra->cursor, BROOKS_INDEX_INVERTED_VALUES_CAPACITY, extra->pool);
+    }
+    return brooks_status_badcall;
+}
+
+brooks_status_e scan_strings_close(struct brooks_operator_t *self)
+{
+    if (self->tag != brooks_opp_tag_scan_strings_index) {
+        return brooks_status_badcall;
+    }
+    brooks_cursor_dispose(((scan_strings_extra_t *) self->extra)->cursor);
+    free (self->extra);
+    return brooks_status_ok;
+}
+
+const brooks_cursor_t *scan_strings_next(struct brooks_operator_t *self)
+{
+    if (self->tag != brooks_opp_tag_scan_strings_index) {
+        return NULL;
+    }
+
+    scan_strings_extra_t *extra = (scan_strings_extra_t *) self->extra;
+    brooks_cursor_clear(extra->cursor);
+
+    // the index answers the predicate at once, hence the result is delivered as a single batch
+    if (!extra->done) {
+        extra->done = true;
+        brooks_index_inverted_lookup(extra->cursor, extra->index, extra->match, extra->needle);
+        brooks_profile_count_input(self->profile, 1, brooks_index_inverted_num_values(extra->index));
+        return extra->cursor;
+    } else return NULL;
+}